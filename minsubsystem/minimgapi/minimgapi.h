@@ -308,6 +308,64 @@ MINIMGAPI_API int AllocMinImage(
     MinImg *p_image,
     int     alignment IS_BY_DEFAULT(16));
 
+/**
+ * @brief   Specifies the file backing a memory-mapped image.
+ * @details The enum is used by @c AllocMappedMinImage().
+ */
+typedef enum {
+  MO_TEMPORARY, ///< An unnamed file removed with the image.
+  MO_CREATE,    ///< A named file created or truncated, kept after the image.
+  MO_OPEN       ///< An existing named file, with its contents.
+} MappingOption;
+
+/**
+ * @brief   Allocates an image in a memory-mapped file.
+ * @param   p_image     The image to be allocated.
+ * @param   p_file_name The name of the file (for @c MO_CREATE and @c MO_OPEN)
+ *                      or the directory to place a temporary file into (for
+ *                      @c MO_TEMPORARY, NULL for the system one).
+ * @param   mapping     Specifies the file (see @c #MappingOption).
+ * @param   alignment   Alignment for image rows, by default a memory page.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function works as @c AllocMinImage(), but the image data are backed by a
+ * file instead of the heap, so images larger than the physical memory can be
+ * processed, and an image created with @c MO_CREATE may be opened with
+ * @c MO_OPEN by another process to share the data without copying. The
+ * mapping is shared: changes are written to the file. An existing file must
+ * be at least as large as the image with the resulting stride. The image is
+ * deallocated with @c FreeMinImage().
+ * The function is not implemented on Windows.
+ */
+MINIMGAPI_API int AllocMappedMinImage(
+    MinImg        *p_image,
+    const char    *p_file_name,
+    MappingOption  mapping   IS_BY_DEFAULT(MO_TEMPORARY),
+    int            alignment IS_BY_DEFAULT(4096));
+
+/**
+ * @brief   Maps an image stored in a file without reading it.
+ * @param   p_image     The image with filled header fields to be mapped.
+ * @param   p_file_name The name of the file.
+ * @param   offset      The offset of the first image line in the file.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function maps the image data stored in the file as is, such as raw
+ * pixels or an uncompressed raster of an image file: line y starts at
+ * @c offset + y * @c p_image->stride bytes, where zero stride stands for the
+ * line size without padding. Nothing is read in advance, the lines are read
+ * from the file when accessed. The mapping is copy-on-write: the image may
+ * be modified, the changed lines are copied to private memory and the file
+ * itself is never changed. The image is released with @c FreeMinImage().
+ * The function is not implemented on Windows.
+ */
+MINIMGAPI_API int MapMinImageFile(
+    MinImg     *p_image,
+    const char *p_file_name,
+    int64_t     offset IS_BY_DEFAULT(0));
+
 /**
  * @brief   Deallocates an image.
  * @param   p_image The image to be deallocated.
@@ -1111,6 +1169,29 @@ MINIMGAPI_API int CopyMinImageFragment(
     int           width,
     int           height);
 
+/**
+ * @brief   Copies an image converting its elements to another type.
+ * @param   p_dst_image The destination image.
+ * @param   p_src_image The source image.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both source and destination images must have the same size and the
+ *          same number of channels. The supported element types are
+ *          @c TYP_UINT8, @c TYP_REAL16 and @c TYP_REAL32, the images of the
+ *          same type are just copied.
+ * @remarks The images must not overlap.
+ * @ingroup MinImgAPI_API
+ *
+ * The function converts the values numerically, so that 255 of a uint8 image
+ * becomes 255.0. Real values are converted to uint8 rounding half up with
+ * saturation and to half precision rounding to nearest even, values out of
+ * the half precision range becoming infinities. The half precision conversions
+ * use the F16C instructions if the processor supports them.
+*/
+MINIMGAPI_API int RetypifyMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image);
+
 /**
  * @brief   Flips an image around vertical or horizontal axis.
  * @param   p_dst_image The destination image.
@@ -1240,7 +1321,7 @@ MINIMGAPI_API int DeinterleaveMinImage(
  *
  * The function resamples an image in the sense of changing image sample rate.
  * The source image pixels are copied to destination one as whole entities,
- * with no interpolation.
+ * with no interpolation (see @c InterpolateMinImage()).
  */
 MINIMGAPI_API int ResampleMinImage(
     const MinImg *p_dst_image,
@@ -1248,6 +1329,363 @@ MINIMGAPI_API int ResampleMinImage(
     double        x_phase IS_BY_DEFAULT(0.5),
     double        y_phase IS_BY_DEFAULT(0.5));
 
+/**
+ * @brief   Specifies the way destination pixels are computed when an image is
+ *          resampled.
+ */
+typedef enum {
+  IO_NEAREST,   ///< The nearest source pixel (see @c ResampleMinImage()).
+  IO_BILINEAR,  ///< Bilinear interpolation of the four nearest source pixels.
+  IO_AREA       ///< Average of the source pixels covered by the destination
+                ///  one, weighted by the covered area.
+} InterpolationOption;
+
+/**
+ * @brief   Changes image sample rate with interpolation.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image   The source image.
+ * @param   interpolation The interpolation method (see @c #InterpolationOption).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both source and destination images must have the same format and
+ *          the same number of channels.
+ * @remarks @c IO_BILINEAR and @c IO_AREA are implemented for @c TYP_UINT8,
+ *          @c TYP_UINT16 and @c TYP_REAL32 images only.
+ * @ingroup MinImgAPI_API
+ *
+ * The function resamples an image so that pixel centers of the source and
+ * destination images are aligned. Channels are processed independently.
+ * @c IO_AREA is meant for downsampling (each source pixel contributes to the
+ * result), @c IO_BILINEAR for upsampling. Integer results are rounded to the
+ * nearest value.
+ */
+MINIMGAPI_API int InterpolateMinImage(
+    const MinImg        *p_dst_image,
+    const MinImg        *p_src_image,
+    InterpolationOption  interpolation);
+
+/**
+ * @brief   Specifies color spaces.
+ * @details The enum is used by @c ConvertMinImageColorSpace().
+ * @ingroup MinImgAPI_API
+ */
+typedef enum {
+  CS_RGB,        ///< sRGB.
+  CS_LINEAR_RGB, ///< Linear RGB with sRGB primaries.
+  CS_YCBCR,      ///< Full range BT.601 YCbCr (as in JPEG).
+  CS_HSV,        ///< Hue, saturation and value.
+  CS_LAB         ///< CIE L*a*b* for D65 white point.
+} ColorSpace;
+
+/**
+ * @brief   Converts an image from one color space to another.
+ * @param   p_dst_image The destination image.
+ * @param   p_src_image The source image.
+ * @param   dst_space   The color space of the destination image.
+ * @param   src_space   The color space of the source image.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both images must have 3 channels and the same size and type.
+ *          @c TYP_UINT8, @c TYP_UINT16 and @c TYP_REAL32 are supported.
+ * @ingroup MinImgAPI_API
+ *
+ * Real images keep natural values: R, G, B, Y in [0, 1], Cb and Cr in
+ * [-0.5, 0.5] shifted by 0.5, H in degrees [0, 360), S and V in [0, 1], L in
+ * [0, 100], a and b about [-128, 127]. Integer images keep the values scaled
+ * to the range of the type: R, G, B, Y, S and V multiplied by the maximal
+ * value, Cb and Cr shifted by the half of the range, H multiplied by
+ * max / 360, L by max / 100, a and b by max / 255 and shifted by 128 * max /
+ * 255, so 8-bit images match the conventions of OpenCV. The images may be the
+ * same (in-place conversion).
+ */
+MINIMGAPI_API int ConvertMinImageColorSpace(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    ColorSpace    dst_space,
+    ColorSpace    src_space IS_BY_DEFAULT(CS_RGB));
+
+/**
+ * @brief   Applies a projective transform to colors of an image.
+ * @param   p_dst_image The destination image.
+ * @param   p_src_image The source image.
+ * @param   p_matrix    The 4x4 transform matrix, row by row.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both images must have 3 channels and the same size and type.
+ *          @c TYP_UINT8, @c TYP_UINT16 and @c TYP_REAL32 are supported.
+ * @ingroup MinImgAPI_API
+ *
+ * The function multiplies the matrix by (c0, c1, c2, 1), where the channel
+ * values of integer images are divided by the maximal value of the type, and
+ * divides the first three coordinates of the result by the fourth one (unless
+ * it is almost zero). The images may be the same (in-place transform).
+ */
+MINIMGAPI_API int TransformMinImageColorsProjectively(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const double *p_matrix);
+
+/**
+ * @brief   Computes per-channel moments of an image.
+ * @param   p_count          The number of accounted pixels (may be NULL).
+ * @param   p_sums           The sums of channel values, one per channel (may
+ *                           be NULL).
+ * @param   p_cross_products The sums of products of channel values, the
+ *                           channels x channels matrix row by row (may be NULL).
+ * @param   p_image          The image.
+ * @param   p_mask           The mask (may be NULL).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks @c TYP_UINT8, @c TYP_UINT16 and @c TYP_REAL32 images are supported.
+ * @remarks The mask must be a one-channel @c TYP_UINT8 image of the same size;
+ *          only pixels with nonzero mask values are accounted.
+ * @ingroup MinImgAPI_API
+ *
+ * Integer images are accumulated in integers, so the results are exact while
+ * they are below 2^53. Moments of a region are computed for the region image
+ * returned by @c GetMinImageRegion().
+ */
+MINIMGAPI_API int GetMinImageMoments(
+    int64_t      *p_count,
+    double       *p_sums,
+    double       *p_cross_products,
+    const MinImg *p_image,
+    const MinImg *p_mask IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Computes per-channel moments of labeled regions of an image.
+ * @param   p_counts         The numbers of pixels of the labels (may be NULL).
+ * @param   p_sums           The sums of channel values, num_labels x channels
+ *                           (may be NULL).
+ * @param   p_cross_products The sums of products of channel values, num_labels
+ *                           x channels x channels (may be NULL).
+ * @param   p_image          The image.
+ * @param   p_labels         The label image.
+ * @param   num_labels       The number of labels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks @c TYP_UINT8, @c TYP_UINT16 and @c TYP_REAL32 images are supported.
+ * @remarks The label image must be a one-channel @c TYP_UINT8, @c TYP_UINT16
+ *          or @c TYP_INT32 image of the same size. Pixels with labels out of
+ *          [0, num_labels) are not accounted.
+ * @ingroup MinImgAPI_API
+ *
+ * The moments are accumulated in the same way as in @c GetMinImageMoments().
+ */
+MINIMGAPI_API int GetMinImageLabelMoments(
+    int64_t      *p_counts,
+    double       *p_sums,
+    double       *p_cross_products,
+    const MinImg *p_image,
+    const MinImg *p_labels,
+    int           num_labels);
+
+/**
+ * @brief   Computes per-channel histograms of an image.
+ * @param   p_histogram The histograms, channels x num_bins.
+ * @param   num_bins    The number of bins.
+ * @param   p_image     The image.
+ * @param   p_mask      The mask (may be NULL).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks @c TYP_UINT8 and @c TYP_UINT16 images are supported.
+ * @remarks The mask is used as in @c GetMinImageMoments().
+ * @ingroup MinImgAPI_API
+ *
+ * The value v of a n-bit image falls into the bin (v * num_bins) >> n, so
+ * num_bins must be in [1, 2^n].
+ */
+MINIMGAPI_API int GetMinImageHistogram(
+    int64_t      *p_histogram,
+    int           num_bins,
+    const MinImg *p_image,
+    const MinImg *p_mask IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Function executing one task of a parallel job.
+ * @param   p_context The job context.
+ * @param   task      0-based task number.
+ * @ingroup MinImgAPI_API
+ */
+typedef void (*MinTaskFunction)(void *p_context, int task);
+
+/**
+ * @brief   External thread pool for parallel operations.
+ * @details The structure describes a thread pool owned by the application.
+ *          @c run must call @c p_function(p_context, task) for every task in
+ *          [0, @c num_tasks) and return after all of them are finished; the
+ *          calling thread may take part in the execution.
+ * @ingroup MinImgAPI_API
+ */
+typedef struct {
+  void *p_pool;      ///< Pool handle passed to @c run.
+  int   num_threads; ///< The number of threads executing the tasks.
+  void (*run)(void            *p_pool,
+              MinTaskFunction  p_function,
+              void            *p_context,
+              int              num_tasks); ///< Executes a parallel job.
+} MinThreadPool;
+
+/**
+ * @brief   Sets the number of threads for parallel operations.
+ * @param   num_threads The number of threads, 0 for the number of hardware
+ *                      threads.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function starts (or stops) the internal thread pool used by row-parallel
+ * operations: @c CopyMinImage(), @c FlipMinImage(), @c TransposeMinImage(),
+ * @c RotateMinImageBy90(), @c CopyMinImageChannels(), @c InterleaveMinImages(),
+ * @c DeinterleaveMinImage() and @c ResampleMinImage(). The work is split into
+ * bands of rows of the destination image. By default the library works in the
+ * calling thread only (@c num_threads equal to 1). An external pool set with
+ * @c SetMinImageThreadPool() takes precedence over the internal one.
+ *
+ * The function must not be called while other threads run library functions.
+ */
+MINIMGAPI_API int SetMinImageThreadCount(
+    int num_threads);
+
+/**
+ * @brief   Sets an external thread pool for parallel operations.
+ * @param   p_pool The pool description or NULL to use the internal pool.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function makes the library run parallel operations on the specified
+ * pool (see @c SetMinImageThreadCount()). The structure is copied, the pool
+ * itself must outlive its use by the library.
+ *
+ * The function must not be called while other threads run library functions.
+ */
+MINIMGAPI_API int SetMinImageThreadPool(
+    const MinThreadPool *p_pool);
+
+/**
+ * @brief   Returns the number of threads used for parallel operations.
+ * @returns The number of threads (1 if operations are serial).
+ * @ingroup MinImgAPI_API
+ */
+MINIMGAPI_API int GetMinImageThreadCount(void);
+
+/**
+ * @brief   Sets the minimal size of an image processed in parallel.
+ * @param   min_bytes The minimal size of destination image data in bytes.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * Operations on smaller images are executed in the calling thread, since for
+ * them the overhead of waking up the threads exceeds the gain. The default
+ * value is 1 MiB.
+ */
+MINIMGAPI_API int SetMinImageParallelThreshold(
+    int min_bytes);
+
+/**
+ * @brief   Runs a parallel job on the thread pool of the library.
+ * @param   p_function The function executing one task.
+ * @param   p_context  The job context passed to @c p_function.
+ * @param   num_tasks  The number of tasks.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function calls @c p_function(p_context, task) for every task in
+ * [0, @c num_tasks) and returns after all of them are finished. The tasks run
+ * on the pool used by the row-parallel operations (see
+ * @c SetMinImageThreadCount()), or serially in the calling thread if there is
+ * no pool or the function is called from a parallel task. This lets other
+ * libraries (for instance, <b>MinImgIO</b>) share the threads with
+ * <b>MinImgAPI</b>.
+ */
+MINIMGAPI_API int RunMinImageTasks(
+    MinTaskFunction  p_function,
+    void            *p_context,
+    int              num_tasks);
+
+/**
+ * @brief   Specifies the instruction sets the vector kernels may use.
+ * @details The enum lists the instruction sets selected at run time in
+ *          addition to the one the library is compiled for (see
+ *          @c SetMinImageSimdLevel()). The results of the kernels are the same
+ *          for all the instruction sets.
+ * @ingroup MinImgAPI_API
+ */
+typedef enum {
+  SIMD_BASELINE = 0,  ///< The instruction set the library is compiled for.
+  SIMD_AVX2     = 1,  ///< Intel AVX2 (with F16C).
+  SIMD_AVX512   = 2   ///< Intel AVX-512 (F and BW subsets).
+} SimdLevel;
+
+/**
+ * @brief   Limits the instruction sets used by the vector kernels.
+ * @param   max_level The widest instruction set allowed (see @c #SimdLevel).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * By default the library uses the widest instruction set supported by the
+ * processor and the operating system. The limit is useful for benchmarking
+ * and for checking the kernels against each other.
+ */
+MINIMGAPI_API int SetMinImageSimdLevel(
+    int max_level);
+
+/**
+ * @brief   Returns the instruction set used by the vector kernels.
+ * @returns The widest instruction set supported by the processor and allowed
+ *          with @c SetMinImageSimdLevel() (see @c #SimdLevel).
+ * @ingroup MinImgAPI_API
+ */
+MINIMGAPI_API int GetMinImageSimdLevel(void);
+
+/**
+ * @brief   Statistics of the image buffer pool.
+ * @details The counters are accumulated since the start of the process (see
+ *          @c GetMinImageBufferPoolStats()).
+ * @ingroup MinImgAPI_API
+ */
+typedef struct {
+  int64_t hits;         ///< Allocations served with a pooled buffer.
+  int64_t misses;       ///< Allocations passed to the system allocator.
+  int64_t bytes_held;   ///< The size of free buffers kept by the pool.
+  int64_t buffers_held; ///< The number of free buffers kept by the pool.
+} MinImageBufferPoolStats;
+
+/**
+ * @brief   Enables pooling of image buffers.
+ * @param   max_bytes The maximal size of free buffers kept by the pool, 0 to
+ *                    disable the pool.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * With the pool enabled, @c FreeMinImage() keeps the buffer of the image for
+ * reuse by subsequent @c AllocMinImage() calls requesting buffers of about the
+ * same size and the same alignment, which saves page faults when a pipeline
+ * allocates similar temporary images over and over. Every thread keeps a few
+ * buffers it has freed for itself, the rest are shared. The pool is disabled
+ * by default.
+ */
+MINIMGAPI_API int SetMinImageBufferPoolCapacity(
+    int64_t max_bytes);
+
+/**
+ * @brief   Releases free buffers kept by the image buffer pool.
+ * @param   max_bytes The size of free buffers the pool may keep.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * Buffers kept by the calling thread and the shared ones are released at
+ * once. Other threads release their buffers on the next allocation or
+ * deallocation of an image or on exit.
+ */
+MINIMGAPI_API int TrimMinImageBufferPool(
+    int64_t max_bytes);
+
+/**
+ * @brief   Returns the statistics of the image buffer pool.
+ * @param   p_stats The statistics (see @c #MinImageBufferPoolStats).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ */
+MINIMGAPI_API int GetMinImageBufferPoolStats(
+    MinImageBufferPoolStats *p_stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,320 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include "buffer_pool.h"
+
+namespace {
+
+// Buffers of the same size class and alignment are interchangeable.
+typedef std::pair<size_t, int> BufferKey;
+
+// Every image buffer is preceded by a header, so that a buffer can be told to
+// belong to the pool without looking it up under a lock.
+struct BufferHeader {
+  BufferKey key;
+  bool      pooled;
+};
+
+const int min_header_size = 32;
+static_assert(sizeof(BufferHeader) <= min_header_size,
+              "The buffer header does not fit into its space");
+
+int GetHeaderSize(
+    int alignment) {
+  return std::max(alignment, min_header_size);
+}
+
+BufferHeader *GetBufferHeader(
+    uint8_t *p_buffer) {
+  return reinterpret_cast<BufferHeader *>(p_buffer - sizeof(BufferHeader));
+}
+
+uint8_t *AllocBufferMemory(
+    const BufferKey &key,
+    bool             pooled) {
+  const int header_size = GetHeaderSize(key.second);
+  uint8_t *p_memory = reinterpret_cast<uint8_t *>(
+      ::alignedmalloc(key.first + header_size, key.second));
+  if (!p_memory)
+    return 0;
+  uint8_t *p_buffer = p_memory + header_size;
+  BufferHeader *p_header = GetBufferHeader(p_buffer);
+  p_header->key = key;
+  p_header->pooled = pooled;
+  return p_buffer;
+}
+
+void FreeBufferMemory(
+    uint8_t *p_buffer) {
+  ::alignedfree(p_buffer -
+                GetHeaderSize(GetBufferHeader(p_buffer)->key.second));
+}
+
+// Rounds the size up so that it exceeds the requested one by at most 1/8.
+size_t GetSizeClass(
+    size_t size) {
+  size_t step = 64;
+  while (step * 16 <= size)
+    step <<= 1;
+  return (size + step - 1) & ~(step - 1);
+}
+
+// Free buffers are kept in small per-thread caches first, so that a thread
+// gets back the buffer it has just touched, and in the shared overflow
+// otherwise. Only the shared overflow is guarded by the mutex. Buffers
+// allocated before the pool was enabled are marked in their headers and are
+// never pooled.
+class BufferPool {
+ public:
+  BufferPool()
+      : capacity_(0), bytes_held_(0), buffers_held_(0), hits_(0), misses_(0),
+        generation_(0), trim_limit_(0) {}
+
+  bool Enabled() const {
+    return capacity_.load(std::memory_order_relaxed) > 0;
+  }
+
+  uint8_t *Acquire(size_t size, int alignment);
+  void Release(uint8_t *p_buffer);
+
+  void SetCapacity(int64_t capacity) {
+    capacity_ = capacity;
+    if (bytes_held_ > capacity)
+      Trim(capacity);
+  }
+
+  void Trim(int64_t max_bytes);
+
+  // Applies a pending trim to the cache of the calling thread.
+  void Collect() {
+    if (buffers_held_.load(std::memory_order_relaxed) > 0)
+      GetThreadCache();
+  }
+
+  void GetStats(MinImageBufferPoolStats *p_stats) const {
+    p_stats->hits = hits_;
+    p_stats->misses = misses_;
+    p_stats->bytes_held = bytes_held_;
+    p_stats->buffers_held = buffers_held_;
+  }
+
+ private:
+  struct ThreadCache;
+
+  static const size_t thread_cache_buffers = 4;
+
+  ThreadCache &GetThreadCache();
+  void FlushThreadCache(ThreadCache *p_cache);
+  void TrimShared(int64_t max_bytes);
+
+  std::mutex mutex_;
+  std::multimap<BufferKey, uint8_t *> shared_;
+
+  std::atomic<int64_t> capacity_;
+  std::atomic<int64_t> bytes_held_;
+  std::atomic<int64_t> buffers_held_;
+  std::atomic<int64_t> hits_;
+  std::atomic<int64_t> misses_;
+  // Incremented by Trim(), makes the threads flush their caches.
+  std::atomic<uint64_t> generation_;
+  std::atomic<int64_t> trim_limit_;
+};
+
+struct BufferPool::ThreadCache {
+  explicit ThreadCache(BufferPool *p_pool)
+      : p_pool(p_pool), generation(p_pool->generation_) {}
+
+  ~ThreadCache() {
+    p_pool->FlushThreadCache(this);
+    if (!p_pool->Enabled())
+      p_pool->TrimShared(0);
+  }
+
+  BufferPool *p_pool;
+  uint64_t generation;
+  std::vector<std::pair<BufferKey, uint8_t *> > buffers;
+};
+
+// The pool is never destroyed: images may be freed by static destructors.
+BufferPool &GetBufferPool() {
+  static BufferPool *p_pool = new BufferPool;
+  return *p_pool;
+}
+
+BufferPool::ThreadCache &BufferPool::GetThreadCache() {
+  thread_local ThreadCache cache(this);
+  if (cache.generation != generation_) {
+    cache.generation = generation_;
+    FlushThreadCache(&cache);
+    TrimShared(trim_limit_);
+  }
+  return cache;
+}
+
+void BufferPool::FlushThreadCache(
+    ThreadCache *p_cache) {
+  if (p_cache->buffers.empty())
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < p_cache->buffers.size(); ++i)
+    shared_.insert(p_cache->buffers[i]);
+  p_cache->buffers.clear();
+}
+
+void BufferPool::TrimShared(
+    int64_t max_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Larger buffers are released first.
+  while (bytes_held_ > max_bytes && !shared_.empty()) {
+    std::multimap<BufferKey, uint8_t *>::iterator it = --shared_.end();
+    bytes_held_ -= it->first.first;
+    --buffers_held_;
+    FreeBufferMemory(it->second);
+    shared_.erase(it);
+  }
+}
+
+uint8_t *BufferPool::Acquire(
+    size_t size,
+    int    alignment) {
+  const BufferKey key(GetSizeClass(size), alignment);
+  uint8_t *p_buffer = 0;
+
+  ThreadCache &cache = GetThreadCache();
+  for (size_t i = cache.buffers.size(); i-- > 0; )
+    if (cache.buffers[i].first == key) {
+      p_buffer = cache.buffers[i].second;
+      cache.buffers.erase(cache.buffers.begin() + i);
+      break;
+    }
+
+  if (!p_buffer && buffers_held_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::multimap<BufferKey, uint8_t *>::iterator it = shared_.find(key);
+    if (it != shared_.end()) {
+      p_buffer = it->second;
+      shared_.erase(it);
+    }
+  }
+
+  if (p_buffer) {
+    ++hits_;
+    bytes_held_ -= key.first;
+    --buffers_held_;
+    return p_buffer;
+  }
+  ++misses_;
+  return AllocBufferMemory(key, true);
+}
+
+void BufferPool::Release(
+    uint8_t *p_buffer) {
+  const BufferKey key = GetBufferHeader(p_buffer)->key;
+  if (bytes_held_ + static_cast<int64_t>(key.first) > capacity_) {
+    FreeBufferMemory(p_buffer);
+    return;
+  }
+  bytes_held_ += key.first;
+  ++buffers_held_;
+
+  ThreadCache &cache = GetThreadCache();
+  cache.buffers.push_back(std::make_pair(key, p_buffer));
+  if (cache.buffers.size() > thread_cache_buffers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shared_.insert(cache.buffers.front());
+    cache.buffers.erase(cache.buffers.begin());
+  }
+}
+
+void BufferPool::Trim(
+    int64_t max_bytes) {
+  trim_limit_ = max_bytes;
+  ++generation_;
+  FlushThreadCache(&GetThreadCache());
+  TrimShared(max_bytes);
+}
+
+} // namespace
+
+uint8_t *AllocImageBuffer(
+    size_t size,
+    int    alignment) {
+  BufferPool &pool = GetBufferPool();
+  if (pool.Enabled())
+    return pool.Acquire(size, alignment);
+  pool.Collect();
+  return AllocBufferMemory(BufferKey(size, alignment), false);
+}
+
+void FreeImageBuffer(
+    uint8_t *p_buffer) {
+  BufferPool &pool = GetBufferPool();
+  if (GetBufferHeader(p_buffer)->pooled) {
+    pool.Release(p_buffer);
+    return;
+  }
+  pool.Collect();
+  FreeBufferMemory(p_buffer);
+}
+
+MINIMGAPI_API int SetMinImageBufferPoolCapacity(
+    int64_t max_bytes) {
+  if (max_bytes < 0)
+    return BAD_ARGS;
+  GetBufferPool().SetCapacity(max_bytes);
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int TrimMinImageBufferPool(
+    int64_t max_bytes) {
+  if (max_bytes < 0)
+    return BAD_ARGS;
+  GetBufferPool().Trim(max_bytes);
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int GetMinImageBufferPoolStats(
+    MinImageBufferPoolStats *p_stats) {
+  if (!p_stats)
+    return BAD_ARGS;
+  GetBufferPool().GetStats(p_stats);
+  return NO_ERRORS;
+}
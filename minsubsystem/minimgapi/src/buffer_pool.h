@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_BUFFER_POOL_H_INCLUDED
+#define MINIMGAPI_SRC_BUFFER_POOL_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Allocates an image buffer of at least size bytes aligned to alignment. The
+ * buffer is taken from the buffer pool if it is enabled (see
+ * SetMinImageBufferPoolCapacity()). Returns NULL if there is no memory.
+ */
+uint8_t *AllocImageBuffer(
+    size_t size,
+    int    alignment);
+
+/**
+ * Frees a buffer allocated with AllocImageBuffer() or returns it to the pool.
+ */
+void FreeImageBuffer(
+    uint8_t *p_buffer);
+
+#endif // #ifndef MINIMGAPI_SRC_BUFFER_POOL_H_INCLUDED
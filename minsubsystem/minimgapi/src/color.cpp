@@ -0,0 +1,526 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/smartptr.h>
+#include "vector/color-inl.h"
+#include "parallel.h"
+
+namespace {
+
+// Pixels are converted by chunks of planar float channels.
+const int color_chunk_len = 256;
+
+// Channel values are stored as natural * scale + offset, where natural values
+// are the ones described in ConvertMinImageColorSpace().
+struct ColorCoding {
+  float scale[3];
+  float offset[3];
+};
+
+ColorCoding GetColorCoding(
+    ColorSpace space,
+    MinTyp     type) {
+  const bool is_integer = type != TYP_REAL32;
+  const float max_value = type == TYP_UINT8 ? 255.f :
+                          type == TYP_UINT16 ? 65535.f : 1.f;
+  ColorCoding coding = {{max_value, max_value, max_value}, {0.f, 0.f, 0.f}};
+  switch (space) {
+    case CS_YCBCR:
+      coding.offset[1] = coding.offset[2] =
+          is_integer ? (max_value + 1.f) / 2.f : 0.5f;
+      break;
+    case CS_HSV:
+      if (is_integer)
+        coding.scale[0] = max_value / 360.f;
+      else
+        coding.scale[0] = 1.f;
+      break;
+    case CS_LAB:
+      if (is_integer) {
+        coding.scale[0] = max_value / 100.f;
+        coding.scale[1] = coding.scale[2] = max_value / 255.f;
+        coding.offset[1] = coding.offset[2] = 128.f * max_value / 255.f;
+      } else {
+        coding.scale[0] = coding.scale[1] = coding.scale[2] = 1.f;
+      }
+      break;
+    default:
+      break;
+  }
+  return coding;
+}
+
+float SrgbToLinear(
+    float value) {
+  return value <= 0.04045f ? value / 12.92f :
+                             std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(
+    float value) {
+  return value <= 0.0031308f ? value * 12.92f :
+                               1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+}
+
+// The sRGB transfer functions tabulated on [0, 1] for linear interpolation.
+// The step is fine enough for 16-bit results.
+class GammaTables {
+ public:
+  static const int size = 1 << 14;
+
+  GammaTables() : decode_(size + 1), encode_(size + 1) {
+    for (int i = 0; i <= size; ++i) {
+      decode_[i] = SrgbToLinear(static_cast<float>(i) / size);
+      encode_[i] = LinearToSrgb(static_cast<float>(i) / size);
+    }
+  }
+
+  void Decode(float *p_values, int len) const {
+    Apply(p_values, len, decode_.data(), &SrgbToLinear);
+  }
+
+  void Encode(float *p_values, int len) const {
+    Apply(p_values, len, encode_.data(), &LinearToSrgb);
+  }
+
+ private:
+  static void Apply(float *p_values, int len, const float *p_table,
+                    float (*p_function)(float)) {
+    for (int i = 0; i < len; ++i) {
+      const float value = p_values[i];
+      if (!(value > 0.f && value < 1.f)) {
+        p_values[i] = p_function(value);
+        continue;
+      }
+      const float position = value * size;
+      const int index = static_cast<int>(position);
+      const float weight = position - index;
+      p_values[i] = p_table[index] + (p_table[index + 1] - p_table[index]) *
+                                     weight;
+    }
+  }
+
+  std::vector<float> decode_;
+  std::vector<float> encode_;
+};
+
+const GammaTables &GetGammaTables() {
+  static const GammaTables tables;
+  return tables;
+}
+
+// Full range BT.601 (JPEG) matrices, Cb and Cr are centered at zero.
+const float rgb_to_ycbcr[12] = {
+   0.299f,     0.587f,     0.114f,    0.f,
+  -0.168736f, -0.331264f,  0.5f,      0.f,
+   0.5f,      -0.418688f, -0.081312f, 0.f};
+const float ycbcr_to_rgb[12] = {
+  1.f,  0.f,        1.402f,    0.f,
+  1.f, -0.344136f, -0.714136f, 0.f,
+  1.f,  1.772f,     0.f,       0.f};
+
+// Linear sRGB to XYZ normalized by the D65 white point, and back.
+const float linear_rgb_to_xyz[12] = {
+  0.412453f / 0.950456f, 0.357580f / 0.950456f, 0.180423f / 0.950456f, 0.f,
+  0.212671f,             0.715160f,             0.072169f,             0.f,
+  0.019334f / 1.088754f, 0.119193f / 1.088754f, 0.950227f / 1.088754f, 0.f};
+const float xyz_to_linear_rgb[12] = {
+   3.240479f * 0.950456f, -1.537150f, -0.498535f * 1.088754f, 0.f,
+  -0.969256f * 0.950456f,  1.875991f,  0.041556f * 1.088754f, 0.f,
+   0.055648f * 0.950456f, -0.204043f,  1.057311f * 1.088754f, 0.f};
+
+void ConvertRgbToHsv(
+    float *p_c0,
+    float *p_c1,
+    float *p_c2,
+    int    len) {
+  for (int i = 0; i < len; ++i) {
+    const float r = p_c0[i], g = p_c1[i], b = p_c2[i];
+    const float v = std::max(r, std::max(g, b));
+    const float delta = v - std::min(r, std::min(g, b));
+    float h = 0.f;
+    if (delta > 0.f) {
+      if (v == r)
+        h = 60.f * (g - b) / delta;
+      else if (v == g)
+        h = 120.f + 60.f * (b - r) / delta;
+      else
+        h = 240.f + 60.f * (r - g) / delta;
+      if (h < 0.f)
+        h += 360.f;
+    }
+    p_c0[i] = h;
+    p_c1[i] = v > 0.f ? delta / v : 0.f;
+    p_c2[i] = v;
+  }
+}
+
+void ConvertHsvToRgb(
+    float *p_c0,
+    float *p_c1,
+    float *p_c2,
+    int    len) {
+  for (int i = 0; i < len; ++i) {
+    const float h = p_c0[i] / 60.f, s = p_c1[i], v = p_c2[i];
+    const float sector = std::floor(h);
+    const float f = h - sector;
+    const float p = v * (1.f - s);
+    const float q = v * (1.f - s * f);
+    const float t = v * (1.f - s * (1.f - f));
+    float r = v, g = t, b = p;
+    switch ((static_cast<int>(sector) % 6 + 6) % 6) {
+      case 1: r = q; g = v; b = p; break;
+      case 2: r = p; g = v; b = t; break;
+      case 3: r = p; g = q; b = v; break;
+      case 4: r = t; g = p; b = v; break;
+      case 5: r = v; g = p; b = q; break;
+      default: break;
+    }
+    p_c0[i] = r;
+    p_c1[i] = g;
+    p_c2[i] = b;
+  }
+}
+
+float LabF(
+    float t) {
+  return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.f / 116.f;
+}
+
+float LabInverseF(
+    float f) {
+  return f > 0.206893f ? f * f * f : (f - 16.f / 116.f) / 7.787f;
+}
+
+void ConvertLinearRgbToLab(
+    float *p_c0,
+    float *p_c1,
+    float *p_c2,
+    int    len) {
+  vector_transform_colors(p_c0, p_c1, p_c2, len, linear_rgb_to_xyz);
+  for (int i = 0; i < len; ++i) {
+    const float fx = LabF(p_c0[i]), fy = LabF(p_c1[i]), fz = LabF(p_c2[i]);
+    p_c0[i] = 116.f * fy - 16.f;
+    p_c1[i] = 500.f * (fx - fy);
+    p_c2[i] = 200.f * (fy - fz);
+  }
+}
+
+void ConvertLabToLinearRgb(
+    float *p_c0,
+    float *p_c1,
+    float *p_c2,
+    int    len) {
+  for (int i = 0; i < len; ++i) {
+    const float fy = (p_c0[i] + 16.f) / 116.f;
+    p_c0[i] = LabInverseF(fy + p_c1[i] / 500.f);
+    p_c1[i] = LabInverseF(fy);
+    p_c2[i] = LabInverseF(fy - p_c2[i] / 200.f);
+  }
+  vector_transform_colors(p_c0, p_c1, p_c2, len, xyz_to_linear_rgb);
+}
+
+bool UsesLinearRgb(
+    ColorSpace space) {
+  return space == CS_LINEAR_RGB || space == CS_LAB;
+}
+
+// Converts natural values between color spaces through RGB.
+struct ColorSpaceConverter {
+  ColorSpace dst_space;
+  ColorSpace src_space;
+
+  void operator()(float *p_c0, float *p_c1, float *p_c2, int len) const {
+    const GammaTables &gamma = GetGammaTables();
+    const bool linear = UsesLinearRgb(dst_space);
+    switch (src_space) {
+      case CS_YCBCR:
+        vector_transform_colors(p_c0, p_c1, p_c2, len, ycbcr_to_rgb);
+        break;
+      case CS_HSV:
+        ConvertHsvToRgb(p_c0, p_c1, p_c2, len);
+        break;
+      case CS_LAB:
+        ConvertLabToLinearRgb(p_c0, p_c1, p_c2, len);
+        break;
+      default:
+        break;
+    }
+    if (UsesLinearRgb(src_space) && !linear) {
+      gamma.Encode(p_c0, len);
+      gamma.Encode(p_c1, len);
+      gamma.Encode(p_c2, len);
+    } else if (!UsesLinearRgb(src_space) && linear) {
+      gamma.Decode(p_c0, len);
+      gamma.Decode(p_c1, len);
+      gamma.Decode(p_c2, len);
+    }
+    switch (dst_space) {
+      case CS_YCBCR:
+        vector_transform_colors(p_c0, p_c1, p_c2, len, rgb_to_ycbcr);
+        break;
+      case CS_HSV:
+        ConvertRgbToHsv(p_c0, p_c1, p_c2, len);
+        break;
+      case CS_LAB:
+        ConvertLinearRgbToLab(p_c0, p_c1, p_c2, len);
+        break;
+      default:
+        break;
+    }
+  }
+};
+
+struct ProjectiveConverter {
+  float matrix[16];
+
+  void operator()(float *p_c0, float *p_c1, float *p_c2, int len) const {
+    vector_project_colors(p_c0, p_c1, p_c2, len, matrix, 1e-5f);
+  }
+};
+
+template <typename T>
+void LoadColors(
+    float             **pp_channels,
+    const T            *p_src,
+    int                 len,
+    const ColorCoding  &coding,
+    const float        * /*p_table*/) {
+  for (int c = 0; c < 3; ++c) {
+    const float scale = 1.f / coding.scale[c];
+    const float offset = coding.offset[c];
+    float *p_channel = pp_channels[c];
+    for (int i = 0; i < len; ++i)
+      p_channel[i] = (p_src[3 * i + c] - offset) * scale;
+  }
+}
+
+template <>
+void LoadColors(
+    float             **pp_channels,
+    const uint8_t      *p_src,
+    int                 len,
+    const ColorCoding  & /*coding*/,
+    const float        *p_table) {
+  for (int c = 0; c < 3; ++c) {
+    const float *p_channel_table = p_table + 256 * c;
+    float *p_channel = pp_channels[c];
+    for (int i = 0; i < len; ++i)
+      p_channel[i] = p_channel_table[p_src[3 * i + c]];
+  }
+}
+
+template <typename T>
+void StoreColors(
+    T                  *p_dst,
+    float *const       *pp_channels,
+    int                 len,
+    const ColorCoding  &coding) {
+  const float max_value = static_cast<float>(std::numeric_limits<T>::max());
+  for (int c = 0; c < 3; ++c) {
+    const float scale = coding.scale[c];
+    const float offset = coding.offset[c] + 0.5f;
+    const float *p_channel = pp_channels[c];
+    for (int i = 0; i < len; ++i) {
+      // Written so that NaN, which fails every comparison, is stored as 0.
+      const float value = p_channel[i] * scale + offset;
+      p_dst[3 * i + c] = static_cast<T>(
+          value > 0.f ? std::min(value, max_value + 0.5f) : 0.f);
+    }
+  }
+}
+
+template <>
+void StoreColors(
+    float              *p_dst,
+    float *const       *pp_channels,
+    int                 len,
+    const ColorCoding  &coding) {
+  for (int c = 0; c < 3; ++c) {
+    const float scale = coding.scale[c];
+    const float offset = coding.offset[c];
+    const float *p_channel = pp_channels[c];
+    for (int i = 0; i < len; ++i)
+      p_dst[3 * i + c] = p_channel[i] * scale + offset;
+  }
+}
+
+template <typename T, typename TConverter>
+int ConvertColorRows(
+    const MinImg      *p_dst_image,
+    const MinImg      *p_src_image,
+    int                y_begin,
+    int                y_end,
+    const ColorCoding &dst_coding,
+    const ColorCoding &src_coding,
+    const float       *p_table,
+    const TConverter  &convert) {
+  MIN_ALIGNED(16) float channels[3][color_chunk_len];
+  float *pp_channels[3] = {channels[0], channels[1], channels[2]};
+  for (int y = y_begin; y < y_end; ++y) {
+    T *p_dst_line = reinterpret_cast<T *>(_GetMinImageLine(p_dst_image, y));
+    const T *p_src_line = reinterpret_cast<const T *>(
+                                             _GetMinImageLine(p_src_image, y));
+    if (!p_dst_line || !p_src_line)
+      return INTERNAL_ERROR;
+    for (int x = 0; x < p_dst_image->width; x += color_chunk_len) {
+      const int len = std::min(color_chunk_len, p_dst_image->width - x);
+      LoadColors(pp_channels, p_src_line + 3 * x, len, src_coding, p_table);
+      convert(channels[0], channels[1], channels[2], len);
+      StoreColors(p_dst_line + 3 * x, pp_channels, len, dst_coding);
+    }
+  }
+  return NO_ERRORS;
+}
+
+template <typename T, typename TConverter>
+int ConvertColors(
+    const MinImg      *p_dst_image,
+    const MinImg      *p_src_image,
+    const ColorCoding &dst_coding,
+    const ColorCoding &src_coding,
+    const TConverter  &convert) {
+  // 8-bit values are decoded with a table.
+  std::vector<float> table;
+  if (sizeof(T) == 1) {
+    table.resize(3 * 256);
+    for (int c = 0; c < 3; ++c)
+      for (int i = 0; i < 256; ++i)
+        table[256 * c + i] = (i - src_coding.offset[c]) / src_coding.scale[c];
+  }
+  const float *p_table = table.empty() ? 0 : table.data();
+
+  int num_bands = GetParallelBandCount(
+      static_cast<int64_t>(p_dst_image->height) *
+      _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+  if (num_bands > 1)
+    return ParallelForBands(num_bands, p_dst_image->height, 1,
+                            [&](int y_begin, int y_end) -> int {
+      return ConvertColorRows<T>(p_dst_image, p_src_image, y_begin, y_end,
+                                 dst_coding, src_coding, p_table, convert);
+    });
+  return ConvertColorRows<T>(p_dst_image, p_src_image, 0, p_dst_image->height,
+                             dst_coding, src_coding, p_table, convert);
+}
+
+// Checks the images, makes a copy of the source if it overlaps the
+// destination other than in place and runs the conversion for the image type.
+template <typename TConverter>
+int ConvertMinImageColors(
+    const MinImg      *p_dst_image,
+    const MinImg      *p_src_image,
+    const ColorCoding &dst_coding,
+    const ColorCoding &src_coding,
+    const TConverter  &convert) {
+  if (p_dst_image->channels != 3)
+    return BAD_ARGS;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace || p_src_image->addressSpace)
+    return NOT_IMPLEMENTED;
+
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  DECLARE_GUARDED_MINIMG(tmp_image);
+  if (tangling != TCR_INDEPENDENT_IMAGES && tangling != TCR_SAME_IMAGE) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(&tmp_image, p_src_image));
+    PROPAGATE_ERROR(CopyMinImage(&tmp_image, p_src_image));
+    p_src_image = &tmp_image;
+  }
+
+  switch (_GetMinImageType(p_dst_image)) {
+    case TYP_UINT8:
+      return ConvertColors<uint8_t>(p_dst_image, p_src_image,
+                                    dst_coding, src_coding, convert);
+    case TYP_UINT16:
+      return ConvertColors<uint16_t>(p_dst_image, p_src_image,
+                                     dst_coding, src_coding, convert);
+    case TYP_REAL32:
+      return ConvertColors<float>(p_dst_image, p_src_image,
+                                  dst_coding, src_coding, convert);
+    default:
+      return NOT_IMPLEMENTED;
+  }
+}
+
+} // namespace
+
+MINIMGAPI_API int ConvertMinImageColorSpace(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    ColorSpace    dst_space,
+    ColorSpace    src_space) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImagePrototypes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  if (dst_space < CS_RGB || dst_space > CS_LAB ||
+      src_space < CS_RGB || src_space > CS_LAB)
+    return BAD_ARGS;
+  if (dst_space == src_space)
+    return CopyMinImage(p_dst_image, p_src_image);
+
+  const MinTyp type = static_cast<MinTyp>(_GetMinImageType(p_dst_image));
+  ColorSpaceConverter convert = {dst_space, src_space};
+  return ConvertMinImageColors(p_dst_image, p_src_image,
+                               GetColorCoding(dst_space, type),
+                               GetColorCoding(src_space, type), convert);
+}
+
+MINIMGAPI_API int TransformMinImageColorsProjectively(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const double *p_matrix) {
+  if (!p_matrix)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImagePrototypes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+
+  ProjectiveConverter convert;
+  for (int i = 0; i < 16; ++i)
+    convert.matrix[i] = static_cast<float>(p_matrix[i]);
+  const ColorCoding coding = GetColorCoding(
+      CS_RGB, static_cast<MinTyp>(_GetMinImageType(p_dst_image)));
+  return ConvertMinImageColors(p_dst_image, p_src_image, coding, coding,
+                               convert);
+}
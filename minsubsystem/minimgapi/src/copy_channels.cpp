@@ -29,6 +29,8 @@ of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of copyright holders.
 */
 
+#include <algorithm>
+#include <vector>
 #include <minbase/minresult.h>
 #include <minimgapi/minimgapi.h>
 #include <minimgapi/minimgapi-inl.h>
@@ -36,6 +38,225 @@ either expressed or implied, of copyright holders.
 #include <minbase/crossplat.h>
 #include <minutils/smartptr.h>
 #include "vector/copy_channels-inl.h"
+#include "copy_channels.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_CopyMinImageChannels, "CopyMinImageChannels");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Pixels are split into planes by chunks of this length.
+static const int planar_chunk_len = 256;
+
+template <typename TChannel>
+struct PlanarKernels {
+  void (*deinterleave3)(TChannel *const *, const TChannel *, int);
+  void (*deinterleave4)(TChannel *const *, const TChannel *, int);
+  void (*interleave3)(TChannel *, const TChannel *const *, int);
+  void (*interleave4)(TChannel *, const TChannel *const *, int);
+};
+
+template <typename TChannel>
+static PlanarKernels<TChannel> GetPlanarKernels() {
+  PlanarKernels<TChannel> kernels = {
+      vector_deinterleave_3to1<TChannel>, vector_deinterleave_4to1<TChannel>,
+      vector_interleave_1to3<TChannel>, vector_interleave_1to4<TChannel>};
+#if defined(MINIMGAPI_WITH_AVX)
+  if (GetMinImageSimdLevel() >= SIMD_AVX2) {
+    kernels.deinterleave3 = vector_deinterleave_3to1_avx2<TChannel>;
+    kernels.deinterleave4 = vector_deinterleave_4to1_avx2<TChannel>;
+    kernels.interleave3 = vector_interleave_1to3_avx2<TChannel>;
+    kernels.interleave4 = vector_interleave_1to4_avx2<TChannel>;
+  }
+#endif // defined(MINIMGAPI_WITH_AVX)
+  return kernels;
+}
+
+template <typename TChannel>
+static void SplitChannels(
+    TChannel *const               *pp_planes,
+    const TChannel                *p_src,
+    int                            channels,
+    int                            len,
+    const PlanarKernels<TChannel> &kernels) {
+  if (channels == 3)
+    kernels.deinterleave3(pp_planes, p_src, len);
+  else if (channels == 4)
+    kernels.deinterleave4(pp_planes, p_src, len);
+  else
+    generic_vector_deinterleave(pp_planes, p_src, channels, len);
+}
+
+template <typename TChannel>
+static void MergeChannels(
+    TChannel                      *p_dst,
+    const TChannel *const         *pp_planes,
+    int                            channels,
+    int                            len,
+    const PlanarKernels<TChannel> &kernels) {
+  if (channels == 3)
+    kernels.interleave3(p_dst, pp_planes, len);
+  else if (channels == 4)
+    kernels.interleave4(p_dst, pp_planes, len);
+  else
+    generic_vector_interleave(p_dst, pp_planes, channels, len);
+}
+
+// Splits the pixels of both images into planes by chunks, replaces the
+// destination planes with the source ones and merges them back. The
+// destination is split only if some of its channels are kept. The images must
+// be either independent or the same.
+template <typename TChannel>
+static int CopyMinImageChannelsByPlanes(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const int    *p_dst_channels,
+    const int    *p_src_channels,
+    int           num_channels) {
+  const int dst_channels = p_dst_image->channels;
+  const int src_channels = p_src_image->channels;
+  std::vector<char> copied(dst_channels, 0);
+  for (int i = 0; i < num_channels; ++i)
+    copied[p_dst_channels[i]] = 1;
+  const bool split_dst = std::count(copied.begin(), copied.end(), 1) <
+                         dst_channels;
+
+  std::vector<TChannel> buffer(planar_chunk_len *
+                               (src_channels + (split_dst ? dst_channels : 0)));
+  std::vector<TChannel *> src_planes(src_channels);
+  for (int c = 0; c < src_channels; ++c)
+    src_planes[c] = &buffer[c * planar_chunk_len];
+  std::vector<TChannel *> dst_planes(dst_channels);
+  if (split_dst)
+    for (int c = 0; c < dst_channels; ++c)
+      dst_planes[c] = &buffer[(src_channels + c) * planar_chunk_len];
+  std::vector<const TChannel *> merged_planes(dst_planes.begin(),
+                                              dst_planes.end());
+
+  const PlanarKernels<TChannel> kernels = GetPlanarKernels<TChannel>();
+  for (int y = 0; y < p_dst_image->height; ++y) {
+    TChannel *p_dst_line = reinterpret_cast<TChannel *>(
+                                             _GetMinImageLine(p_dst_image, y));
+    const TChannel *p_src_line = reinterpret_cast<const TChannel *>(
+                                             _GetMinImageLine(p_src_image, y));
+    if (!p_dst_line || !p_src_line)
+      return INTERNAL_ERROR;
+    for (int x = 0; x < p_dst_image->width; x += planar_chunk_len) {
+      const int len = std::min(planar_chunk_len, p_dst_image->width - x);
+      SplitChannels(&src_planes[0], p_src_line + x * src_channels,
+                    src_channels, len, kernels);
+      if (split_dst)
+        SplitChannels(&dst_planes[0], p_dst_line + x * dst_channels,
+                      dst_channels, len, kernels);
+      for (int i = 0; i < num_channels; ++i)
+        merged_planes[p_dst_channels[i]] = src_planes[p_src_channels[i]];
+      MergeChannels(p_dst_line + x * dst_channels, &merged_planes[0],
+                    dst_channels, len, kernels);
+      for (int c = 0; c < dst_channels; ++c)
+        merged_planes[c] = dst_planes[c];
+    }
+  }
+  return NO_ERRORS;
+}
+
+template <typename TChannel>
+static int InterleaveMinImageLines(
+    const MinImg        *p_dst_image,
+    const MinImg *const *p_p_src_images,
+    int                  num_src_images) {
+  std::vector<const TChannel *> planes(num_src_images);
+  const PlanarKernels<TChannel> kernels = GetPlanarKernels<TChannel>();
+  for (int y = 0; y < p_dst_image->height; ++y) {
+    TChannel *p_dst_line = reinterpret_cast<TChannel *>(
+                                             _GetMinImageLine(p_dst_image, y));
+    if (!p_dst_line)
+      return INTERNAL_ERROR;
+    for (int i = 0; i < num_src_images; ++i)
+      if (!(planes[i] = reinterpret_cast<const TChannel *>(
+                                     _GetMinImageLine(p_p_src_images[i], y))))
+        return INTERNAL_ERROR;
+    MergeChannels(p_dst_line, &planes[0], num_src_images, p_dst_image->width,
+                  kernels);
+  }
+  return NO_ERRORS;
+}
+
+template <typename TChannel>
+static int DeinterleaveMinImageLines(
+    const MinImg *const *p_p_dst_images,
+    const MinImg        *p_src_image,
+    int                  num_dst_images) {
+  std::vector<TChannel *> planes(num_dst_images);
+  const PlanarKernels<TChannel> kernels = GetPlanarKernels<TChannel>();
+  for (int y = 0; y < p_src_image->height; ++y) {
+    const TChannel *p_src_line = reinterpret_cast<const TChannel *>(
+                                             _GetMinImageLine(p_src_image, y));
+    if (!p_src_line)
+      return INTERNAL_ERROR;
+    for (int i = 0; i < num_dst_images; ++i)
+      if (!(planes[i] = reinterpret_cast<TChannel *>(
+                                     _GetMinImageLine(p_p_dst_images[i], y))))
+        return INTERNAL_ERROR;
+    SplitChannels(&planes[0], p_src_line, num_dst_images, p_src_image->width,
+                  kernels);
+  }
+  return NO_ERRORS;
+}
+
+int InterleaveMinImagePlanes(
+    const MinImg        *p_dst_image,
+    const MinImg *const *p_p_src_images,
+    int                  num_src_images) {
+  if (p_dst_image->addressSpace)
+    return NOT_IMPLEMENTED;
+  for (int i = 0; i < num_src_images; ++i)
+    if (p_p_src_images[i]->channels != 1 || p_p_src_images[i]->addressSpace)
+      return NOT_IMPLEMENTED;
+  switch (p_dst_image->channelDepth) {
+    case 1:
+      return InterleaveMinImageLines<uint8_t>(p_dst_image, p_p_src_images,
+                                              num_src_images);
+    case 2:
+      return InterleaveMinImageLines<uint16_t>(p_dst_image, p_p_src_images,
+                                               num_src_images);
+    case 4:
+      return InterleaveMinImageLines<uint32_t>(p_dst_image, p_p_src_images,
+                                               num_src_images);
+    case 8:
+      return InterleaveMinImageLines<uint64_t>(p_dst_image, p_p_src_images,
+                                               num_src_images);
+    default:
+      return NOT_IMPLEMENTED;
+  }
+}
+
+int DeinterleaveMinImagePlanes(
+    const MinImg *const *p_p_dst_images,
+    const MinImg        *p_src_image,
+    int                  num_dst_images) {
+  if (p_src_image->addressSpace)
+    return NOT_IMPLEMENTED;
+  for (int i = 0; i < num_dst_images; ++i)
+    if (p_p_dst_images[i]->channels != 1 || p_p_dst_images[i]->addressSpace)
+      return NOT_IMPLEMENTED;
+  switch (p_src_image->channelDepth) {
+    case 1:
+      return DeinterleaveMinImageLines<uint8_t>(p_p_dst_images, p_src_image,
+                                                num_dst_images);
+    case 2:
+      return DeinterleaveMinImageLines<uint16_t>(p_p_dst_images, p_src_image,
+                                                 num_dst_images);
+    case 4:
+      return DeinterleaveMinImageLines<uint32_t>(p_p_dst_images, p_src_image,
+                                                 num_dst_images);
+    case 8:
+      return DeinterleaveMinImageLines<uint64_t>(p_p_dst_images, p_src_image,
+                                                 num_dst_images);
+    default:
+      return NOT_IMPLEMENTED;
+  }
+}
 
 template <typename TChannel>
 static int DeinterleaveMinImage4To3(
@@ -74,8 +295,19 @@ static int DeinterleaveMinImage4To3(
                                          _GetMinImageLine(p_work_src_image, 0));
   if (!p_dst_line || !p_src_line)
     return INTERNAL_ERROR;
+
+  void (*deinterleave)(TChannel *, const TChannel *, int) =
+      vector_deinterleave_4to3<TChannel>;
+#if defined(MINIMGAPI_WITH_AVX)
+  const int simd_level = GetMinImageSimdLevel();
+  if (simd_level >= SIMD_AVX512)
+    deinterleave = vector_deinterleave_4to3_avx512<TChannel>;
+  else if (simd_level >= SIMD_AVX2)
+    deinterleave = vector_deinterleave_4to3_avx2<TChannel>;
+#endif // defined(MINIMGAPI_WITH_AVX)
+
   for (int y = 0; y < p_work_dst_image->height; ++y) {
-    vector_deinterleave_4to3(p_dst_line, p_src_line, p_work_dst_image->width);
+    deinterleave(p_dst_line, p_src_line, p_work_dst_image->width);
     p_dst_line = ShiftPtr(p_dst_line, p_work_dst_image->stride);
     p_src_line = ShiftPtr(p_src_line, p_work_src_image->stride);
   }
@@ -88,6 +320,10 @@ MINIMGAPI_API int CopyMinImageChannels(
     const int    *p_dst_channels,
     const int    *p_src_channels,
     int           num_channels) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImageChannels);
+#endif // defined(MINSTOPWATCH_ENABLED)
+
   if (!p_dst_channels || !p_src_channels || num_channels < 0)
     return BAD_ARGS;
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
@@ -97,9 +333,30 @@ MINIMGAPI_API int CopyMinImageChannels(
                      &tmp_image, p_dst_image, p_src_image->channels, AO_EMPTY));
   if (_CompareMinImagePrototypes(p_src_image, &tmp_image))
     return BAD_ARGS;
+  for (int i = 0; i < num_channels; ++i)
+    if (p_dst_channels[i] < 0 || p_dst_channels[i] >= p_dst_image->channels ||
+        p_src_channels[i] < 0 || p_src_channels[i] >= p_src_image->channels)
+      return BAD_ARGS;
   if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS || !num_channels)
     return NO_ERRORS;
 
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  int num_bands = tangling != TCR_INDEPENDENT_IMAGES ? 1 : GetParallelBandCount(
+      static_cast<int64_t>(p_dst_image->height) *
+      _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+  if (num_bands > 1)
+    return ParallelForBands(num_bands, p_dst_image->height, 1,
+                            [&](int y_begin, int y_end) -> int {
+      MinImg dst_band = {}, src_band = {};
+      PROPAGATE_ERROR(_GetMinImageRegion(&dst_band, p_dst_image, 0, y_begin,
+                                         p_dst_image->width, y_end - y_begin));
+      PROPAGATE_ERROR(_GetMinImageRegion(&src_band, p_src_image, 0, y_begin,
+                                         p_src_image->width, y_end - y_begin));
+      return CopyMinImageChannels(&dst_band, &src_band, p_dst_channels,
+                                  p_src_channels, num_channels);
+    });
+
   if (num_channels == 3 &&
       p_dst_image->channels == 3 && p_src_image->channels == 4 &&
       p_dst_channels[0] == 0 && p_src_channels[0] == 0 &&
@@ -126,6 +383,37 @@ MINIMGAPI_API int CopyMinImageChannels(
       return NO_ERRORS;
   }
 
+  if ((tangling == TCR_INDEPENDENT_IMAGES || tangling == TCR_SAME_IMAGE) &&
+      !p_dst_image->addressSpace && !p_src_image->addressSpace) {
+    int res = NOT_IMPLEMENTED;
+    switch (p_dst_image->channelDepth) {
+      case 1:
+        res = CopyMinImageChannelsByPlanes<uint8_t>(
+            p_dst_image, p_src_image, p_dst_channels, p_src_channels,
+            num_channels);
+        break;
+      case 2:
+        res = CopyMinImageChannelsByPlanes<uint16_t>(
+            p_dst_image, p_src_image, p_dst_channels, p_src_channels,
+            num_channels);
+        break;
+      case 4:
+        res = CopyMinImageChannelsByPlanes<uint32_t>(
+            p_dst_image, p_src_image, p_dst_channels, p_src_channels,
+            num_channels);
+        break;
+      case 8:
+        res = CopyMinImageChannelsByPlanes<uint64_t>(
+            p_dst_image, p_src_image, p_dst_channels, p_src_channels,
+            num_channels);
+        break;
+      default:
+        res = NOT_IMPLEMENTED;
+    }
+    if (res == NO_ERRORS)
+      return NO_ERRORS;
+  }
+
   MinImg unfolded_dst_image = {};
   PROPAGATE_ERROR(_UnfoldMinImageChannels(&unfolded_dst_image, p_dst_image));
   DECLARE_GUARDED_MINIMG(transfolded_dst_image);
@@ -142,14 +430,6 @@ MINIMGAPI_API int CopyMinImageChannels(
 
   int used_dst_channels = 0;
   for (int i = 0; i < num_channels; ++i) {
-    int dst_channel = p_dst_channels[i];
-    int src_channel = p_src_channels[i];
-
-    if (dst_channel < 0 || dst_channel > p_dst_image->channels)
-      return BAD_ARGS;
-    if (src_channel < 0 || src_channel > p_src_image->channels)
-      return BAD_ARGS;
-
     ++used_dst_channels;
     for (int j = 0; j < i; ++j)
       if (p_dst_channels[j] == p_dst_channels[i]) {
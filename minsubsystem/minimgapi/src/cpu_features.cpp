@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+
+#include <atomic>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include "cpu_features.h"
+
+#if defined(MINIMGAPI_WITH_AVX)
+# if defined(_MSC_VER)
+#   include <intrin.h>
+# else
+#   include <cpuid.h>
+# endif
+#endif
+
+namespace {
+
+#if defined(MINIMGAPI_WITH_AVX)
+
+void CpuId(
+    uint32_t *p_regs,
+    uint32_t  leaf,
+    uint32_t  subleaf) {
+#if defined(_MSC_VER)
+  int regs[4] = {0};
+  __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i)
+    p_regs[i] = static_cast<uint32_t>(regs[i]);
+#else
+  __cpuid_count(leaf, subleaf, p_regs[0], p_regs[1], p_regs[2], p_regs[3]);
+#endif
+}
+
+// Returns the register states the OS saves on context switch (XCR0).
+uint64_t GetEnabledXStateFeatures() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax = 0, edx = 0;
+  __asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+int DetectSimdLevelOnce() {
+  uint32_t regs[4] = {0};
+  CpuId(regs, 0, 0);
+  const uint32_t max_leaf = regs[0];
+  if (max_leaf < 7)
+    return SIMD_BASELINE;
+
+  CpuId(regs, 1, 0);
+  const bool has_osxsave = (regs[2] >> 27) & 1;
+  const bool has_avx = (regs[2] >> 28) & 1;
+  const bool has_f16c = (regs[2] >> 29) & 1;
+  if (!has_osxsave || !has_avx || !has_f16c)
+    return SIMD_BASELINE;
+  const uint64_t xstate = GetEnabledXStateFeatures();
+  if ((xstate & 0x06) != 0x06)  // SSE and AVX registers
+    return SIMD_BASELINE;
+
+  CpuId(regs, 7, 0);
+  const bool has_avx2 = (regs[1] >> 5) & 1;
+  const bool has_avx512f = (regs[1] >> 16) & 1;
+  const bool has_avx512bw = (regs[1] >> 30) & 1;
+  if (!has_avx2)
+    return SIMD_BASELINE;
+  if (has_avx512f && has_avx512bw &&
+      (xstate & 0xE0) == 0xE0)  // opmask and ZMM registers
+    return SIMD_AVX512;
+  return SIMD_AVX2;
+}
+
+#endif // defined(MINIMGAPI_WITH_AVX)
+
+std::atomic<int> g_simd_level_limit(SIMD_AVX512);
+
+} // namespace
+
+int DetectSimdLevel() {
+#if defined(MINIMGAPI_WITH_AVX)
+  static const int detected_level = DetectSimdLevelOnce();
+  return detected_level;
+#else
+  return SIMD_BASELINE;
+#endif
+}
+
+MINIMGAPI_API int SetMinImageSimdLevel(
+    int max_level) {
+  if (max_level < SIMD_BASELINE || max_level > SIMD_AVX512)
+    return BAD_ARGS;
+  g_simd_level_limit = max_level;
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int GetMinImageSimdLevel(void) {
+  int level = DetectSimdLevel();
+  int limit = g_simd_level_limit.load(std::memory_order_relaxed);
+  return level < limit ? level : limit;
+}
@@ -0,0 +1,65 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_CPU_FEATURES_H_INCLUDED
+#define MINIMGAPI_SRC_CPU_FEATURES_H_INCLUDED
+
+#include <minimgapi/minimgapi.h>
+
+/*
+ * Kernels for instruction sets wider than the baseline are compiled in the
+ * same translation units as the baseline code, with the target specified per
+ * function, and are selected at run time with GetMinImageSimdLevel(). Such a
+ * kernel must only be called from a function having the same target.
+ */
+#if defined(USE_SSE_SIMD) && !defined(MINIMGAPI_NO_AVX)
+# if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#   define MINIMGAPI_WITH_AVX
+#   define MINIMGAPI_TARGET_AVX2   __attribute__((target("avx2,f16c")))
+#   define MINIMGAPI_TARGET_AVX512 \
+        __attribute__((target("avx2,f16c,avx512f,avx512bw")))
+# elif defined(_MSC_VER) && _MSC_VER >= 1910
+#   define MINIMGAPI_WITH_AVX
+#   define MINIMGAPI_TARGET_AVX2
+#   define MINIMGAPI_TARGET_AVX512
+# endif
+#endif
+
+/**
+ * Returns the widest instruction set supported by both the processor and the
+ * operating system, ignoring the limit set with SetMinImageSimdLevel().
+ */
+int DetectSimdLevel();
+
+#endif // #ifndef MINIMGAPI_SRC_CPU_FEATURES_H_INCLUDED
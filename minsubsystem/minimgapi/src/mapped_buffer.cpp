@@ -0,0 +1,224 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include "mapped_buffer.h"
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif // !defined(_WIN32)
+
+namespace {
+
+// A mapping starts at a page boundary, which may precede the image data.
+struct Mapping {
+  void   *p_base;
+  size_t  size;
+};
+
+// The live mappings by the addresses of their image data. The counter lets
+// UnmapImageBuffer() skip the lookup while there are no mappings at all.
+std::mutex g_mappings_mutex;
+std::unordered_map<uint8_t *, Mapping> g_mappings;
+std::atomic<int> g_num_mappings(0);
+
+void RegisterMapping(
+    uint8_t *p_data,
+    void    *p_base,
+    size_t   size) {
+  Mapping mapping_info = {p_base, size};
+  std::lock_guard<std::mutex> lock(g_mappings_mutex);
+  g_mappings[p_data] = mapping_info;
+  ++g_num_mappings;
+}
+
+#if !defined(_WIN32)
+
+int OpenMappedFile(
+    int           *p_fd,
+    size_t         size,
+    const char    *p_file_name,
+    MappingOption  mapping) {
+  int fd = -1;
+  switch (mapping) {
+    case MO_TEMPORARY: {
+      // The file is unlinked at once and disappears with the mapping.
+      const char *p_dir_name = p_file_name;
+      if (!p_dir_name)
+        p_dir_name = ::getenv("TMPDIR");
+      if (!p_dir_name || !*p_dir_name)
+        p_dir_name = "/tmp";
+      std::string path = std::string(p_dir_name) + "/minimg.XXXXXX";
+      fd = ::mkstemp(&path[0]);
+      if (fd < 0)
+        return FILE_ERROR;
+      ::unlink(path.c_str());
+      break;
+    }
+    case MO_CREATE:
+      if (!p_file_name)
+        return BAD_ARGS;
+      fd = ::open(p_file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        return FILE_ERROR;
+      break;
+    case MO_OPEN: {
+      if (!p_file_name)
+        return BAD_ARGS;
+      fd = ::open(p_file_name, O_RDWR);
+      if (fd < 0)
+        return FILE_ERROR;
+      struct stat file_stat;
+      if (::fstat(fd, &file_stat) ||
+          static_cast<uint64_t>(file_stat.st_size) < size) {
+        ::close(fd);
+        return BAD_ARGS;
+      }
+      *p_fd = fd;
+      return NO_ERRORS;
+    }
+    default:
+      return BAD_ARGS;
+  }
+
+  if (::ftruncate(fd, static_cast<off_t>(size))) {
+    ::close(fd);
+    return NO_MEMORY;
+  }
+  *p_fd = fd;
+  return NO_ERRORS;
+}
+
+#endif // !defined(_WIN32)
+
+} // namespace
+
+int MapImageBuffer(
+    uint8_t      **pp_buffer,
+    size_t         size,
+    const char    *p_file_name,
+    MappingOption  mapping) {
+  if (!pp_buffer || !size)
+    return BAD_ARGS;
+#if defined(_WIN32)
+  (void)p_file_name;
+  (void)mapping;
+  return NOT_IMPLEMENTED;
+#else // !defined(_WIN32)
+  int fd = -1;
+  PROPAGATE_ERROR(OpenMappedFile(&fd, size, p_file_name, mapping));
+  void *p_mapping = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p_mapping == MAP_FAILED)
+    return NO_MEMORY;
+
+  uint8_t *p_buffer = static_cast<uint8_t *>(p_mapping);
+  RegisterMapping(p_buffer, p_mapping, size);
+  *pp_buffer = p_buffer;
+  return NO_ERRORS;
+#endif // !defined(_WIN32)
+}
+
+int MapImageFileRange(
+    uint8_t    **pp_data,
+    const char  *p_file_name,
+    uint64_t     offset,
+    size_t       size) {
+  if (!pp_data || !p_file_name || !size)
+    return BAD_ARGS;
+#if defined(_WIN32)
+  (void)offset;
+  return NOT_IMPLEMENTED;
+#else // !defined(_WIN32)
+  const int fd = ::open(p_file_name, O_RDONLY);
+  if (fd < 0)
+    return FILE_ERROR;
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) ||
+      static_cast<uint64_t>(file_stat.st_size) < offset + size) {
+    ::close(fd);
+    return BAD_ARGS;
+  }
+
+  // mmap() takes offsets at page boundaries only.
+  const uint64_t page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  const uint64_t base_offset = offset / page_size * page_size;
+  const size_t map_size = size + static_cast<size_t>(offset - base_offset);
+  // A private mapping may be written to, the changes are never carried to
+  // the file.
+  void *p_mapping = ::mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                           fd, static_cast<off_t>(base_offset));
+  ::close(fd);
+  if (p_mapping == MAP_FAILED)
+    return NO_MEMORY;
+
+  uint8_t *p_data = static_cast<uint8_t *>(p_mapping) + (offset - base_offset);
+  RegisterMapping(p_data, p_mapping, map_size);
+  *pp_data = p_data;
+  return NO_ERRORS;
+#endif // !defined(_WIN32)
+}
+
+bool UnmapImageBuffer(
+    uint8_t *p_buffer) {
+  if (!g_num_mappings.load(std::memory_order_relaxed))
+    return false;
+#if defined(_WIN32)
+  (void)p_buffer;
+  return false;
+#else // !defined(_WIN32)
+  Mapping mapping_info;
+  {
+    std::lock_guard<std::mutex> lock(g_mappings_mutex);
+    std::unordered_map<uint8_t *, Mapping>::iterator it =
+        g_mappings.find(p_buffer);
+    if (it == g_mappings.end())
+      return false;
+    mapping_info = it->second;
+    g_mappings.erase(it);
+    --g_num_mappings;
+  }
+  ::munmap(mapping_info.p_base, mapping_info.size);
+  return true;
+#endif // !defined(_WIN32)
+}
@@ -0,0 +1,69 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_MAPPED_BUFFER_H_INCLUDED
+#define MINIMGAPI_SRC_MAPPED_BUFFER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <minimgapi/minimgapi.h>
+
+/**
+ * Maps a file of size bytes into memory (see AllocMappedMinImage() for the
+ * meaning of p_file_name and mapping) and stores the address of the mapping
+ * to *pp_buffer. Returns an error code.
+ */
+int MapImageBuffer(
+    uint8_t      **pp_buffer,
+    size_t         size,
+    const char    *p_file_name,
+    MappingOption  mapping);
+
+/**
+ * Maps size bytes of an existing file from the offset copy-on-write and
+ * stores the address of the first of them to *pp_data. Returns an error code.
+ */
+int MapImageFileRange(
+    uint8_t    **pp_data,
+    const char  *p_file_name,
+    uint64_t     offset,
+    size_t       size);
+
+/**
+ * Unmaps a buffer mapped with MapImageBuffer() or MapImageFileRange(). Returns false if the buffer
+ * is not a mapping.
+ */
+bool UnmapImageBuffer(
+    uint8_t *p_buffer);
+
+#endif // #ifndef MINIMGAPI_SRC_MAPPED_BUFFER_H_INCLUDED
@@ -32,6 +32,7 @@ either expressed or implied, of copyright holders.
 #include <cstring>
 #include <cstdlib>
 #include <algorithm>
+#include <vector>
 
 #include <minimgapi/minimgapi-inl.h>
 #include <minbase/minresult.h>
@@ -39,6 +40,10 @@ either expressed or implied, of copyright holders.
 #include <minbase/crossplat.h>
 #include <minimgapi/minimgapi.h>
 #include <minimgapi/imgguard.hpp>
+#include "buffer_pool.h"
+#include "copy_channels.h"
+#include "mapped_buffer.h"
+#include "parallel.h"
 
 
 MINIMGAPI_API int NewMinImagePrototype(
@@ -65,7 +70,11 @@ MINIMGAPI_API int NewMinImagePrototype(
   return NO_ERRORS;
 }
 
-MINIMGAPI_API int AllocMinImage(
+// Validates the image prototype and the alignment, computes the stride if it
+// is not set and stores the size of the buffer to *p_size (0 if the image is
+// empty).
+static int PrepareMinImageAllocation(
+    size_t *p_size,
     MinImg *p_image,
     int     alignment) {
   PROPAGATE_ERROR(_AssureMinImagePrototypeIsValid(p_image));
@@ -75,6 +84,7 @@ MINIMGAPI_API int AllocMinImage(
     return BAD_ARGS;
   if (std::abs(p_image->stride) % alignment)
     return BAD_ARGS;
+  *p_size = 0;
   if (_AssureMinImageIsEmpty(p_image) == NO_ERRORS)
     return NO_ERRORS;
   if (p_image->addressSpace != 0)
@@ -89,17 +99,72 @@ MINIMGAPI_API int AllocMinImage(
 
   if (!p_image->stride)
     p_image->stride = (line_size + alignment - 1) & ~(alignment - 1);
-  const int abs_stride = std::abs(p_image->stride);
+  *p_size = static_cast<size_t>(p_image->height) * std::abs(p_image->stride);
+  return NO_ERRORS;
+}
+
+static void SetMinImageBuffer(
+    MinImg  *p_image,
+    uint8_t *p_buffer) {
+  p_image->pScan0 = p_buffer;
+  if (p_image->stride < 0)
+    p_image->pScan0 += (p_image->height - 1) *
+                       static_cast<ptrdiff_t>(-p_image->stride);
+}
+
+MINIMGAPI_API int AllocMinImage(
+    MinImg *p_image,
+    int     alignment) {
+  size_t size = 0;
+  PROPAGATE_ERROR(PrepareMinImageAllocation(&size, p_image, alignment));
+  if (!size)
+    return NO_ERRORS;
 
-  uint8_t *p_buffer = reinterpret_cast<uint8_t *>(
-                      ::alignedmalloc(p_image->height * abs_stride, alignment));
+  uint8_t *p_buffer = AllocImageBuffer(size, alignment);
   if (!p_buffer)
     return NO_MEMORY;
 
-  p_image->pScan0 = p_buffer;
-  if (p_image->stride < 0)
-    p_image->pScan0 += (p_image->height - 1) * abs_stride;
+  SetMinImageBuffer(p_image, p_buffer);
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int AllocMappedMinImage(
+    MinImg        *p_image,
+    const char    *p_file_name,
+    MappingOption  mapping,
+    int            alignment) {
+  size_t size = 0;
+  PROPAGATE_ERROR(PrepareMinImageAllocation(&size, p_image, alignment));
+  if (!size)
+    return NO_ERRORS;
+
+  uint8_t *p_buffer = 0;
+  PROPAGATE_ERROR(MapImageBuffer(&p_buffer, size, p_file_name, mapping));
+
+  SetMinImageBuffer(p_image, p_buffer);
+  return NO_ERRORS;
+}
 
+MINIMGAPI_API int MapMinImageFile(
+    MinImg     *p_image,
+    const char *p_file_name,
+    int64_t     offset) {
+  if (!p_file_name || offset < 0)
+    return BAD_ARGS;
+  if (p_image && p_image->stride < 0)
+    return BAD_ARGS;
+  size_t size = 0;
+  PROPAGATE_ERROR(PrepareMinImageAllocation(&size, p_image, 1));
+  if (!size)
+    return NO_ERRORS;
+  // The file may end right after the pixels of the last line.
+  size -= p_image->stride - _GetMinImageBytesPerLine(p_image);
+
+  uint8_t *p_data = 0;
+  PROPAGATE_ERROR(MapImageFileRange(&p_data, p_file_name,
+                                    static_cast<uint64_t>(offset), size));
+
+  SetMinImageBuffer(p_image, p_data);
   return NO_ERRORS;
 }
 
@@ -118,7 +183,8 @@ MINIMGAPI_API int FreeMinImage(
                                  _GetMinImageLine(p_image, p_image->height - 1);
   if (!p_buffer)
     return INTERNAL_ERROR;
-  ::alignedfree(p_buffer);
+  if (!UnmapImageBuffer(p_buffer))
+    FreeImageBuffer(p_buffer);
   ::memset(p_image, 0, sizeof(*p_image));
 
   return NO_ERRORS;
@@ -638,6 +704,22 @@ MINIMGAPI_API int CopyMinImage(
   if (p_work_dst_image->addressSpace != 0)
     return NOT_IMPLEMENTED;
 
+  if (tangling == TCR_INDEPENDENT_IMAGES) {
+    int num_bands = GetParallelBandCount(
+        static_cast<int64_t>(p_dst_image->height) *
+        _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+    if (num_bands > 1)
+      return ParallelForBands(num_bands, p_dst_image->height, 1,
+                              [&](int y_begin, int y_end) -> int {
+        MinImg dst_band = {0}, src_band = {0};
+        PROPAGATE_ERROR(_GetMinImageRegion(&dst_band, p_dst_image, 0, y_begin,
+                                   p_dst_image->width, y_end - y_begin));
+        PROPAGATE_ERROR(_GetMinImageRegion(&src_band, p_src_image, 0, y_begin,
+                                   p_src_image->width, y_end - y_begin));
+        return CopyMinImage(&dst_band, &src_band);
+      });
+  }
+
   int bit_line_width = p_work_dst_image->width *
                       _GetMinImageBitsPerPixel(p_work_dst_image);
   int byte_line_width = bit_line_width >> 3;
@@ -902,6 +984,22 @@ MINIMGAPI_API int FlipMinImage(
     if (p_work_dst_image->addressSpace != 0)
       return NOT_IMPLEMENTED;
 
+    if (tangling == TCR_INDEPENDENT_IMAGES) {
+      int num_bands = GetParallelBandCount(
+          static_cast<int64_t>(p_dst_image->height) *
+          _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+      if (num_bands > 1)
+        return ParallelForBands(num_bands, p_dst_image->height, 1,
+                                [&](int y_begin, int y_end) -> int {
+          MinImg dst_band = {0}, src_band = {0};
+          PROPAGATE_ERROR(_GetMinImageRegion(&dst_band, p_dst_image, 0, y_begin,
+                                     p_dst_image->width, y_end - y_begin));
+          PROPAGATE_ERROR(_GetMinImageRegion(&src_band, p_src_image, 0, y_begin,
+                                     p_src_image->width, y_end - y_begin));
+          return FlipMinImage(&dst_band, &src_band, DO_HORIZONTAL);
+        });
+    }
+
     int bits_per_pixel = _GetMinImageBitsPerPixel(p_work_dst_image);
     if (bits_per_pixel & 0x07U) {
       int bit_line_width = p_work_dst_image->width * bits_per_pixel;
@@ -1063,6 +1161,38 @@ MINIMGAPI_API int InterleaveMinImages(
   if (p_dst_image->channels != sum_src_channels)
     return BAD_ARGS;
 
+  bool independent_images = true;
+  for (int i = 0; i < num_src_images; ++i) {
+    uint32_t tangling = 0;
+    PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image,
+                                         p_p_src_images[i]));
+    independent_images &= tangling == TCR_INDEPENDENT_IMAGES;
+  }
+  int num_bands = !independent_images ? 1 : GetParallelBandCount(
+      static_cast<int64_t>(p_dst_image->height) *
+      _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+  if (num_bands > 1)
+    return ParallelForBands(num_bands, p_dst_image->height, 1,
+                            [&](int y_begin, int y_end) -> int {
+      MinImg dst_band = {0};
+      PROPAGATE_ERROR(_GetMinImageRegion(&dst_band, p_dst_image, 0, y_begin,
+                                         p_dst_image->width, y_end - y_begin));
+      std::vector<MinImg> src_bands(num_src_images);
+      std::vector<const MinImg *> p_src_bands(num_src_images);
+      for (int i = 0; i < num_src_images; ++i) {
+        PROPAGATE_ERROR(_GetMinImageRegion(&src_bands[i], p_p_src_images[i],
+                                           0, y_begin, p_dst_image->width,
+                                           y_end - y_begin));
+        p_src_bands[i] = &src_bands[i];
+      }
+      return InterleaveMinImages(&dst_band, &p_src_bands[0], num_src_images);
+    });
+
+  if (independent_images &&
+      InterleaveMinImagePlanes(p_dst_image, p_p_src_images,
+                               num_src_images) == NO_ERRORS)
+    return NO_ERRORS;
+
   MinImg unfolded_dst_image = {0};
   PROPAGATE_ERROR(_UnfoldMinImageChannels(&unfolded_dst_image, p_dst_image));
   DECLARE_GUARDED_MINIMG(transfolded_dst_image);
@@ -1090,10 +1220,21 @@ MINIMGAPI_API int InterleaveMinImages(
       continue;
     }
 
+    MinImg unfolded_src_image = {0};
+    PROPAGATE_ERROR(_UnfoldMinImageChannels(&unfolded_src_image, p_src_image));
+
+    MinImg transposed_src_image = {0};
+    PROPAGATE_ERROR(_GetMinImageRegion(&transposed_src_image,
+                                       &transfolded_src_image,
+                                       0, 0, transfolded_src_image.width,
+                                       p_dst_image->width *
+                                       p_src_image->channels));
+    PROPAGATE_ERROR(TransposeMinImage(&transposed_src_image,
+                                      &unfolded_src_image));
     for (int i = 0; i < p_src_image->channels; ++i) {
       MinImg transposed_src_channel = {0};
       PROPAGATE_ERROR(_SliceMinImageVertically(&transposed_src_channel,
-                                               &transfolded_src_image,
+                                               &transposed_src_image,
                                                i, p_src_image->channels));
       MinImg transposed_dst_channel = {0};
       PROPAGATE_ERROR(_SliceMinImageVertically(&transposed_dst_channel,
@@ -1132,6 +1273,38 @@ MINIMGAPI_API int DeinterleaveMinImage(
   if (p_src_image->channels != sum_dst_channels)
     return BAD_ARGS;
 
+  bool independent_images = true;
+  for (int i = 0; i < num_dst_images; ++i) {
+    uint32_t tangling = 0;
+    PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_p_dst_images[i],
+                                         p_src_image));
+    independent_images &= tangling == TCR_INDEPENDENT_IMAGES;
+  }
+  int num_bands = !independent_images ? 1 : GetParallelBandCount(
+      static_cast<int64_t>(p_src_image->height) *
+      _GetMinImageBytesPerLine(p_src_image), p_src_image->height);
+  if (num_bands > 1)
+    return ParallelForBands(num_bands, p_src_image->height, 1,
+                            [&](int y_begin, int y_end) -> int {
+      MinImg src_band = {0};
+      PROPAGATE_ERROR(_GetMinImageRegion(&src_band, p_src_image, 0, y_begin,
+                                         p_src_image->width, y_end - y_begin));
+      std::vector<MinImg> dst_bands(num_dst_images);
+      std::vector<const MinImg *> p_dst_bands(num_dst_images);
+      for (int i = 0; i < num_dst_images; ++i) {
+        PROPAGATE_ERROR(_GetMinImageRegion(&dst_bands[i], p_p_dst_images[i],
+                                           0, y_begin, p_src_image->width,
+                                           y_end - y_begin));
+        p_dst_bands[i] = &dst_bands[i];
+      }
+      return DeinterleaveMinImage(&p_dst_bands[0], &src_band, num_dst_images);
+    });
+
+  if (independent_images &&
+      DeinterleaveMinImagePlanes(p_p_dst_images, p_src_image,
+                                 num_dst_images) == NO_ERRORS)
+    return NO_ERRORS;
+
   MinImg unfolded_src_image = {0};
   PROPAGATE_ERROR(_UnfoldMinImageChannels(&unfolded_src_image, p_src_image));
   DECLARE_GUARDED_MINIMG(transfolded_src_image);
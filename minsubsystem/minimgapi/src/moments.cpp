@@ -0,0 +1,450 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/smartptr.h>
+#include "vector/moments-inl.h"
+#include "parallel.h"
+
+namespace {
+
+// Histograms of one-channel images are counted in several copies, so that
+// consecutive equal values do not wait for each other's increments.
+const int histogram_copies = 4;
+
+template <typename T>
+struct MomentsTraits;
+
+template <>
+struct MomentsTraits<uint8_t> {
+  typedef int64_t Sum;
+  static void Accumulate(const uint8_t *p_pixels, int len, int channels,
+                         Sum *p_sums, Sum *p_cross_products) {
+    vector_moments_8u(p_pixels, len, channels, p_sums, p_cross_products);
+  }
+};
+
+template <>
+struct MomentsTraits<uint16_t> {
+  typedef int64_t Sum;
+  static void Accumulate(const uint16_t *p_pixels, int len, int channels,
+                         Sum *p_sums, Sum *p_cross_products) {
+    vector_moments_16u(p_pixels, len, channels, p_sums, p_cross_products);
+  }
+};
+
+template <>
+struct MomentsTraits<float> {
+  typedef double Sum;
+  static void Accumulate(const float *p_pixels, int len, int channels,
+                         Sum *p_sums, Sum *p_cross_products) {
+    vector_moments_32f(p_pixels, len, channels, p_sums, p_cross_products);
+  }
+};
+
+// Moments of num_labels pixel sets. For each label there are the channel sums
+// followed by the upper triangle of the cross product matrix, stored row by
+// row as a full channels x channels matrix.
+template <typename TSum>
+struct MomentsTable {
+  int                  channels;
+  std::vector<int64_t> counts;
+  std::vector<TSum>    values;
+
+  MomentsTable(int num_labels, int num_channels)
+      : channels(num_channels),
+        counts(num_labels),
+        values(static_cast<size_t>(num_labels) * ValuesPerLabel()) {}
+
+  int ValuesPerLabel() const {
+    return channels + channels * channels;
+  }
+
+  TSum *Values(int label) {
+    return values.data() + static_cast<size_t>(label) * ValuesPerLabel();
+  }
+
+  // Adds len interleaved pixels to the moments of the label.
+  template <typename T>
+  void AddSpan(int label, const T *p_pixels, int len) {
+    counts[label] += len;
+    TSum *p_sums = Values(label);
+    MomentsTraits<T>::Accumulate(p_pixels, len, channels, p_sums,
+                                 p_sums + channels);
+  }
+
+  void Add(const MomentsTable &other) {
+    for (size_t i = 0; i < counts.size(); ++i)
+      counts[i] += other.counts[i];
+    for (size_t i = 0; i < values.size(); ++i)
+      values[i] += other.values[i];
+  }
+};
+
+// Calls add_span(x_begin, x_end, label) for the runs of pixels of a row with
+// equal labels. Runs with negative labels are skipped.
+template <typename TLabelOf, typename TAddSpan>
+void ForEachLabelRun(
+    int              width,
+    const TLabelOf  &label_of,
+    const TAddSpan  &add_span) {
+  int x = 0;
+  while (x < width) {
+    const int label = label_of(x);
+    int x_end = x + 1;
+    while (x_end < width && label_of(x_end) == label)
+      ++x_end;
+    if (label >= 0)
+      add_span(x, x_end, label);
+    x = x_end;
+  }
+}
+
+// Calls add_span(x_begin, x_end, label) for the runs of pixels of rows
+// [y_begin, y_end) selected by the optional mask (label 0) or by the label
+// image.
+template <typename TAddSpan>
+int ForEachRowRun(
+    const MinImg   *p_image,
+    const MinImg   *p_mask,
+    const MinImg   *p_labels,
+    int             num_labels,
+    int             y_begin,
+    int             y_end,
+    const TAddSpan &add_span) {
+  for (int y = y_begin; y < y_end; ++y) {
+    const uint8_t *p_line = _GetMinImageLine(p_image, y);
+    if (!p_line)
+      return INTERNAL_ERROR;
+    auto add_line_span = [&](int x_begin, int x_end, int label) {
+      add_span(p_line, x_begin, x_end, label);
+    };
+    if (p_mask) {
+      const uint8_t *p_mask_line = _GetMinImageLine(p_mask, y);
+      if (!p_mask_line)
+        return INTERNAL_ERROR;
+      ForEachLabelRun(p_image->width, [&](int x) {
+        return p_mask_line[x] ? 0 : -1;
+      }, add_line_span);
+    } else if (p_labels) {
+      const uint8_t *p_label_line = _GetMinImageLine(p_labels, y);
+      if (!p_label_line)
+        return INTERNAL_ERROR;
+      auto in_range = [num_labels](int64_t label) {
+        return label >= 0 && label < num_labels ? static_cast<int>(label) : -1;
+      };
+      switch (p_labels->channelDepth) {
+        case 1:
+          ForEachLabelRun(p_image->width, [&](int x) {
+            return in_range(p_label_line[x]);
+          }, add_line_span);
+          break;
+        case 2:
+          ForEachLabelRun(p_image->width, [&](int x) {
+            return in_range(
+                reinterpret_cast<const uint16_t *>(p_label_line)[x]);
+          }, add_line_span);
+          break;
+        default:
+          ForEachLabelRun(p_image->width, [&](int x) {
+            return in_range(
+                reinterpret_cast<const int32_t *>(p_label_line)[x]);
+          }, add_line_span);
+      }
+    } else {
+      add_line_span(0, p_image->width, 0);
+    }
+  }
+  return NO_ERRORS;
+}
+
+// Runs accumulate(y_begin, y_end, p_partial) on num_bands row bands and
+// returns the partial results in the order of the bands, so that merged
+// floating point sums do not depend on scheduling.
+template <typename TPartial, typename TAccumulate>
+int AccumulateRowBands(
+    std::vector<TPartial> *p_partials,
+    const TPartial        &zero,
+    int                    num_bands,
+    int                    height,
+    const TAccumulate     &accumulate) {
+  p_partials->clear();
+  if (num_bands <= 1) {
+    p_partials->push_back(zero);
+    return accumulate(0, height, &p_partials->back());
+  }
+
+  std::map<int, TPartial> partials;
+  std::mutex mutex;
+  PROPAGATE_ERROR(ParallelForBands(num_bands, height, 1,
+                                   [&](int y_begin, int y_end) -> int {
+    TPartial partial = zero;
+    PROPAGATE_ERROR(accumulate(y_begin, y_end, &partial));
+    std::lock_guard<std::mutex> lock(mutex);
+    partials.insert(std::make_pair(y_begin, partial));
+    return NO_ERRORS;
+  }));
+  for (auto &item : partials)
+    p_partials->push_back(item.second);
+  return NO_ERRORS;
+}
+
+template <typename T>
+int ComputeMoments(
+    int64_t      *p_counts,
+    double       *p_sums,
+    double       *p_cross_products,
+    const MinImg *p_image,
+    const MinImg *p_mask,
+    const MinImg *p_labels,
+    int           num_labels) {
+  typedef typename MomentsTraits<T>::Sum Sum;
+  const int channels = p_image->channels;
+  const MomentsTable<Sum> zero(num_labels, channels);
+
+  // Every band keeps its own table, which may be large for many labels.
+  const int64_t image_bytes = static_cast<int64_t>(p_image->height) *
+                              _GetMinImageBytesPerLine(p_image);
+  int num_bands = GetParallelBandCount(image_bytes, p_image->height);
+  if (num_bands > 1 && static_cast<int64_t>(sizeof(Sum)) * num_bands *
+                       static_cast<int64_t>(zero.values.size()) > image_bytes)
+    num_bands = 1;
+
+  std::vector<MomentsTable<Sum> > partials;
+  PROPAGATE_ERROR(AccumulateRowBands(&partials, zero, num_bands,
+                                     p_image->height,
+      [&](int y_begin, int y_end, MomentsTable<Sum> *p_table) -> int {
+    return ForEachRowRun(p_image, p_mask, p_labels, num_labels, y_begin, y_end,
+        [&](const uint8_t *p_line, int x_begin, int x_end, int label) {
+      p_table->AddSpan(label, reinterpret_cast<const T *>(p_line) +
+                                  static_cast<size_t>(channels) * x_begin,
+                       x_end - x_begin);
+    });
+  }));
+  for (size_t i = 1; i < partials.size(); ++i)
+    partials[0].Add(partials[i]);
+
+  MomentsTable<Sum> &table = partials[0];
+  for (int label = 0; label < num_labels; ++label) {
+    const Sum *p_values = table.Values(label);
+    if (p_counts)
+      p_counts[label] = table.counts[label];
+    if (p_sums)
+      for (int i = 0; i < channels; ++i)
+        p_sums[label * channels + i] = static_cast<double>(p_values[i]);
+    if (p_cross_products) {
+      double *p_matrix = p_cross_products +
+                         static_cast<size_t>(label) * channels * channels;
+      for (int i = 0; i < channels; ++i)
+        for (int j = i; j < channels; ++j)
+          p_matrix[i * channels + j] = p_matrix[j * channels + i] =
+              static_cast<double>(p_values[channels + i * channels + j]);
+    }
+  }
+  return NO_ERRORS;
+}
+
+int GetMoments(
+    int64_t      *p_counts,
+    double       *p_sums,
+    double       *p_cross_products,
+    const MinImg *p_image,
+    const MinImg *p_mask,
+    const MinImg *p_labels,
+    int           num_labels) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  if (p_mask && _AssureMinImageFits(p_mask, TYP_UINT8, 1, p_image->width,
+                                    p_image->height) != NO_ERRORS)
+    return BAD_ARGS;
+  if (p_labels) {
+    PROPAGATE_ERROR(_AssureMinImageIsValid(p_labels));
+    const int label_type = _GetMinImageType(p_labels);
+    if (label_type != TYP_UINT8 && label_type != TYP_UINT16 &&
+        label_type != TYP_INT32)
+      return BAD_ARGS;
+    if (p_labels->channels != 1 || _CompareMinImage2DSizes(p_labels, p_image))
+      return BAD_ARGS;
+  }
+  if (p_image->addressSpace || (p_mask && p_mask->addressSpace) ||
+      (p_labels && p_labels->addressSpace))
+    return NOT_IMPLEMENTED;
+
+  switch (_GetMinImageType(p_image)) {
+    case TYP_UINT8:
+      return ComputeMoments<uint8_t>(p_counts, p_sums, p_cross_products,
+                                     p_image, p_mask, p_labels, num_labels);
+    case TYP_UINT16:
+      return ComputeMoments<uint16_t>(p_counts, p_sums, p_cross_products,
+                                      p_image, p_mask, p_labels, num_labels);
+    case TYP_REAL32:
+      return ComputeMoments<float>(p_counts, p_sums, p_cross_products,
+                                   p_image, p_mask, p_labels, num_labels);
+    default:
+      return NOT_IMPLEMENTED;
+  }
+}
+
+// Counts len interleaved pixels in the histograms; bin_of maps values to bins.
+template <typename T, typename TBinOf>
+void AddHistogramSpan(
+    int64_t      *p_histogram,
+    int           num_bins,
+    int           channels,
+    const T      *p_pixels,
+    int           len,
+    const TBinOf &bin_of) {
+  if (channels == 1) {
+    int64_t *p_copy0 = p_histogram;
+    int64_t *p_copy1 = p_copy0 + num_bins;
+    int64_t *p_copy2 = p_copy1 + num_bins;
+    int64_t *p_copy3 = p_copy2 + num_bins;
+    int x = 0;
+    for (; x + 4 <= len; x += 4) {
+      ++p_copy0[bin_of(p_pixels[x])];
+      ++p_copy1[bin_of(p_pixels[x + 1])];
+      ++p_copy2[bin_of(p_pixels[x + 2])];
+      ++p_copy3[bin_of(p_pixels[x + 3])];
+    }
+    for (; x < len; ++x)
+      ++p_copy0[bin_of(p_pixels[x])];
+    return;
+  }
+  for (int x = 0; x < len; ++x, p_pixels += channels)
+    for (int c = 0; c < channels; ++c)
+      ++p_histogram[c * num_bins + bin_of(p_pixels[c])];
+}
+
+template <typename T, typename TBinOf>
+int ComputeHistogram(
+    int64_t      *p_histogram,
+    int           num_bins,
+    const MinImg *p_image,
+    const MinImg *p_mask,
+    const TBinOf &bin_of) {
+  const int channels = p_image->channels;
+  const int copies = channels == 1 ? histogram_copies : 1;
+  const std::vector<int64_t> zero(
+      static_cast<size_t>(channels) * copies * num_bins);
+
+  int num_bands = GetParallelBandCount(
+      static_cast<int64_t>(p_image->height) * _GetMinImageBytesPerLine(p_image),
+      p_image->height);
+  std::vector<std::vector<int64_t> > partials;
+  PROPAGATE_ERROR(AccumulateRowBands(&partials, zero, num_bands,
+                                     p_image->height,
+      [&](int y_begin, int y_end, std::vector<int64_t> *p_partial) -> int {
+    return ForEachRowRun(p_image, p_mask, 0, 1, y_begin, y_end,
+        [&](const uint8_t *p_line, int x_begin, int x_end, int) {
+      AddHistogramSpan(p_partial->data(), num_bins, channels,
+                       reinterpret_cast<const T *>(p_line) +
+                           static_cast<size_t>(channels) * x_begin,
+                       x_end - x_begin, bin_of);
+    });
+  }));
+
+  const size_t histogram_len = static_cast<size_t>(channels) * num_bins;
+  std::fill(p_histogram, p_histogram + histogram_len, 0);
+  for (size_t band = 0; band < partials.size(); ++band)
+    for (int copy = 0; copy < copies; ++copy)
+      for (size_t i = 0; i < histogram_len; ++i)
+        p_histogram[i] += partials[band][copy * histogram_len + i];
+  return NO_ERRORS;
+}
+
+} // namespace
+
+MINIMGAPI_API int GetMinImageMoments(
+    int64_t      *p_count,
+    double       *p_sums,
+    double       *p_cross_products,
+    const MinImg *p_image,
+    const MinImg *p_mask) {
+  return GetMoments(p_count, p_sums, p_cross_products, p_image, p_mask, 0, 1);
+}
+
+MINIMGAPI_API int GetMinImageLabelMoments(
+    int64_t      *p_counts,
+    double       *p_sums,
+    double       *p_cross_products,
+    const MinImg *p_image,
+    const MinImg *p_labels,
+    int           num_labels) {
+  if (!p_labels || num_labels < 0)
+    return BAD_ARGS;
+  return GetMoments(p_counts, p_sums, p_cross_products, p_image, 0, p_labels,
+                    num_labels);
+}
+
+MINIMGAPI_API int GetMinImageHistogram(
+    int64_t      *p_histogram,
+    int           num_bins,
+    const MinImg *p_image,
+    const MinImg *p_mask) {
+  if (!p_histogram)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  if (p_mask && _AssureMinImageFits(p_mask, TYP_UINT8, 1, p_image->width,
+                                    p_image->height) != NO_ERRORS)
+    return BAD_ARGS;
+  if (p_image->addressSpace || (p_mask && p_mask->addressSpace))
+    return NOT_IMPLEMENTED;
+
+  switch (_GetMinImageType(p_image)) {
+    case TYP_UINT8: {
+      if (num_bins < 1 || num_bins > 0x100)
+        return BAD_ARGS;
+      uint16_t bins[0x100];
+      for (int v = 0; v < 0x100; ++v)
+        bins[v] = static_cast<uint16_t>((v * num_bins) >> 8);
+      return ComputeHistogram<uint8_t>(p_histogram, num_bins, p_image, p_mask,
+                                       [&bins](uint8_t v) { return bins[v]; });
+    }
+    case TYP_UINT16: {
+      if (num_bins < 1 || num_bins > 0x10000)
+        return BAD_ARGS;
+      const uint32_t bins = static_cast<uint32_t>(num_bins);
+      return ComputeHistogram<uint16_t>(p_histogram, num_bins, p_image, p_mask,
+                                        [bins](uint16_t v) {
+        return (v * bins) >> 16;
+      });
+    }
+    default:
+      return NOT_IMPLEMENTED;
+  }
+}
@@ -0,0 +1,255 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include "parallel.h"
+
+namespace {
+
+// Set while the thread executes a parallel task (or waits for a parallel job
+// it has started), so that nested library calls stay serial.
+thread_local bool t_in_parallel_job = false;
+
+class ParallelJobGuard {
+ public:
+  ParallelJobGuard() : was_in_job_(t_in_parallel_job) {
+    t_in_parallel_job = true;
+  }
+  ~ParallelJobGuard() {
+    t_in_parallel_job = was_in_job_;
+  }
+
+ private:
+  bool was_in_job_;
+};
+
+// The internal pool: num_threads - 1 workers plus the calling thread.
+// One job runs at a time; a caller finding the pool busy runs its job alone.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads)
+      : num_threads_(num_threads), p_function_(0), p_context_(0),
+        num_tasks_(0), next_task_(0), generation_(0), busy_workers_(0),
+        stop_(false) {
+    for (int i = 1; i < num_threads; ++i)
+      workers_.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i)
+      workers_[i].join();
+  }
+
+  int num_threads() const {
+    return num_threads_;
+  }
+
+  void Run(MinTaskFunction p_function, void *p_context, int num_tasks) {
+    std::unique_lock<std::mutex> job_lock(job_mutex_, std::try_to_lock);
+    if (!job_lock.owns_lock()) {
+      for (int task = 0; task < num_tasks; ++task)
+        p_function(p_context, task);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      p_function_ = p_function;
+      p_context_ = p_context;
+      num_tasks_ = num_tasks;
+      next_task_ = 0;
+      busy_workers_ = static_cast<int>(workers_.size());
+      ++generation_;
+    }
+    start_.notify_all();
+
+    ExecuteTasks();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return busy_workers_ == 0; });
+  }
+
+ private:
+  void ExecuteTasks() {
+    for (int task = next_task_++; task < num_tasks_; task = next_task_++)
+      p_function_(p_context_, task);
+  }
+
+  void WorkerLoop() {
+    t_in_parallel_job = true;
+    uint64_t seen_generation = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&] {
+          return stop_ || generation_ != seen_generation;
+        });
+        if (stop_)
+          return;
+        seen_generation = generation_;
+      }
+
+      ExecuteTasks();
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --busy_workers_;
+      }
+      done_.notify_one();
+    }
+  }
+
+  const int num_threads_;
+  std::vector<std::thread> workers_;
+
+  std::mutex job_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+
+  MinTaskFunction p_function_;
+  void *p_context_;
+  int num_tasks_;
+  std::atomic<int> next_task_;
+  uint64_t generation_;
+  int busy_workers_;
+  bool stop_;
+};
+
+ThreadPool *gp_thread_pool = 0;
+MinThreadPool g_external_pool = {0};
+std::atomic<int> g_parallel_threshold(1 << 20);
+
+struct TaskContext {
+  MinTaskFunction p_function;
+  void *p_context;
+};
+
+void RunGuardedTask(void *p_context, int task) {
+  ParallelJobGuard guard;
+  const TaskContext *p_task = static_cast<const TaskContext *>(p_context);
+  p_task->p_function(p_task->p_context, task);
+}
+
+} // namespace
+
+int GetParallelBandCount(
+    int64_t num_bytes,
+    int     num_rows) {
+  if (t_in_parallel_job || num_rows < 2 ||
+      num_bytes < g_parallel_threshold.load(std::memory_order_relaxed))
+    return 1;
+  return std::max(1, std::min(GetMinImageThreadCount(), num_rows));
+}
+
+void RunParallelTasks(
+    MinTaskFunction  p_function,
+    void            *p_context,
+    int              num_tasks) {
+  ParallelJobGuard guard;
+  TaskContext task_context = {p_function, p_context};
+  if (g_external_pool.run)
+    g_external_pool.run(g_external_pool.p_pool, &RunGuardedTask,
+                        &task_context, num_tasks);
+  else if (gp_thread_pool)
+    gp_thread_pool->Run(&RunGuardedTask, &task_context, num_tasks);
+  else
+    for (int task = 0; task < num_tasks; ++task)
+      p_function(p_context, task);
+}
+
+MINIMGAPI_API int SetMinImageThreadCount(
+    int num_threads) {
+  if (num_threads < 0)
+    return BAD_ARGS;
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  delete gp_thread_pool;
+  gp_thread_pool = 0;
+  if (num_threads > 1)
+    gp_thread_pool = new ThreadPool(num_threads);
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int SetMinImageThreadPool(
+    const MinThreadPool *p_pool) {
+  if (p_pool && (!p_pool->run || p_pool->num_threads < 1))
+    return BAD_ARGS;
+  if (p_pool)
+    g_external_pool = *p_pool;
+  else
+    g_external_pool = MinThreadPool();
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int GetMinImageThreadCount(void) {
+  if (g_external_pool.run)
+    return g_external_pool.num_threads;
+  return gp_thread_pool ? gp_thread_pool->num_threads() : 1;
+}
+
+MINIMGAPI_API int SetMinImageParallelThreshold(
+    int min_bytes) {
+  if (min_bytes < 0)
+    return BAD_ARGS;
+  g_parallel_threshold = min_bytes;
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int RunMinImageTasks(
+    MinTaskFunction  p_function,
+    void            *p_context,
+    int              num_tasks) {
+  if (!p_function || num_tasks < 0)
+    return BAD_ARGS;
+  if (GetParallelBandCount(std::numeric_limits<int64_t>::max(), num_tasks) > 1)
+    RunParallelTasks(p_function, p_context, num_tasks);
+  else
+    for (int task = 0; task < num_tasks; ++task)
+      p_function(p_context, task);
+  return NO_ERRORS;
+}
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_PARALLEL_H_INCLUDED
+#define MINIMGAPI_SRC_PARALLEL_H_INCLUDED
+
+#include <vector>
+#include <minbase/minresult.h>
+#include <minimgapi/minimgapi.h>
+
+/**
+ * Returns the number of row bands an operation writing num_bytes of image data
+ * in num_rows rows should be split into. Returns 1 if the operation must run
+ * serially: parallelism is off, the image is small or the calling thread is
+ * already executing a parallel task.
+ */
+int GetParallelBandCount(
+    int64_t num_bytes,
+    int     num_rows);
+
+/**
+ * Runs p_function(p_context, task) for every task in [0, num_tasks) on the
+ * current thread pool and waits for all of them.
+ */
+void RunParallelTasks(
+    MinTaskFunction  p_function,
+    void            *p_context,
+    int              num_tasks);
+
+/**
+ * Splits rows [0, height) into num_bands bands, with band borders aligned to
+ * row_alignment, and calls band_func(y_begin, y_end) for each of them in
+ * parallel. Returns the first error code returned by band_func.
+ */
+template <typename TBandFunc>
+int ParallelForBands(
+    int              num_bands,
+    int              height,
+    int              row_alignment,
+    const TBandFunc &band_func) {
+  if (num_bands < 1 || height < 0 || row_alignment < 1)
+    return BAD_ARGS;
+
+  struct Job {
+    const TBandFunc *p_band_func;
+    std::vector<int> borders;
+    std::vector<int> results;
+
+    static void Run(void *p_context, int band) {
+      Job *p_job = static_cast<Job *>(p_context);
+      p_job->results[band] = (*p_job->p_band_func)(p_job->borders[band],
+                                                   p_job->borders[band + 1]);
+    }
+  } job;
+  job.p_band_func = &band_func;
+  job.borders.resize(num_bands + 1);
+  job.results.resize(num_bands, NO_ERRORS);
+  for (int band = 0; band < num_bands; ++band) {
+    int64_t y = static_cast<int64_t>(height) * band / num_bands;
+    job.borders[band] = static_cast<int>(y / row_alignment * row_alignment);
+  }
+  job.borders[num_bands] = height;
+
+  RunParallelTasks(&Job::Run, &job, num_bands);
+
+  for (int band = 0; band < num_bands; ++band)
+    PROPAGATE_ERROR(job.results[band]);
+  return NO_ERRORS;
+}
+
+#endif // #ifndef MINIMGAPI_SRC_PARALLEL_H_INCLUDED
@@ -29,8 +29,10 @@ of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of copyright holders.
 */
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
+#include <vector>
 #include <minbase/minresult.h>
 #include <minutils/smartptr.h>
 #include <minbase/crossplat.h>
@@ -38,10 +40,13 @@ either expressed or implied, of copyright holders.
 #include <minimgapi/minimgapi-inl.h>
 #include <minimgapi/imgguard.hpp>
 #include "bitcpy.h"
+#include "parallel.h"
+#include "vector/resample-inl.h"
 
 #if defined(MINSTOPWATCH_ENABLED)
 #  include <minstopwatch/stopwatch.hpp>
 DECLARE_MINSTOPWATCH(gsw_ResampleMinImage, "ResampleMinImage");
+DECLARE_MINSTOPWATCH(gsw_InterpolateMinImage, "InterpolateMinImage");
 #endif // defined(MINSTOPWATCH_ENABLED)
 
 template<typename TChunk>
@@ -49,7 +54,9 @@ static int ChunkedResampleMinImage(
     const MinImg *p_dst_image,
     const MinImg *p_src_image,
     double        x_phase,
-    double        y_phase) {
+    double        y_phase,
+    int           dst_y_begin,
+    int           dst_y_end) {
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
   NEED_NO_ERRORS(_CompareMinImagePixels(p_dst_image, p_src_image));
@@ -83,10 +90,10 @@ static int ChunkedResampleMinImage(
   int byte_line_width = _GetMinImageBytesPerLine(p_dst_image);
   int last_line_done = -1;
   TChunk *p_dst_line = reinterpret_cast<TChunk *>(
-                                              _GetMinImageLine(p_dst_image, 0));
+                                              _GetMinImageLine(p_dst_image, dst_y_begin));
   if (!p_dst_line)
     return INTERNAL_ERROR;
-  for (int dst_y = 0; dst_y < p_dst_image->height; ++dst_y) {
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y) {
     int src_y = static_cast<int>((dst_y + y_phase) * y_quotient);
     if (src_y == last_line_done)
       ::memcpy(p_dst_line, ShiftPtr(p_dst_line, -p_dst_image->stride),
@@ -98,6 +105,7 @@ static int ChunkedResampleMinImage(
         return INTERNAL_ERROR;
       for (int dst_chunk_x = 0; dst_chunk_x < chunks_per_line; ++dst_chunk_x)
         p_dst_line[dst_chunk_x] = p_src_line[src_indices_by_dst[dst_chunk_x]];
+      last_line_done = src_y;
     }
     p_dst_line = ShiftPtr(p_dst_line, p_dst_image->stride);
   }
@@ -110,7 +118,9 @@ static int ResampleNBytesImage(
     const MinImg *p_src_image,
     double        x_phase,
     double        y_phase,
-    int           element_byte_size) {
+    int           element_byte_size,
+    int           dst_y_begin,
+    int           dst_y_end) {
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
   NEED_NO_ERRORS(_CompareMinImagePixels(p_dst_image, p_src_image));
@@ -135,12 +145,12 @@ static int ResampleNBytesImage(
   double y_quotient = p_src_image->height / (p_dst_image->height + 0.);
   int byte_line_width = _GetMinImageBytesPerLine(p_dst_image);
   int last_line_done = -1;
-  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, 0);
+  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, dst_y_begin);
   if (!p_dst_line)
     return INTERNAL_ERROR;
-  for (int dst_y = 0; dst_y < p_dst_image->height; ++dst_y) {
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y) {
     int src_y = static_cast<int>((dst_y + y_phase) * y_quotient);
-    if (dst_y == last_line_done)
+    if (src_y == last_line_done)
       ::memcpy(p_dst_line, p_dst_line - p_dst_image->stride, byte_line_width);
     else {
       const uint8_t *p_src_line = _GetMinImageLine(p_src_image, src_y);
@@ -148,8 +158,9 @@ static int ResampleNBytesImage(
         return INTERNAL_ERROR;
       for (int dst_x = 0; dst_x < p_dst_image->width; ++dst_x)
         ::memcpy(p_dst_line + dst_x * element_byte_size,
-               p_src_line + src_indices_by_dst[dst_x] * element_byte_size,
-               element_byte_size);
+                 p_src_line + src_indices_by_dst[dst_x],
+                 element_byte_size);
+      last_line_done = src_y;
     }
     p_dst_line += p_dst_image->stride;
   }
@@ -162,7 +173,9 @@ static int ResampleNBitsImage(
     const MinImg *p_src_image,
     double        x_phase,
     double        y_phase,
-    int           element_bit_size) {
+    int           element_bit_size,
+    int           dst_y_begin,
+    int           dst_y_end) {
   NEED_NO_ERRORS(_AssureMinImageFits(p_dst_image, TYP_UINT1));
   NEED_NO_ERRORS(_AssureMinImageFits(p_src_image, TYP_UINT1));
   NEED_NO_ERRORS(_CompareMinImagePixels(p_dst_image, p_src_image));
@@ -178,23 +191,17 @@ static int ResampleNBitsImage(
     return NOT_IMPLEMENTED;
 
   double x_quotient = p_src_image->width / (p_dst_image->width + 0.);
-  scoped_cpp_array<int> src_indices_by_dst(
-                           new int[p_dst_image->width * p_dst_image->channels]);
-  for (int dst_x = 0; dst_x < p_dst_image->width; ++dst_x) {
-    int *dst_pixel = &src_indices_by_dst[dst_x * p_dst_image->channels];
-    int src_x = static_cast<int>((dst_x + x_phase) * x_quotient);
-    int src_bit_x = src_x * p_src_image->channels;
-    for (int channel = 0; channel < p_dst_image->channels; ++channel)
-      dst_pixel[channel] = src_bit_x + channel;
-  }
+  scoped_cpp_array<int> src_indices_by_dst(new int[p_dst_image->width]);
+  for (int dst_x = 0; dst_x < p_dst_image->width; ++dst_x)
+    src_indices_by_dst[dst_x] = static_cast<int>((dst_x + x_phase) * x_quotient);
 
   double y_quotient = p_src_image->height / (p_dst_image->height + 0.);
   int bit_line_width = p_dst_image->width * element_bit_size;
   int last_line_done = -1;
-  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, 0);
+  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, dst_y_begin);
   if (!p_dst_line)
     return INTERNAL_ERROR;
-  for (int dst_y = 0; dst_y < p_dst_image->height; ++dst_y) {
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y) {
     int src_y = static_cast<int>((dst_y + y_phase) * y_quotient);
     if (src_y == last_line_done)
       bitcpy(p_dst_line, 0, p_dst_line - p_dst_image->stride, 0,
@@ -207,6 +214,7 @@ static int ResampleNBitsImage(
         bitcpy(p_dst_line, dst_x                     * element_bit_size,
                p_src_line, src_indices_by_dst[dst_x] * element_bit_size,
                element_bit_size);
+      last_line_done = src_y;
     }
     p_dst_line += p_dst_image->stride;
   }
@@ -214,6 +222,50 @@ static int ResampleNBitsImage(
   return NO_ERRORS;
 }
 
+// Resamples rows [dst_y_begin, dst_y_end) of the destination image.
+static int ResampleMinImageRows(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    double        x_phase,
+    double        y_phase,
+    int           dst_y_begin,
+    int           dst_y_end) {
+  int bits_per_pixel = _GetMinImageBitsPerPixel(p_dst_image);
+  if (bits_per_pixel & 0x07U)
+    return ResampleNBitsImage(p_dst_image, p_src_image,
+                              x_phase, y_phase, bits_per_pixel,
+                              dst_y_begin, dst_y_end);
+
+  int bytes_per_pixel = bits_per_pixel >> 3;
+  if (p_dst_image->channels == 3)
+    bytes_per_pixel /= 3;
+
+  switch (bytes_per_pixel) {
+  case 1:
+    return ChunkedResampleMinImage<uint8_t>(p_dst_image, p_src_image,
+                                            x_phase, y_phase,
+                                            dst_y_begin, dst_y_end);
+  case 2:
+    return ChunkedResampleMinImage<uint16_t>(p_dst_image, p_src_image,
+                                             x_phase, y_phase,
+                                             dst_y_begin, dst_y_end);
+  case 4:
+    return ChunkedResampleMinImage<uint32_t>(p_dst_image, p_src_image,
+                                             x_phase, y_phase,
+                                             dst_y_begin, dst_y_end);
+  case 8:
+    return ChunkedResampleMinImage<uint64_t>(p_dst_image, p_src_image,
+                                             x_phase, y_phase,
+                                             dst_y_begin, dst_y_end);
+  default:
+    return ResampleNBytesImage(p_dst_image, p_src_image,
+                               x_phase, y_phase, bytes_per_pixel,
+                               dst_y_begin, dst_y_end);
+  }
+
+  return INTERNAL_ERROR;
+}
+
 MINIMGAPI_API int ResampleMinImage(
     const MinImg *p_dst_image,
     const MinImg *p_src_image,
@@ -267,32 +319,232 @@ MINIMGAPI_API int ResampleMinImage(
     p_work_src_image = &tmp_image;
   }
 
-  int bits_per_pixel = _GetMinImageBitsPerPixel(p_work_dst_image);
-  if (bits_per_pixel & 0x07U)
-    return ResampleNBitsImage(p_work_dst_image, p_work_src_image,
-                              x_phase, y_phase, bits_per_pixel);
+  if (detangle == DTM_DO_NOTHING && tangling == TCR_INDEPENDENT_IMAGES) {
+    int num_bands = GetParallelBandCount(
+        static_cast<int64_t>(p_dst_image->height) *
+        _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+    if (num_bands > 1)
+      return ParallelForBands(num_bands, p_dst_image->height, 1,
+                              [&](int y_begin, int y_end) -> int {
+        return ResampleMinImageRows(p_dst_image, p_src_image,
+                                    x_phase, y_phase, y_begin, y_end);
+      });
+  }
 
-  int bytes_per_pixel = bits_per_pixel >> 3;
-  if (p_work_dst_image->channels == 3)
-    bytes_per_pixel /= 3;
+  return ResampleMinImageRows(p_work_dst_image, p_work_src_image,
+                              x_phase, y_phase,
+                              0, p_work_dst_image->height);
+}
 
-  switch (bytes_per_pixel) {
-  case 1:
-    return ChunkedResampleMinImage<uint8_t>(p_work_dst_image, p_work_src_image,
-                                                              x_phase, y_phase);
-  case 2:
-    return ChunkedResampleMinImage<uint16_t>(p_work_dst_image, p_work_src_image,
-                                                              x_phase, y_phase);
-  case 4:
-    return ChunkedResampleMinImage<uint32_t>(p_work_dst_image, p_work_src_image,
-                                                              x_phase, y_phase);
-  case 8:
-    return ChunkedResampleMinImage<uint64_t>(p_work_dst_image, p_work_src_image,
-                                                              x_phase, y_phase);
-  default:
-    return ResampleNBytesImage(p_work_dst_image, p_work_src_image,
-                               x_phase, y_phase, bytes_per_pixel);
+
+// Weighted source pixels contributing to each destination pixel along an axis.
+// Every destination pixel has num_taps taps, unused ones have zero weight.
+struct ResampleAxis {
+  int                num_taps;
+  std::vector<int>   indices;
+  std::vector<float> weights;
+};
+
+static void BuildBilinearAxis(
+    ResampleAxis *p_axis,
+    int           dst_size,
+    int           src_size) {
+  double scale = src_size / (dst_size + 0.);
+  p_axis->num_taps = 2;
+  p_axis->indices.resize(2 * dst_size);
+  p_axis->weights.resize(2 * dst_size);
+  for (int dst_i = 0; dst_i < dst_size; ++dst_i) {
+    double src_pos = (dst_i + 0.5) * scale - 0.5;
+    int src_i = static_cast<int>(floor(src_pos));
+    double frac = src_pos - src_i;
+    p_axis->indices[2 * dst_i] = std::min(std::max(src_i, 0), src_size - 1);
+    p_axis->indices[2 * dst_i + 1] = std::min(std::max(src_i + 1, 0),
+                                              src_size - 1);
+    p_axis->weights[2 * dst_i] = static_cast<float>(1. - frac);
+    p_axis->weights[2 * dst_i + 1] = static_cast<float>(frac);
   }
+}
 
-  return INTERNAL_ERROR;
+static void BuildAreaAxis(
+    ResampleAxis *p_axis,
+    int           dst_size,
+    int           src_size) {
+  double scale = src_size / (dst_size + 0.);
+  int num_taps = 1;
+  for (int dst_i = 0; dst_i < dst_size; ++dst_i) {
+    int first = static_cast<int>(floor(dst_i * scale));
+    int last = std::min(static_cast<int>(ceil((dst_i + 1) * scale)), src_size);
+    num_taps = std::max(num_taps, last - first);
+  }
+
+  p_axis->num_taps = num_taps;
+  p_axis->indices.assign(num_taps * dst_size, 0);
+  p_axis->weights.assign(num_taps * dst_size, 0.f);
+  for (int dst_i = 0; dst_i < dst_size; ++dst_i) {
+    double begin = dst_i * scale;
+    double end = std::min((dst_i + 1) * scale, static_cast<double>(src_size));
+    int first = static_cast<int>(floor(begin));
+    for (int tap = 0; tap < num_taps; ++tap) {
+      int src_i = std::min(first + tap, src_size - 1);
+      double covered = std::min(src_i + 1., end) - std::max(src_i + 0., begin);
+      p_axis->indices[dst_i * num_taps + tap] = src_i;
+      if (first + tap < src_size && covered > 0)
+        p_axis->weights[dst_i * num_taps + tap] =
+            static_cast<float>(covered / scale);
+    }
+  }
+}
+
+// The horizontal taps expanded to every element (pixel channel) of a
+// destination line, laid out for vector_interpolate_row().
+struct LineTaps {
+  int                num_taps;
+  std::vector<int>   offsets;
+  std::vector<float> weights;
+};
+
+static void BuildLineTaps(
+    LineTaps           *p_taps,
+    const ResampleAxis &axis,
+    int                 dst_width,
+    int                 channels) {
+  const int num_taps = axis.num_taps;
+  const int len = dst_width * channels;
+  p_taps->num_taps = num_taps;
+  p_taps->offsets.assign(static_cast<size_t>((len + 3) / 4) * 4 * num_taps, 0);
+  p_taps->weights.assign(p_taps->offsets.size(), 0.f);
+  for (int i = 0; i < len; ++i) {
+    const int dst_x = i / channels;
+    const int channel = i % channels;
+    const size_t first = static_cast<size_t>(i / 4) * num_taps * 4 + i % 4;
+    for (int tap = 0; tap < num_taps; ++tap) {
+      p_taps->offsets[first + 4 * tap] =
+          axis.indices[dst_x * num_taps + tap] * channels + channel;
+      p_taps->weights[first + 4 * tap] = axis.weights[dst_x * num_taps + tap];
+    }
+  }
+}
+
+// Resamples rows [dst_y_begin, dst_y_end) of the destination image. The
+// horizontally resampled source lines are cached, so each of them is computed
+// once per call even when it contributes to several destination lines.
+template<typename T>
+static int InterpolateMinImageRows(
+    const MinImg       *p_dst_image,
+    const MinImg       *p_src_image,
+    const LineTaps     &x_taps,
+    const ResampleAxis &y_axis,
+    int                 dst_y_begin,
+    int                 dst_y_end) {
+  const int channels = p_dst_image->channels;
+  const int line_len = p_dst_image->width * channels;
+  const int num_cached = y_axis.num_taps;
+  std::vector<float> buffer(static_cast<size_t>(num_cached + 1) * line_len);
+  std::vector<int> cached_src_y(num_cached, -1);
+  float *p_sum_line = buffer.data() + static_cast<size_t>(num_cached) *
+                                      line_len;
+
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y) {
+    const int *p_indices = y_axis.indices.data() + dst_y * y_axis.num_taps;
+    const float *p_weights = y_axis.weights.data() + dst_y * y_axis.num_taps;
+    bool first_tap = true;
+    for (int tap = 0; tap < y_axis.num_taps; ++tap) {
+      if (p_weights[tap] == 0.f)
+        continue;
+      int src_y = p_indices[tap];
+      int slot = src_y % num_cached;
+      float *p_line = buffer.data() + static_cast<size_t>(slot) * line_len;
+      if (cached_src_y[slot] != src_y) {
+        const T *p_src_line = reinterpret_cast<const T *>(
+                                          _GetMinImageLine(p_src_image, src_y));
+        if (!p_src_line)
+          return INTERNAL_ERROR;
+        vector_interpolate_row(p_line, p_src_line, x_taps.offsets.data(),
+                               x_taps.weights.data(), x_taps.num_taps,
+                               line_len);
+        cached_src_y[slot] = src_y;
+      }
+      if (first_tap)
+        vector_scale_row(p_sum_line, p_line, p_weights[tap], line_len);
+      else
+        vector_accumulate_row(p_sum_line, p_line, p_weights[tap], line_len);
+      first_tap = false;
+    }
+
+    T *p_dst_line = reinterpret_cast<T *>(_GetMinImageLine(p_dst_image, dst_y));
+    if (!p_dst_line)
+      return INTERNAL_ERROR;
+    vector_round_row(p_dst_line, p_sum_line, line_len);
+  }
+
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int InterpolateMinImage(
+    const MinImg        *p_dst_image,
+    const MinImg        *p_src_image,
+    InterpolationOption  interpolation) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_InterpolateMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  NEED_NO_ERRORS(_CompareMinImagePixels(p_dst_image, p_src_image));
+  if (interpolation == IO_NEAREST)
+    return ResampleMinImage(p_dst_image, p_src_image, 0.5, 0.5);
+  if (interpolation != IO_BILINEAR && interpolation != IO_AREA)
+    return BAD_ARGS;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return BAD_ARGS;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  MinTyp type = static_cast<MinTyp>(_GetMinImageType(p_dst_image));
+  if (type != TYP_UINT8 && type != TYP_UINT16 && type != TYP_REAL32)
+    return NOT_IMPLEMENTED;
+
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  const MinImg *p_work_src_image = p_src_image;
+  DECLARE_GUARDED_MINIMG(tmp_image);
+  if (tangling != TCR_INDEPENDENT_IMAGES) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(&tmp_image, p_src_image));
+    PROPAGATE_ERROR(CopyMinImage(&tmp_image, p_src_image));
+    p_work_src_image = &tmp_image;
+  }
+
+  ResampleAxis x_axis, y_axis;
+  if (interpolation == IO_AREA) {
+    BuildAreaAxis(&x_axis, p_dst_image->width, p_src_image->width);
+    BuildAreaAxis(&y_axis, p_dst_image->height, p_src_image->height);
+  } else {
+    BuildBilinearAxis(&x_axis, p_dst_image->width, p_src_image->width);
+    BuildBilinearAxis(&y_axis, p_dst_image->height, p_src_image->height);
+  }
+  LineTaps x_taps;
+  BuildLineTaps(&x_taps, x_axis, p_dst_image->width, p_dst_image->channels);
+
+  auto interpolate_rows = [&](int y_begin, int y_end) -> int {
+    switch (type) {
+    case TYP_UINT8:
+      return InterpolateMinImageRows<uint8_t>(p_dst_image, p_work_src_image,
+                                              x_taps, y_axis, y_begin, y_end);
+    case TYP_UINT16:
+      return InterpolateMinImageRows<uint16_t>(p_dst_image, p_work_src_image,
+                                               x_taps, y_axis, y_begin, y_end);
+    default:
+      return InterpolateMinImageRows<float>(p_dst_image, p_work_src_image,
+                                            x_taps, y_axis, y_begin, y_end);
+    }
+  };
+
+  int num_bands = GetParallelBandCount(
+      static_cast<int64_t>(p_dst_image->height) *
+      _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+  if (num_bands > 1)
+    return ParallelForBands(num_bands, p_dst_image->height, 1, interpolate_rows);
+  return interpolate_rows(0, p_dst_image->height);
 }
@@ -0,0 +1,193 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <minbase/minresult.h>
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/smartptr.h>
+#include "vector/resample-inl.h"
+#include "vector/retypify-inl.h"
+#if defined(MINIMGAPI_WITH_AVX)
+#include "vector/avx2/retypify-inl.h"
+#endif // defined(MINIMGAPI_WITH_AVX)
+#include "parallel.h"
+
+namespace {
+
+// Conversions other than from or to real32 go through a float buffer.
+const int retypify_chunk_len = 256;
+
+struct Real16Kernels {
+  void (*to_real32)(float *, const uint16_t *, int);
+  void (*from_real32)(uint16_t *, const float *, int);
+};
+
+Real16Kernels GetReal16Kernels() {
+  Real16Kernels kernels = {vector_real16_to_real32, vector_real32_to_real16};
+#if defined(MINIMGAPI_WITH_AVX)
+  if (GetMinImageSimdLevel() >= SIMD_AVX2) {
+    kernels.to_real32 = vector_real16_to_real32_avx2;
+    kernels.from_real32 = vector_real32_to_real16_avx2;
+  }
+#endif // defined(MINIMGAPI_WITH_AVX)
+  return kernels;
+}
+
+void LoadReal32(
+    float               *p_dst,
+    const uint8_t       *p_src,
+    MinTyp               src_type,
+    int                  len,
+    const Real16Kernels &real16) {
+  switch (src_type) {
+    case TYP_UINT8:
+      vector_uint8_to_real32(p_dst, p_src, len);
+      break;
+    case TYP_REAL16:
+      real16.to_real32(p_dst, reinterpret_cast<const uint16_t *>(p_src), len);
+      break;
+    default:
+      ::memcpy(p_dst, p_src, len * sizeof(float));
+  }
+}
+
+void StoreReal32(
+    uint8_t             *p_dst,
+    const float         *p_src,
+    MinTyp               dst_type,
+    int                  len,
+    const Real16Kernels &real16) {
+  switch (dst_type) {
+    case TYP_UINT8:
+      vector_round_row(p_dst, p_src, len);
+      break;
+    case TYP_REAL16:
+      real16.from_real32(reinterpret_cast<uint16_t *>(p_dst), p_src, len);
+      break;
+    default:
+      ::memcpy(p_dst, p_src, len * sizeof(float));
+  }
+}
+
+int RetypifyRows(
+    const MinImg        *p_dst_image,
+    const MinImg        *p_src_image,
+    int                  y_begin,
+    int                  y_end,
+    const Real16Kernels &real16) {
+  MinImg dst_band = {}, src_band = {};
+  PROPAGATE_ERROR(_GetMinImageRegion(&dst_band, p_dst_image, 0, y_begin,
+                                     p_dst_image->width, y_end - y_begin));
+  PROPAGATE_ERROR(_GetMinImageRegion(&src_band, p_src_image, 0, y_begin,
+                                     p_src_image->width, y_end - y_begin));
+  const MinTyp dst_type = static_cast<MinTyp>(_GetMinImageType(p_dst_image));
+  const MinTyp src_type = static_cast<MinTyp>(_GetMinImageType(p_src_image));
+  const int dst_depth = p_dst_image->channelDepth;
+  const int src_depth = p_src_image->channelDepth;
+  const int row_len = dst_band.width * dst_band.channels;
+  // Solid bands are converted in runs of rows as long as the byte length of
+  // a run still fits into int.
+  int run_rows = 1;
+  if (_AssureMinImageIsSolid(&dst_band) == NO_ERRORS &&
+      _AssureMinImageIsSolid(&src_band) == NO_ERRORS)
+    run_rows = std::max(
+        1, INT_MAX / (row_len * std::max(dst_depth, src_depth)));
+  MIN_ALIGNED(16) float buffer[retypify_chunk_len];
+  for (int y = 0; y < dst_band.height; y += run_rows) {
+    uint8_t *p_dst_line = _GetMinImageLine(&dst_band, y);
+    const uint8_t *p_src_line = _GetMinImageLine(&src_band, y);
+    if (!p_dst_line || !p_src_line)
+      return INTERNAL_ERROR;
+    const int len = std::min(run_rows, dst_band.height - y) * row_len;
+    if (src_type == TYP_REAL32)
+      StoreReal32(p_dst_line, reinterpret_cast<const float *>(p_src_line),
+                  dst_type, len, real16);
+    else if (dst_type == TYP_REAL32)
+      LoadReal32(reinterpret_cast<float *>(p_dst_line), p_src_line,
+                 src_type, len, real16);
+    else
+      for (int x = 0; x < len; x += retypify_chunk_len) {
+        const int chunk_len = std::min(retypify_chunk_len, len - x);
+        LoadReal32(buffer, p_src_line + x * src_depth, src_type, chunk_len,
+                   real16);
+        StoreReal32(p_dst_line + x * dst_depth, buffer, dst_type, chunk_len,
+                    real16);
+      }
+  }
+  return NO_ERRORS;
+}
+
+bool IsRetypifiable(int type) {
+  return type == TYP_UINT8 || type == TYP_REAL16 || type == TYP_REAL32;
+}
+
+} // namespace
+
+MINIMGAPI_API int RetypifyMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImage3DSizes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  const int dst_type = _GetMinImageType(p_dst_image);
+  const int src_type = _GetMinImageType(p_src_image);
+  if (dst_type == src_type)
+    return CopyMinImage(p_dst_image, p_src_image);
+  if (!IsRetypifiable(dst_type) || !IsRetypifiable(src_type))
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace || p_src_image->addressSpace)
+    return NOT_IMPLEMENTED;
+
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  if (tangling != TCR_INDEPENDENT_IMAGES)
+    return BAD_ARGS;
+
+  const Real16Kernels real16 = GetReal16Kernels();
+  int num_bands = GetParallelBandCount(
+      static_cast<int64_t>(p_dst_image->height) *
+      _GetMinImageBytesPerLine(p_dst_image), p_dst_image->height);
+  if (num_bands > 1)
+    return ParallelForBands(num_bands, p_dst_image->height, 1,
+                            [&](int y_begin, int y_end) -> int {
+      return RetypifyRows(p_dst_image, p_src_image, y_begin, y_end, real16);
+    });
+  return RetypifyRows(p_dst_image, p_src_image, 0, p_dst_image->height,
+                      real16);
+}
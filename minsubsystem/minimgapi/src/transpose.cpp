@@ -38,6 +38,7 @@ either expressed or implied, of copyright holders.
 #include <minimgapi/imgguard.hpp>
 #include "vector/transpose-inl.h"
 #include "bitcpy.h"
+#include "parallel.h"
 
 #if defined(MINSTOPWATCH_ENABLED)
 #  include <minstopwatch/stopwatch.hpp>
@@ -413,6 +414,74 @@ static int TransposeNBitsImage(
   return NO_ERRORS;
 }
 
+static int Transpose8BitTile(
+    uint8_t       *p_dst_buffer,
+    int            dst_stride,
+    const uint8_t *p_src_buffer,
+    int            src_stride,
+    int            src_width,
+    int            src_height) {
+  // On NEON Transpose8BitImage16x128Vertical is not always faster than
+  // Transpose8BitImage, so it is not used there. It was tested on 'odroid'.
+#if !defined(USE_NEON_SIMD)
+  if (src_height >= 16 && src_width >= 128)
+    return Transpose8BitImage16x128Vertical(p_dst_buffer, dst_stride,
+                                            p_src_buffer, src_stride,
+                                            src_width, src_height);
+#endif // !defined(USE_NEON_SIMD)
+  return Transpose8BitImage(p_dst_buffer, dst_stride, p_src_buffer, src_stride,
+                            src_width, src_height);
+}
+
+// Source regions larger than this are split before being passed to a kernel.
+static const int transpose_tile_bytes = 8 * 1024;
+
+// Splits the source recursively along its longer side until a tile with its
+// transposed counterpart fits into the cache, then transposes the tile with
+// the given kernel. The split points are aligned to 16 pixels, so the kernels
+// keep working with whole SIMD blocks. Being cache-oblivious, the traversal
+// keeps the cost per pixel nearly independent of the image size.
+template <typename TransposeKernel>
+static int TransposeTiled(
+    const TransposeKernel &transpose_tile,
+    uint8_t               *p_dst_buffer,
+    int                    dst_stride,
+    const uint8_t         *p_src_buffer,
+    int                    src_stride,
+    int                    src_width,
+    int                    src_height,
+    int                    bytes_per_pixel) {
+  if (static_cast<int64_t>(src_width) * src_height * bytes_per_pixel <=
+          transpose_tile_bytes || (src_width <= 16 && src_height <= 16))
+    return transpose_tile(p_dst_buffer, dst_stride, p_src_buffer, src_stride,
+                          src_width, src_height);
+
+  if (src_width >= src_height) {
+    int left_width = (src_width / 2 + 15) & ~15;
+    PROPAGATE_ERROR(TransposeTiled(transpose_tile, p_dst_buffer, dst_stride,
+                                   p_src_buffer, src_stride,
+                                   left_width, src_height, bytes_per_pixel));
+    return TransposeTiled(transpose_tile,
+                          p_dst_buffer +
+                              static_cast<ptrdiff_t>(left_width) * dst_stride,
+                          dst_stride,
+                          p_src_buffer + left_width * bytes_per_pixel,
+                          src_stride,
+                          src_width - left_width, src_height, bytes_per_pixel);
+  }
+
+  int top_height = (src_height / 2 + 15) & ~15;
+  PROPAGATE_ERROR(TransposeTiled(transpose_tile, p_dst_buffer, dst_stride,
+                                 p_src_buffer, src_stride,
+                                 src_width, top_height, bytes_per_pixel));
+  return TransposeTiled(transpose_tile,
+                        p_dst_buffer + top_height * bytes_per_pixel,
+                        dst_stride,
+                        p_src_buffer +
+                            static_cast<ptrdiff_t>(top_height) * src_stride,
+                        src_stride,
+                        src_width, src_height - top_height, bytes_per_pixel);
+}
 
 MINIMGAPI_API int TransposeMinImage(
     const MinImg *p_dst_image,
@@ -438,6 +507,27 @@ MINIMGAPI_API int TransposeMinImage(
 
   uint32_t tangling = 0;
   PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+
+  // Bands of destination rows are transposed from vertical strips of the source.
+  const int band_alignment = 16;
+  if (tangling == TCR_INDEPENDENT_IMAGES &&
+      !(GetMinImageBitsPerPixel(p_dst_image) & 0x07)) {
+    int num_bands = GetParallelBandCount(
+        static_cast<int64_t>(p_dst_image->height) *
+        _GetMinImageBytesPerLine(p_dst_image),
+        p_dst_image->height / band_alignment);
+    if (num_bands > 1)
+      return ParallelForBands(num_bands, p_dst_image->height, band_alignment,
+                              [&](int y_begin, int y_end) -> int {
+        MinImg dst_band = {0}, src_band = {0};
+        PROPAGATE_ERROR(_GetMinImageRegion(&dst_band, p_dst_image, 0, y_begin,
+                                   p_dst_image->width, y_end - y_begin));
+        PROPAGATE_ERROR(_GetMinImageRegion(&src_band, p_src_image, y_begin, 0,
+                                   y_end - y_begin, p_src_image->height));
+        return TransposeMinImage(&dst_band, &src_band);
+      });
+  }
+
   if (tangling != TCR_INDEPENDENT_IMAGES) {
     PROPAGATE_ERROR(AllocMinImage(&tmp_image));
     PROPAGATE_ERROR(CopyMinImage(&tmp_image, p_src_image));
@@ -477,38 +567,24 @@ MINIMGAPI_API int TransposeMinImage(
       return NO_ERRORS;
     }
     else
-      return Transpose8BitImage(p_work_dst_image->pScan0,
-                                p_work_dst_image->stride,
-                                p_work_src_image->pScan0,
-                                p_work_src_image->stride,
-                                p_work_src_image->width,
-                                p_work_src_image->height);
-#elif defined(USE_NEON_SIMD)
-    // Transpose8BitImage16x128Vertical is not always faster than Transpose8BitImage,
-    // so it is not used here. It was tested on 'odroid' platform.
-    return Transpose8BitImage(p_work_dst_image->pScan0,
-                              p_work_dst_image->stride,
-                              p_work_src_image->pScan0,
-                              p_work_src_image->stride,
-                              p_work_src_image->width,
-                              p_work_src_image->height);
-#else // !USE_NEON_SIMD
-    if (p_work_src_image->height >= 16 && p_work_src_image->width >= 128)
-      return Transpose8BitImage16x128Vertical (
-            p_work_dst_image->pScan0,
-            p_work_dst_image->stride,
-            p_work_src_image->pScan0,
-            p_work_src_image->stride,
-            p_work_src_image->width,
-            p_work_src_image->height);
-    else
-      return Transpose8BitImage(p_work_dst_image->pScan0,
-                                p_work_dst_image->stride,
-                                p_work_src_image->pScan0,
-                                p_work_src_image->stride,
-                                p_work_src_image->width,
-                                p_work_src_image->height);
-#endif // !USE_NEON_SIMD
+      return TransposeTiled(Transpose8BitTile,
+                            p_work_dst_image->pScan0,
+                            p_work_dst_image->stride,
+                            p_work_src_image->pScan0,
+                            p_work_src_image->stride,
+                            p_work_src_image->width,
+                            p_work_src_image->height,
+                            bytes_per_pixel);
+#else // !USE_ELBRUS_SIMD
+    return TransposeTiled(Transpose8BitTile,
+                          p_work_dst_image->pScan0,
+                          p_work_dst_image->stride,
+                          p_work_src_image->pScan0,
+                          p_work_src_image->stride,
+                          p_work_src_image->width,
+                          p_work_src_image->height,
+                          bytes_per_pixel);
+#endif // !USE_ELBRUS_SIMD
   case 2:
 #if defined(USE_ELBRUS_SIMD)
     if ((p_work_src_image->stride > 0) && (p_work_dst_image->stride > 0))
@@ -523,12 +599,14 @@ MINIMGAPI_API int TransposeMinImage(
       return NO_ERRORS;
     }
 #endif
-    return Transpose16BitImage(p_work_dst_image->pScan0,
-                               p_work_dst_image->stride,
-                               p_work_src_image->pScan0,
-                               p_work_src_image->stride,
-                               p_work_src_image->width,
-                               p_work_src_image->height);
+    return TransposeTiled(Transpose16BitImage,
+                          p_work_dst_image->pScan0,
+                          p_work_dst_image->stride,
+                          p_work_src_image->pScan0,
+                          p_work_src_image->stride,
+                          p_work_src_image->width,
+                          p_work_src_image->height,
+                          bytes_per_pixel);
   case 4:
 #if defined(USE_ELBRUS_SIMD)
     if ((p_work_src_image->stride > 0) && (p_work_dst_image->stride > 0))
@@ -543,26 +621,44 @@ MINIMGAPI_API int TransposeMinImage(
       return NO_ERRORS;
     }
 #endif
-    return Transpose32BitImage(p_work_dst_image->pScan0,
-                               p_work_dst_image->stride,
-                               p_work_src_image->pScan0,
-                               p_work_src_image->stride,
-                               p_work_src_image->width,
-                               p_work_src_image->height);
+    return TransposeTiled(Transpose32BitImage,
+                          p_work_dst_image->pScan0,
+                          p_work_dst_image->stride,
+                          p_work_src_image->pScan0,
+                          p_work_src_image->stride,
+                          p_work_src_image->width,
+                          p_work_src_image->height,
+                          bytes_per_pixel);
   case 8:
-    return Transpose64BitImage(p_work_dst_image->pScan0,
-                               p_work_dst_image->stride,
-                               p_work_src_image->pScan0,
-                               p_work_src_image->stride,
-                               p_work_src_image->width,
-                               p_work_src_image->height);
+    return TransposeTiled(Transpose64BitImage,
+                          p_work_dst_image->pScan0,
+                          p_work_dst_image->stride,
+                          p_work_src_image->pScan0,
+                          p_work_src_image->stride,
+                          p_work_src_image->width,
+                          p_work_src_image->height,
+                          bytes_per_pixel);
   default:
-    return TransposeNBytesImage(p_work_dst_image->pScan0,
-                                p_work_dst_image->stride,
-                                p_work_src_image->pScan0,
-                                p_work_src_image->stride,
-                                p_work_src_image->width,
-                                p_work_src_image->height,
-                                bytes_per_pixel);
+    return TransposeTiled([bytes_per_pixel](uint8_t *p_dst_buffer,
+                                            int dst_stride,
+                                            const uint8_t *p_src_buffer,
+                                            int src_stride,
+                                            int src_width,
+                                            int src_height) -> int {
+                            return TransposeNBytesImage(p_dst_buffer,
+                                                        dst_stride,
+                                                        p_src_buffer,
+                                                        src_stride,
+                                                        src_width,
+                                                        src_height,
+                                                        bytes_per_pixel);
+                          },
+                          p_work_dst_image->pScan0,
+                          p_work_dst_image->stride,
+                          p_work_src_image->pScan0,
+                          p_work_src_image->stride,
+                          p_work_src_image->width,
+                          p_work_src_image->height,
+                          bytes_per_pixel);
   }
 }
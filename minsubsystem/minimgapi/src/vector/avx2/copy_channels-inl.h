@@ -0,0 +1,313 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_AVX2_COPY_CHANNELS_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_AVX2_COPY_CHANNELS_INL_H_INCLUDED
+
+#include <immintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+#include "../../cpu_features.h"
+
+// Byte shuffle packing the first three channels of every pixel of a 128-bit
+// lane into its first 12 bytes.
+template<typename T> static MUSTINLINE __m128i Deinterleave4To3LaneShuffle() {
+  return _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i
+Deinterleave4To3LaneShuffle<uint8_t>() {
+  return _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i
+Deinterleave4To3LaneShuffle<uint16_t>() {
+  return _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+}
+
+// Every 32 bytes of the source give 24 bytes of the destination. For 64-bit
+// channels a pixel fills the whole register, so no shuffling is needed.
+template<typename T> static MINIMGAPI_TARGET_AVX2 void
+vector_deinterleave_4to3_avx2(
+    T       *p_dst,
+    const T *p_src,
+    int      len) {
+  const int pixels_per_step = 32 / (4 * sizeof(T));
+  const __m256i shuffle = _mm256_broadcastsi128_si256(
+                                          Deinterleave4To3LaneShuffle<T>());
+  const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+  const T *ps = p_src;
+  T *pd = p_dst;
+  int i = 0;
+  for (; i + pixels_per_step <= len;
+       i += pixels_per_step, ps += 4 * pixels_per_step,
+                             pd += 3 * pixels_per_step) {
+    __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ps));
+    if (sizeof(T) < 8)
+      pix = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pix, shuffle),
+                                        gather);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pd),
+                     _mm256_castsi256_si128(pix));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(pd) + 1,
+                     _mm256_extracti128_si256(pix, 1));
+  }
+  for (; i < len; ++i, ps += 4, pd += 3) {
+    pd[0] = ps[0];
+    pd[1] = ps[1];
+    pd[2] = ps[2];
+  }
+}
+
+// The planar kernels apply the riffle layers of the SSE ones (see
+// sse/copy_channels-inl.h) to both 128-bit lanes, each lane processing its own
+// group of pixels.
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i
+InterleaveLoAvx2(__m256i a, __m256i b) {
+  return sizeof(T) == 1 ? _mm256_unpacklo_epi8(a, b) :
+         sizeof(T) == 2 ? _mm256_unpacklo_epi16(a, b) :
+         sizeof(T) == 4 ? _mm256_unpacklo_epi32(a, b) :
+                          _mm256_unpacklo_epi64(a, b);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i
+InterleaveHiAvx2(__m256i a, __m256i b) {
+  return sizeof(T) == 1 ? _mm256_unpackhi_epi8(a, b) :
+         sizeof(T) == 2 ? _mm256_unpackhi_epi16(a, b) :
+         sizeof(T) == 4 ? _mm256_unpackhi_epi32(a, b) :
+                          _mm256_unpackhi_epi64(a, b);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i
+PackEvenAvx2(__m256i a, __m256i b) {
+  if (sizeof(T) == 1) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    return _mm256_packus_epi16(_mm256_and_si256(a, mask),
+                               _mm256_and_si256(b, mask));
+  }
+  if (sizeof(T) == 2) {
+    const __m256i mask = _mm256_set1_epi32(0x0000FFFF);
+    return _mm256_packus_epi32(_mm256_and_si256(a, mask),
+                               _mm256_and_si256(b, mask));
+  }
+  if (sizeof(T) == 4)
+    return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a),
+                                                 _mm256_castsi256_ps(b),
+                                                 _MM_SHUFFLE(2, 0, 2, 0)));
+  return _mm256_unpacklo_epi64(a, b);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i
+PackOddAvx2(__m256i a, __m256i b) {
+  if (sizeof(T) == 1)
+    return _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                               _mm256_srli_epi16(b, 8));
+  if (sizeof(T) == 2)
+    return _mm256_packus_epi32(_mm256_srli_epi32(a, 16),
+                               _mm256_srli_epi32(b, 16));
+  if (sizeof(T) == 4)
+    return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a),
+                                                 _mm256_castsi256_ps(b),
+                                                 _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm256_unpackhi_epi64(a, b);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE void RiffleAvx2(
+    __m256i &v0, __m256i &v1, __m256i &v2,
+    __m256i &v3, __m256i &v4, __m256i &v5) {
+  const __m256i t0 = InterleaveLoAvx2<T>(v0, v3);
+  const __m256i t1 = InterleaveHiAvx2<T>(v0, v3);
+  const __m256i t2 = InterleaveLoAvx2<T>(v1, v4);
+  const __m256i t3 = InterleaveHiAvx2<T>(v1, v4);
+  const __m256i t4 = InterleaveLoAvx2<T>(v2, v5);
+  const __m256i t5 = InterleaveHiAvx2<T>(v2, v5);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3, v4 = t4, v5 = t5;
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE void RiffleAvx2(
+    __m256i &v0, __m256i &v1, __m256i &v2, __m256i &v3) {
+  const __m256i t0 = InterleaveLoAvx2<T>(v0, v2);
+  const __m256i t1 = InterleaveHiAvx2<T>(v0, v2);
+  const __m256i t2 = InterleaveLoAvx2<T>(v1, v3);
+  const __m256i t3 = InterleaveHiAvx2<T>(v1, v3);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3;
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE void
+UnriffleAvx2(
+    __m256i &v0, __m256i &v1, __m256i &v2,
+    __m256i &v3, __m256i &v4, __m256i &v5) {
+  const __m256i t0 = PackEvenAvx2<T>(v0, v1);
+  const __m256i t1 = PackEvenAvx2<T>(v2, v3);
+  const __m256i t2 = PackEvenAvx2<T>(v4, v5);
+  const __m256i t3 = PackOddAvx2<T>(v0, v1);
+  const __m256i t4 = PackOddAvx2<T>(v2, v3);
+  const __m256i t5 = PackOddAvx2<T>(v4, v5);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3, v4 = t4, v5 = t5;
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 MUSTINLINE void
+UnriffleAvx2(
+    __m256i &v0, __m256i &v1, __m256i &v2, __m256i &v3) {
+  const __m256i t0 = PackEvenAvx2<T>(v0, v1);
+  const __m256i t1 = PackEvenAvx2<T>(v2, v3);
+  const __m256i t2 = PackOddAvx2<T>(v0, v1);
+  const __m256i t3 = PackOddAvx2<T>(v2, v3);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3;
+}
+
+static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i LoadSi256(const void *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+static MINIMGAPI_TARGET_AVX2 MUSTINLINE void StoreSi256(void *p, __m256i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+// Lane 0 of the result is the lane 0 of a, lane 1 is the lane 0 of b.
+static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i JoinLo(__m256i a, __m256i b) {
+  return _mm256_permute2x128_si256(a, b, 0x20);
+}
+
+// Lane 0 of the result is the lane 1 of a, lane 1 is the lane 1 of b.
+static MINIMGAPI_TARGET_AVX2 MUSTINLINE __m256i JoinHi(__m256i a, __m256i b) {
+  return _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 void
+vector_deinterleave_3to1_avx2(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>();
+  T *pd0 = pp_dst[0], *pd1 = pp_dst[1], *pd2 = pp_dst[2];
+  int i = 0;
+  for (; i + 4 * n <= len; i += 4 * n) {
+    const T *ps = p_src + 3 * i;
+    const __m256i x0 = LoadSi256(ps), y0 = LoadSi256(ps + 6 * n);
+    const __m256i x1 = LoadSi256(ps + 2 * n), y1 = LoadSi256(ps + 8 * n);
+    const __m256i x2 = LoadSi256(ps + 4 * n), y2 = LoadSi256(ps + 10 * n);
+    __m256i v0 = JoinLo(x0, y0), v1 = JoinHi(x0, y0);
+    __m256i v2 = JoinLo(x1, y1), v3 = JoinHi(x1, y1);
+    __m256i v4 = JoinLo(x2, y2), v5 = JoinHi(x2, y2);
+    for (int k = 0; k < layers; ++k)
+      RiffleAvx2<T>(v0, v1, v2, v3, v4, v5);
+    StoreSi256(pd0 + i, JoinLo(v0, v1)), StoreSi256(pd0 + i + 2 * n,
+                                                    JoinHi(v0, v1));
+    StoreSi256(pd1 + i, JoinLo(v2, v3)), StoreSi256(pd1 + i + 2 * n,
+                                                    JoinHi(v2, v3));
+    StoreSi256(pd2 + i, JoinLo(v4, v5)), StoreSi256(pd2 + i + 2 * n,
+                                                    JoinHi(v4, v5));
+  }
+  T *const pp_tail[3] = {pd0 + i, pd1 + i, pd2 + i};
+  SseDeinterleave3To1(pp_tail, p_src + 3 * i, len - i);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 void
+vector_deinterleave_4to1_avx2(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>() - 1;
+  T *pd0 = pp_dst[0], *pd1 = pp_dst[1], *pd2 = pp_dst[2], *pd3 = pp_dst[3];
+  int i = 0;
+  for (; i + 2 * n <= len; i += 2 * n) {
+    const T *ps = p_src + 4 * i;
+    const __m256i x0 = LoadSi256(ps), y0 = LoadSi256(ps + 4 * n);
+    const __m256i x1 = LoadSi256(ps + 2 * n), y1 = LoadSi256(ps + 6 * n);
+    __m256i v0 = JoinLo(x0, y0), v1 = JoinHi(x0, y0);
+    __m256i v2 = JoinLo(x1, y1), v3 = JoinHi(x1, y1);
+    for (int k = 0; k < layers; ++k)
+      RiffleAvx2<T>(v0, v1, v2, v3);
+    StoreSi256(pd0 + i, v0), StoreSi256(pd1 + i, v1);
+    StoreSi256(pd2 + i, v2), StoreSi256(pd3 + i, v3);
+  }
+  T *const pp_tail[4] = {pd0 + i, pd1 + i, pd2 + i, pd3 + i};
+  SseDeinterleave4To1(pp_tail, p_src + 4 * i, len - i);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 void
+vector_interleave_1to3_avx2(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>();
+  const T *ps0 = pp_src[0], *ps1 = pp_src[1], *ps2 = pp_src[2];
+  int i = 0;
+  for (; i + 4 * n <= len; i += 4 * n) {
+    const __m256i a0 = LoadSi256(ps0 + i), b0 = LoadSi256(ps0 + i + 2 * n);
+    const __m256i a1 = LoadSi256(ps1 + i), b1 = LoadSi256(ps1 + i + 2 * n);
+    const __m256i a2 = LoadSi256(ps2 + i), b2 = LoadSi256(ps2 + i + 2 * n);
+    __m256i v0 = JoinLo(a0, b0), v1 = JoinHi(a0, b0);
+    __m256i v2 = JoinLo(a1, b1), v3 = JoinHi(a1, b1);
+    __m256i v4 = JoinLo(a2, b2), v5 = JoinHi(a2, b2);
+    for (int k = 0; k < layers; ++k)
+      UnriffleAvx2<T>(v0, v1, v2, v3, v4, v5);
+    T *pd = p_dst + 3 * i;
+    StoreSi256(pd, JoinLo(v0, v1)), StoreSi256(pd + 6 * n, JoinHi(v0, v1));
+    StoreSi256(pd + 2 * n, JoinLo(v2, v3));
+    StoreSi256(pd + 8 * n, JoinHi(v2, v3));
+    StoreSi256(pd + 4 * n, JoinLo(v4, v5));
+    StoreSi256(pd + 10 * n, JoinHi(v4, v5));
+  }
+  const T *const pp_tail[3] = {ps0 + i, ps1 + i, ps2 + i};
+  SseInterleave1To3(p_dst + 3 * i, pp_tail, len - i);
+}
+
+template<typename T> static MINIMGAPI_TARGET_AVX2 void
+vector_interleave_1to4_avx2(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>() - 1;
+  const T *ps0 = pp_src[0], *ps1 = pp_src[1];
+  const T *ps2 = pp_src[2], *ps3 = pp_src[3];
+  int i = 0;
+  for (; i + 2 * n <= len; i += 2 * n) {
+    __m256i v0 = LoadSi256(ps0 + i), v1 = LoadSi256(ps1 + i);
+    __m256i v2 = LoadSi256(ps2 + i), v3 = LoadSi256(ps3 + i);
+    for (int k = 0; k < layers; ++k)
+      UnriffleAvx2<T>(v0, v1, v2, v3);
+    T *pd = p_dst + 4 * i;
+    StoreSi256(pd, JoinLo(v0, v1)), StoreSi256(pd + 2 * n, JoinLo(v2, v3));
+    StoreSi256(pd + 4 * n, JoinHi(v0, v1));
+    StoreSi256(pd + 6 * n, JoinHi(v2, v3));
+  }
+  const T *const pp_tail[4] = {ps0 + i, ps1 + i, ps2 + i, ps3 + i};
+  SseInterleave1To4(p_dst + 4 * i, pp_tail, len - i);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_AVX2_COPY_CHANNELS_INL_H_INCLUDED
@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_AVX2_RETYPIFY_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_AVX2_RETYPIFY_INL_H_INCLUDED
+
+#include <immintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+#include "../../cpu_features.h"
+
+// The F16C conversions are exact for half to float and round to nearest even
+// for float to half, matching the generic kernels bit for bit.
+static MINIMGAPI_TARGET_AVX2 void vector_real16_to_real32_avx2(
+    float          *p_dst,
+    const uint16_t *p_src,
+    int             len) {
+  int i = 0;
+  for (; i + 8 <= len; i += 8)
+    _mm256_storeu_ps(p_dst + i, _mm256_cvtph_ps(_mm_loadu_si128(
+                         reinterpret_cast<const __m128i *>(p_src + i))));
+  generic_vector_real16_to_real32(p_dst + i, p_src + i, len - i);
+}
+
+static MINIMGAPI_TARGET_AVX2 void vector_real32_to_real16_avx2(
+    uint16_t    *p_dst,
+    const float *p_src,
+    int          len) {
+  int i = 0;
+  for (; i + 8 <= len; i += 8)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i),
+                     _mm256_cvtps_ph(_mm256_loadu_ps(p_src + i),
+                                     _MM_FROUND_TO_NEAREST_INT));
+  generic_vector_real32_to_real16(p_dst + i, p_src + i, len - i);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_AVX2_RETYPIFY_INL_H_INCLUDED
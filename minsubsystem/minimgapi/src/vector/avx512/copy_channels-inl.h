@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_AVX512_COPY_CHANNELS_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_AVX512_COPY_CHANNELS_INL_H_INCLUDED
+
+#include <immintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+#include "../../cpu_features.h"
+#include "../avx2/copy_channels-inl.h"
+
+// Every 64 bytes of the source give 48 bytes of the destination, written with
+// a masked store.
+template<typename T> static MINIMGAPI_TARGET_AVX512 void
+vector_deinterleave_4to3_avx512(
+    T       *p_dst,
+    const T *p_src,
+    int      len) {
+  const int pixels_per_step = 64 / (4 * sizeof(T));
+  const __m512i shuffle = _mm512_broadcast_i32x4(
+                                          Deinterleave4To3LaneShuffle<T>());
+  const __m512i gather = sizeof(T) < 8 ?
+      _mm512_setr_epi32(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 15, 15, 15, 15) :
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, 15, 15, 15, 15);
+  const __mmask16 store_mask = 0x0FFF;
+  const T *ps = p_src;
+  T *pd = p_dst;
+  int i = 0;
+  for (; i + pixels_per_step <= len;
+       i += pixels_per_step, ps += 4 * pixels_per_step,
+                             pd += 3 * pixels_per_step) {
+    __m512i pix = _mm512_loadu_si512(ps);
+    if (sizeof(T) < 8)
+      pix = _mm512_shuffle_epi8(pix, shuffle);
+    _mm512_mask_storeu_epi32(pd, store_mask,
+                             _mm512_permutexvar_epi32(gather, pix));
+  }
+  for (; i < len; ++i, ps += 4, pd += 3) {
+    pd[0] = ps[0];
+    pd[1] = ps[1];
+    pd[2] = ps[2];
+  }
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_AVX512_COPY_CHANNELS_INL_H_INCLUDED
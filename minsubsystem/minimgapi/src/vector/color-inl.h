@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_COLOR_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_COLOR_INL_H_INCLUDED
+
+#include <cmath>
+#include <minutils/smartptr.h>
+#include <minbase/crossplat.h>
+
+// Applies an affine transform to planar colors: c_i = sum_j m[4i+j] c_j + m[4i+3]
+static MUSTINLINE void generic_vector_transform_colors(
+    float       *p_c0,
+    float       *p_c1,
+    float       *p_c2,
+    int          len,
+    const float *p_matrix) {
+  for (int i = 0; i < len; ++i) {
+    const float c0 = p_c0[i], c1 = p_c1[i], c2 = p_c2[i];
+    p_c0[i] = p_matrix[0] * c0 + p_matrix[1] * c1 + p_matrix[2] * c2 +
+              p_matrix[3];
+    p_c1[i] = p_matrix[4] * c0 + p_matrix[5] * c1 + p_matrix[6] * c2 +
+              p_matrix[7];
+    p_c2[i] = p_matrix[8] * c0 + p_matrix[9] * c1 + p_matrix[10] * c2 +
+              p_matrix[11];
+  }
+}
+
+// Applies a projective transform (4x4 matrix) to planar colors. The result is
+// not divided by the homogeneous coordinate if its magnitude is below eps.
+static MUSTINLINE void generic_vector_project_colors(
+    float       *p_c0,
+    float       *p_c1,
+    float       *p_c2,
+    int          len,
+    const float *p_matrix,
+    float        eps) {
+  for (int i = 0; i < len; ++i) {
+    const float c0 = p_c0[i], c1 = p_c1[i], c2 = p_c2[i];
+    float w = p_matrix[12] * c0 + p_matrix[13] * c1 + p_matrix[14] * c2 +
+              p_matrix[15];
+    w = std::abs(w) >= eps ? 1.f / w : 1.f;
+    p_c0[i] = (p_matrix[0] * c0 + p_matrix[1] * c1 + p_matrix[2] * c2 +
+               p_matrix[3]) * w;
+    p_c1[i] = (p_matrix[4] * c0 + p_matrix[5] * c1 + p_matrix[6] * c2 +
+               p_matrix[7]) * w;
+    p_c2[i] = (p_matrix[8] * c0 + p_matrix[9] * c1 + p_matrix[10] * c2 +
+               p_matrix[11]) * w;
+  }
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/color-inl.h"
+#else
+
+static MUSTINLINE void vector_transform_colors(
+    float       *p_c0,
+    float       *p_c1,
+    float       *p_c2,
+    int          len,
+    const float *p_matrix) {
+  generic_vector_transform_colors(p_c0, p_c1, p_c2, len, p_matrix);
+}
+
+static MUSTINLINE void vector_project_colors(
+    float       *p_c0,
+    float       *p_c1,
+    float       *p_c2,
+    int          len,
+    const float *p_matrix,
+    float        eps) {
+  generic_vector_project_colors(p_c0, p_c1, p_c2, len, p_matrix, eps);
+}
+
+#endif
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_COLOR_INL_H_INCLUDED
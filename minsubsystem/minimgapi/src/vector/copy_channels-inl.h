@@ -49,10 +49,74 @@ template<typename T> static MUSTINLINE void vector_deinterleave_4to3(
   }
 }
 
+template<typename T> static MUSTINLINE void generic_vector_deinterleave(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       channels,
+    int       len) {
+  for (int c = 0; c < channels; ++c) {
+    T *pd = pp_dst[c];
+    const T *ps = p_src + c;
+    for (int i = 0; i < len; ++i, ps += channels)
+      pd[i] = *ps;
+  }
+}
+
+template<typename T> static MUSTINLINE void generic_vector_interleave(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             channels,
+    int             len) {
+  for (int c = 0; c < channels; ++c) {
+    const T *ps = pp_src[c];
+    T *pd = p_dst + c;
+    for (int i = 0; i < len; ++i, pd += channels)
+      *pd = ps[i];
+  }
+}
+
+// Splits a line of 3-channel pixels into three planes.
+template<typename T> static MUSTINLINE void vector_deinterleave_3to1(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       len) {
+  generic_vector_deinterleave(pp_dst, p_src, 3, len);
+}
+
+// Splits a line of 4-channel pixels into four planes.
+template<typename T> static MUSTINLINE void vector_deinterleave_4to1(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       len) {
+  generic_vector_deinterleave(pp_dst, p_src, 4, len);
+}
+
+// Merges three planes into a line of 3-channel pixels.
+template<typename T> static MUSTINLINE void vector_interleave_1to3(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             len) {
+  generic_vector_interleave(p_dst, pp_src, 3, len);
+}
+
+// Merges four planes into a line of 4-channel pixels.
+template<typename T> static MUSTINLINE void vector_interleave_1to4(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             len) {
+  generic_vector_interleave(p_dst, pp_src, 4, len);
+}
+
 #if defined(USE_SSE_SIMD)
 #include "sse/copy_channels-inl.h"
 #elif defined(USE_NEON_SIMD)
 #include "neon/copy_channels-inl.h"
 #endif
 
+#include "../cpu_features.h"
+#if defined(MINIMGAPI_WITH_AVX)
+#include "avx2/copy_channels-inl.h"
+#include "avx512/copy_channels-inl.h"
+#endif
+
 #endif // #ifndef MINIMGAPI_SRC_VECTOR_COPY_CHANNELS_INL_H_INCLUDED
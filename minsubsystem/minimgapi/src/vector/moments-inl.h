@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_MOMENTS_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_MOMENTS_INL_H_INCLUDED
+
+#include <stdint.h>
+#include <minutils/smartptr.h>
+#include <minbase/crossplat.h>
+
+// The kernels add moments of len interleaved pixels: p_sums[i] gets the sum of
+// channel i and p_cross_products[i * channels + j] for j >= i gets the sum of
+// products of channels i and j (the lower triangle is left intact). Integer
+// pixels are accumulated in integers, so the results are exact.
+
+template <typename T, typename TSum>
+static MUSTINLINE void generic_vector_moments(
+    const T *p_pixels,
+    int      len,
+    int      channels,
+    TSum    *p_sums,
+    TSum    *p_cross_products) {
+  for (int x = 0; x < len; ++x, p_pixels += channels)
+    for (int i = 0; i < channels; ++i) {
+      const TSum v = p_pixels[i];
+      p_sums[i] += v;
+      for (int j = i; j < channels; ++j)
+        p_cross_products[i * channels + j] += v * p_pixels[j];
+    }
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/moments-inl.h"
+#else
+
+static MUSTINLINE void vector_moments_8u(
+    const uint8_t *p_pixels,
+    int            len,
+    int            channels,
+    int64_t       *p_sums,
+    int64_t       *p_cross_products) {
+  generic_vector_moments(p_pixels, len, channels, p_sums, p_cross_products);
+}
+
+static MUSTINLINE void vector_moments_16u(
+    const uint16_t *p_pixels,
+    int             len,
+    int             channels,
+    int64_t        *p_sums,
+    int64_t        *p_cross_products) {
+  generic_vector_moments(p_pixels, len, channels, p_sums, p_cross_products);
+}
+
+#endif
+
+static MUSTINLINE void vector_moments_32f(
+    const float *p_pixels,
+    int          len,
+    int          channels,
+    double      *p_sums,
+    double      *p_cross_products) {
+  generic_vector_moments(p_pixels, len, channels, p_sums, p_cross_products);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_MOMENTS_INL_H_INCLUDED
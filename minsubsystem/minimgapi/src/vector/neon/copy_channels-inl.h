@@ -64,4 +64,67 @@ template<> STATIC_SPECIAL MUSTINLINE void vector_deinterleave_4to3(
   }
 }
 
+#define MINIMGAPI_NEON_CHANNEL_KERNELS(T, suffix, n)                          \
+template<> STATIC_SPECIAL MUSTINLINE void vector_deinterleave_3to1(           \
+    T##_t *const *pp_dst, const T##_t *p_src, int len) {                      \
+  int i = 0;                                                                  \
+  for (; i + n <= len; i += n) {                                              \
+    const T##x##n##x3_t pix = vld3q_##suffix(p_src + 3 * i);                  \
+    vst1q_##suffix(pp_dst[0] + i, pix.val[0]);                                \
+    vst1q_##suffix(pp_dst[1] + i, pix.val[1]);                                \
+    vst1q_##suffix(pp_dst[2] + i, pix.val[2]);                                \
+  }                                                                           \
+  T##_t *const pp_tail[3] = {pp_dst[0] + i, pp_dst[1] + i, pp_dst[2] + i};    \
+  generic_vector_deinterleave(pp_tail, p_src + 3 * i, 3, len - i);            \
+}                                                                             \
+template<> STATIC_SPECIAL MUSTINLINE void vector_deinterleave_4to1(           \
+    T##_t *const *pp_dst, const T##_t *p_src, int len) {                      \
+  int i = 0;                                                                  \
+  for (; i + n <= len; i += n) {                                              \
+    const T##x##n##x4_t pix = vld4q_##suffix(p_src + 4 * i);                  \
+    vst1q_##suffix(pp_dst[0] + i, pix.val[0]);                                \
+    vst1q_##suffix(pp_dst[1] + i, pix.val[1]);                                \
+    vst1q_##suffix(pp_dst[2] + i, pix.val[2]);                                \
+    vst1q_##suffix(pp_dst[3] + i, pix.val[3]);                                \
+  }                                                                           \
+  T##_t *const pp_tail[4] = {pp_dst[0] + i, pp_dst[1] + i, pp_dst[2] + i,     \
+                             pp_dst[3] + i};                                  \
+  generic_vector_deinterleave(pp_tail, p_src + 4 * i, 4, len - i);            \
+}                                                                             \
+template<> STATIC_SPECIAL MUSTINLINE void vector_interleave_1to3(             \
+    T##_t *p_dst, const T##_t *const *pp_src, int len) {                      \
+  int i = 0;                                                                  \
+  for (; i + n <= len; i += n) {                                              \
+    T##x##n##x3_t pix;                                                        \
+    pix.val[0] = vld1q_##suffix(pp_src[0] + i);                               \
+    pix.val[1] = vld1q_##suffix(pp_src[1] + i);                               \
+    pix.val[2] = vld1q_##suffix(pp_src[2] + i);                               \
+    vst3q_##suffix(p_dst + 3 * i, pix);                                       \
+  }                                                                           \
+  const T##_t *const pp_tail[3] = {pp_src[0] + i, pp_src[1] + i,              \
+                                   pp_src[2] + i};                            \
+  generic_vector_interleave(p_dst + 3 * i, pp_tail, 3, len - i);              \
+}                                                                             \
+template<> STATIC_SPECIAL MUSTINLINE void vector_interleave_1to4(             \
+    T##_t *p_dst, const T##_t *const *pp_src, int len) {                      \
+  int i = 0;                                                                  \
+  for (; i + n <= len; i += n) {                                              \
+    T##x##n##x4_t pix;                                                        \
+    pix.val[0] = vld1q_##suffix(pp_src[0] + i);                               \
+    pix.val[1] = vld1q_##suffix(pp_src[1] + i);                               \
+    pix.val[2] = vld1q_##suffix(pp_src[2] + i);                               \
+    pix.val[3] = vld1q_##suffix(pp_src[3] + i);                               \
+    vst4q_##suffix(p_dst + 4 * i, pix);                                       \
+  }                                                                           \
+  const T##_t *const pp_tail[4] = {pp_src[0] + i, pp_src[1] + i,              \
+                                   pp_src[2] + i, pp_src[3] + i};             \
+  generic_vector_interleave(p_dst + 4 * i, pp_tail, 4, len - i);              \
+}
+
+MINIMGAPI_NEON_CHANNEL_KERNELS(uint8, u8, 16)
+MINIMGAPI_NEON_CHANNEL_KERNELS(uint16, u16, 8)
+MINIMGAPI_NEON_CHANNEL_KERNELS(uint32, u32, 4)
+
+#undef MINIMGAPI_NEON_CHANNEL_KERNELS
+
 #endif // #ifndef MINIMGAPI_SRC_VECTOR_NEON_COPY_CHANNELS_INL_H_INCLUDED
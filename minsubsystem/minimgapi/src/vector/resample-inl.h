@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_RESAMPLE_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_RESAMPLE_INL_H_INCLUDED
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <minutils/smartptr.h>
+#include <minbase/crossplat.h>
+
+// p_dst[i] = weight * p_src[i]
+static MUSTINLINE void generic_vector_scale_row(
+    float       *p_dst,
+    const float *p_src,
+    float        weight,
+    int          len) {
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = weight * p_src[i];
+}
+
+// p_dst[i] += weight * p_src[i]
+static MUSTINLINE void generic_vector_accumulate_row(
+    float       *p_dst,
+    const float *p_src,
+    float        weight,
+    int          len) {
+  for (int i = 0; i < len; ++i)
+    p_dst[i] += weight * p_src[i];
+}
+
+// Converts to integer type rounding half up with saturation.
+template<typename T> static MUSTINLINE void generic_vector_round_row(
+    T           *p_dst,
+    const float *p_src,
+    int          len) {
+  const float max_value = static_cast<float>(std::numeric_limits<T>::max());
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = static_cast<T>(std::min(std::max(p_src[i], 0.f), max_value) +
+                              0.5f);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE void generic_vector_round_row(
+    float       *p_dst,
+    const float *p_src,
+    int          len) {
+  ::memcpy(p_dst, p_src, len * sizeof(float));
+}
+
+// Computes elements [begin, len) of a horizontally resampled line. The taps of
+// the elements are stored in blocks of four elements: the offset and the weight
+// of tap t of element i are at index (i / 4 * num_taps + t) * 4 + i % 4.
+template<typename T> static MUSTINLINE void generic_vector_interpolate_row(
+    float       *p_dst,
+    const T     *p_src,
+    const int   *p_offsets,
+    const float *p_weights,
+    int          num_taps,
+    int          begin,
+    int          len) {
+  for (int i = begin; i < len; ++i) {
+    const size_t first = static_cast<size_t>(i / 4) * num_taps * 4 + i % 4;
+    float sum = 0.f;
+    for (int tap = 0; tap < num_taps; ++tap)
+      sum += p_weights[first + 4 * tap] * p_src[p_offsets[first + 4 * tap]];
+    p_dst[i] = sum;
+  }
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/resample-inl.h"
+#else
+
+template<typename T> static MUSTINLINE void vector_interpolate_row(
+    float       *p_dst,
+    const T     *p_src,
+    const int   *p_offsets,
+    const float *p_weights,
+    int          num_taps,
+    int          len) {
+  generic_vector_interpolate_row(p_dst, p_src, p_offsets, p_weights, num_taps,
+                                 0, len);
+}
+
+static MUSTINLINE void vector_scale_row(
+    float       *p_dst,
+    const float *p_src,
+    float        weight,
+    int          len) {
+  generic_vector_scale_row(p_dst, p_src, weight, len);
+}
+
+static MUSTINLINE void vector_accumulate_row(
+    float       *p_dst,
+    const float *p_src,
+    float        weight,
+    int          len) {
+  generic_vector_accumulate_row(p_dst, p_src, weight, len);
+}
+
+template<typename T> static MUSTINLINE void vector_round_row(
+    T           *p_dst,
+    const float *p_src,
+    int          len) {
+  generic_vector_round_row(p_dst, p_src, len);
+}
+
+#endif
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_RESAMPLE_INL_H_INCLUDED
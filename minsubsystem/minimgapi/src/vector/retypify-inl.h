@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_RETYPIFY_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_RETYPIFY_INL_H_INCLUDED
+
+#include <cstring>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+
+// Half precision numbers are stored as uint16_t bit patterns. NaNs keep the
+// upper bits of their payload and are made quiet, the same way the F16C
+// instructions do it.
+static MUSTINLINE float generic_real16_to_real32(uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1F;
+  uint32_t mantissa = half & 0x3FF;
+  uint32_t bits = sign;
+  if (exponent == 0x1F)
+    bits |= 0x7F800000 | (mantissa ? 0x400000 : 0) | (mantissa << 13);
+  else if (exponent)
+    bits |= ((exponent + 112) << 23) | (mantissa << 13);
+  else if (mantissa) {
+    uint32_t normalized_exponent = 113;
+    while (!(mantissa & 0x400)) {
+      mantissa <<= 1;
+      --normalized_exponent;
+    }
+    bits |= (normalized_exponent << 23) | ((mantissa & 0x3FF) << 13);
+  }
+  float value = 0.f;
+  ::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Rounds to nearest even, overflowing to infinity.
+static MUSTINLINE uint16_t generic_real32_to_real16(float value) {
+  uint32_t bits = 0;
+  ::memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  bits &= 0x7FFFFFFF;
+  if (bits > 0x7F800000)  // NaN
+    return sign | 0x7E00 | ((bits >> 13) & 0x3FF);
+  if (bits >= 0x477FF000)  // 65520 and above
+    return sign | 0x7C00;
+
+  uint32_t result = 0;
+  uint32_t remainder = 0;
+  uint32_t half_ulp = 0;
+  if (bits >= 0x38800000) {  // normal result
+    result = (bits - 0x38000000) >> 13;
+    remainder = bits & 0x1FFF;
+    half_ulp = 0x1000;
+  } else if (bits >= 0x33000000) {  // subnormal result
+    const uint32_t mantissa = (bits & 0x7FFFFF) | 0x800000;
+    const int shift = 126 - static_cast<int>(bits >> 23);
+    result = mantissa >> shift;
+    remainder = mantissa & ((1u << shift) - 1);
+    half_ulp = 1u << (shift - 1);
+  }
+  if (remainder > half_ulp || (remainder == half_ulp && (result & 1)))
+    ++result;
+  return sign | static_cast<uint16_t>(result);
+}
+
+static MUSTINLINE void generic_vector_real16_to_real32(
+    float          *p_dst,
+    const uint16_t *p_src,
+    int             len) {
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = generic_real16_to_real32(p_src[i]);
+}
+
+static MUSTINLINE void generic_vector_real32_to_real16(
+    uint16_t    *p_dst,
+    const float *p_src,
+    int          len) {
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = generic_real32_to_real16(p_src[i]);
+}
+
+static MUSTINLINE void generic_vector_uint8_to_real32(
+    float         *p_dst,
+    const uint8_t *p_src,
+    int            len) {
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = static_cast<float>(p_src[i]);
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/retypify-inl.h"
+#else
+
+static MUSTINLINE void vector_real16_to_real32(
+    float          *p_dst,
+    const uint16_t *p_src,
+    int             len) {
+  generic_vector_real16_to_real32(p_dst, p_src, len);
+}
+
+static MUSTINLINE void vector_real32_to_real16(
+    uint16_t    *p_dst,
+    const float *p_src,
+    int          len) {
+  generic_vector_real32_to_real16(p_dst, p_src, len);
+}
+
+static MUSTINLINE void vector_uint8_to_real32(
+    float         *p_dst,
+    const uint8_t *p_src,
+    int            len) {
+  generic_vector_uint8_to_real32(p_dst, p_src, len);
+}
+
+#endif
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_RETYPIFY_INL_H_INCLUDED
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_SSE_COLOR_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_SSE_COLOR_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+
+// Returns m[0] c0 + m[1] c1 + m[2] c2 + m[3] for 4 pixels.
+static MUSTINLINE __m128 DotColorsPs(
+    __m128       c0,
+    __m128       c1,
+    __m128       c2,
+    const float *p_row) {
+  return _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p_row[0]), c0),
+                 _mm_mul_ps(_mm_set1_ps(p_row[1]), c1)),
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p_row[2]), c2),
+                 _mm_set1_ps(p_row[3])));
+}
+
+static MUSTINLINE void vector_transform_colors(
+    float       *p_c0,
+    float       *p_c1,
+    float       *p_c2,
+    int          len,
+    const float *p_matrix) {
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    const __m128 c0 = _mm_loadu_ps(p_c0 + i);
+    const __m128 c1 = _mm_loadu_ps(p_c1 + i);
+    const __m128 c2 = _mm_loadu_ps(p_c2 + i);
+    _mm_storeu_ps(p_c0 + i, DotColorsPs(c0, c1, c2, p_matrix));
+    _mm_storeu_ps(p_c1 + i, DotColorsPs(c0, c1, c2, p_matrix + 4));
+    _mm_storeu_ps(p_c2 + i, DotColorsPs(c0, c1, c2, p_matrix + 8));
+  }
+  generic_vector_transform_colors(p_c0 + i, p_c1 + i, p_c2 + i, len - i,
+                                  p_matrix);
+}
+
+static MUSTINLINE void vector_project_colors(
+    float       *p_c0,
+    float       *p_c1,
+    float       *p_c2,
+    int          len,
+    const float *p_matrix,
+    float        eps) {
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  const __m128 eps_ps = _mm_set1_ps(eps);
+  const __m128 one = _mm_set1_ps(1.f);
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    const __m128 c0 = _mm_loadu_ps(p_c0 + i);
+    const __m128 c1 = _mm_loadu_ps(p_c1 + i);
+    const __m128 c2 = _mm_loadu_ps(p_c2 + i);
+    const __m128 w = DotColorsPs(c0, c1, c2, p_matrix + 12);
+    const __m128 valid = _mm_cmpge_ps(_mm_and_ps(w, abs_mask), eps_ps);
+    const __m128 inv_w = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(one, w)),
+                                   _mm_andnot_ps(valid, one));
+    _mm_storeu_ps(p_c0 + i,
+                  _mm_mul_ps(DotColorsPs(c0, c1, c2, p_matrix), inv_w));
+    _mm_storeu_ps(p_c1 + i,
+                  _mm_mul_ps(DotColorsPs(c0, c1, c2, p_matrix + 4), inv_w));
+    _mm_storeu_ps(p_c2 + i,
+                  _mm_mul_ps(DotColorsPs(c0, c1, c2, p_matrix + 8), inv_w));
+  }
+  generic_vector_project_colors(p_c0 + i, p_c1 + i, p_c2 + i, len - i,
+                                p_matrix, eps);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_SSE_COLOR_INL_H_INCLUDED
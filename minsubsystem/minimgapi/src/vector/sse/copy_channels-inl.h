@@ -38,4 +38,298 @@ either expressed or implied, of copyright holders.
 #include <minbase/crossplat.h>
 #include <minutils/smartptr.h>
 
+/*
+ * The kernels treat a group of registers as one sequence of n elements and
+ * permute it with layers of the perfect shuffle (riffle), which interleaves
+ * the first half of the sequence with the second one and so moves the element
+ * at position p to position 2p mod (n - 1). Channel c of pixel i is at
+ * position ki + c for k-channel pixels and has to be moved to (n / k)c + i,
+ * so 2 to the power of the layer count is n / k: 5 layers split 3-channel
+ * uint8 pixels held in 6 registers, 4 layers split 4-channel ones held in 4
+ * registers, and every doubling of the element size takes one layer less.
+ * The inverse layer (unriffle) separates the elements at even and odd
+ * positions.
+ */
+
+template<typename T> static MUSTINLINE __m128i InterleaveLo(__m128i a,
+                                                            __m128i b);
+template<typename T> static MUSTINLINE __m128i InterleaveHi(__m128i a,
+                                                            __m128i b);
+template<typename T> static MUSTINLINE __m128i PackEven(__m128i a, __m128i b);
+template<typename T> static MUSTINLINE __m128i PackOdd(__m128i a, __m128i b);
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveLo<uint8_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpacklo_epi8(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveHi<uint8_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpackhi_epi8(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackEven<uint8_t>(
+    __m128i a,
+    __m128i b) {
+  const __m128i mask = _mm_set1_epi16(0x00FF);
+  return _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackOdd<uint8_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveLo<uint16_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpacklo_epi16(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveHi<uint16_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpackhi_epi16(a, b);
+}
+
+// SSE2 has no unsigned 32-to-16 bit packing, so the values are sign extended
+// to stay in the range of the signed one.
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackEven<uint16_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                         _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackOdd<uint16_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveLo<uint32_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpacklo_epi32(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveHi<uint32_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpackhi_epi32(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackEven<uint32_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a),
+                                         _mm_castsi128_ps(b),
+                                         _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackOdd<uint32_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a),
+                                         _mm_castsi128_ps(b),
+                                         _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveLo<uint64_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpacklo_epi64(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i InterleaveHi<uint64_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpackhi_epi64(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackEven<uint64_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpacklo_epi64(a, b);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE __m128i PackOdd<uint64_t>(
+    __m128i a,
+    __m128i b) {
+  return _mm_unpackhi_epi64(a, b);
+}
+
+// The number of riffle layers splitting 3-channel pixels; 4-channel ones need
+// one layer less.
+template<typename T> static MUSTINLINE int ChannelShuffleLayers() {
+  return sizeof(T) == 1 ? 5 : sizeof(T) == 2 ? 4 : sizeof(T) == 4 ? 3 : 2;
+}
+
+template<typename T> static MUSTINLINE void Riffle(
+    __m128i &v0, __m128i &v1, __m128i &v2,
+    __m128i &v3, __m128i &v4, __m128i &v5) {
+  const __m128i t0 = InterleaveLo<T>(v0, v3);
+  const __m128i t1 = InterleaveHi<T>(v0, v3);
+  const __m128i t2 = InterleaveLo<T>(v1, v4);
+  const __m128i t3 = InterleaveHi<T>(v1, v4);
+  const __m128i t4 = InterleaveLo<T>(v2, v5);
+  const __m128i t5 = InterleaveHi<T>(v2, v5);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3, v4 = t4, v5 = t5;
+}
+
+template<typename T> static MUSTINLINE void Riffle(
+    __m128i &v0, __m128i &v1, __m128i &v2, __m128i &v3) {
+  const __m128i t0 = InterleaveLo<T>(v0, v2);
+  const __m128i t1 = InterleaveHi<T>(v0, v2);
+  const __m128i t2 = InterleaveLo<T>(v1, v3);
+  const __m128i t3 = InterleaveHi<T>(v1, v3);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3;
+}
+
+template<typename T> static MUSTINLINE void Unriffle(
+    __m128i &v0, __m128i &v1, __m128i &v2,
+    __m128i &v3, __m128i &v4, __m128i &v5) {
+  const __m128i t0 = PackEven<T>(v0, v1);
+  const __m128i t1 = PackEven<T>(v2, v3);
+  const __m128i t2 = PackEven<T>(v4, v5);
+  const __m128i t3 = PackOdd<T>(v0, v1);
+  const __m128i t4 = PackOdd<T>(v2, v3);
+  const __m128i t5 = PackOdd<T>(v4, v5);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3, v4 = t4, v5 = t5;
+}
+
+template<typename T> static MUSTINLINE void Unriffle(
+    __m128i &v0, __m128i &v1, __m128i &v2, __m128i &v3) {
+  const __m128i t0 = PackEven<T>(v0, v1);
+  const __m128i t1 = PackEven<T>(v2, v3);
+  const __m128i t2 = PackOdd<T>(v0, v1);
+  const __m128i t3 = PackOdd<T>(v2, v3);
+  v0 = t0, v1 = t1, v2 = t2, v3 = t3;
+}
+
+static MUSTINLINE __m128i LoadSi128(const void *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+static MUSTINLINE void StoreSi128(void *p, __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+template<typename T> static MUSTINLINE void SseDeinterleave3To1(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>();
+  T *pd0 = pp_dst[0], *pd1 = pp_dst[1], *pd2 = pp_dst[2];
+  int i = 0;
+  for (; i + 2 * n <= len; i += 2 * n) {
+    const T *ps = p_src + 3 * i;
+    __m128i v0 = LoadSi128(ps), v1 = LoadSi128(ps + n);
+    __m128i v2 = LoadSi128(ps + 2 * n), v3 = LoadSi128(ps + 3 * n);
+    __m128i v4 = LoadSi128(ps + 4 * n), v5 = LoadSi128(ps + 5 * n);
+    for (int k = 0; k < layers; ++k)
+      Riffle<T>(v0, v1, v2, v3, v4, v5);
+    StoreSi128(pd0 + i, v0), StoreSi128(pd0 + i + n, v1);
+    StoreSi128(pd1 + i, v2), StoreSi128(pd1 + i + n, v3);
+    StoreSi128(pd2 + i, v4), StoreSi128(pd2 + i + n, v5);
+  }
+  T *const pp_tail[3] = {pd0 + i, pd1 + i, pd2 + i};
+  generic_vector_deinterleave(pp_tail, p_src + 3 * i, 3, len - i);
+}
+
+template<typename T> static MUSTINLINE void SseDeinterleave4To1(
+    T *const *pp_dst,
+    const T  *p_src,
+    int       len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>() - 1;
+  T *pd0 = pp_dst[0], *pd1 = pp_dst[1], *pd2 = pp_dst[2], *pd3 = pp_dst[3];
+  int i = 0;
+  for (; i + n <= len; i += n) {
+    const T *ps = p_src + 4 * i;
+    __m128i v0 = LoadSi128(ps), v1 = LoadSi128(ps + n);
+    __m128i v2 = LoadSi128(ps + 2 * n), v3 = LoadSi128(ps + 3 * n);
+    for (int k = 0; k < layers; ++k)
+      Riffle<T>(v0, v1, v2, v3);
+    StoreSi128(pd0 + i, v0), StoreSi128(pd1 + i, v1);
+    StoreSi128(pd2 + i, v2), StoreSi128(pd3 + i, v3);
+  }
+  T *const pp_tail[4] = {pd0 + i, pd1 + i, pd2 + i, pd3 + i};
+  generic_vector_deinterleave(pp_tail, p_src + 4 * i, 4, len - i);
+}
+
+template<typename T> static MUSTINLINE void SseInterleave1To3(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>();
+  const T *ps0 = pp_src[0], *ps1 = pp_src[1], *ps2 = pp_src[2];
+  int i = 0;
+  for (; i + 2 * n <= len; i += 2 * n) {
+    __m128i v0 = LoadSi128(ps0 + i), v1 = LoadSi128(ps0 + i + n);
+    __m128i v2 = LoadSi128(ps1 + i), v3 = LoadSi128(ps1 + i + n);
+    __m128i v4 = LoadSi128(ps2 + i), v5 = LoadSi128(ps2 + i + n);
+    for (int k = 0; k < layers; ++k)
+      Unriffle<T>(v0, v1, v2, v3, v4, v5);
+    T *pd = p_dst + 3 * i;
+    StoreSi128(pd, v0), StoreSi128(pd + n, v1);
+    StoreSi128(pd + 2 * n, v2), StoreSi128(pd + 3 * n, v3);
+    StoreSi128(pd + 4 * n, v4), StoreSi128(pd + 5 * n, v5);
+  }
+  const T *const pp_tail[3] = {ps0 + i, ps1 + i, ps2 + i};
+  generic_vector_interleave(p_dst + 3 * i, pp_tail, 3, len - i);
+}
+
+template<typename T> static MUSTINLINE void SseInterleave1To4(
+    T              *p_dst,
+    const T *const *pp_src,
+    int             len) {
+  const int n = 16 / sizeof(T);
+  const int layers = ChannelShuffleLayers<T>() - 1;
+  const T *ps0 = pp_src[0], *ps1 = pp_src[1];
+  const T *ps2 = pp_src[2], *ps3 = pp_src[3];
+  int i = 0;
+  for (; i + n <= len; i += n) {
+    __m128i v0 = LoadSi128(ps0 + i), v1 = LoadSi128(ps1 + i);
+    __m128i v2 = LoadSi128(ps2 + i), v3 = LoadSi128(ps3 + i);
+    for (int k = 0; k < layers; ++k)
+      Unriffle<T>(v0, v1, v2, v3);
+    T *pd = p_dst + 4 * i;
+    StoreSi128(pd, v0), StoreSi128(pd + n, v1);
+    StoreSi128(pd + 2 * n, v2), StoreSi128(pd + 3 * n, v3);
+  }
+  const T *const pp_tail[4] = {ps0 + i, ps1 + i, ps2 + i, ps3 + i};
+  generic_vector_interleave(p_dst + 4 * i, pp_tail, 4, len - i);
+}
+
+#define MINIMGAPI_SSE_CHANNEL_KERNELS(T)                                      \
+template<> STATIC_SPECIAL MUSTINLINE void vector_deinterleave_3to1(            \
+    T *const *pp_dst, const T *p_src, int len) {                              \
+  SseDeinterleave3To1(pp_dst, p_src, len);                                    \
+}                                                                             \
+template<> STATIC_SPECIAL MUSTINLINE void vector_deinterleave_4to1(            \
+    T *const *pp_dst, const T *p_src, int len) {                              \
+  SseDeinterleave4To1(pp_dst, p_src, len);                                    \
+}                                                                             \
+template<> STATIC_SPECIAL MUSTINLINE void vector_interleave_1to3(              \
+    T *p_dst, const T *const *pp_src, int len) {                              \
+  SseInterleave1To3(p_dst, pp_src, len);                                      \
+}                                                                             \
+template<> STATIC_SPECIAL MUSTINLINE void vector_interleave_1to4(              \
+    T *p_dst, const T *const *pp_src, int len) {                              \
+  SseInterleave1To4(p_dst, pp_src, len);                                      \
+}
+
+MINIMGAPI_SSE_CHANNEL_KERNELS(uint8_t)
+MINIMGAPI_SSE_CHANNEL_KERNELS(uint16_t)
+MINIMGAPI_SSE_CHANNEL_KERNELS(uint32_t)
+MINIMGAPI_SSE_CHANNEL_KERNELS(uint64_t)
+
+#undef MINIMGAPI_SSE_CHANNEL_KERNELS
+
 #endif // #ifndef MINIMGAPI_SRC_VECTOR_SSE_COPY_CHANNELS_INL_H_INCLUDED
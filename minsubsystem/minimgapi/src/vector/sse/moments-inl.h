@@ -0,0 +1,323 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_SSE_MOMENTS_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_SSE_MOMENTS_INL_H_INCLUDED
+
+#include <algorithm>
+#include <emmintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+
+// The SSE kernels work on groups of whole pixels loaded into one register
+// (16 bytes, or 12 for 3 channels), so every lane always holds the same
+// channel. Products of channels i and i + d are accumulated by multiplying a
+// group by the group loaded d elements further (in a separate pass for every
+// d, except for 3 channels). Lanes whose channel pairs cross a pixel border are
+// dropped when the lane accumulators are flushed.
+
+// 32-bit lane accumulators are flushed after this many iterations.
+static const int moments_block_len = 8192;
+
+// Adds accumulated lane values of a group: lane k of p_lanes holds element
+// first + k of the group.
+template <typename TLane>
+static MUSTINLINE void FlushMomentLanes(
+    const TLane *p_lanes,
+    int          num_lanes,
+    int          first,
+    int          group_len,
+    int          channels,
+    int          d,
+    int64_t     *p_values,
+    int          values_stride) {
+  for (int k = 0; k < num_lanes && first + k < group_len; ++k) {
+    const int i = (first + k) % channels;
+    if (i + d < channels)
+      p_values[i * values_stride + d] += p_lanes[k];
+  }
+}
+
+static MUSTINLINE void FlushMomentsEpi32(
+    __m128i  acc,
+    int      first,
+    int      group_len,
+    int      channels,
+    int      d,
+    int64_t *p_values,
+    int      values_stride) {
+  MIN_ALIGNED(16) int32_t lanes[4];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  FlushMomentLanes(lanes, 4, first, group_len, channels, d, p_values,
+                   values_stride);
+}
+
+// Interleaves bytes of groups x and y and widens them to 16 bits, so that
+// _mm_madd_epi16 adds products of the same element of both groups.
+static MUSTINLINE void LoadGroupPairs8u(
+    const uint8_t *p_x,
+    const uint8_t *p_y,
+    __m128i       *p_pairs) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_x));
+  const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_y));
+  const __m128i lo = _mm_unpacklo_epi8(x, y);
+  const __m128i hi = _mm_unpackhi_epi8(x, y);
+  p_pairs[0] = _mm_unpacklo_epi8(lo, zero);
+  p_pairs[1] = _mm_unpackhi_epi8(lo, zero);
+  p_pairs[2] = _mm_unpacklo_epi8(hi, zero);
+  p_pairs[3] = _mm_unpackhi_epi8(hi, zero);
+}
+
+// Accumulates products of elements at distance d over num_iters pairs of
+// groups (and the sums if d is zero).
+static MUSTINLINE void AccumulateMoments8u(
+    const uint8_t *p_pixels,
+    int            num_iters,
+    int            group_len,
+    int            channels,
+    int            d,
+    int64_t       *p_sums,
+    int64_t       *p_cross_products) {
+  const __m128i ones = _mm_set1_epi16(1);
+  for (int begin = 0; begin < num_iters; begin += moments_block_len) {
+    const int end = std::min(num_iters, begin + moments_block_len);
+    __m128i sum0 = _mm_setzero_si128(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+    __m128i acc0 = sum0, acc1 = sum0, acc2 = sum0, acc3 = sum0;
+    const uint8_t *p_x = p_pixels + 2 * group_len * begin;
+    for (int i = begin; i < end; ++i, p_x += 2 * group_len) {
+      __m128i pairs[4];
+      LoadGroupPairs8u(p_x, p_x + group_len, pairs);
+      if (d == 0) {
+        sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(pairs[0], ones));
+        sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(pairs[1], ones));
+        sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(pairs[2], ones));
+        sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(pairs[3], ones));
+        acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(pairs[0], pairs[0]));
+        acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(pairs[1], pairs[1]));
+        acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(pairs[2], pairs[2]));
+        acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(pairs[3], pairs[3]));
+      } else {
+        __m128i shifted[4];
+        LoadGroupPairs8u(p_x + d, p_x + group_len + d, shifted);
+        acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(pairs[0], shifted[0]));
+        acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(pairs[1], shifted[1]));
+        acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(pairs[2], shifted[2]));
+        acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(pairs[3], shifted[3]));
+      }
+    }
+    if (d == 0) {
+      FlushMomentsEpi32(sum0, 0, group_len, channels, 0, p_sums, 1);
+      FlushMomentsEpi32(sum1, 4, group_len, channels, 0, p_sums, 1);
+      FlushMomentsEpi32(sum2, 8, group_len, channels, 0, p_sums, 1);
+      FlushMomentsEpi32(sum3, 12, group_len, channels, 0, p_sums, 1);
+    }
+    const int stride = channels + 1;
+    FlushMomentsEpi32(acc0, 0, group_len, channels, d, p_cross_products, stride);
+    FlushMomentsEpi32(acc1, 4, group_len, channels, d, p_cross_products, stride);
+    FlushMomentsEpi32(acc2, 8, group_len, channels, d, p_cross_products, stride);
+    FlushMomentsEpi32(acc3, 12, group_len, channels, d, p_cross_products,
+                      stride);
+  }
+}
+
+// Three channel pixels are accumulated in one pass: reloading the groups for
+// every distance costs more than keeping twelve accumulators.
+static MUSTINLINE void AccumulateMoments8uC3(
+    const uint8_t *p_pixels,
+    int            num_iters,
+    int64_t       *p_sums,
+    int64_t       *p_cross_products) {
+  const int group_len = 12;
+  const __m128i ones = _mm_set1_epi16(1);
+  for (int begin = 0; begin < num_iters; begin += moments_block_len) {
+    const int end = std::min(num_iters, begin + moments_block_len);
+    __m128i sum0 = _mm_setzero_si128(), sum1 = sum0, sum2 = sum0;
+    __m128i acc00 = sum0, acc01 = sum0, acc02 = sum0;
+    __m128i acc10 = sum0, acc11 = sum0, acc12 = sum0;
+    __m128i acc20 = sum0, acc21 = sum0, acc22 = sum0;
+    const uint8_t *p_x = p_pixels + 2 * group_len * begin;
+    for (int i = begin; i < end; ++i, p_x += 2 * group_len) {
+      __m128i pairs[4], shifted[4];
+      LoadGroupPairs8u(p_x, p_x + group_len, pairs);
+      sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(pairs[0], ones));
+      sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(pairs[1], ones));
+      sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(pairs[2], ones));
+      acc00 = _mm_add_epi32(acc00, _mm_madd_epi16(pairs[0], pairs[0]));
+      acc01 = _mm_add_epi32(acc01, _mm_madd_epi16(pairs[1], pairs[1]));
+      acc02 = _mm_add_epi32(acc02, _mm_madd_epi16(pairs[2], pairs[2]));
+      LoadGroupPairs8u(p_x + 1, p_x + group_len + 1, shifted);
+      acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(pairs[0], shifted[0]));
+      acc11 = _mm_add_epi32(acc11, _mm_madd_epi16(pairs[1], shifted[1]));
+      acc12 = _mm_add_epi32(acc12, _mm_madd_epi16(pairs[2], shifted[2]));
+      LoadGroupPairs8u(p_x + 2, p_x + group_len + 2, shifted);
+      acc20 = _mm_add_epi32(acc20, _mm_madd_epi16(pairs[0], shifted[0]));
+      acc21 = _mm_add_epi32(acc21, _mm_madd_epi16(pairs[1], shifted[1]));
+      acc22 = _mm_add_epi32(acc22, _mm_madd_epi16(pairs[2], shifted[2]));
+    }
+    FlushMomentsEpi32(sum0, 0, group_len, 3, 0, p_sums, 1);
+    FlushMomentsEpi32(sum1, 4, group_len, 3, 0, p_sums, 1);
+    FlushMomentsEpi32(sum2, 8, group_len, 3, 0, p_sums, 1);
+    FlushMomentsEpi32(acc00, 0, group_len, 3, 0, p_cross_products, 4);
+    FlushMomentsEpi32(acc01, 4, group_len, 3, 0, p_cross_products, 4);
+    FlushMomentsEpi32(acc02, 8, group_len, 3, 0, p_cross_products, 4);
+    FlushMomentsEpi32(acc10, 0, group_len, 3, 1, p_cross_products, 4);
+    FlushMomentsEpi32(acc11, 4, group_len, 3, 1, p_cross_products, 4);
+    FlushMomentsEpi32(acc12, 8, group_len, 3, 1, p_cross_products, 4);
+    FlushMomentsEpi32(acc20, 0, group_len, 3, 2, p_cross_products, 4);
+    FlushMomentsEpi32(acc21, 4, group_len, 3, 2, p_cross_products, 4);
+    FlushMomentsEpi32(acc22, 8, group_len, 3, 2, p_cross_products, 4);
+  }
+}
+
+static MUSTINLINE void vector_moments_8u(
+    const uint8_t *p_pixels,
+    int            len,
+    int            channels,
+    int64_t       *p_sums,
+    int64_t       *p_cross_products) {
+  int num_iters = 0;
+  int group_len = 0;
+  if (channels >= 1 && channels <= 4) {
+    group_len = channels == 3 ? 12 : 16;
+    // The last loads (of 16 bytes, d = channels - 1 bytes further) must stay
+    // inside the pixels.
+    const int64_t tail = group_len + channels - 1 + 16;
+    const int64_t n = static_cast<int64_t>(len) * channels;
+    if (n >= tail)
+      num_iters = static_cast<int>((n - tail) / (2 * group_len) + 1);
+  }
+  if (channels == 3)
+    AccumulateMoments8uC3(p_pixels, num_iters, p_sums, p_cross_products);
+  else
+    for (int d = 0; d < channels && num_iters > 0; ++d)
+      AccumulateMoments8u(p_pixels, num_iters, group_len, channels, d, p_sums,
+                          p_cross_products);
+  const int done = 2 * group_len / std::max(channels, 1) * num_iters;
+  generic_vector_moments(p_pixels + channels * done, len - done, channels,
+                         p_sums, p_cross_products);
+}
+
+static MUSTINLINE void FlushMomentsEpi64(
+    __m128i  acc,
+    int      first,
+    int      group_len,
+    int      channels,
+    int      d,
+    int64_t *p_values,
+    int      values_stride) {
+  MIN_ALIGNED(16) int64_t lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  // The 64-bit lanes hold the even (first) or the odd (first + 1) elements.
+  FlushMomentLanes(lanes, 1, first, group_len, channels, d, p_values,
+                   values_stride);
+  FlushMomentLanes(lanes + 1, 1, first + 2, group_len, channels, d, p_values,
+                   values_stride);
+}
+
+// Products of 16-bit values do not fit into signed 32-bit lanes, so they are
+// computed with _mm_mul_epu32 and accumulated in 64-bit lanes.
+static MUSTINLINE void AccumulateMoments16u(
+    const uint16_t *p_pixels,
+    int             num_iters,
+    int             group_len,
+    int             channels,
+    int             d,
+    int64_t        *p_sums,
+    int64_t        *p_cross_products) {
+  const __m128i zero = _mm_setzero_si128();
+  for (int begin = 0; begin < num_iters; begin += moments_block_len) {
+    const int end = std::min(num_iters, begin + moments_block_len);
+    __m128i sum_lo = zero, sum_hi = zero;
+    __m128i acc_lo_even = zero, acc_lo_odd = zero;
+    __m128i acc_hi_even = zero, acc_hi_odd = zero;
+    const uint16_t *p_x = p_pixels + group_len * begin;
+    for (int i = begin; i < end; ++i, p_x += group_len) {
+      const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_x));
+      const __m128i y = _mm_loadu_si128(
+                               reinterpret_cast<const __m128i *>(p_x + d));
+      const __m128i x_lo = _mm_unpacklo_epi16(x, zero);
+      const __m128i x_hi = _mm_unpackhi_epi16(x, zero);
+      const __m128i y_lo = _mm_unpacklo_epi16(y, zero);
+      const __m128i y_hi = _mm_unpackhi_epi16(y, zero);
+      if (d == 0) {
+        sum_lo = _mm_add_epi32(sum_lo, x_lo);
+        sum_hi = _mm_add_epi32(sum_hi, x_hi);
+      }
+      acc_lo_even = _mm_add_epi64(acc_lo_even, _mm_mul_epu32(x_lo, y_lo));
+      acc_lo_odd = _mm_add_epi64(acc_lo_odd, _mm_mul_epu32(
+          _mm_srli_epi64(x_lo, 32), _mm_srli_epi64(y_lo, 32)));
+      acc_hi_even = _mm_add_epi64(acc_hi_even, _mm_mul_epu32(x_hi, y_hi));
+      acc_hi_odd = _mm_add_epi64(acc_hi_odd, _mm_mul_epu32(
+          _mm_srli_epi64(x_hi, 32), _mm_srli_epi64(y_hi, 32)));
+    }
+    if (d == 0) {
+      FlushMomentsEpi32(sum_lo, 0, group_len, channels, 0, p_sums, 1);
+      FlushMomentsEpi32(sum_hi, 4, group_len, channels, 0, p_sums, 1);
+    }
+    const int stride = channels + 1;
+    FlushMomentsEpi64(acc_lo_even, 0, group_len, channels, d,
+                      p_cross_products, stride);
+    FlushMomentsEpi64(acc_lo_odd, 1, group_len, channels, d,
+                      p_cross_products, stride);
+    FlushMomentsEpi64(acc_hi_even, 4, group_len, channels, d,
+                      p_cross_products, stride);
+    FlushMomentsEpi64(acc_hi_odd, 5, group_len, channels, d,
+                      p_cross_products, stride);
+  }
+}
+
+static MUSTINLINE void vector_moments_16u(
+    const uint16_t *p_pixels,
+    int             len,
+    int             channels,
+    int64_t        *p_sums,
+    int64_t        *p_cross_products) {
+  int num_iters = 0;
+  int group_len = 0;
+  if (channels >= 1 && channels <= 4) {
+    group_len = channels == 3 ? 6 : 8;
+    const int64_t tail = channels - 1 + 8;
+    const int64_t n = static_cast<int64_t>(len) * channels;
+    if (n >= tail)
+      num_iters = static_cast<int>((n - tail) / group_len + 1);
+  }
+  for (int d = 0; d < channels && num_iters > 0; ++d)
+    AccumulateMoments16u(p_pixels, num_iters, group_len, channels, d, p_sums,
+                         p_cross_products);
+  const int done = group_len / std::max(channels, 1) * num_iters;
+  generic_vector_moments(p_pixels + channels * done, len - done, channels,
+                         p_sums, p_cross_products);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_SSE_MOMENTS_INL_H_INCLUDED
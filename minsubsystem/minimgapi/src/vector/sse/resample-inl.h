@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_SSE_RESAMPLE_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_SSE_RESAMPLE_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+
+static MUSTINLINE void vector_scale_row(
+    float       *p_dst,
+    const float *p_src,
+    float        weight,
+    int          len) {
+  const __m128 w = _mm_set1_ps(weight);
+  int i = 0;
+  for (; i + 4 <= len; i += 4)
+    _mm_storeu_ps(p_dst + i, _mm_mul_ps(w, _mm_loadu_ps(p_src + i)));
+  generic_vector_scale_row(p_dst + i, p_src + i, weight, len - i);
+}
+
+static MUSTINLINE void vector_accumulate_row(
+    float       *p_dst,
+    const float *p_src,
+    float        weight,
+    int          len) {
+  const __m128 w = _mm_set1_ps(weight);
+  int i = 0;
+  for (; i + 4 <= len; i += 4)
+    _mm_storeu_ps(p_dst + i, _mm_add_ps(_mm_loadu_ps(p_dst + i),
+                                        _mm_mul_ps(w, _mm_loadu_ps(p_src + i))));
+  generic_vector_accumulate_row(p_dst + i, p_src + i, weight, len - i);
+}
+
+// SSE2 has no gather, so the source samples are loaded one by one, and four
+// destination elements are weighted and summed at once.
+template<typename T> static MUSTINLINE void vector_interpolate_row(
+    float       *p_dst,
+    const T     *p_src,
+    const int   *p_offsets,
+    const float *p_weights,
+    int          num_taps,
+    int          len) {
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    const size_t first = static_cast<size_t>(i) * num_taps;
+    const int *p_block_offsets = p_offsets + first;
+    const float *p_block_weights = p_weights + first;
+    __m128 sum = _mm_setzero_ps();
+    for (int tap = 0; tap < 4 * num_taps; tap += 4) {
+      const __m128 samples = _mm_setr_ps(
+          static_cast<float>(p_src[p_block_offsets[tap]]),
+          static_cast<float>(p_src[p_block_offsets[tap + 1]]),
+          static_cast<float>(p_src[p_block_offsets[tap + 2]]),
+          static_cast<float>(p_src[p_block_offsets[tap + 3]]));
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p_block_weights + tap),
+                                       samples));
+    }
+    _mm_storeu_ps(p_dst + i, sum);
+  }
+  generic_vector_interpolate_row(p_dst, p_src, p_offsets, p_weights, num_taps,
+                                 i, len);
+}
+
+// Rounds half up and saturates like generic_vector_round_row.
+static MUSTINLINE __m128i RoundClampedPs(
+    const float *p_src,
+    __m128       max_value) {
+  __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(p_src), _mm_setzero_ps()),
+                        max_value);
+  return _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+}
+
+template<typename T> static MUSTINLINE void vector_round_row(
+    T           *p_dst,
+    const float *p_src,
+    int          len) {
+  generic_vector_round_row(p_dst, p_src, len);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE void vector_round_row(
+    uint8_t     *p_dst,
+    const float *p_src,
+    int          len) {
+  const __m128 max_value = _mm_set1_ps(255.f);
+  int i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i lo = _mm_packs_epi32(RoundClampedPs(p_src + i, max_value),
+                                 RoundClampedPs(p_src + i + 4, max_value));
+    __m128i hi = _mm_packs_epi32(RoundClampedPs(p_src + i + 8, max_value),
+                                 RoundClampedPs(p_src + i + 12, max_value));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+  generic_vector_round_row(p_dst + i, p_src + i, len - i);
+}
+
+template<> STATIC_SPECIAL MUSTINLINE void vector_round_row(
+    uint16_t    *p_dst,
+    const float *p_src,
+    int          len) {
+  // SSE2 has no unsigned 32-to-16 bit packing, so values are shifted to the
+  // signed range and back.
+  const __m128 max_value = _mm_set1_ps(65535.f);
+  const __m128i bias32 = _mm_set1_epi32(0x8000);
+  const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m128i lo = _mm_sub_epi32(RoundClampedPs(p_src + i, max_value), bias32);
+    __m128i hi = _mm_sub_epi32(RoundClampedPs(p_src + i + 4, max_value),
+                               bias32);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i),
+                     _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16));
+  }
+  generic_vector_round_row(p_dst + i, p_src + i, len - i);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_SSE_RESAMPLE_INL_H_INCLUDED
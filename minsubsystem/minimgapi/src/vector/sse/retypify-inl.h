@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+#ifndef MINIMGAPI_SRC_VECTOR_SSE_RETYPIFY_INL_H_INCLUDED
+#define MINIMGAPI_SRC_VECTOR_SSE_RETYPIFY_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minbase/crossplat.h>
+#include <minutils/smartptr.h>
+
+static MUSTINLINE __m128i SelectEpi32(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Converts four half precision numbers zero-extended to 32 bits. Subnormal
+// numbers are normalized with a float subtraction, which is exact, so the
+// result does not depend on the denormals mode.
+static MUSTINLINE __m128 Real16ToReal32Ps(__m128i half) {
+  const __m128i exponent_mask = _mm_set1_epi32(0x7C00 << 13);
+  const __m128i magnitude = _mm_slli_epi32(
+                            _mm_and_si128(half, _mm_set1_epi32(0x7FFF)), 13);
+  const __m128i exponent = _mm_and_si128(magnitude, exponent_mask);
+  const __m128i is_special = _mm_cmpeq_epi32(exponent, exponent_mask);
+  const __m128i is_subnormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+  const __m128i is_nan = _mm_cmpgt_epi32(magnitude, exponent_mask);
+
+  __m128i bits = _mm_add_epi32(magnitude, _mm_set1_epi32(112 << 23));
+  bits = _mm_add_epi32(bits, _mm_and_si128(is_special,
+                                           _mm_set1_epi32(112 << 23)));
+  bits = _mm_or_si128(bits, _mm_and_si128(is_nan, _mm_set1_epi32(0x400000)));
+  const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+  const __m128i subnormal = _mm_castps_si128(_mm_sub_ps(
+      _mm_castsi128_ps(_mm_add_epi32(magnitude, _mm_set1_epi32(113 << 23))),
+      magic));
+  bits = SelectEpi32(is_subnormal, subnormal, bits);
+  const __m128i sign = _mm_slli_epi32(
+                         _mm_and_si128(half, _mm_set1_epi32(0x8000)), 16);
+  return _mm_castsi128_ps(_mm_or_si128(bits, sign));
+}
+
+// Converts four floats to half precision numbers in the low halves of 32-bit
+// lanes. Subnormal results are rounded with a float addition, which uses the
+// default round to nearest even mode.
+static MUSTINLINE __m128i Real32ToReal16Epi32(__m128 value) {
+  const __m128i bits = _mm_castps_si128(value);
+  const __m128i magnitude = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+  const __m128i sign = _mm_srli_epi32(
+                  _mm_andnot_si128(_mm_set1_epi32(0x7FFFFFFF), bits), 16);
+
+  const __m128i is_nan = _mm_cmpgt_epi32(magnitude,
+                                         _mm_set1_epi32(0x7F800000));
+  const __m128i is_finite = _mm_cmplt_epi32(magnitude,
+                                            _mm_set1_epi32(0x47800000));
+  const __m128i is_subnormal = _mm_cmplt_epi32(magnitude,
+                                               _mm_set1_epi32(0x38800000));
+
+  const __m128i nan = _mm_or_si128(_mm_set1_epi32(0x7E00), _mm_and_si128(
+                _mm_srli_epi32(magnitude, 13), _mm_set1_epi32(0x3FF)));
+  const __m128i special = SelectEpi32(is_nan, nan, _mm_set1_epi32(0x7C00));
+
+  const __m128i odd = _mm_and_si128(_mm_srli_epi32(magnitude, 13),
+                                    _mm_set1_epi32(1));
+  const __m128i normal = _mm_srli_epi32(_mm_add_epi32(
+      _mm_add_epi32(magnitude, _mm_set1_epi32(0xFFF - 0x38000000)), odd), 13);
+
+  const __m128i magic = _mm_set1_epi32(126 << 23);
+  const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(
+      _mm_castsi128_ps(magnitude), _mm_castsi128_ps(magic))), magic);
+
+  const __m128i finite = SelectEpi32(is_subnormal, subnormal, normal);
+  return _mm_or_si128(SelectEpi32(is_finite, finite, special), sign);
+}
+
+static MUSTINLINE __m128i PackReal16Epi32(__m128i lo, __m128i hi) {
+  // Sign extension keeps the values in the range of signed saturation.
+  lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+  hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+  return _mm_packs_epi32(lo, hi);
+}
+
+static MUSTINLINE void vector_real16_to_real32(
+    float          *p_dst,
+    const uint16_t *p_src,
+    int             len) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    const __m128i half = _mm_loadu_si128(
+                               reinterpret_cast<const __m128i *>(p_src + i));
+    _mm_storeu_ps(p_dst + i, Real16ToReal32Ps(_mm_unpacklo_epi16(half, zero)));
+    _mm_storeu_ps(p_dst + i + 4,
+                  Real16ToReal32Ps(_mm_unpackhi_epi16(half, zero)));
+  }
+  generic_vector_real16_to_real32(p_dst + i, p_src + i, len - i);
+}
+
+static MUSTINLINE void vector_real32_to_real16(
+    uint16_t    *p_dst,
+    const float *p_src,
+    int          len) {
+  int i = 0;
+  for (; i + 8 <= len; i += 8)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i), PackReal16Epi32(
+                         Real32ToReal16Epi32(_mm_loadu_ps(p_src + i)),
+                         Real32ToReal16Epi32(_mm_loadu_ps(p_src + i + 4))));
+  generic_vector_real32_to_real16(p_dst + i, p_src + i, len - i);
+}
+
+static MUSTINLINE void vector_uint8_to_real32(
+    float         *p_dst,
+    const uint8_t *p_src,
+    int            len) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= len; i += 16) {
+    const __m128i src = _mm_loadu_si128(
+                               reinterpret_cast<const __m128i *>(p_src + i));
+    const __m128i lo = _mm_unpacklo_epi8(src, zero);
+    const __m128i hi = _mm_unpackhi_epi8(src, zero);
+    _mm_storeu_ps(p_dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_ps(p_dst + i + 4,
+                  _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_ps(p_dst + i + 8,
+                  _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_ps(p_dst + i + 12,
+                  _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+  }
+  generic_vector_uint8_to_real32(p_dst + i, p_src + i, len - i);
+}
+
+#endif // #ifndef MINIMGAPI_SRC_VECTOR_SSE_RETYPIFY_INL_H_INCLUDED
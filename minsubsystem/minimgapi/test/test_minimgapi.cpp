@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 #include <minbase/minresult.h>
 #include <minimgapi/minimgapi.h>
@@ -118,6 +124,875 @@ TEST(TestMinimgapi, TestCopyMinImageChannels43) {
   }
 }
 
+static void FillMinImageRandomly(const MinImg *p_image) {
+  for (int y = 0; y < p_image->height; ++y) {
+    uint8_t *p_line = p_image->pScan0 + p_image->stride * y;
+    for (int x = 0; x < _GetMinImageBytesPerLine(p_image); ++x)
+      p_line[x] = rand() & 0xFFU;
+  }
+}
+
+// Runs operation serially and on 4 threads and compares the results.
+template <typename TOperation>
+static void ExpectParallelMatchesSerial(const char   *name,
+                                        const MinImg *p_dst_prototype,
+                                        TOperation    operation) {
+  SCOPED_TRACE(name);
+  DECLARE_GUARDED_MINIMG(serial);
+  DECLARE_GUARDED_MINIMG(parallel);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&serial, p_dst_prototype));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&parallel, p_dst_prototype));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&serial));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&parallel));
+
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(1));
+  ASSERT_EQ(NO_ERRORS, operation(&serial));
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(4));
+  ASSERT_EQ(NO_ERRORS, SetMinImageParallelThreshold(0));
+  ASSERT_EQ(NO_ERRORS, operation(&parallel));
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(1));
+  ASSERT_EQ(NO_ERRORS, SetMinImageParallelThreshold(1 << 20));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&serial, &parallel));
+}
+
+TEST(TestMinimgapi, TestParallelOperations) {
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 301, 157, 3, TYP_UINT8));
+  FillMinImageRandomly(&src);
+  DECLARE_GUARDED_MINIMG(transposed);
+  ASSERT_EQ(NO_ERRORS, CloneTransposedMinImagePrototype(&transposed, &src,
+                                                        AO_EMPTY));
+  DECLARE_GUARDED_MINIMG(resampled);
+  ASSERT_EQ(NO_ERRORS, CloneResizedMinImagePrototype(&resampled, &src,
+                                                     517, 89, AO_EMPTY));
+  DECLARE_GUARDED_MINIMG(planes);
+  ASSERT_EQ(NO_ERRORS, CloneDimensionedMinImagePrototype(&planes, &src, 1,
+                                                         AO_EMPTY));
+
+  ExpectParallelMatchesSerial("CopyMinImage", &src, [&](const MinImg *p_dst) {
+    return CopyMinImage(p_dst, &src);
+  });
+  ExpectParallelMatchesSerial("FlipMinImage horizontal", &src, [&](const MinImg *p_dst) {
+    return FlipMinImage(p_dst, &src, DO_HORIZONTAL);
+  });
+  ExpectParallelMatchesSerial("FlipMinImage vertical", &src, [&](const MinImg *p_dst) {
+    return FlipMinImage(p_dst, &src, DO_VERTICAL);
+  });
+  ExpectParallelMatchesSerial("TransposeMinImage", &transposed, [&](const MinImg *p_dst) {
+    return TransposeMinImage(p_dst, &src);
+  });
+  ExpectParallelMatchesSerial("RotateMinImageBy90", &transposed, [&](const MinImg *p_dst) {
+    return RotateMinImageBy90(p_dst, &src, 1);
+  });
+  ExpectParallelMatchesSerial("ResampleMinImage", &resampled, [&](const MinImg *p_dst) {
+    return ResampleMinImage(p_dst, &src);
+  });
+  ExpectParallelMatchesSerial("InterpolateMinImage area", &resampled, [&](const MinImg *p_dst) {
+    return InterpolateMinImage(p_dst, &src, IO_AREA);
+  });
+  ExpectParallelMatchesSerial("InterpolateMinImage bilinear", &resampled, [&](const MinImg *p_dst) {
+    return InterpolateMinImage(p_dst, &src, IO_BILINEAR);
+  });
+  ExpectParallelMatchesSerial("CopyMinImageChannels", &src, [&](const MinImg *p_dst) {
+    const int dst_channels[] = {2, 0, 1};
+    const int src_channels[] = {0, 1, 2};
+    return CopyMinImageChannels(p_dst, &src, dst_channels, src_channels, 3);
+  });
+  ExpectParallelMatchesSerial("DeinterleaveMinImage", &planes, [&](const MinImg *p_dst) {
+    DECLARE_GUARDED_MINIMG(rest);
+    PROPAGATE_ERROR(CloneDimensionedMinImagePrototype(&rest, &src, 2));
+    const MinImg *p_dst_images[] = {p_dst, &rest};
+    return DeinterleaveMinImage(p_dst_images, &src, 2);
+  });
+  ExpectParallelMatchesSerial("InterleaveMinImages", &src, [&](const MinImg *p_dst) {
+    DECLARE_GUARDED_MINIMG(plane);
+    PROPAGATE_ERROR(CloneDimensionedMinImagePrototype(&plane, &src, 1));
+    const int plane_channel = 0, src_channel = 1;
+    PROPAGATE_ERROR(CopyMinImageChannels(&plane, &src, &plane_channel,
+                                         &src_channel, 1));
+    const MinImg *p_src_images[] = {&plane, &src};
+    DECLARE_GUARDED_MINIMG(interleaved);
+    PROPAGATE_ERROR(CloneDimensionedMinImagePrototype(&interleaved, &src, 4));
+    PROPAGATE_ERROR(InterleaveMinImages(&interleaved, p_src_images, 2));
+    const int dst_channels[] = {0, 1, 2};
+    const int src_channels[] = {1, 2, 3};
+    return CopyMinImageChannels(p_dst, &interleaved, dst_channels,
+                                src_channels, 3);
+  });
+}
+
+// Returns the address of channel c of pixel (x, y).
+static const uint8_t *GetMinImageElement(const MinImg *p_image,
+                                         int x, int y, int c) {
+  return p_image->pScan0 + y * p_image->stride +
+         (x * p_image->channels + c) * p_image->channelDepth;
+}
+
+TEST(TestMinimgapi, TestPlanarChannels) {
+  const MinTyp types[] = {TYP_UINT8, TYP_UINT16, TYP_REAL32, TYP_REAL64};
+  const int widths[] = {1, 31, 100, 301};
+  for (MinTyp type : types) {
+    SCOPED_TRACE(type);
+    for (int width : widths) {
+      SCOPED_TRACE(width);
+      for (int channels = 3; channels <= 4; ++channels) {
+        SCOPED_TRACE(channels);
+        DECLARE_GUARDED_MINIMG(src);
+        ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, 5, channels,
+                                                  type));
+        FillMinImageRandomly(&src);
+        const int depth = src.channelDepth;
+
+        MinImg planes[4] = {};
+        const MinImg *p_planes[4] = {};
+        for (int c = 0; c < channels; ++c) {
+          ASSERT_EQ(NO_ERRORS, CloneDimensionedMinImagePrototype(&planes[c],
+                                                                 &src, 1));
+          p_planes[c] = &planes[c];
+        }
+        ASSERT_EQ(NO_ERRORS, DeinterleaveMinImage(p_planes, &src, channels));
+        for (int y = 0; y < src.height; ++y)
+          for (int x = 0; x < width; ++x)
+            for (int c = 0; c < channels; ++c)
+              ASSERT_EQ(0, memcmp(GetMinImageElement(&planes[c], x, y, 0),
+                                  GetMinImageElement(&src, x, y, c), depth));
+
+        DECLARE_GUARDED_MINIMG(merged);
+        ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&merged, &src));
+        ASSERT_EQ(NO_ERRORS, InterleaveMinImages(&merged, p_planes, channels));
+        EXPECT_EQ(NO_ERRORS, CompareMinImages(&src, &merged));
+        for (int c = 0; c < channels; ++c)
+          ASSERT_EQ(NO_ERRORS, FreeMinImage(&planes[c]));
+
+        // A selection keeping a destination channel and a swap in place.
+        DECLARE_GUARDED_MINIMG(dst);
+        ASSERT_EQ(NO_ERRORS, CloneDimensionedMinImagePrototype(&dst, &src,
+                                                               7 - channels));
+        FillMinImageRandomly(&dst);
+        DECLARE_GUARDED_MINIMG(expected);
+        ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&expected, &dst));
+        ASSERT_EQ(NO_ERRORS, CopyMinImage(&expected, &dst));
+        const int dst_channels[] = {2, 0, 0};
+        const int src_channels[] = {1, channels - 1, 0};
+        for (int y = 0; y < src.height; ++y)
+          for (int x = 0; x < width; ++x)
+            for (int i = 0; i < 3; ++i)
+              memcpy(const_cast<uint8_t *>(GetMinImageElement(&expected, x, y,
+                                                           dst_channels[i])),
+                     GetMinImageElement(&src, x, y, src_channels[i]), depth);
+        ASSERT_EQ(NO_ERRORS, CopyMinImageChannels(&dst, &src, dst_channels,
+                                                  src_channels, 3));
+        EXPECT_EQ(NO_ERRORS, CompareMinImages(&expected, &dst));
+
+        const int swapped[] = {0, 2};
+        const int swapping[] = {2, 0};
+        ASSERT_EQ(NO_ERRORS, CopyMinImageChannels(&dst, &dst, swapped,
+                                                  swapping, 2));
+        for (int y = 0; y < src.height; ++y)
+          for (int x = 0; x < width; ++x) {
+            ASSERT_EQ(0, memcmp(GetMinImageElement(&dst, x, y, 0),
+                                GetMinImageElement(&expected, x, y, 2), depth));
+            ASSERT_EQ(0, memcmp(GetMinImageElement(&dst, x, y, 2),
+                                GetMinImageElement(&expected, x, y, 0), depth));
+          }
+      }
+    }
+  }
+
+  DECLARE_GUARDED_MINIMG(image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image, 8, 8, 3, TYP_UINT8));
+  const int channel = 3, first_channel = 0;
+  EXPECT_EQ(BAD_ARGS, CopyMinImageChannels(&image, &image, &channel,
+                                           &first_channel, 1));
+  EXPECT_EQ(BAD_ARGS, CopyMinImageChannels(&image, &image, &first_channel,
+                                           &channel, 1));
+}
+
+TEST(TestMinimgapi, TestTransposeLargeMinImage) {
+  const MinTyp types[] = {TYP_UINT8, TYP_UINT16, TYP_REAL32, TYP_REAL64};
+  for (MinTyp type : types)
+    for (int channels : {1, 3}) {
+      DECLARE_GUARDED_MINIMG(src);
+      ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 301, 173, channels, type));
+      FillMinImageRandomly(&src);
+      const int pixel_size = GetMinImageBitsPerPixel(&src) / 8;
+      DECLARE_GUARDED_MINIMG(transposed);
+      ASSERT_EQ(NO_ERRORS, CloneTransposedMinImagePrototype(&transposed, &src));
+      ASSERT_EQ(NO_ERRORS, TransposeMinImage(&transposed, &src));
+      DECLARE_GUARDED_MINIMG(rotated);
+      ASSERT_EQ(NO_ERRORS, CloneTransposedMinImagePrototype(&rotated, &src));
+      ASSERT_EQ(NO_ERRORS, RotateMinImageBy90(&rotated, &src, 1));
+      for (int y = 0; y < src.height; ++y)
+        for (int x = 0; x < src.width; ++x) {
+          const uint8_t *p_pixel = src.pScan0 + y * src.stride + x * pixel_size;
+          ASSERT_EQ(0, memcmp(p_pixel, transposed.pScan0 + x * transposed.stride +
+                                       y * pixel_size, pixel_size));
+          ASSERT_EQ(0, memcmp(p_pixel, rotated.pScan0 + x * rotated.stride +
+                                       (src.height - 1 - y) * pixel_size,
+                              pixel_size));
+        }
+    }
+}
+
+TEST(TestMinimgapi, TestResampleMinImageNBytes) {
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 7, 5, 5, TYP_UINT8));
+  FillMinImageRandomly(&src);
+  DECLARE_GUARDED_MINIMG(dst);
+  ASSERT_EQ(NO_ERRORS, CloneResizedMinImagePrototype(&dst, &src, 14, 10));
+  ASSERT_EQ(NO_ERRORS, ResampleMinImage(&dst, &src, 0, 0));
+  for (int y = 0; y < dst.height; ++y) {
+    const uint8_t *p_dst_line = dst.pScan0 + y * dst.stride;
+    const uint8_t *p_src_line = src.pScan0 + (y / 2) * src.stride;
+    for (int x = 0; x < dst.width * dst.channels; ++x)
+      ASSERT_EQ(p_src_line[(x / 10) * 5 + x % 5], p_dst_line[x]);
+  }
+}
+
+TEST(TestMinimgapi, TestInterpolateMinImage) {
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 36, 20, 3, TYP_UINT8));
+  FillMinImageRandomly(&src);
+
+  // Area downsampling by 2 averages 2x2 blocks.
+  DECLARE_GUARDED_MINIMG(half);
+  ASSERT_EQ(NO_ERRORS, CloneResizedMinImagePrototype(&half, &src, 18, 10));
+  ASSERT_EQ(NO_ERRORS, InterpolateMinImage(&half, &src, IO_AREA));
+  for (int y = 0; y < half.height; ++y) {
+    const uint8_t *p_src_line0 = src.pScan0 + 2 * y * src.stride;
+    const uint8_t *p_src_line1 = p_src_line0 + src.stride;
+    const uint8_t *p_half_line = half.pScan0 + y * half.stride;
+    for (int x = 0; x < half.width; ++x)
+      for (int c = 0; c < 3; ++c) {
+        int sum = p_src_line0[6 * x + c] + p_src_line0[6 * x + 3 + c] +
+                  p_src_line1[6 * x + c] + p_src_line1[6 * x + 3 + c];
+        ASSERT_EQ((sum + 2) / 4, p_half_line[3 * x + c]);
+      }
+  }
+
+  // Bilinear upsampling by 2 reproduces a linear ramp inside the image.
+  DECLARE_GUARDED_MINIMG(ramp);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&ramp, 16, 4, 1, TYP_REAL32));
+  for (int y = 0; y < ramp.height; ++y)
+    for (int x = 0; x < ramp.width; ++x)
+      reinterpret_cast<float *>(ramp.pScan0 + y * ramp.stride)[x] = 4.f * x;
+  DECLARE_GUARDED_MINIMG(ramp2);
+  ASSERT_EQ(NO_ERRORS, CloneResizedMinImagePrototype(&ramp2, &ramp, 32, 8));
+  ASSERT_EQ(NO_ERRORS, InterpolateMinImage(&ramp2, &ramp, IO_BILINEAR));
+  for (int y = 0; y < ramp2.height; ++y) {
+    const float *p_line = reinterpret_cast<float *>(ramp2.pScan0 +
+                                                    y * ramp2.stride);
+    EXPECT_EQ(0.f, p_line[0]);
+    for (int x = 1; x < ramp2.width - 1; ++x)
+      EXPECT_FLOAT_EQ(2.f * x - 1.f, p_line[x]);
+    EXPECT_EQ(60.f, p_line[ramp2.width - 1]);
+  }
+
+  // Constant images stay constant for any scale.
+  DECLARE_GUARDED_MINIMG(flat);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&flat, 23, 17, 2, TYP_UINT16));
+  uint16_t value = 40000;
+  ASSERT_EQ(NO_ERRORS, FillMinImage(&flat, &value, sizeof(value)));
+  const int sizes[][2] = {{7, 5}, {23, 17}, {50, 31}};
+  for (const int *size : sizes) {
+    DECLARE_GUARDED_MINIMG(scaled);
+    ASSERT_EQ(NO_ERRORS, CloneResizedMinImagePrototype(&scaled, &flat,
+                                                       size[0], size[1]));
+    for (InterpolationOption interpolation : {IO_BILINEAR, IO_AREA}) {
+      ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&scaled));
+      ASSERT_EQ(NO_ERRORS, InterpolateMinImage(&scaled, &flat, interpolation));
+      for (int y = 0; y < scaled.height; ++y)
+        for (int x = 0; x < scaled.width * scaled.channels; ++x)
+          ASSERT_EQ(value, reinterpret_cast<uint16_t *>(
+                               scaled.pScan0 + y * scaled.stride)[x]);
+    }
+  }
+
+  DECLARE_GUARDED_MINIMG(wide);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&wide, 4, 4, 1, TYP_REAL64));
+  EXPECT_EQ(NOT_IMPLEMENTED, InterpolateMinImage(&wide, &wide, IO_AREA));
+}
+
+TEST(TestMinimgapi, TestBufferPool) {
+  MinImg unpooled = {};
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&unpooled, 640, 480, 3, TYP_UINT8,
+                                            0, AO_PREALLOCATED));
+  ASSERT_EQ(NO_ERRORS, SetMinImageBufferPoolCapacity(16 << 20));
+
+  MinImageBufferPoolStats initial = {};
+  ASSERT_EQ(NO_ERRORS, GetMinImageBufferPoolStats(&initial));
+  uint8_t *p_buffer = 0;
+  for (int i = 0; i < 3; ++i) {
+    DECLARE_GUARDED_MINIMG(image);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image, 640, 480 - i, 3,
+                                              TYP_UINT8, 0, AO_PREALLOCATED));
+    if (i > 0)
+      EXPECT_EQ(p_buffer, image.pScan0);
+    p_buffer = image.pScan0;
+  }
+  ASSERT_EQ(NO_ERRORS, FreeMinImage(&unpooled));
+
+  MinImageBufferPoolStats stats = {};
+  ASSERT_EQ(NO_ERRORS, GetMinImageBufferPoolStats(&stats));
+  EXPECT_EQ(initial.misses + 1, stats.misses);
+  EXPECT_EQ(initial.hits + 2, stats.hits);
+  EXPECT_EQ(1, stats.buffers_held);
+  EXPECT_LE(640 * 480 * 3, stats.bytes_held);
+
+  ASSERT_EQ(NO_ERRORS, TrimMinImageBufferPool(0));
+  ASSERT_EQ(NO_ERRORS, GetMinImageBufferPoolStats(&stats));
+  EXPECT_EQ(0, stats.buffers_held);
+  EXPECT_EQ(0, stats.bytes_held);
+  ASSERT_EQ(NO_ERRORS, SetMinImageBufferPoolCapacity(0));
+  EXPECT_EQ(BAD_ARGS, SetMinImageBufferPoolCapacity(-1));
+}
+
+TEST(TestMinimgapi, TestConvertMinImageColorSpace) {
+  uint8_t pixels[2][3] = {{255, 0, 0}, {255, 255, 255}};
+  const struct {
+    ColorSpace space;
+    uint8_t expected[2][3];
+  } cases[] = {
+    {CS_LINEAR_RGB, {{255, 0, 0}, {255, 255, 255}}},
+    {CS_YCBCR, {{76, 85, 255}, {255, 128, 128}}},
+    {CS_HSV, {{0, 255, 255}, {0, 0, 255}}},
+    {CS_LAB, {{136, 208, 195}, {255, 128, 128}}},
+  };
+  MinImg rgb = {};
+  ASSERT_EQ(NO_ERRORS, WrapAlignedBufferWithMinImage(&rgb, pixels, 2, 1, 3,
+                                                     TYP_UINT8, 6));
+  for (const auto &test_case : cases) {
+    uint8_t converted[2][3] = {};
+    MinImg dst = {};
+    ASSERT_EQ(NO_ERRORS, WrapAlignedBufferWithMinImage(&dst, converted, 2, 1, 3,
+                                                       TYP_UINT8, 6));
+    ASSERT_EQ(NO_ERRORS, ConvertMinImageColorSpace(&dst, &rgb,
+                                                   test_case.space));
+    for (int i = 0; i < 2; ++i)
+      for (int c = 0; c < 3; ++c)
+        EXPECT_NEAR(test_case.expected[i][c], converted[i][c], 1)
+            << "space " << test_case.space << " pixel " << i;
+  }
+
+  // Round trips through every color space, in place for the way back. 8-bit
+  // linear RGB and Lab lose dark shades, so only the others are checked there.
+  const MinTyp types[] = {TYP_UINT8, TYP_UINT16, TYP_REAL32};
+  const ColorSpace spaces[] = {CS_LINEAR_RGB, CS_YCBCR, CS_HSV, CS_LAB};
+  const double tolerances[3][4] = {{-1, 2, 3, -1},
+                                   {2 * 257, 2 * 257, 2 * 257, 2 * 257},
+                                   {1e-4, 1e-4, 1e-4, 1e-4}};
+  for (int t = 0; t < 3; ++t) {
+    DECLARE_GUARDED_MINIMG(src);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 531, 7, 3, types[t]));
+    FillMinImageRandomly(&src);
+    if (types[t] == TYP_REAL32)
+      for (int y = 0; y < src.height; ++y) {
+        float *p_line = reinterpret_cast<float *>(src.pScan0 + y * src.stride);
+        for (int x = 0; x < src.width * 3; ++x)
+          p_line[x] = (rand() & 0xFFFF) / 65535.f;
+      }
+    for (int s = 0; s < 4; ++s) {
+      if (tolerances[t][s] < 0)
+        continue;
+      const ColorSpace space = spaces[s];
+      DECLARE_GUARDED_MINIMG(converted);
+      ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&converted, &src));
+      ASSERT_EQ(NO_ERRORS, ConvertMinImageColorSpace(&converted, &src, space));
+      ASSERT_EQ(NO_ERRORS, ConvertMinImageColorSpace(&converted, &converted,
+                                                     CS_RGB, space));
+      double max_error = 0;
+      for (int y = 0; y < src.height; ++y)
+        for (int x = 0; x < src.width * 3; ++x) {
+          double a = 0, b = 0;
+          switch (types[t]) {
+            case TYP_UINT8:
+              a = (src.pScan0 + y * src.stride)[x];
+              b = (converted.pScan0 + y * converted.stride)[x];
+              break;
+            case TYP_UINT16:
+              a = reinterpret_cast<uint16_t *>(src.pScan0 + y * src.stride)[x];
+              b = reinterpret_cast<uint16_t *>(converted.pScan0 +
+                                               y * converted.stride)[x];
+              break;
+            default:
+              a = reinterpret_cast<float *>(src.pScan0 + y * src.stride)[x];
+              b = reinterpret_cast<float *>(converted.pScan0 +
+                                            y * converted.stride)[x];
+          }
+          max_error = std::max(max_error, std::abs(a - b));
+        }
+      EXPECT_LE(max_error, tolerances[t][s]) << "type " << types[t]
+                                          << " space " << space;
+    }
+  }
+}
+
+TEST(TestMinimgapi, TestTransformMinImageColorsProjectively) {
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 37, 5, 3, TYP_REAL32));
+  for (int y = 0; y < src.height; ++y) {
+    float *p_line = reinterpret_cast<float *>(src.pScan0 + y * src.stride);
+    for (int x = 0; x < src.width * 3; ++x)
+      p_line[x] = (rand() & 0xFF) / 255.f;
+  }
+  const double a = 0.2, k = 0.5;
+  double matrix[16] = {};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      matrix[4 * i + j] = (k + 1) * (i == j ? 1 : a);
+    matrix[12 + i] = k;
+  }
+  matrix[15] = 1;
+  DECLARE_GUARDED_MINIMG(dst);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst, &src));
+  ASSERT_EQ(NO_ERRORS, TransformMinImageColorsProjectively(&dst, &src, matrix));
+  for (int y = 0; y < src.height; ++y) {
+    const float *p_src = reinterpret_cast<float *>(src.pScan0 + y * src.stride);
+    const float *p_dst = reinterpret_cast<float *>(dst.pScan0 + y * dst.stride);
+    for (int x = 0; x < src.width; ++x) {
+      const float *c = p_src + 3 * x;
+      const double sum = c[0] + c[1] + c[2];
+      for (int i = 0; i < 3; ++i)
+        EXPECT_NEAR((k + 1) * (c[i] + a * (sum - c[i])) / (k * sum + 1),
+                    p_dst[3 * x + i], 1e-5);
+    }
+  }
+}
+
+TEST(TestMinimgapi, TestMinImageMoments) {
+  const int width = 301, height = 57, channels = 3, num_labels = 40;
+  DECLARE_GUARDED_MINIMG(image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image, width, height, channels,
+                                            TYP_UINT16));
+  FillMinImageRandomly(&image);
+  DECLARE_GUARDED_MINIMG(image8);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image8, width, height, channels,
+                                            TYP_UINT8));
+  FillMinImageRandomly(&image8);
+  DECLARE_GUARDED_MINIMG(labels);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&labels, width, height, 1,
+                                            TYP_INT32));
+  DECLARE_GUARDED_MINIMG(mask);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&mask, width, height, 1,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      const int label = x / 23 + y / 19 * 14 - 1;
+      reinterpret_cast<int32_t *>(labels.pScan0 + y * labels.stride)[x] = label;
+      mask.pScan0[y * mask.stride + x] = label % 3 == 0 ? 255 : 0;
+    }
+
+  // Exact moments of labels (or of the mask with num_labels == 1).
+  auto reference = [&](const MinImg *p_image, bool use_mask, bool use_labels,
+                       int n, std::vector<int64_t> *p_counts,
+                       std::vector<double> *p_sums,
+                       std::vector<double> *p_cross) {
+    std::vector<int64_t> sums(n * channels), cross(n * channels * channels);
+    p_counts->assign(n, 0);
+    for (int y = 0; y < p_image->height; ++y)
+      for (int x = 0; x < p_image->width; ++x) {
+        int label = 0;
+        if (use_labels)
+          label = reinterpret_cast<int32_t *>(labels.pScan0 +
+                                              y * labels.stride)[x];
+        if (use_mask && !mask.pScan0[y * mask.stride + x])
+          label = -1;
+        if (label < 0 || label >= n)
+          continue;
+        int64_t v[channels];
+        for (int c = 0; c < channels; ++c)
+          v[c] = p_image->channelDepth == 1 ?
+              p_image->pScan0[y * p_image->stride + x * channels + c] :
+              reinterpret_cast<uint16_t *>(p_image->pScan0 + y *
+                                           p_image->stride)[x * channels + c];
+        ++(*p_counts)[label];
+        for (int i = 0; i < channels; ++i) {
+          sums[label * channels + i] += v[i];
+          for (int j = 0; j < channels; ++j)
+            cross[(label * channels + i) * channels + j] += v[i] * v[j];
+        }
+      }
+    p_sums->assign(sums.begin(), sums.end());
+    p_cross->assign(cross.begin(), cross.end());
+  };
+
+  std::vector<int64_t> counts(num_labels), expected_counts;
+  std::vector<double> sums(num_labels * channels), expected_sums;
+  std::vector<double> cross(num_labels * channels * channels), expected_cross;
+  for (const MinImg *p_image : {&image, &image8}) {
+    reference(p_image, false, false, 1, &expected_counts, &expected_sums,
+              &expected_cross);
+    ASSERT_EQ(NO_ERRORS, GetMinImageMoments(counts.data(), sums.data(),
+                                            cross.data(), p_image));
+    EXPECT_EQ(expected_counts[0], counts[0]);
+    for (int i = 0; i < channels; ++i)
+      EXPECT_EQ(expected_sums[i], sums[i]);
+    for (int i = 0; i < channels * channels; ++i)
+      EXPECT_EQ(expected_cross[i], cross[i]);
+
+    reference(p_image, true, false, 1, &expected_counts, &expected_sums,
+              &expected_cross);
+    ASSERT_EQ(NO_ERRORS, GetMinImageMoments(counts.data(), sums.data(),
+                                            cross.data(), p_image, &mask));
+    EXPECT_EQ(expected_counts[0], counts[0]);
+    for (int i = 0; i < channels; ++i)
+      EXPECT_EQ(expected_sums[i], sums[i]);
+    for (int i = 0; i < channels * channels; ++i)
+      EXPECT_EQ(expected_cross[i], cross[i]);
+
+    reference(p_image, false, true, num_labels, &expected_counts,
+              &expected_sums, &expected_cross);
+    ASSERT_EQ(NO_ERRORS, GetMinImageLabelMoments(counts.data(), sums.data(),
+                                                 cross.data(), p_image,
+                                                 &labels, num_labels));
+    EXPECT_EQ(expected_counts, counts);
+    EXPECT_EQ(expected_sums, sums);
+    EXPECT_EQ(expected_cross, cross);
+  }
+
+  // Other channel counts take other kernels.
+  for (int n = 1; n <= 5; ++n)
+    for (MinTyp type : {TYP_UINT8, TYP_UINT16}) {
+      DECLARE_GUARDED_MINIMG(other);
+      ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&other, 133, 3, n, type));
+      FillMinImageRandomly(&other);
+      std::vector<double> other_sums(n), other_cross(n * n);
+      std::vector<int64_t> exact_sums(n), exact_cross(n * n);
+      ASSERT_EQ(NO_ERRORS, GetMinImageMoments(0, other_sums.data(),
+                                              other_cross.data(), &other));
+      for (int y = 0; y < other.height; ++y)
+        for (int x = 0; x < other.width * n; x += n)
+          for (int i = 0; i < n; ++i) {
+            const uint8_t *p_line = other.pScan0 + y * other.stride;
+            auto value = [&](int k) -> int64_t {
+              return type == TYP_UINT8 ? p_line[k] :
+                  reinterpret_cast<const uint16_t *>(p_line)[k];
+            };
+            exact_sums[i] += value(x + i);
+            for (int j = 0; j < n; ++j)
+              exact_cross[i * n + j] += value(x + i) * value(x + j);
+          }
+      EXPECT_EQ(std::vector<double>(exact_sums.begin(), exact_sums.end()),
+                other_sums) << n << " channels of type " << type;
+      EXPECT_EQ(std::vector<double>(exact_cross.begin(), exact_cross.end()),
+                other_cross) << n << " channels of type " << type;
+    }
+
+  // Real images and regions: the sums of a region equal the sums of its copy.
+  MinImg region = {};
+  ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&region, &image8, 17, 5, 200, 31));
+  DECLARE_GUARDED_MINIMG(real_region);
+  ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&real_region, &region,
+                                                        TYP_REAL32));
+  for (int y = 0; y < region.height; ++y)
+    for (int x = 0; x < region.width * channels; ++x)
+      reinterpret_cast<float *>(real_region.pScan0 + y * real_region.stride)[x]
+          = region.pScan0[y * region.stride + x];
+  ASSERT_EQ(NO_ERRORS, GetMinImageMoments(counts.data(), sums.data(),
+                                          cross.data(), &region));
+  std::vector<double> real_sums(channels), real_cross(channels * channels);
+  int64_t real_count = 0;
+  ASSERT_EQ(NO_ERRORS, GetMinImageMoments(&real_count, real_sums.data(),
+                                          real_cross.data(), &real_region));
+  EXPECT_EQ(200 * 31, real_count);
+  EXPECT_EQ(counts[0], real_count);
+  for (int i = 0; i < channels; ++i)
+    EXPECT_DOUBLE_EQ(sums[i], real_sums[i]);
+  for (int i = 0; i < channels * channels; ++i)
+    EXPECT_DOUBLE_EQ(cross[i], real_cross[i]);
+
+  // Histograms.
+  std::vector<int64_t> histogram(channels * 256), expected(channels * 256);
+  ASSERT_EQ(NO_ERRORS, GetMinImageHistogram(histogram.data(), 7, &image8,
+                                            &mask));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      if (mask.pScan0[y * mask.stride + x])
+        for (int c = 0; c < channels; ++c)
+          ++expected[c * 7 +
+                     (image8.pScan0[y * image8.stride + x * channels + c] *
+                      7 >> 8)];
+  EXPECT_TRUE(std::equal(expected.begin(), expected.begin() + channels * 7,
+                         histogram.begin()));
+  MinImg plane = {};
+  ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&plane, &mask, 0, 0, width, height));
+  ASSERT_EQ(NO_ERRORS, GetMinImageHistogram(histogram.data(), 256, &plane));
+  EXPECT_EQ(histogram[0] + histogram[255], width * height);
+  EXPECT_EQ(GetMinImageHistogram(histogram.data(), 257, &plane), BAD_ARGS);
+
+  // Parallel bands give the same results.
+  std::vector<int64_t> parallel_counts(num_labels);
+  std::vector<double> parallel_sums(num_labels * channels);
+  std::vector<double> parallel_cross(num_labels * channels * channels);
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(4));
+  ASSERT_EQ(NO_ERRORS, SetMinImageParallelThreshold(0));
+  ASSERT_EQ(NO_ERRORS, GetMinImageLabelMoments(parallel_counts.data(),
+                                               parallel_sums.data(),
+                                               parallel_cross.data(), &image,
+                                               &labels, num_labels));
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(1));
+  ASSERT_EQ(NO_ERRORS, SetMinImageParallelThreshold(1 << 20));
+  reference(&image, false, true, num_labels, &expected_counts,
+            &expected_sums, &expected_cross);
+  EXPECT_EQ(expected_counts, parallel_counts);
+  EXPECT_EQ(expected_sums, parallel_sums);
+  EXPECT_EQ(expected_cross, parallel_cross);
+}
+
+TEST(TestMinimgapi, TestRetypifyMinImage) {
+  // All the half precision numbers: the conversion to real32 and back must
+  // restore them, NaNs becoming quiet.
+  const int num_halves = 0x10000;
+  DECLARE_GUARDED_MINIMG(halves);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&halves, num_halves / 64, 64, 1,
+                                            TYP_REAL16));
+  uint16_t *p_halves = reinterpret_cast<uint16_t *>(halves.pScan0);
+  for (int i = 0; i < num_halves; ++i)
+    p_halves[i] = static_cast<uint16_t>(i);
+  DECLARE_GUARDED_MINIMG(floats);
+  ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&floats, &halves,
+                                                        TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&floats, &halves));
+  DECLARE_GUARDED_MINIMG(restored);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&restored, &halves));
+  ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&restored, &floats));
+  const float *p_floats = reinterpret_cast<float *>(floats.pScan0);
+  const uint16_t *p_restored = reinterpret_cast<uint16_t *>(restored.pScan0);
+  for (int i = 0; i < num_halves; ++i) {
+    const bool is_nan = (i & 0x7C00) == 0x7C00 && (i & 0x3FF);
+    EXPECT_EQ(is_nan, std::isnan(p_floats[i])) << i;
+    EXPECT_EQ(is_nan ? i | 0x200 : i, p_restored[i]) << i;
+  }
+
+  const struct {
+    uint16_t half;
+    float    value;
+  } exact[] = {
+    {0x0000, 0.f}, {0x8000, -0.f}, {0x3C00, 1.f}, {0xC000, -2.f},
+    {0x3555, 0.333251953125f}, {0x7BFF, 65504.f}, {0x0400, std::ldexp(1.f, -14)},
+    {0x0001, std::ldexp(1.f, -24)}, {0x83FF, -std::ldexp(1023.f, -24)},
+    {0x7C00, HUGE_VALF}, {0xFC00, -HUGE_VALF}};
+  for (const auto &item : exact) {
+    uint32_t expected_bits = 0, bits = 0;
+    std::memcpy(&expected_bits, &item.value, sizeof(float));
+    std::memcpy(&bits, p_floats + item.half, sizeof(float));
+    EXPECT_EQ(expected_bits, bits) << item.half;
+  }
+
+  // Ties round to even; values just off the ties, overflows and underflows.
+  std::vector<float> values;
+  std::vector<uint16_t> expected;
+  for (int i = 0; i < 0x7BFF; ++i) {
+    const float middle = static_cast<float>(
+        (static_cast<double>(p_floats[i]) + p_floats[i + 1]) / 2);
+    values.push_back(middle);
+    expected.push_back(static_cast<uint16_t>(i & 1 ? i + 1 : i));
+    values.push_back(std::nextafter(middle, 0.f));
+    expected.push_back(static_cast<uint16_t>(i));
+    values.push_back(-std::nextafter(middle, HUGE_VALF));
+    expected.push_back(static_cast<uint16_t>(0x8000 | (i + 1)));
+  }
+  const float edges[] = {65519.f, 65520.f, 1e10f, HUGE_VALF,
+                         std::ldexp(1.f, -25), std::ldexp(1.5f, -25),
+                         std::ldexp(1.f, -30), 1e-40f};
+  const uint16_t edge_halves[] = {0x7BFF, 0x7C00, 0x7C00, 0x7C00,
+                                  0x0000, 0x0001, 0x0000, 0x0000};
+  values.insert(values.end(), edges, edges + 8);
+  expected.insert(expected.end(), edge_halves, edge_halves + 8);
+
+  MinImg value_image = {};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&value_image, values.data(),
+                          static_cast<int>(values.size()), 1, 1, TYP_REAL32));
+  DECLARE_GUARDED_MINIMG(rounded);
+  ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&rounded, &value_image,
+                                                        TYP_REAL16));
+  ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&rounded, &value_image));
+  for (size_t i = 0; i < values.size(); ++i)
+    EXPECT_EQ(expected[i], reinterpret_cast<uint16_t *>(rounded.pScan0)[i])
+        << values[i];
+
+  // uint8 values survive half precision, real values are rounded half up.
+  DECLARE_GUARDED_MINIMG(bytes);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bytes, 37, 29, 3, TYP_UINT8));
+  FillMinImageRandomly(&bytes);
+  DECLARE_GUARDED_MINIMG(byte_halves);
+  ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&byte_halves, &bytes,
+                                                        TYP_REAL16));
+  ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&byte_halves, &bytes));
+  DECLARE_GUARDED_MINIMG(restored_bytes);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&restored_bytes, &bytes));
+  ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&restored_bytes, &byte_halves));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&bytes, &restored_bytes));
+  float reals[] = {-3.f, 0.49f, 0.5f, 1.5f, 254.5f, 300.f};
+  const uint8_t rounded_reals[] = {0, 0, 1, 2, 255, 255};
+  MinImg real_image = {};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&real_image, reals, 6, 1, 1,
+                                                   TYP_REAL32));
+  DECLARE_GUARDED_MINIMG(real_halves);
+  ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&real_halves,
+                                                        &real_image,
+                                                        TYP_REAL16));
+  ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&real_halves, &real_image));
+  for (const MinImg *p_src : {&real_image, &real_halves}) {
+    DECLARE_GUARDED_MINIMG(real_bytes);
+    ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&real_bytes, p_src,
+                                                          TYP_UINT8));
+    ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&real_bytes, p_src));
+    for (int i = 0; i < 6; ++i)
+      EXPECT_EQ(rounded_reals[i], real_bytes.pScan0[i]) << reals[i];
+  }
+
+  EXPECT_EQ(BAD_ARGS, RetypifyMinImage(&restored_bytes, &floats));
+  DECLARE_GUARDED_MINIMG(words);
+  ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&words, &halves,
+                                                        TYP_UINT16));
+  EXPECT_EQ(NOT_IMPLEMENTED, RetypifyMinImage(&halves, &words));
+}
+
+#if !defined(_WIN32)
+TEST(TestMinimgapi, TestMappedMinImage) {
+  DECLARE_GUARDED_MINIMG(temporary);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&temporary, 1000, 300, 1,
+                                            TYP_REAL32, 0, AO_EMPTY));
+  ASSERT_EQ(NO_ERRORS, AllocMappedMinImage(&temporary, NULL));
+  EXPECT_EQ(4096, temporary.stride);
+  FillMinImageRandomly(&temporary);
+
+  const std::string file_name = ::testing::TempDir() + "mapped_minimg.bin";
+  MinImg created = {};
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&created, &temporary, AO_EMPTY));
+  ASSERT_EQ(NO_ERRORS, AllocMappedMinImage(&created, file_name.c_str(),
+                                           MO_CREATE));
+  ASSERT_EQ(NO_ERRORS, CopyMinImage(&created, &temporary));
+  ASSERT_EQ(NO_ERRORS, FreeMinImage(&created));
+
+  DECLARE_GUARDED_MINIMG(opened);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&opened, &temporary, AO_EMPTY));
+  ASSERT_EQ(NO_ERRORS, AllocMappedMinImage(&opened, file_name.c_str(),
+                                           MO_OPEN));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&opened, &temporary));
+
+  DECLARE_GUARDED_MINIMG(larger);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&larger, 1000, 301, 1, TYP_REAL32,
+                                            0, AO_EMPTY));
+  EXPECT_EQ(BAD_ARGS, AllocMappedMinImage(&larger, file_name.c_str(),
+                                          MO_OPEN));
+
+  // Raw data from an offset which is not at a page boundary.
+  MinImg expected = {};
+  ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&expected, &temporary, 4, 7, 996, 293));
+  DECLARE_GUARDED_MINIMG(raw);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&raw, 996, 293, 1, TYP_REAL32,
+                                            0, AO_EMPTY));
+  raw.stride = temporary.stride;
+  ASSERT_EQ(NO_ERRORS, MapMinImageFile(&raw, file_name.c_str(),
+                                       7 * temporary.stride + 16));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&raw, &expected));
+  // The mapping is copy-on-write: the pixels may be changed, the file is not.
+  float &pixel = reinterpret_cast<float *>(raw.pScan0)[0];
+  pixel = pixel == 0.f ? 1.f : 0.f;
+  EXPECT_NE(NO_ERRORS, CompareMinImages(&raw, &expected));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&opened, &temporary));
+  EXPECT_EQ(NO_ERRORS, FreeMinImage(&raw));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&raw, &expected, AO_EMPTY));
+  raw.stride = temporary.stride;
+  EXPECT_EQ(BAD_ARGS, MapMinImageFile(&raw, file_name.c_str(),
+                                      8 * temporary.stride + 200));
+  std::remove(file_name.c_str());
+}
+#endif // !defined(_WIN32)
+
+// Runs operation with the baseline kernels and with every wider instruction
+// set supported by the processor and compares the results.
+template <typename TOperation>
+static void ExpectSimdLevelsMatchBaseline(const char   *name,
+                                          const MinImg *p_dst_prototype,
+                                          TOperation    operation) {
+  SCOPED_TRACE(name);
+  const int max_level = GetMinImageSimdLevel();
+  DECLARE_GUARDED_MINIMG(baseline);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&baseline, p_dst_prototype));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&baseline));
+  ASSERT_EQ(NO_ERRORS, SetMinImageSimdLevel(SIMD_BASELINE));
+  ASSERT_EQ(NO_ERRORS, operation(&baseline));
+  for (int level = SIMD_AVX2; level <= max_level; ++level) {
+    SCOPED_TRACE(level);
+    DECLARE_GUARDED_MINIMG(vectorized);
+    ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&vectorized, p_dst_prototype));
+    ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&vectorized));
+    ASSERT_EQ(NO_ERRORS, SetMinImageSimdLevel(level));
+    ASSERT_EQ(NO_ERRORS, operation(&vectorized));
+    EXPECT_EQ(NO_ERRORS, CompareMinImages(&baseline, &vectorized));
+  }
+  ASSERT_EQ(NO_ERRORS, SetMinImageSimdLevel(SIMD_AVX512));
+}
+
+TEST(TestMinimgapi, TestSimdLevels) {
+  EXPECT_EQ(BAD_ARGS, SetMinImageSimdLevel(-1));
+  EXPECT_EQ(BAD_ARGS, SetMinImageSimdLevel(SIMD_AVX512 + 1));
+
+  const int sizes[][2] = {{1, 1}, {31, 33}, {64, 96}, {301, 157}};
+  const MinTyp types[] = {TYP_UINT8, TYP_UINT16, TYP_UINT32, TYP_UINT64};
+  for (const int *size : sizes) {
+    SCOPED_TRACE(testing::Message() << size[0] << "x" << size[1]);
+    for (MinTyp type : types) {
+      SCOPED_TRACE(type);
+      DECLARE_GUARDED_MINIMG(src);
+      ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, size[0], size[1], 4,
+                                                type));
+      FillMinImageRandomly(&src);
+      DECLARE_GUARDED_MINIMG(rgb);
+      ASSERT_EQ(NO_ERRORS, CloneDimensionedMinImagePrototype(&rgb, &src, 3,
+                                                             AO_EMPTY));
+      ExpectSimdLevelsMatchBaseline("CopyMinImageChannels 4 to 3", &rgb,
+                                    [&](const MinImg *p_dst) {
+        const int channels[] = {0, 1, 2};
+        return CopyMinImageChannels(p_dst, &src, channels, channels, 3);
+      });
+      DECLARE_GUARDED_MINIMG(bgr);
+      ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&bgr, &rgb));
+      ExpectSimdLevelsMatchBaseline("CopyMinImageChannels 4 to 3 reversed",
+                                    &bgr, [&](const MinImg *p_dst) {
+        const int dst_channels[] = {2, 1, 0};
+        const int src_channels[] = {0, 1, 2};
+        return CopyMinImageChannels(p_dst, &src, dst_channels, src_channels,
+                                    3);
+      });
+      ExpectSimdLevelsMatchBaseline("CopyMinImageChannels 3 to 4", &src,
+                                    [&](const MinImg *p_dst) {
+        const int dst_channels[] = {3, 1, 0};
+        const int src_channels[] = {0, 1, 2};
+        return CopyMinImageChannels(p_dst, &bgr, dst_channels, src_channels,
+                                    3);
+      });
+    }
+
+    DECLARE_GUARDED_MINIMG(halves);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&halves, size[0], size[1], 3,
+                                              TYP_REAL16));
+    FillMinImageRandomly(&halves);
+    DECLARE_GUARDED_MINIMG(floats);
+    ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(&floats, &halves,
+                                                          TYP_REAL32));
+    ExpectSimdLevelsMatchBaseline("RetypifyMinImage real16 to real32", &floats,
+                                  [&](const MinImg *p_dst) {
+      return RetypifyMinImage(p_dst, &halves);
+    });
+    // Random bits below the half precision mantissa test the rounding.
+    ASSERT_EQ(NO_ERRORS, RetypifyMinImage(&floats, &halves));
+    for (int y = 0; y < floats.height; ++y) {
+      uint32_t *p_line = reinterpret_cast<uint32_t *>(floats.pScan0 +
+                                                      y * floats.stride);
+      for (int x = 0; x < 3 * floats.width; ++x)
+        p_line[x] ^= rand() & 0x1FFF;
+    }
+    ExpectSimdLevelsMatchBaseline("RetypifyMinImage real32 to real16", &halves,
+                                  [&](const MinImg *p_dst) {
+      return RetypifyMinImage(p_dst, &floats);
+    });
+  }
+}
+
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
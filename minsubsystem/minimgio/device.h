@@ -47,6 +47,16 @@ extern "C" {
 #endif
 
 static const char * DSS_CAMERA = "camera";
+/**
+ * Replays recorded frames as a video capture device, without any hardware.
+ * The device name has the form <source>[\n<frameRate>[\n<ringFrames>]],
+ * where the source is a directory of images, a list file or a multi-page
+ * image. The frames are looped at the given rate, or as fast as they are
+ * queried when the rate is omitted or zero, from a ring of decoded frames
+ * (16 by default). Pages whose size or type differ from the first one are
+ * skipped. Only @c SP_FRAMESIZE and @c SP_FRAMERATE are supported.
+ */
+static const char * DSS_REPLAY = "replay";
 
 /**
  * Specifies frame size on a video capture device in the following format:
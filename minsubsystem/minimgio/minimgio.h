@@ -137,6 +137,13 @@ either expressed or implied, of copyright holders.
  *   char szImageMemPath[250] = {0};
  *   sprintf(szImageMemPath, "mem://%p.%lu", pImageData, imageSize);
  * @endcode
+ *
+ * TIFF images can also be saved into a memory block with SaveMinImageEx().
+ * Since such filename has no extension, the format must be specified with
+ * @c pProps->iff. The image is written from the beginning of the block as a
+ * single page, and the function fails if the block is too small. To encode an
+ * image into a buffer of unknown size use @c se::image_io::EncodeImage() with
+ * @c se::image_io::ExtensibleBufferOutputStream.
  */
 
 /**
@@ -159,6 +166,7 @@ either expressed or implied, of copyright holders.
 #include <minbase/crossplat.h>
 #include <minimgio/define.h>
 #include <minbase/minimg.h>
+#include <mingeo/mingeo.h>
 
 #ifdef __cplusplus
   extern "C" {
@@ -275,6 +283,42 @@ MINIMGIO_API int GetMinImagePageName
   int         page
 );
 
+/**
+ * @brief   Callback receiving the images of an image list.
+ * @param   pContext  The context passed to @c ListMinImageFiles().
+ * @param   pFileName The path of the next image of the list.
+ * @returns @c NO_ERRORS to continue listing or an error code to stop it.
+ * @ingroup MinImgIOAPI
+ */
+typedef int (*MinImageListCallback)
+(
+  void       *pContext,
+  const char *pFileName
+);
+
+/**
+ * @brief   Lists the images of an image list file.
+ * @param   pFileName The filename of the list (.lst).
+ * @param   callback  The callback receiving the paths of the images.
+ * @param   pContext  The context passed to the callback.
+ * @returns The number of images on success or an error code otherwise (see
+ *          @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function parses the list once and passes the paths of its images to the
+ * callback in order. The paths are the ones @c LoadMinImage() loads the pages
+ * of the list from: the names in the list are taken relative to its directory.
+ * Empty lines and lines starting with ';' are skipped, "#stop" or "#end" ends
+ * the list. If the callback returns an error, listing stops and the error is
+ * returned. @c NOT_SUPPORTED is returned for files other than lists.
+ */
+MINIMGIO_API int ListMinImageFiles
+(
+  const char           *pFileName,
+  MinImageListCallback  callback,
+  void                 *pContext IS_BY_DEFAULT(0)
+);
+
 /**
  * @brief   Gets basic information about an image.
  * @param   pImg      The image to be filled.
@@ -336,6 +380,194 @@ MINIMGIO_API int LoadMinImage
   int           page IS_BY_DEFAULT(0)
 );
 
+/**
+ * @brief   Handle of an image file opened for reading.
+ * @ingroup MinImgIOAPI
+ */
+typedef struct MinImageFile MinImageFile;
+
+/**
+ * @brief   Opens an image file for reading.
+ * @param   ppFile    The opened file handle.
+ * @param   pFileName The filename of the image.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function maps the whole file into memory with a single open, so that
+ * detecting its format, getting the properties and loading the pages do not
+ * open and parse the file again and again, as GuessImageFileFormat(),
+ * GetMinImageFileProps() and LoadMinImage() do. This pays off for small
+ * images and network file systems. Only the parts of the file the decoders
+ * read are loaded, so opening a page of a multi-page file does not read the
+ * others. The last properties requested are kept in the handle. Lists,
+ * devices, memory blocks and files which cannot be mapped are accessed by
+ * name as usual.
+ */
+MINIMGIO_API int OpenMinImageFile
+(
+  MinImageFile **ppFile,
+  const char    *pFileName
+);
+
+/**
+ * @brief   Gets the number of pages in an opened image file.
+ * @param   pFile     The file handle (see OpenMinImageFile()).
+ * @returns The number of pages on success or an error code otherwise.
+ * @ingroup MinImgIOAPI
+ */
+MINIMGIO_API int GetOpenedMinImagePages
+(
+  MinImageFile *pFile
+);
+
+/**
+ * @brief   Gets information about a page of an opened image file.
+ * @param   pImg      The image to be filled, or @c NULL.
+ * @param   pProps    The additional information about the image, or @c NULL.
+ * @param   pFile     The file handle (see OpenMinImageFile()).
+ * @param   page      0-based page number.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function works as GetMinImageFilePropsEx().
+ */
+MINIMGIO_API int GetOpenedMinImageProps
+(
+  MinImg       *pImg,
+  ExtImgProps  *pProps,
+  MinImageFile *pFile,
+  int           page IS_BY_DEFAULT(0)
+);
+
+/**
+ * @brief   Loads a page of an opened image file.
+ * @param   pImg      Loaded image.
+ * @param   pFile     The file handle (see OpenMinImageFile()).
+ * @param   page      0-based page number.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function works as LoadMinImage(); @c pImg must be allocated in advance.
+ */
+MINIMGIO_API int LoadOpenedMinImage
+(
+  const MinImg *pImg,
+  MinImageFile *pFile,
+  int           page IS_BY_DEFAULT(0)
+);
+
+/**
+ * @brief   Closes an image file opened for reading.
+ * @param   pFile     The file handle (see OpenMinImageFile()).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ */
+MINIMGIO_API int CloseMinImageFile
+(
+  MinImageFile *pFile
+);
+
+/**
+ * @brief   Loads a region of an image from a file, optionally downscaled.
+ * @param   pImg       Loaded image region.
+ * @param   pFileName  The filename of the image to load.
+ * @param   page       0-based page number.
+ * @param   pRoi       The region to load in full resolution coordinates, or
+ *                     @c NULL for the whole page.
+ * @param   scaleDenom The downscale factor: 1, 2, 4 or 8.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function loads the specified region of the image reduced @c scaleDenom
+ * times in both directions. The image must be allocated in advance with at
+ * least ceil(width / scaleDenom) x ceil(height / scaleDenom) pixels of the
+ * region; pixel (i, j) of it receives pixel (x / scaleDenom + i,
+ * y / scaleDenom + j) of the reduced image. Only the needed part of the file
+ * is decoded where the format allows it: JPEG is decoded at the reduced scale
+ * and stops after the last row of the region, TIFF reads only the strips and
+ * tiles covering the region and PNG stops after its last row. Other formats
+ * are loaded in full and then cropped and reduced.
+ */
+MINIMGIO_API int LoadMinImageRegion
+(
+  const MinImg  *pImg,
+  const char    *pFileName,
+  int            page,
+  const MinRect *pRoi,
+  int            scaleDenom IS_BY_DEFAULT(1)
+);
+
+/**
+ * @brief   Callback receiving the decoded rows of an image.
+ * @param   pContext The context passed to @c LoadMinImageRows().
+ * @param   pImg     The image being loaded.
+ * @param   firstRow The first of the new decoded rows.
+ * @param   nRows    The number of the new decoded rows.
+ * @returns @c NO_ERRORS to continue decoding or an error code to stop it.
+ * @ingroup MinImgIOAPI
+ */
+typedef int (*MinImageRowsCallback)
+(
+  void         *pContext,
+  const MinImg *pImg,
+  int           firstRow,
+  int           nRows
+);
+
+/**
+ * @brief   Loads an image from a file reporting the rows as they are decoded.
+ * @param   pImg        Loaded image.
+ * @param   pFileName   The filename of the image to load.
+ * @param   page        0-based page number.
+ * @param   rowsPerCall The number of rows reported by a call of the callback.
+ * @param   callback    The callback receiving the decoded rows.
+ * @param   pContext    The context passed to the callback.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function loads the image as @c LoadMinImage() does and calls the
+ * callback from the calling thread every time the next @c rowsPerCall rows
+ * are in the image, so the top of the image may be processed while the rest
+ * is still decoded. The rows reported once are not changed later. The last
+ * call may report fewer rows. JPEG, TIFF and non-interlaced PNG images are
+ * decoded and reported row by row (TIFF by strips or rows of tiles); the
+ * other images are reported after they have been loaded in full. If the
+ * callback returns an error, decoding stops and the error is returned.
+ */
+MINIMGIO_API int LoadMinImageRows
+(
+  const MinImg         *pImg,
+  const char           *pFileName,
+  int                   page,
+  int                   rowsPerCall,
+  MinImageRowsCallback  callback,
+  void                 *pContext IS_BY_DEFAULT(0)
+);
+
+/**
+ * @brief   Maps an image from a file instead of loading it.
+ * @param   pImg      The mapped image (the header must be empty).
+ * @param   pFileName The filename of the image to map.
+ * @param   page      0-based page number.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function fills the image header and points the image lines straight
+ * into a copy-on-write memory mapping of the file, so nothing is decoded or
+ * copied and the pixels are read from the file when accessed. Only TIFF pages
+ * stored uncompressed in contiguous strips with the native byte order and
+ * at least 8 bits per sample can be mapped, @c NOT_SUPPORTED is returned for
+ * the others, which should be loaded with @c LoadMinImage(). Changes to the
+ * image are kept in memory and never written to the file. The image is
+ * released with @c FreeMinImage().
+ */
+MINIMGIO_API int MapMinImage
+(
+  MinImg     *pImg,
+  const char *pFileName,
+  int         page IS_BY_DEFAULT(0)
+);
+
 /**
  * @brief   Saves an image to a specified file.
  * @param   pFileName The name of the file to save the image.
@@ -377,6 +609,90 @@ MINIMGIO_API int SaveMinImageEx
   int                page IS_BY_DEFAULT(0)
 );
 
+/**
+ * @brief   Handle of a multi-page image file being written.
+ * @ingroup MinImgIOAPI
+ */
+typedef struct MinImageWriter MinImageWriter;
+
+/**
+ * @brief   Creates a multi-page image file to write pages one by one.
+ * @param   ppWriter   The created writer handle.
+ * @param   pFileName  The name of the file to create.
+ * @param   iff        The file format, or @c IFF_UNKNOWN to choose it by the
+ *                     filename extension.
+ * @param   background Whether the pages are encoded on a background thread.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function creates (or truncates) the file and keeps it open until
+ * CloseMinImageWriter() is called. Unlike SaveMinImageEx() with increasing
+ * page numbers, every page is written once after the previous one, so writing
+ * N pages costs O(N). Only TIFF files can be written this way.
+ *
+ * In the background mode AddMinImageWriterPage() copies the page and returns
+ * at once (unless a few pages are already waiting); errors of the background
+ * thread are reported by the next call. Once writing a page fails, the
+ * writer rejects the later pages and CloseMinImageWriter() returns the error.
+ */
+MINIMGIO_API int OpenMinImageWriter
+(
+  MinImageWriter **ppWriter,
+  const char      *pFileName,
+  ImgFileFormat    iff IS_BY_DEFAULT(IFF_UNKNOWN),
+  int              background IS_BY_DEFAULT(0)
+);
+
+/**
+ * @brief   Appends a page to a multi-page image file.
+ * @param   pWriter   The writer handle (see OpenMinImageWriter()).
+ * @param   pImg      The image to be written as the next page.
+ * @param   pProps    The save parameters of the page, or @c NULL.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ */
+MINIMGIO_API int AddMinImageWriterPage
+(
+  MinImageWriter    *pWriter,
+  const MinImg      *pImg,
+  const ExtImgProps *pProps IS_BY_DEFAULT(0)
+);
+
+/**
+ * @brief   Finishes writing a multi-page image file.
+ * @param   pWriter   The writer handle (see OpenMinImageWriter()).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function waits for the pages queued for the background thread, closes
+ * the file and destroys the handle.
+ */
+MINIMGIO_API int CloseMinImageWriter
+(
+  MinImageWriter *pWriter
+);
+
+/**
+ * @brief   Saves images as the pages of a multi-page file.
+ * @param   pFileName The name of the file to save the images.
+ * @param   pImgs     The images to be saved.
+ * @param   nImgs     The number of the images.
+ * @param   pProps    The save parameters of all the pages, or @c NULL.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgIOAPI
+ *
+ * The function overwrites the file with @c nImgs pages using a
+ * @c MinImageWriter. The format is taken from @c pProps or from the filename
+ * extension.
+ */
+MINIMGIO_API int SaveMinImagePages
+(
+  const char        *pFileName,
+  const MinImg      *pImgs,
+  int                nImgs,
+  const ExtImgProps *pProps IS_BY_DEFAULT(0)
+);
+
 /**
  * @brief   Packs a grayscale image into monochrome once.
  * @param   pDst      The output 1-bit single-channel image.
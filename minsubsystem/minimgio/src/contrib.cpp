@@ -4,6 +4,10 @@
 
 #include <minimgio/contrib.h>
 #include <minutils/minhelpers.h>
+#include <minbase/minresult.h>
+
+#include "minimgiotiff.h"
+#include "pngencode.h"
 
 #if defined(WITH_TIFF)
 # include <tiffio.h>
@@ -18,6 +22,7 @@
 #if defined(WITH_PNG)
 # define PNG_SKIP_SETJMP_CHECK
 # include <png.h>
+# include <zlib.h>
 #endif // WITH_PNG
 
 #if defined(WITH_WEBP)
@@ -143,12 +148,30 @@ int ExtensibleBufferOutputStream::WriteBytes(const uint8_t *bytes, int count) {
 }
 
 static int EncodeImageToTiff(
-    const MinImg            & /* image */,
-    OutputStreamInterface   & /* output */) {
+    const MinImg            &image,
+    OutputStreamInterface   &output) {
 #if !defined(WITH_TIFF)
+  SUPPRESS_UNUSED_VARIABLE(image);
+  SUPPRESS_UNUSED_VARIABLE(output);
   return -1;
 #else
-  return -1;
+  if (!image.pScan0) {
+    return -2;
+  }
+
+  // TIFF directories are linked by absolute offsets, so the file is composed
+  // in memory first and then passed to the output in one piece.
+  std::vector<uint8_t> buffer;
+  if (SaveTiffToBuffer(&buffer, &image, NULL) != NO_ERRORS) {
+    return -3;
+  }
+
+  if (buffer.empty() ||
+      output.WriteBytes(&buffer[0], static_cast<int>(buffer.size()))) {
+    return -1;
+  }
+
+  return 0;
 #endif // WITH_TIFF
 }
 
@@ -340,6 +363,8 @@ static int EncodeImageToPng(
     return -3;
   }
 
+  // Kept out of the setjmp() scope to be freed if libpng fails.
+  std::vector<std::vector<uint8_t> > blocks;
   if (setjmp(png_jmpbuf(png_ptr))) {
     png_destroy_write_struct(&png_ptr, &info_ptr);
     return -3;
@@ -367,6 +392,16 @@ static int EncodeImageToPng(
   png_set_write_fn(png_ptr, &output, PngWriteHelper, PngFlushHelper);
   png_write_info(png_ptr, info_ptr);
 
+  if (IsPngParallelEncodingUseful(&image)) {
+    if (DeflatePngRows(&blocks, &image, Z_DEFAULT_COMPRESSION) != NO_ERRORS) {
+      png_destroy_write_struct(&png_ptr, &info_ptr);
+      return -3;
+    }
+    WritePngDataChunks(png_ptr, blocks);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    return 0;
+  }
+
   std::vector<png_bytep> row_ptrs(image.height);
   for (int y = 0; y < image.height; ++y) {
     row_ptrs[y] = image.pScan0 + y * image.stride;
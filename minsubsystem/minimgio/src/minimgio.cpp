@@ -38,8 +38,14 @@ either expressed or implied, of copyright holders.
 #include <cstdio>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
 
 #include <minbase/minresult.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/imgguard.hpp>
 #include "minimgiodevice.h"
 #include "minimgiotiff.h"
 #include "minimgiojpeg.h"
@@ -49,6 +55,8 @@ either expressed or implied, of copyright holders.
 #include "utils.h"
 #include "pack.h"
 
+#include <sys/stat.h>
+
 #ifdef _WIN32
 #define stricmp _stricmp
 #else
@@ -186,21 +194,14 @@ MINIMGIO_API int GuessImageFileFormat
   return GuessImageFileFormatByExtension(fileName);
 }
 
-MINIMGIO_API int GetMinImageFilePages
+// Dispatchers by a known format, shared by the functions taking a filename
+// and those taking an opened file.
+static int GetMinImageFilePagesByFormat
 (
+  int         iff,
   const char *pFileName
 )
 {
-  if (!pFileName)
-    return BAD_ARGS;
-  int fileLocation = DeduceFileLocation(pFileName);
-  if (fileLocation == inDevice)
-    return GetDevicePages(pFileName);
-
-  int iff = GuessImageFileFormat(pFileName);
-  if (iff < 0)
-    return iff;
-
   switch (iff)
   {
     case IFF_TIFF:
@@ -220,6 +221,77 @@ MINIMGIO_API int GetMinImageFilePages
   return INTERNAL_ERROR;
 }
 
+static int GetMinImageFilePropsByFormat
+(
+  int          iff,
+  MinImg      *pImg,
+  ExtImgProps *pProps,
+  const char  *pFileName,
+  int          page
+)
+{
+  switch (iff)
+  {
+  case IFF_TIFF:
+    return GetTiffPropsEx(pImg, pProps, pFileName, page);
+  case IFF_JPEG:
+    return GetJpegPropsEx(pImg, pProps, pFileName);
+  case  IFF_PNG:
+    return GetPngPropsEx(pImg, pProps, pFileName);
+  case IFF_WEBP:
+    return GetWebPPropsEx(pImg, pProps, pFileName);
+  case IFF_LST:
+    return GetLstPropsEx(pImg, pProps, pFileName, page);
+  default:
+    return FILE_ERROR;
+  }
+  return INTERNAL_ERROR;
+}
+
+static int LoadMinImageByFormat
+(
+  int           iff,
+  const MinImg *pImg,
+  const char   *pFileName,
+  int           page
+)
+{
+  switch (iff)
+  {
+  case IFF_TIFF:
+    return LoadTiff(pImg, pFileName, page);
+  case IFF_JPEG:
+    return LoadJpeg(pImg, pFileName);
+  case IFF_PNG:
+    return LoadPng(pImg, pFileName);
+  case IFF_WEBP:
+    return LoadWebP(pImg, pFileName);
+  case IFF_LST:
+    return LoadLst(pImg, pFileName, page);
+  default:
+    return FILE_ERROR;
+  }
+  return INTERNAL_ERROR;
+}
+
+MINIMGIO_API int GetMinImageFilePages
+(
+  const char *pFileName
+)
+{
+  if (!pFileName)
+    return BAD_ARGS;
+  int fileLocation = DeduceFileLocation(pFileName);
+  if (fileLocation == inDevice)
+    return GetDevicePages(pFileName);
+
+  int iff = GuessImageFileFormat(pFileName);
+  if (iff < 0)
+    return iff;
+
+  return GetMinImageFilePagesByFormat(iff, pFileName);
+}
+
 MINIMGIO_API int GetMinImagePageName(char *pPageName, int pageNameSize, const char *pFileName, int page)
 {
   int fileLocation = DeduceFileLocation(pFileName);
@@ -249,6 +321,25 @@ MINIMGIO_API int GetMinImagePageName(char *pPageName, int pageNameSize, const ch
   return INTERNAL_ERROR;
 }
 
+MINIMGIO_API int ListMinImageFiles
+(
+  const char           *pFileName,
+  MinImageListCallback  callback,
+  void                 *pContext
+)
+{
+  if (!pFileName || !callback)
+    return BAD_ARGS;
+
+  int iff = GuessImageFileFormat(pFileName);
+  if (iff < 0)
+    return iff;
+  if (iff != IFF_LST)
+    return NOT_SUPPORTED;
+
+  return ListLstImages(pFileName, callback, pContext);
+}
+
 MINIMGIO_API int GetMinImageFileProps
 (
   MinImg     *pImg,
@@ -277,22 +368,7 @@ MINIMGIO_API int GetMinImageFilePropsEx
   if (iff < 0)
     return iff;
 
-  switch (iff)
-  {
-  case IFF_TIFF:
-    return GetTiffPropsEx(pImg, pProps, pFileName, page);
-  case IFF_JPEG:
-    return GetJpegPropsEx(pImg, pProps, pFileName);
-  case  IFF_PNG:
-    return GetPngPropsEx(pImg, pProps, pFileName);
-  case IFF_WEBP:
-    return GetWebPPropsEx(pImg, pProps, pFileName);
-  case IFF_LST:
-    return GetLstPropsEx(pImg, pProps, pFileName, page);
-  default:
-    return FILE_ERROR;
-  }
-  return INTERNAL_ERROR;
+  return GetMinImageFilePropsByFormat(iff, pImg, pProps, pFileName, page);
 }
 
 MINIMGIO_API int LoadMinImage
@@ -308,6 +384,450 @@ MINIMGIO_API int LoadMinImage
   if (fileLocation == inDevice)
     return LoadDevice(pImg, pFileName);
 
+  int iff = GuessImageFileFormat(pFileName);
+  if (iff < 0)
+    return iff;
+
+  return LoadMinImageByFormat(iff, pImg, pFileName, page);
+}
+
+// An image file mapped into memory with a single open. The decoders parse it
+// through a mem:// name, so probing and loading never touch the file again,
+// and only the pages of the file they read are brought into memory. Files of
+// other formats (lists, devices) and files which cannot be mapped are
+// accessed by the original name.
+struct MinImageFile
+{
+  MinImageFile() : buffered(false), iff(IFF_UNKNOWN), nPages(-1), propsPage(-1)
+  {
+    ::memset(&mapping, 0, sizeof(mapping));
+    ::memset(&props, 0, sizeof(props));
+    ::memset(&extProps, 0, sizeof(extProps));
+  }
+  ~MinImageFile()
+  {
+    FreeMinImage(&mapping);
+  }
+
+  MinImg mapping;
+  std::string fileName;
+  bool buffered;
+  int iff;
+  int nPages;
+  int propsPage;
+  MinImg props;
+  ExtImgProps extProps;
+};
+
+static int GetFileSize
+(
+  uint64_t   *pSize,
+  const char *pFileName
+)
+{
+#ifdef _WIN32
+  struct _stati64 fileStat;
+  if (::_stati64(pFileName, &fileStat) != 0)
+    return FILE_ERROR;
+#else
+  struct stat fileStat;
+  if (::stat(pFileName, &fileStat) != 0)
+    return FILE_ERROR;
+#endif
+  *pSize = static_cast<uint64_t>(fileStat.st_size);
+  return NO_ERRORS;
+}
+
+// Maps the whole file as a single line of bytes. Files too large for a line or
+// a mem:// name are left unmapped.
+static int MapWholeFile
+(
+  MinImg     *pMapping,
+  const char *pFileName
+)
+{
+  uint64_t size = 0;
+  PROPAGATE_ERROR(GetFileSize(&size, pFileName));
+  if (size == 0)
+    return FILE_ERROR;
+  if (size > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+      size > static_cast<uint64_t>(std::numeric_limits<unsigned long>::max()))
+    return NOT_SUPPORTED;
+
+  MinImg mapping = {0};
+  mapping.width = static_cast<int>(size);
+  mapping.height = 1;
+  mapping.channels = 1;
+  mapping.channelDepth = 1;
+  mapping.format = FMT_UINT;
+  PROPAGATE_ERROR(MapMinImageFile(&mapping, pFileName, 0));
+  *pMapping = mapping;
+  return NO_ERRORS;
+}
+
+MINIMGIO_API int OpenMinImageFile
+(
+  MinImageFile **ppFile,
+  const char    *pFileName
+)
+{
+  if (!ppFile || !pFileName)
+    return BAD_ARGS;
+
+  std::unique_ptr<MinImageFile> pFile(new MinImageFile);
+  pFile->fileName = pFileName;
+
+  if (DeduceFileLocation(pFileName) == inFileSystem)
+  {
+    const int res = MapWholeFile(&pFile->mapping, pFileName);
+    if (res == FILE_ERROR)
+      return res;
+    if (res == NO_ERRORS)
+    {
+      char memoryName[64] = {0};
+      sprintf(memoryName, "mem://%p.%lu",
+              static_cast<void *>(pFile->mapping.pScan0),
+              static_cast<unsigned long>(pFile->mapping.width));
+      const int iff = GuessImageFileFormatByTag(memoryName);
+      if (iff != IFF_UNKNOWN)
+      {
+        pFile->fileName = memoryName;
+        pFile->buffered = true;
+        pFile->iff = iff;
+      }
+      else
+        FreeMinImage(&pFile->mapping);
+    }
+  }
+
+  *ppFile = pFile.release();
+  return NO_ERRORS;
+}
+
+MINIMGIO_API int GetOpenedMinImagePages
+(
+  MinImageFile *pFile
+)
+{
+  if (!pFile)
+    return BAD_ARGS;
+  if (!pFile->buffered)
+    return GetMinImageFilePages(pFile->fileName.c_str());
+
+  if (pFile->nPages < 0)
+    pFile->nPages = GetMinImageFilePagesByFormat(pFile->iff,
+                                                 pFile->fileName.c_str());
+  return pFile->nPages;
+}
+
+MINIMGIO_API int GetOpenedMinImageProps
+(
+  MinImg       *pImg,
+  ExtImgProps  *pProps,
+  MinImageFile *pFile,
+  int           page
+)
+{
+  if (!pFile || (!pProps && !pImg) || (pImg && pImg->pScan0) || page < 0)
+    return BAD_ARGS;
+  if (!pFile->buffered)
+    return GetMinImageFilePropsEx(pImg, pProps, pFile->fileName.c_str(), page);
+
+  // The headers of the last page asked for are kept for the next calls.
+  if (pFile->propsPage != page)
+  {
+    MinImg props = {0};
+    ExtImgProps extProps = {IFF_UNKNOWN, IFC_NONE, 0.f, 0.f, 0};
+    PROPAGATE_ERROR(GetMinImageFilePropsByFormat(
+        pFile->iff, &props, &extProps, pFile->fileName.c_str(), page));
+    pFile->props = props;
+    pFile->extProps = extProps;
+    pFile->propsPage = page;
+  }
+
+  if (pImg)
+    *pImg = pFile->props;
+  if (pProps)
+    *pProps = pFile->extProps;
+  return NO_ERRORS;
+}
+
+MINIMGIO_API int LoadOpenedMinImage
+(
+  const MinImg *pImg,
+  MinImageFile *pFile,
+  int           page
+)
+{
+  if (!pFile)
+    return BAD_ARGS;
+  if (!pFile->buffered)
+    return LoadMinImage(pImg, pFile->fileName.c_str(), page);
+
+  return LoadMinImageByFormat(pFile->iff, pImg, pFile->fileName.c_str(), page);
+}
+
+MINIMGIO_API int CloseMinImageFile
+(
+  MinImageFile *pFile
+)
+{
+  if (!pFile)
+    return BAD_ARGS;
+
+  delete pFile;
+  return NO_ERRORS;
+}
+
+// Loads the region of the page at full scale. Formats which cannot decode a
+// part of the image are loaded in full and cropped.
+static int LoadRegionAtFullScale
+(
+  const MinImg  *pImg,
+  const char    *pFileName,
+  int            page,
+  int            iff,
+  const MinRect &roi
+)
+{
+  switch (iff)
+  {
+  case IFF_TIFF:
+    return LoadTiffRegion(pImg, pFileName, page, &roi);
+  case IFF_JPEG:
+    return LoadJpegRegion(pImg, pFileName, &roi, 1);
+  case IFF_PNG:
+    return LoadPngRegion(pImg, pFileName, &roi);
+  default:
+    break;
+  }
+
+  DECLARE_GUARDED_MINIMG(image);
+  PROPAGATE_ERROR(GetMinImageFileProps(&image, pFileName, page));
+  PROPAGATE_ERROR(AllocMinImage(&image));
+  PROPAGATE_ERROR(LoadMinImage(&image, pFileName, page));
+
+  MinImg srcRegion = {0}, dstRegion = {0};
+  PROPAGATE_ERROR(GetMinImageRegion(&srcRegion, &image,
+                                    roi.x, roi.y, roi.width, roi.height));
+  PROPAGATE_ERROR(GetMinImageRegion(&dstRegion, pImg,
+                                    0, 0, roi.width, roi.height));
+  return CopyMinImage(&dstRegion, &srcRegion);
+}
+
+// Averages the scale x scale blocks of the source into the pixels of the
+// destination. Blocks cut off by the source edges are averaged over the pixels
+// they contain.
+template <typename T, typename S>
+static void AverageBlocks
+(
+  const MinImg *pDst,
+  const MinImg *pSrc,
+  int           scale
+)
+{
+  const int channels = pDst->channels;
+  for (int y = 0; y < pDst->height; y++)
+  {
+    const int yBegin = y * scale;
+    const int yEnd = std::min(yBegin + scale, pSrc->height);
+    T *pDstLine = reinterpret_cast<T *>(pDst->pScan0 +
+        static_cast<ptrdiff_t>(y) * pDst->stride);
+    for (int x = 0; x < pDst->width; x++)
+    {
+      const int xBegin = x * scale;
+      const int xEnd = std::min(xBegin + scale, pSrc->width);
+      const S n = static_cast<S>((yEnd - yBegin) * (xEnd - xBegin));
+      for (int c = 0; c < channels; c++)
+      {
+        S sum = 0;
+        for (int yy = yBegin; yy < yEnd; yy++)
+        {
+          const T *pSrcLine = reinterpret_cast<const T *>(pSrc->pScan0 +
+              static_cast<ptrdiff_t>(yy) * pSrc->stride);
+          for (int xx = xBegin; xx < xEnd; xx++)
+            sum += pSrcLine[xx * channels + c];
+        }
+        if (std::numeric_limits<S>::is_integer)
+          sum = sum >= 0 ? (sum + n / 2) / n : -((n / 2 - sum) / n);
+        else if (std::numeric_limits<T>::is_integer)
+          sum = std::floor(sum / n + S(0.5));
+        else
+          sum /= n;
+        pDstLine[x * channels + c] = static_cast<T>(sum);
+      }
+    }
+  }
+}
+
+// Bit images take the value of the majority of the block, ties are set.
+static void AverageBitBlocks
+(
+  const MinImg *pDst,
+  const MinImg *pSrc,
+  int           scale
+)
+{
+  const int channels = pDst->channels;
+  for (int y = 0; y < pDst->height; y++)
+  {
+    const int yBegin = y * scale;
+    const int yEnd = std::min(yBegin + scale, pSrc->height);
+    uint8_t *pDstLine = pDst->pScan0 + static_cast<ptrdiff_t>(y) * pDst->stride;
+    for (int x = 0; x < pDst->width; x++)
+    {
+      const int xBegin = x * scale;
+      const int xEnd = std::min(xBegin + scale, pSrc->width);
+      const int n = (yEnd - yBegin) * (xEnd - xBegin);
+      for (int c = 0; c < channels; c++)
+      {
+        int sum = 0;
+        for (int yy = yBegin; yy < yEnd; yy++)
+        {
+          const uint8_t *pSrcLine = pSrc->pScan0 +
+              static_cast<ptrdiff_t>(yy) * pSrc->stride;
+          for (int xx = xBegin; xx < xEnd; xx++)
+            sum += GET_IMAGE_LINE_BIT(pSrcLine, xx * channels + c) ? 1 : 0;
+        }
+        if (2 * sum >= n)
+          SET_IMAGE_LINE_BIT(pDstLine, x * channels + c);
+        else
+          CLEAR_IMAGE_LINE_BIT(pDstLine, x * channels + c);
+      }
+    }
+  }
+}
+
+static int AverageMinImageBlocks
+(
+  const MinImg *pDst,
+  const MinImg *pSrc,
+  int           scale
+)
+{
+  const int type = GetMinImageType(pSrc);
+  PROPAGATE_ERROR(type);
+  switch (type)
+  {
+  case TYP_UINT1:
+    AverageBitBlocks(pDst, pSrc, scale);
+    break;
+  case TYP_UINT8:
+    AverageBlocks<uint8_t, int64_t>(pDst, pSrc, scale);
+    break;
+  case TYP_INT8:
+    AverageBlocks<int8_t, int64_t>(pDst, pSrc, scale);
+    break;
+  case TYP_UINT16:
+    AverageBlocks<uint16_t, int64_t>(pDst, pSrc, scale);
+    break;
+  case TYP_INT16:
+    AverageBlocks<int16_t, int64_t>(pDst, pSrc, scale);
+    break;
+  case TYP_UINT32:
+    AverageBlocks<uint32_t, int64_t>(pDst, pSrc, scale);
+    break;
+  case TYP_INT32:
+    AverageBlocks<int32_t, int64_t>(pDst, pSrc, scale);
+    break;
+  case TYP_REAL32:
+    AverageBlocks<float, double>(pDst, pSrc, scale);
+    break;
+  case TYP_UINT64:
+    AverageBlocks<uint64_t, long double>(pDst, pSrc, scale);
+    break;
+  case TYP_INT64:
+    AverageBlocks<int64_t, long double>(pDst, pSrc, scale);
+    break;
+  case TYP_REAL64:
+    AverageBlocks<double, long double>(pDst, pSrc, scale);
+    break;
+  default:
+    return NOT_SUPPORTED;
+  }
+  return NO_ERRORS;
+}
+
+MINIMGIO_API int LoadMinImageRegion
+(
+  const MinImg  *pImg,
+  const char    *pFileName,
+  int            page,
+  const MinRect *pRoi,
+  int            scaleDenom
+)
+{
+  if (!pImg || !pFileName)
+    return BAD_ARGS;
+  if (scaleDenom != 1 && scaleDenom != 2 && scaleDenom != 4 && scaleDenom != 8)
+    return BAD_ARGS;
+  if (DeduceFileLocation(pFileName) == inDevice)
+    return NOT_IMPLEMENTED;
+
+  int iff = GuessImageFileFormat(pFileName);
+  if (iff < 0)
+    return iff;
+
+  // libjpeg reduces the image itself while decoding.
+  if (iff == IFF_JPEG)
+    return LoadJpegRegion(pImg, pFileName, pRoi, scaleDenom);
+
+  MinImg fileImg = {0};
+  PROPAGATE_ERROR(GetMinImageFileProps(&fileImg, pFileName, page));
+  const MinRect roi = pRoi ? *pRoi : MinRect(0, 0, fileImg.width, fileImg.height);
+  if (roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 ||
+      roi.x + roi.width > fileImg.width || roi.y + roi.height > fileImg.height)
+    return BAD_ARGS;
+  if (scaleDenom == 1)
+    return LoadRegionAtFullScale(pImg, pFileName, page, iff, roi);
+
+  // Other formats load the blocks of scaleDenom x scaleDenom pixels covering
+  // the region at full scale and average each block into one pixel.
+  const int x0 = roi.x / scaleDenom;
+  const int y0 = roi.y / scaleDenom;
+  const int wd = (roi.width + scaleDenom - 1) / scaleDenom;
+  const int ht = (roi.height + scaleDenom - 1) / scaleDenom;
+  if (pImg->width < wd || pImg->height < ht)
+    return BAD_ARGS;
+  const MinRect blocks(x0 * scaleDenom, y0 * scaleDenom,
+                       std::min(wd * scaleDenom, fileImg.width - x0 * scaleDenom),
+                       std::min(ht * scaleDenom, fileImg.height - y0 * scaleDenom));
+
+  DECLARE_GUARDED_MINIMG(blockImg);
+  blockImg.width = blocks.width;
+  blockImg.height = blocks.height;
+  blockImg.channels = pImg->channels;
+  blockImg.channelDepth = pImg->channelDepth;
+  blockImg.format = pImg->format;
+  PROPAGATE_ERROR(AllocMinImage(&blockImg));
+  PROPAGATE_ERROR(LoadRegionAtFullScale(&blockImg, pFileName, page, iff, blocks));
+
+  MinImg dstRegion = {0};
+  PROPAGATE_ERROR(GetMinImageRegion(&dstRegion, pImg, 0, 0, wd, ht));
+  return AverageMinImageBlocks(&dstRegion, &blockImg, scaleDenom);
+}
+
+MINIMGIO_API int LoadMinImageRows
+(
+  const MinImg         *pImg,
+  const char           *pFileName,
+  int                   page,
+  int                   rowsPerCall,
+  MinImageRowsCallback  callback,
+  void                 *pContext
+)
+{
+  if (!pImg || !pFileName || rowsPerCall <= 0 || !callback)
+    return BAD_ARGS;
+
+  RowsNotifier notifier = {pImg, rowsPerCall, callback, pContext, 0};
+  int fileLocation = DeduceFileLocation(pFileName);
+  if (fileLocation == inDevice)
+  {
+    PROPAGATE_ERROR(LoadDevice(pImg, pFileName));
+    return notifier.Finish(pImg->height);
+  }
+
   int iff = GuessImageFileFormat(pFileName);
   if (iff < 0)
     return iff;
@@ -315,19 +835,40 @@ MINIMGIO_API int LoadMinImage
   switch (iff)
   {
   case IFF_TIFF:
-    return LoadTiff(pImg, pFileName, page);
+    return LoadTiffRows(pImg, pFileName, page, &notifier);
   case IFF_JPEG:
-    return LoadJpeg(pImg, pFileName);
+    return LoadJpegRows(pImg, pFileName, &notifier);
   case IFF_PNG:
-    return LoadPng(pImg, pFileName);
-  case IFF_WEBP:
-    return LoadWebP(pImg, pFileName);
-  case IFF_LST:
-    return LoadLst(pImg, pFileName, page);
+    return LoadPngRows(pImg, pFileName, &notifier);
   default:
-    return FILE_ERROR;
+    PROPAGATE_ERROR(LoadMinImageByFormat(iff, pImg, pFileName, page));
+    return notifier.Finish(pImg->height);
+  }
+}
+
+MINIMGIO_API int MapMinImage
+(
+  MinImg     *pImg,
+  const char *pFileName,
+  int         page
+)
+{
+  if (!pImg || !pFileName || page < 0)
+    return BAD_ARGS;
+  if (pImg->pScan0)
+    return BAD_ARGS;
+
+  int iff = GuessImageFileFormat(pFileName);
+  if (iff < 0)
+    return iff;
+
+  switch (iff)
+  {
+  case IFF_TIFF:
+    return MapTiff(pImg, pFileName, page);
+  default:
+    return NOT_SUPPORTED;
   }
-  return INTERNAL_ERROR;
 }
 
 MINIMGIO_API int SaveMinImage
@@ -385,6 +926,74 @@ MINIMGIO_API int SaveMinImageEx
   return INTERNAL_ERROR;
 }
 
+MINIMGIO_API int OpenMinImageWriter
+(
+  MinImageWriter **ppWriter,
+  const char      *pFileName,
+  ImgFileFormat    iff,
+  int              background
+)
+{
+  if (!ppWriter || !pFileName)
+    return BAD_ARGS;
+  if (DeduceFileLocation(pFileName) == inDevice)
+    return NOT_IMPLEMENTED;
+
+  int format = iff;
+  if (format == IFF_UNKNOWN)
+    format = GuessImageFileFormatByExtension(pFileName);
+  if (format < 0)
+    return format;
+
+  switch (format)
+  {
+  case IFF_TIFF:
+    return OpenTiffWriter(ppWriter, pFileName, background != 0);
+  case IFF_UNKNOWN:
+    return FILE_ERROR;
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
+
+MINIMGIO_API int AddMinImageWriterPage
+(
+  MinImageWriter    *pWriter,
+  const MinImg      *pImg,
+  const ExtImgProps *pProps
+)
+{
+  return AddTiffWriterPage(pWriter, pImg, pProps);
+}
+
+MINIMGIO_API int CloseMinImageWriter
+(
+  MinImageWriter *pWriter
+)
+{
+  return CloseTiffWriter(pWriter);
+}
+
+MINIMGIO_API int SaveMinImagePages
+(
+  const char        *pFileName,
+  const MinImg      *pImgs,
+  int                nImgs,
+  const ExtImgProps *pProps
+)
+{
+  if (!pFileName || !pImgs || nImgs <= 0)
+    return BAD_ARGS;
+
+  MinImageWriter *pWriter = NULL;
+  PROPAGATE_ERROR(OpenMinImageWriter(&pWriter, pFileName,
+                                     pProps ? pProps->iff : IFF_UNKNOWN, 0));
+  for (int k = 0; k < nImgs; ++k)
+    BACKED_PROPAGATE_ERROR(AddMinImageWriterPage(pWriter, pImgs + k, pProps),
+                           CloseMinImageWriter(pWriter));
+  return CloseMinImageWriter(pWriter);
+}
+
 MINIMGIO_API int PackMinImage
 (
   const MinImg *pDst,
@@ -318,10 +318,19 @@ int GetJpegPropsEx
   return NOT_IMPLEMENTED;
 }
 
-// Implementation of LoadJpeg() and LoadJpegMem()
+// Destination of LoadJpegRows(): the image and the notifier of decoded rows,
+// if any.
+struct JpegRowsTarget
+{
+  const MinImg *pImg;
+  RowsNotifier *pNotifier;
+};
+
+// Implementation of LoadJpeg() and LoadJpegRows()
 static
-int decodeImgLoad(const MinImg *pImg, jpeg_decompress_struct *jds)
+int decodeImgLoad(const JpegRowsTarget *pTarget, jpeg_decompress_struct *jds)
 {
+  const MinImg *pImg = pTarget->pImg;
   if (pImg->channelDepth != 1 || pImg->channels != jds->output_components)
     return BAD_ARGS;
   if (pImg->width < (int)jds->output_width || pImg->height < (int)jds->output_height)
@@ -334,8 +343,12 @@ int decodeImgLoad(const MinImg *pImg, jpeg_decompress_struct *jds)
   {
     ppBuf[0] = (JSAMPROW)(pImg->pScan0 + pImg->stride * y);
     jpeg_read_scanlines(jds, ppBuf, 1);
+    if (pTarget->pNotifier)
+      PROPAGATE_ERROR(pTarget->pNotifier->Advance(y + 1));
   }
 
+  if (pTarget->pNotifier)
+    PROPAGATE_ERROR(pTarget->pNotifier->Finish((int)jds->output_height));
   return NO_ERRORS;
 }
 
@@ -348,7 +361,8 @@ int doNothingWithProps(const ExtImgProps *, const jpeg_decompress_struct *)
 int LoadJpeg_FileSystem
 (
   const MinImg *pImg,
-  const char *pFileName
+  const char *pFileName,
+  RowsNotifier *pNotifier
 )
 {
   // Open file source.
@@ -362,7 +376,8 @@ int LoadJpeg_FileSystem
     return FILE_ERROR;
 
   // Decode source.
-  PROPAGATE_ERROR(DecodeJpegInfo(pImg, NULL, FileFolder(pF),
+  const JpegRowsTarget target = {pImg, pNotifier};
+  PROPAGATE_ERROR(DecodeJpegInfo(&target, NULL, FileFolder(pF),
       decodeImgLoad, doNothingWithProps, jpeg_finish_decompress));
 
   return NO_ERRORS;
@@ -371,7 +386,8 @@ int LoadJpeg_FileSystem
 int LoadJpeg_Memory
 (
   const MinImg  *pImg,
-  const char    *pFileName
+  const char    *pFileName,
+  RowsNotifier  *pNotifier
 )
 {
   uint8_t *ptr;
@@ -383,7 +399,8 @@ int LoadJpeg_Memory
   if (!pImg->pScan0)
     return BAD_ARGS;
 
-  PROPAGATE_ERROR(DecodeJpegInfo(pImg, NULL, ArrayFolder(ptr, size),
+  const JpegRowsTarget target = {pImg, pNotifier};
+  PROPAGATE_ERROR(DecodeJpegInfo(&target, NULL, ArrayFolder(ptr, size),
       decodeImgLoad, doNothingWithProps, jpeg_finish_decompress));
 
   return NO_ERRORS;
@@ -394,14 +411,155 @@ int LoadJpeg
   const MinImg  *pImg,
   const char    *pFileName
 )
+{
+  return LoadJpegRows(pImg, pFileName, NULL);
+}
+
+int LoadJpegRows
+(
+  const MinImg  *pImg,
+  const char    *pFileName,
+  RowsNotifier  *pNotifier
+)
 {
   int fileLocation = DeduceFileLocation(pFileName);
   switch (fileLocation)
   {
     case inFileSystem:
-      return LoadJpeg_FileSystem(pImg, pFileName);
+      return LoadJpeg_FileSystem(pImg, pFileName, pNotifier);
     case inMemory:
-      return LoadJpeg_Memory(pImg, pFileName);
+      return LoadJpeg_Memory(pImg, pFileName, pNotifier);
+  }
+
+  return NOT_IMPLEMENTED;
+}
+
+// Implementation of LoadJpegRegion(). The image is decoded at the reduced
+// scale by libjpeg itself and decoding stops after the last row of the region.
+// With libjpeg-turbo the rows above the region are skipped and the columns are
+// cropped by the decoder, otherwise they are decoded and thrown away.
+template<typename SourceType>
+static int DecodeJpegRegion
+(
+  const MinImg  *pImg,
+  SourceType    source,
+  const MinRect *pRoi,
+  int           scaleDenom
+)
+{
+  if (!source.isGood())
+    return BAD_ARGS;
+  if (!pImg->pScan0 || pImg->channelDepth != 1 || pImg->format != FMT_UINT)
+    return BAD_ARGS;
+
+  jpeg_decompress_struct cinfo = {0};
+  jem jerr;
+  ::memset(&jerr, 0, sizeof(jerr));
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = jee;
+  jerr.pub.output_message = jom;
+
+  if (setjmp(jerr.buf))
+    return FILE_ERROR;
+
+  jpeg_create_decompress(&cinfo);
+  scoped_ljobj guard(&cinfo);
+
+  bindJpegDecompStruct(&cinfo, source);
+  jpeg_read_header(&cinfo, true);
+
+  const int fullWidth = static_cast<int>(cinfo.image_width);
+  const int fullHeight = static_cast<int>(cinfo.image_height);
+  const MinRect roi = pRoi ? *pRoi : MinRect(0, 0, fullWidth, fullHeight);
+  if (roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 ||
+      roi.x + roi.width > fullWidth || roi.y + roi.height > fullHeight)
+    return BAD_ARGS;
+
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = scaleDenom;
+  jpeg_start_decompress(&cinfo);
+
+  const int nc = cinfo.output_components;
+  const int x0 = roi.x / scaleDenom;
+  const int y0 = roi.y / scaleDenom;
+  const int wd = std::min((roi.width + scaleDenom - 1) / scaleDenom,
+                          static_cast<int>(cinfo.output_width) - x0);
+  const int ht = std::min((roi.height + scaleDenom - 1) / scaleDenom,
+                          static_cast<int>(cinfo.output_height) - y0);
+  if (pImg->channels != nc || pImg->width < wd || pImg->height < ht)
+    return BAD_ARGS;
+
+  int colOffset = x0;
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER)
+  if (wd < static_cast<int>(cinfo.output_width))
+  {
+    JDIMENSION cropX = x0, cropWidth = wd;
+    jpeg_crop_scanline(&cinfo, &cropX, &cropWidth);
+    colOffset = x0 - static_cast<int>(cropX);
+  }
+  if (y0 > 0)
+    jpeg_skip_scanlines(&cinfo, y0);
+#endif
+
+  const bool directRows = colOffset == 0 &&
+                          static_cast<int>(cinfo.output_width) == wd;
+  JSAMPARRAY ppRow = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo,
+      JPOOL_IMAGE, cinfo.output_width * nc, 1);
+
+  while (static_cast<int>(cinfo.output_scanline) < y0)
+    jpeg_read_scanlines(&cinfo, ppRow, 1);
+
+  for (int y = 0; y < ht; y++)
+  {
+    uint8_t *pLine = pImg->pScan0 + pImg->stride * y;
+    if (directRows)
+    {
+      JSAMPROW ppBuf[1] = {(JSAMPROW)pLine};
+      jpeg_read_scanlines(&cinfo, ppBuf, 1);
+    }
+    else
+    {
+      jpeg_read_scanlines(&cinfo, ppRow, 1);
+      ::memcpy(pLine, ppRow[0] + colOffset * nc, wd * nc);
+    }
+  }
+
+  jpeg_abort_decompress(&cinfo);
+  return NO_ERRORS;
+}
+
+int LoadJpegRegion
+(
+  const MinImg  *pImg,
+  const char    *pFileName,
+  const MinRect *pRoi,
+  int           scaleDenom
+)
+{
+  if (!pImg || !pFileName)
+    return BAD_ARGS;
+  if (scaleDenom != 1 && scaleDenom != 2 && scaleDenom != 4 && scaleDenom != 8)
+    return BAD_ARGS;
+
+  int fileLocation = DeduceFileLocation(pFileName);
+  switch (fileLocation)
+  {
+    case inFileSystem:
+    {
+      scoped_file pF(fopen(pFileName, "rb"));
+      if (!pF)
+        return FILE_ERROR;
+      return DecodeJpegRegion(pImg, FileFolder(pF), pRoi, scaleDenom);
+    }
+    case inMemory:
+    {
+      uint8_t *ptr;
+      size_t size;
+      PROPAGATE_ERROR(ExtractMemoryLocation(pFileName, &ptr, &size));
+      if (!ptr || size == 0)
+        return BAD_ARGS;
+      return DecodeJpegRegion(pImg, ArrayFolder(ptr, size), pRoi, scaleDenom);
+    }
   }
 
   return NOT_IMPLEMENTED;
@@ -504,6 +662,18 @@ int LoadJpeg(const MinImg * /*pImg*/, const char * /*pFileName*/)
   return NOT_SUPPORTED;
 }
 
+int LoadJpegRows(const MinImg * /*pImg*/, const char * /*pFileName*/,
+                 RowsNotifier * /*pNotifier*/)
+{
+  return NOT_SUPPORTED;
+}
+
+int LoadJpegRegion(const MinImg * /*pImg*/, const char * /*pFileName*/,
+                   const MinRect * /*pRoi*/, int /*scaleDenom*/)
+{
+  return NOT_SUPPORTED;
+}
+
 int SaveJpegEx(const char * /*pFileName*/, const MinImg * /*pImg*/,
                const ExtImgProps * /*pProps*/)
 {
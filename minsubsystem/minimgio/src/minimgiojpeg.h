@@ -37,6 +37,8 @@ either expressed or implied, of copyright holders.
 
 #include <minimgio/minimgio.h>
 
+struct RowsNotifier;
+
 int GetJpegPages
 (
   const char *pFileName
@@ -63,6 +65,22 @@ int LoadJpeg
   const char *pFileName
 );
 
+// Loads the image reporting the decoded rows to the notifier, if any.
+int LoadJpegRows
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  RowsNotifier *pNotifier
+);
+
+int LoadJpegRegion
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  const MinRect *pRoi,
+  int scaleDenom
+);
+
 int SaveJpegEx
 (
   const char *pFileName,
@@ -75,7 +75,11 @@ static std::string absoluteImagePath(const std::string &lstPath, const std::stri
   return lstDirPath + "/" + imageName;
 }
 
-int GetLstPages(const char *pFileName)
+// Parses the list once and calls visit(page, imageName) for each image in it
+// until the visitor returns false. Empty lines and lines starting with ';' are
+// skipped, "#stop" or "#end" ends the list.
+template <class Visitor>
+static int ParseLst(const char *pFileName, Visitor visit)
 {
   if (!pFileName || !strlen(pFileName))
     return BAD_ARGS;
@@ -84,7 +88,7 @@ int GetLstPages(const char *pFileName)
   if (fileStream.is_open() == false)
     return FILE_ERROR;
 
-  int pageCount = 0;
+  int page = 0;
   while(fileStream.eof() == false)
   {
     std::string imageName = getTrimmedLine(fileStream);
@@ -93,9 +97,21 @@ int GetLstPages(const char *pFileName)
     if (imageName == "#stop" || imageName == "#end")
       break;
 
-    pageCount++;
+    if (!visit(page++, imageName))
+      break;
   }
 
+  return NO_ERRORS;
+}
+
+int GetLstPages(const char *pFileName)
+{
+  int pageCount = 0;
+  const int res = ParseLst(pFileName, [&](int, const std::string &) {
+    pageCount++;
+    return true;
+  });
+  PROPAGATE_ERROR(res);
   return pageCount;
 }
 
@@ -103,31 +119,39 @@ int GetLstPageName(char *pPageName, int pageNameSize, const char *pFileName, int
 {
   if (!pPageName || pageNameSize <= 0)
     return BAD_ARGS;
-  if (!pFileName || !strlen(pFileName))
-    return BAD_ARGS;
 
-  int pageIndex = -1;
-  std::ifstream fileStream(pFileName);
-  if (fileStream.is_open() == false)
-    return FILE_ERROR;
+  bool found = false;
+  const int res = ParseLst(pFileName, [&](int index, const std::string &imageName) {
+    if (index != page)
+      return true;
+    ::memset(pPageName, 0, pageNameSize);
+    ::memcpy(pPageName, imageName.c_str(), std::min((int)imageName.size(), pageNameSize));
+    found = true;
+    return false;
+  });
+  PROPAGATE_ERROR(res);
+
+  return found ? NO_ERRORS : BAD_ARGS;
+}
 
-  while(fileStream.eof() == false)
-  {
-    std::string imageName = getTrimmedLine(fileStream);
-    if (imageName.length() == 0 || imageName[0] == ';')
-      continue;
-    if (imageName == "#stop" || imageName == "#end")
-      break;
+int ListLstImages(const char *pFileName, MinImageListCallback callback, void *pContext)
+{
+  if (!callback)
+    return BAD_ARGS;
 
-    if (++pageIndex == page)
-    {
-      ::memset(pPageName, 0, pageNameSize);
-      ::memcpy(pPageName, imageName.c_str(), std::min((int)imageName.size(), pageNameSize));
-      return NO_ERRORS;
-    }
-  }
+  int callbackRes = NO_ERRORS;
+  int pageCount = 0;
+  const int res = ParseLst(pFileName, [&](int, const std::string &imageName) {
+    callbackRes = callback(pContext, absoluteImagePath(pFileName, imageName).c_str());
+    if (callbackRes != NO_ERRORS)
+      return false;
+    pageCount++;
+    return true;
+  });
+  PROPAGATE_ERROR(res);
+  PROPAGATE_ERROR(callbackRes);
 
-  return BAD_ARGS;
+  return pageCount;
 }
 
 int GetLstPropsEx(MinImg *pImg, ExtImgProps *pProps, const char *pFileName, int page)
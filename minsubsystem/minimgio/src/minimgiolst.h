@@ -50,6 +50,13 @@ int GetLstPageName
   int page
 );
 
+int ListLstImages
+(
+  const char *pFileName,
+  MinImageListCallback callback,
+  void *pContext
+);
+
 int GetLstPropsEx
 (
   MinImg *pImg,
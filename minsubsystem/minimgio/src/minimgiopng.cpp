@@ -36,16 +36,21 @@ either expressed or implied, of copyright holders.
 #include <cstring>
 #include <cstddef>
 #include <algorithm>
+#include <vector>
 
 #include <minbase/minresult.h>
 #include <minutils/smartptr.h>
 
 #include "minimgiojpeg.h"
+#include "minimgiopng.h"
 #include "utils.h"
+#include "pack.h"
+#include "pngencode.h"
 
 #ifdef WITH_PNG
 
 #include <png.h>
+#include <zlib.h>
 
 static void _FClose(FILE*& pF)
 {
@@ -269,6 +274,11 @@ int GetPngPropsEx(MinImg *pImg, ExtImgProps *pProps, const char *pFileName)
 }
 
 int LoadPng(const MinImg *pImg, const char *pFileName)
+{
+  return LoadPngRows(pImg, pFileName, NULL);
+}
+
+int LoadPngRows(const MinImg *pImg, const char *pFileName, RowsNotifier *pNotifier)
 {
   if (!pImg || !pImg->pScan0 || !pFileName || pImg->channels < 1)
     return BAD_ARGS;
@@ -315,13 +325,115 @@ int LoadPng(const MinImg *pImg, const char *pFileName)
   for(int32_t y = 0; y < pImg->height; ++y)
     ppRows[y] = pImg->pScan0 + y * pImg->stride;
 
-  png_read_image(pPng, ppRows);
+  // Interlaced images are complete only after the last pass, others are
+  // reported row by row.
+  const bool interlaced =
+    png_get_interlace_type(pPng, pInfo) != PNG_INTERLACE_NONE;
+  if (!pNotifier || interlaced)
+    png_read_image(pPng, ppRows);
+  else
+  {
+    for (int32_t y = 0; y < pImg->height; ++y)
+    {
+      png_read_row(pPng, ppRows[y], NULL);
+      BACKED_PROPAGATE_ERROR(
+        pNotifier->Advance(y + 1),
+        png_destroy_read_struct(&pPng, &pInfo, 0)
+      );
+    }
+  }
+  if (pNotifier)
+    BACKED_PROPAGATE_ERROR(
+      pNotifier->Finish(pImg->height),
+      png_destroy_read_struct(&pPng, &pInfo, 0)
+    );
 
   png_destroy_read_struct(&pPng, &pInfo, (png_infopp)NULL);
   return NO_ERRORS;
 
 }
 
+int LoadPngRegion(const MinImg *pImg, const char *pFileName, const MinRect *pRoi)
+{
+  if (!pImg || !pImg->pScan0 || !pFileName || !pRoi || pImg->channels < 1)
+    return BAD_ARGS;
+  if (pImg->format != FMT_UINT || pImg->channels > 4)
+    return NOT_SUPPORTED;
+  if (pImg->channelDepth < 0 || pImg->channelDepth > 2)
+    return NOT_SUPPORTED;
+
+  FileReaderInterface *file = CreateFileReader(pFileName);
+  if (!file)
+    return BAD_ARGS;
+  scoped_file_reader FileGuardian(file);
+
+  png_structp pPng = NULL;
+  png_infop pInfo = NULL;
+  MinImg imgRead = { 0 };
+  imgRead.channels = pImg->channels;
+  imgRead.channelDepth = pImg->channelDepth;
+  BACKED_PROPAGATE_ERROR(
+    PngInitAndReadPrototype(&pPng, &pInfo, &imgRead, file),
+    png_destroy_read_struct(&pPng, &pInfo, NULL)
+  );
+
+  const MinRect roi = *pRoi;
+  if (
+    roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 ||
+    roi.x + roi.width > imgRead.width ||
+    roi.y + roi.height > imgRead.height ||
+    roi.width > pImg->width ||
+    roi.height > pImg->height ||
+    imgRead.channels != pImg->channels ||
+    imgRead.channelDepth != pImg->channelDepth ||
+    imgRead.format != pImg->format ||
+    imgRead.addressSpace != pImg->addressSpace
+    )
+  {
+    png_destroy_read_struct(&pPng, &pInfo, 0);
+    return BAD_ARGS;
+  }
+
+  // Interlaced images can only be read as a whole, others are read row by row
+  // up to the last row of the region.
+  const bool interlaced =
+    png_get_interlace_type(pPng, pInfo) != PNG_INTERLACE_NONE;
+  const size_t rowBytes = png_get_rowbytes(pPng, pInfo);
+  const int nRows = interlaced ? imgRead.height : 1;
+  scoped_cpp_array<png_byte> pBuffer(new png_byte[rowBytes * nRows]);
+  scoped_cpp_array<png_bytep> ppRows(new png_bytep[nRows]);
+  for (int y = 0; y < nRows; ++y)
+    ppRows[y] = pBuffer + y * rowBytes;
+
+  if (setjmp(png_jmpbuf(pPng)))
+  {
+    png_destroy_read_struct(&pPng, &pInfo, 0);
+    return INTERNAL_ERROR;
+  }
+  if (interlaced)
+    png_read_image(pPng, ppRows);
+
+  const size_t len = static_cast<size_t>(roi.width) * pImg->channels;
+  const size_t offset = static_cast<size_t>(roi.x) * pImg->channels;
+  for (int y = 0; y < roi.y + roi.height; ++y)
+  {
+    const png_bytep pRow = interlaced ? ppRows[y] : ppRows[0];
+    if (!interlaced)
+      png_read_row(pPng, pRow, NULL);
+    if (y < roi.y)
+      continue;
+    uint8_t *pLine = pImg->pScan0 + (y - roi.y) * pImg->stride;
+    if (pImg->channelDepth == 0)
+      CopyBitRange(pLine, 0, pRow, offset, len, false);
+    else
+      ::memcpy(pLine, pRow + offset * pImg->channelDepth,
+               len * pImg->channelDepth);
+  }
+
+  png_destroy_read_struct(&pPng, &pInfo, (png_infopp)NULL);
+  return NO_ERRORS;
+}
+
 int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pProps)
 {
   if (!pImg || !pImg->pScan0 || !pFileName || pImg->channels < 1)
@@ -348,6 +460,8 @@ int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPro
     return INTERNAL_ERROR;
   }
 
+  // Kept out of the setjmp() scope to be freed if libpng fails.
+  std::vector<std::vector<uint8_t> > blocks;
   if (setjmp(png_jmpbuf(pPng)))
   {
     png_destroy_write_struct(&pPng, &pInfo);
@@ -364,6 +478,7 @@ int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPro
     colorType = PNG_COLOR_TYPE_RGBA;
   png_set_IHDR(pPng, pInfo, pImg->width, pImg->height, depth, colorType, PNG_INTERLACE_NONE, 0, 0);
 
+  int level = Z_DEFAULT_COMPRESSION;
   if (pProps != 0)
   {
     if (pProps->xDPI || pProps->yDPI)
@@ -376,7 +491,7 @@ int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPro
     if (pProps->qty)
     {
       // to comply with jpeg range 0-100, where 0 is the default value
-      const int level = std::max(-1, std::min(pProps->qty / 10, 9));
+      level = std::max(-1, std::min(pProps->qty / 10, 9));
       png_set_compression_level(pPng, level);
     }
   }
@@ -388,6 +503,18 @@ int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPro
     png_set_swap(pPng);
 #endif
 
+  // Large images are filtered and compressed in parallel by bands.
+  if (IsPngParallelEncodingUseful(pImg))
+  {
+    BACKED_PROPAGATE_ERROR(
+      DeflatePngRows(&blocks, pImg, level),
+      png_destroy_write_struct(&pPng, &pInfo)
+    );
+    WritePngDataChunks(pPng, blocks);
+    png_destroy_write_struct(&pPng, &pInfo);
+    return NO_ERRORS;
+  }
+
   scoped_cpp_array<png_bytep> ppRows(new png_bytep[pImg->height]);
   for(int y = 0; y < pImg->height; ++y)
     ppRows[y] = pImg->pScan0 + y * pImg->stride;
@@ -423,6 +550,18 @@ int LoadPng(const MinImg * /*pImg*/, const char * /*pFileName*/)
   return NOT_SUPPORTED;
 }
 
+int LoadPngRows(const MinImg * /*pImg*/, const char * /*pFileName*/,
+                RowsNotifier * /*pNotifier*/)
+{
+  return NOT_SUPPORTED;
+}
+
+int LoadPngRegion(const MinImg * /*pImg*/, const char * /*pFileName*/,
+                  const MinRect * /*pRoi*/)
+{
+  return NOT_SUPPORTED;
+}
+
 int SavePngEx(const char * /*pFileName*/, const MinImg * /*pImg*/,
               const ExtImgProps * /*pProps*/)
 {
@@ -37,6 +37,8 @@ either expressed or implied, of copyright holders.
 
 #include <minimgio/minimgio.h>
 
+struct RowsNotifier;
+
 int GetPngPages
 (
   const char *pFileName
@@ -63,6 +65,21 @@ int LoadPng
   const char *pFileName
 );
 
+// Loads the image reporting the decoded rows to the notifier, if any.
+int LoadPngRows
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  RowsNotifier *pNotifier
+);
+
+int LoadPngRegion
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  const MinRect *pRoi
+);
+
 int SavePngEx
 (
   const char *pFileName,
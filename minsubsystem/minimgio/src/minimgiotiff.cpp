@@ -31,12 +31,20 @@ either expressed or implied, of copyright holders.
 
 */
 
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <minutils/smartptr.h>
 #include <minutils/minhelpers.h>
 #include <minbase/minresult.h>
+#include <minimgapi/minimgapi.h>
 
 #ifdef WITH_TIFF
 
@@ -68,8 +76,167 @@ template <class T> static void _TIFFGetField(
 #endif // WITH_TIFF
 
 #include "minimgiotiff.h"
+#include "utils.h"
 #include "pack.h"
 
+#ifdef WITH_TIFF
+
+// Seekable byte stream over a memory block, used as a TIFFClientOpen() handle.
+// Either wraps a fixed external block or grows an external vector on write.
+struct TiffMemoryStream
+{
+  uint8_t *data;
+  std::vector<uint8_t> *buffer;
+  toff_t capacity;
+  toff_t size;
+  toff_t pos;
+
+  TiffMemoryStream(uint8_t *pData, toff_t dataCapacity, toff_t dataSize)
+  {
+    data = pData;
+    buffer = NULL;
+    capacity = dataCapacity;
+    size = dataSize;
+    pos = 0;
+  }
+
+  explicit TiffMemoryStream(std::vector<uint8_t> *pBuffer)
+  {
+    pBuffer->clear();
+    data = NULL;
+    buffer = pBuffer;
+    capacity = 0;
+    size = 0;
+    pos = 0;
+  }
+};
+
+static tsize_t TiffMemoryRead(thandle_t handle, tdata_t pBuf, tsize_t count)
+{
+  TiffMemoryStream *pStream = static_cast<TiffMemoryStream *>(handle);
+  if (count <= 0 || pStream->pos >= pStream->size)
+    return 0;
+  const toff_t len = std::min<toff_t>(count, pStream->size - pStream->pos);
+  ::memcpy(pBuf, pStream->data + pStream->pos, len);
+  pStream->pos += len;
+  return static_cast<tsize_t>(len);
+}
+
+static tsize_t TiffMemoryWrite(thandle_t handle, tdata_t pBuf, tsize_t count)
+{
+  TiffMemoryStream *pStream = static_cast<TiffMemoryStream *>(handle);
+  if (count <= 0)
+    return 0;
+  const toff_t end = pStream->pos + static_cast<toff_t>(count);
+  if (end < pStream->pos)
+    return 0;
+  if (end > pStream->capacity)
+  {
+    if (!pStream->buffer)
+      return 0;
+    pStream->buffer->resize(end);
+    pStream->data = &(*pStream->buffer)[0];
+    pStream->capacity = end;
+  }
+  ::memcpy(pStream->data + pStream->pos, pBuf, count);
+  pStream->pos = end;
+  pStream->size = std::max(pStream->size, end);
+  return count;
+}
+
+static toff_t TiffMemorySeek(thandle_t handle, toff_t offset, int whence)
+{
+  TiffMemoryStream *pStream = static_cast<TiffMemoryStream *>(handle);
+  toff_t base = 0;
+  switch (whence)
+  {
+  case SEEK_SET:
+    break;
+  case SEEK_CUR:
+    base = pStream->pos;
+    break;
+  case SEEK_END:
+    base = pStream->size;
+    break;
+  default:
+    return static_cast<toff_t>(-1);
+  }
+  if (base + offset < base)
+    return static_cast<toff_t>(-1);
+  pStream->pos = base + offset;
+  return pStream->pos;
+}
+
+static int TiffMemoryClose(thandle_t handle)
+{
+  TiffMemoryStream *pStream = static_cast<TiffMemoryStream *>(handle);
+  if (pStream->buffer)
+    pStream->buffer->resize(pStream->size);
+  delete pStream;
+  return 0;
+}
+
+static toff_t TiffMemorySize(thandle_t handle)
+{
+  return static_cast<TiffMemoryStream *>(handle)->size;
+}
+
+static int TiffMemoryMap(thandle_t handle, tdata_t *ppBase, toff_t *pSize)
+{
+  // Lets libtiff read strips straight from the block instead of copying them.
+  TiffMemoryStream *pStream = static_cast<TiffMemoryStream *>(handle);
+  if (pStream->buffer)
+    return 0;
+  *ppBase = pStream->data;
+  *pSize = pStream->size;
+  return 1;
+}
+
+static void TiffMemoryUnmap(thandle_t, tdata_t, toff_t)
+{
+  ; // The block is owned by the caller.
+}
+
+static TIFF *OpenTiffMemoryStream
+(
+  TiffMemoryStream *pStream,
+  const char *pName,
+  const char *pMode
+)
+{
+  TIFF *pTIF = TIFFClientOpen(pName, pMode, pStream,
+                              TiffMemoryRead, TiffMemoryWrite, TiffMemorySeek,
+                              TiffMemoryClose, TiffMemorySize,
+                              TiffMemoryMap, TiffMemoryUnmap);
+  // On failure libtiff does not call the close procedure.
+  if (!pTIF)
+    delete pStream;
+  return pTIF;
+}
+
+// Opens either a regular file or a mem://<pointer>.<size> block. A memory
+// block opened for writing receives the image from its very beginning.
+static TIFF *OpenTiff(const char *pFileName, const char *pMode)
+{
+  if (DeduceFileLocation(pFileName) != inMemory)
+    return TIFFOpen(pFileName, pMode);
+
+  uint8_t *ptr = NULL;
+  size_t size = 0;
+  if (ExtractMemoryLocation(pFileName, &ptr, &size) != NO_ERRORS || !ptr)
+    return NULL;
+  const toff_t capacity = static_cast<toff_t>(size);
+  if (capacity != size)
+    return NULL;
+
+  const bool reading = pMode[0] == 'r';
+  return OpenTiffMemoryStream(
+      new TiffMemoryStream(ptr, capacity, reading ? capacity : 0),
+      pFileName, pMode);
+}
+
+#endif // WITH_TIFF
+
 
 int GetTiffPages(const char *pFileName)
 {
@@ -83,7 +250,7 @@ int GetTiffPages(const char *pFileName)
   TIFFSetErrorHandler(NULL);
   TIFFSetWarningHandler(NULL);
 
-  scoped_tiff_handle pTIF(TIFFOpen(pFileName, "r"));
+  scoped_tiff_handle pTIF(OpenTiff(pFileName, "r"));
   if (!pTIF)
     return FILE_ERROR;
   const int nPages = TIFFNumberOfDirectories(pTIF);
@@ -137,7 +304,7 @@ int GetTiffPropsEx
   TIFFSetErrorHandler(NULL);
   TIFFSetWarningHandler(NULL);
 
-  scoped_tiff_handle pTIF(TIFFOpen(pFileName, "r"));
+  scoped_tiff_handle pTIF(OpenTiff(pFileName, "r"));
   if (!pTIF)
     return FILE_ERROR;
   const int nPages = TIFFNumberOfDirectories(pTIF);
@@ -230,19 +397,183 @@ int GetTiffPropsEx
 #endif // WITH_TIFF
 }
 
-int LoadTiff
+#ifdef WITH_TIFF
+
+// Pages smaller than this are decoded in the calling thread.
+static const int64_t PARALLEL_TIFF_MIN_BYTES = 1 << 20;
+
+// Describes how the strips or tiles of a page map onto the destination image,
+// which receives the region roi of the page. Strips are treated as tiles as
+// wide as the page. Only the chunks intersecting the region are read.
+struct TiffChunkLayout
+{
+  const char *pFileName;
+  int page;
+  const MinImg *pImg;
+  MinRect roi;
+  int width;
+  int height;
+  int channels;
+  int bytesPerSample;
+  bool invert;
+  bool tiled;
+  int chunkWidth;
+  int chunkHeight;
+  tsize_t chunkRowSize;
+  tsize_t chunkSize;
+  int chunksAcross;
+  int firstColumn;
+  int firstRow;
+  int regionColumns;
+  int nChunks;
+  RowsNotifier *pNotifier;
+};
+
+// Reports the rows of the region decoded by chunk k, which are complete once
+// the last chunk across the region is read.
+static int NotifyTiffRows
+(
+  const TiffChunkLayout &layout,
+  int k,
+  int yEnd
+)
+{
+  if (!layout.pNotifier || (k + 1) % layout.regionColumns != 0)
+    return NO_ERRORS;
+  return layout.pNotifier->Advance(yEnd - layout.roi.y);
+}
+
+// Decodes chunks [begin, end) of the region into the image. Strips whose rows
+// need no conversion are decoded straight into the image.
+static int ReadTiffChunks
+(
+  TIFF *pTIF,
+  const TiffChunkLayout &layout,
+  int begin,
+  int end
+)
+{
+  const MinImg *pImg = layout.pImg;
+  const MinRect &roi = layout.roi;
+  const bool packed = layout.bytesPerSample == 0;
+  const bool convert = packed && (pImg->channelDepth > 0 || layout.invert);
+  const bool directRows = !layout.tiled && !convert &&
+                          roi.x == 0 && roi.width == layout.width &&
+                          pImg->stride == layout.chunkRowSize;
+
+  // Only strips cut by the region edges, tiles and converted rows go through
+  // the chunk buffer.
+  bool copyChunks = !directRows;
+  for (int k = begin; k < end && !copyChunks; k++)
+  {
+    const int y0 = (layout.firstRow + k / layout.regionColumns) *
+                   layout.chunkHeight;
+    const int rows = std::min(layout.chunkHeight, layout.height - y0);
+    copyChunks = y0 < roi.y || y0 + rows > roi.y + roi.height;
+  }
+  scoped_scanline pChunk(copyChunks ? _TIFFmalloc(layout.chunkSize) : 0);
+  if (copyChunks && !pChunk)
+    return NO_MEMORY;
+  uint8_t *pChunkUint8 = (uint8_t *)((void *)(pChunk));
+
+  for (int k = begin; k < end; k++)
+  {
+    const int column = layout.firstColumn + k % layout.regionColumns;
+    const int row = layout.firstRow + k / layout.regionColumns;
+    const int chunk = row * layout.chunksAcross + column;
+    const int x0 = column * layout.chunkWidth;
+    const int y0 = row * layout.chunkHeight;
+    const int rows = std::min(layout.chunkHeight, layout.height - y0);
+    const int xBegin = std::max(x0, roi.x);
+    const int xEnd = std::min(x0 + layout.chunkWidth, roi.x + roi.width);
+    const int yBegin = std::max(y0, roi.y);
+    const int yEnd = std::min(y0 + rows, roi.y + roi.height);
+    uint8_t *p_dst_line = pImg->pScan0 +
+        static_cast<ptrdiff_t>(yBegin - roi.y) * pImg->stride;
+
+    if (directRows && yBegin == y0 && yEnd == y0 + rows)
+    {
+      const tsize_t size = layout.chunkRowSize * rows;
+      if (TIFFReadEncodedStrip(pTIF, chunk, p_dst_line, size) < size)
+        return FILE_ERROR;
+      PROPAGATE_ERROR(NotifyTiffRows(layout, k, yEnd));
+      continue;
+    }
+
+    const tsize_t size = layout.tiled ? layout.chunkSize :
+                                        layout.chunkRowSize * rows;
+    const tsize_t read = layout.tiled ?
+        TIFFReadEncodedTile(pTIF, chunk, pChunkUint8, size) :
+        TIFFReadEncodedStrip(pTIF, chunk, pChunkUint8, size);
+    if (read < layout.chunkRowSize * rows)
+      return FILE_ERROR;
+
+    const size_t len = static_cast<size_t>(xEnd - xBegin) * layout.channels;
+    const size_t srcOffset = static_cast<size_t>(xBegin - x0) * layout.channels;
+    const size_t dstOffset = static_cast<size_t>(xBegin - roi.x) * layout.channels;
+    const uint8_t *pSrcLine = pChunkUint8 + (yBegin - y0) * layout.chunkRowSize;
+    for (int y = yBegin; y < yEnd; y++)
+    {
+      if (packed && pImg->channelDepth == 0)
+        CopyBitRange(p_dst_line, dstOffset, pSrcLine, srcOffset, len,
+                     layout.invert);
+      else if (packed)
+        UnpackBitRange(p_dst_line + dstOffset, pSrcLine, srcOffset, len,
+                       layout.invert);
+      else
+        ::memcpy(p_dst_line + dstOffset * layout.bytesPerSample,
+                 pSrcLine + srcOffset * layout.bytesPerSample,
+                 len * layout.bytesPerSample);
+      pSrcLine += layout.chunkRowSize;
+      p_dst_line += pImg->stride;
+    }
+    PROPAGATE_ERROR(NotifyTiffRows(layout, k, yEnd));
+  }
+
+  return NO_ERRORS;
+}
+
+struct TiffReadJob
+{
+  TIFF *pTIF;
+  const TiffChunkLayout *pLayout;
+  int nBands;
+  std::vector<int> results;
+
+  static void Run(void *pContext, int band)
+  {
+    TiffReadJob *pJob = static_cast<TiffReadJob *>(pContext);
+    const TiffChunkLayout &layout = *pJob->pLayout;
+    const int begin = static_cast<int>(
+        static_cast<int64_t>(layout.nChunks) * band / pJob->nBands);
+    const int end = static_cast<int>(
+        static_cast<int64_t>(layout.nChunks) * (band + 1) / pJob->nBands);
+    if (band == 0)
+    {
+      pJob->results[band] = ReadTiffChunks(pJob->pTIF, layout, begin, end);
+      return;
+    }
+
+    scoped_tiff_handle pTIF(OpenTiff(layout.pFileName, "r"));
+    if (!pTIF || !TIFFSetDirectory(pTIF, static_cast<tdir_t>(layout.page)))
+    {
+      pJob->results[band] = FILE_ERROR;
+      return;
+    }
+    pJob->results[band] = ReadTiffChunks(pTIF, layout, begin, end);
+  }
+};
+
+// Loads the region roi of the page, or the whole page if pRoi is NULL.
+static int LoadTiffImpl
 (
   const MinImg *pImg,
   const char *pFileName,
-  int page
+  int page,
+  const MinRect *pRoi,
+  RowsNotifier *pNotifier
 )
 {
-#ifndef WITH_TIFF
-  SUPPRESS_UNUSED_VARIABLE(pImg);
-  SUPPRESS_UNUSED_VARIABLE(pFileName);
-  SUPPRESS_UNUSED_VARIABLE(page);
-  return NOT_SUPPORTED;
-#else
   if (!pImg || !pFileName || page < 0)
     return BAD_ARGS;
   if (!pImg->pScan0)
@@ -251,7 +582,7 @@ int LoadTiff
   TIFFSetErrorHandler(NULL);
   TIFFSetWarningHandler(NULL);
 
-  scoped_tiff_handle pTIF(TIFFOpen(pFileName, "r"));
+  scoped_tiff_handle pTIF(OpenTiff(pFileName, "r"));
   if (!pTIF)
     return FILE_ERROR;
   const int nPages = TIFFNumberOfDirectories(pTIF);
@@ -281,7 +612,11 @@ int LoadTiff
     return BAD_ARGS;
   if (bpc > 0 && pImg->channelDepth != bpc)
     return BAD_ARGS;
-  if (pImg->height < ht || pImg->width < wd)
+  const MinRect roi = pRoi ? *pRoi : MinRect(0, 0, wd, ht);
+  if (roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 ||
+      roi.x + roi.width > wd || roi.y + roi.height > ht)
+    return BAD_ARGS;
+  if (pImg->height < roi.height || pImg->width < roi.width)
     return BAD_ARGS;
 
   int metr = 0;
@@ -310,32 +645,212 @@ int LoadTiff
   }
 
   const tsize_t scanLen = TIFFScanlineSize(pTIF);
-  scoped_scanline pScanLine(_TIFFmalloc(scanLen));
-  if (!pScanLine)
-    return NO_MEMORY;
-  const int byteWidth = pImg->channelDepth > 0 ?
-                        pImg->width * pImg->channels * pImg->channelDepth :
-                        (pImg->width * pImg->channels + 7) >> 3;
-  if (byteWidth < scanLen)
-    return INTERNAL_ERROR;
 
-  const bool invert = (metr == PHOTOMETRIC_MINISWHITE);
-  const size_t len = wd * nc;
-  uint8_t *pScanLineUint8 = (uint8_t *)((void *)(pScanLine));
-  uint8_t *p_dst_line = pImg->pScan0;
-  for (int y = 0; y < ht; y++)
+  TiffChunkLayout layout;
+  layout.pFileName = pFileName;
+  layout.page = page;
+  layout.pImg = pImg;
+  layout.roi = roi;
+  layout.width = wd;
+  layout.height = ht;
+  layout.channels = nc;
+  layout.bytesPerSample = bpc;
+  layout.invert = (metr == PHOTOMETRIC_MINISWHITE);
+  layout.tiled = TIFFIsTiled(pTIF) != 0;
+  if (layout.tiled)
+  {
+    uint32 tw = 0, th = 0;
+    _TIFFGetField(pTIF, TIFFTAG_TILEWIDTH, &tw, static_cast<uint32>(0));
+    _TIFFGetField(pTIF, TIFFTAG_TILELENGTH, &th, static_cast<uint32>(0));
+    if (tw == 0 || th == 0)
+      return FILE_ERROR;
+    layout.chunkWidth = static_cast<int>(tw);
+    layout.chunkHeight = static_cast<int>(th);
+    layout.chunkRowSize = TIFFTileRowSize(pTIF);
+    layout.chunkSize = TIFFTileSize(pTIF);
+    layout.chunksAcross = (wd + layout.chunkWidth - 1) / layout.chunkWidth;
+    layout.nChunks = static_cast<int>(TIFFNumberOfTiles(pTIF));
+  }
+  else
+  {
+    uint32 rps = 0;
+    _TIFFGetField(pTIF, TIFFTAG_ROWSPERSTRIP, &rps, static_cast<uint32>(ht));
+    layout.chunkWidth = wd;
+    layout.chunkHeight = static_cast<int>(std::min<uint32>(rps, ht));
+    layout.chunkRowSize = scanLen;
+    layout.chunkSize = TIFFStripSize(pTIF);
+    layout.chunksAcross = 1;
+    layout.nChunks = static_cast<int>(TIFFNumberOfStrips(pTIF));
+  }
+  if (layout.chunkHeight <= 0 || layout.chunkRowSize <= 0 ||
+      layout.chunkSize < layout.chunkRowSize * layout.chunkHeight)
+    return FILE_ERROR;
+  const int chunksDown = (ht + layout.chunkHeight - 1) / layout.chunkHeight;
+  if (layout.nChunks < layout.chunksAcross * chunksDown)
+    return FILE_ERROR;
+  layout.firstColumn = roi.x / layout.chunkWidth;
+  layout.firstRow = roi.y / layout.chunkHeight;
+  layout.regionColumns = (roi.x + roi.width - 1) / layout.chunkWidth -
+                         layout.firstColumn + 1;
+  layout.nChunks = layout.regionColumns *
+      ((roi.y + roi.height - 1) / layout.chunkHeight - layout.firstRow + 1);
+  layout.pNotifier = pNotifier;
+
+  // Every band decodes its strips or tiles through its own handle, as libtiff
+  // handles may not be shared between threads. Reported rows need the chunks
+  // read in order by a single band.
+  int nBands = 1;
+  if (!pNotifier &&
+      static_cast<int64_t>(scanLen) * roi.height >= PARALLEL_TIFF_MIN_BYTES)
+    nBands = std::max(1, std::min(GetMinImageThreadCount(), layout.nChunks));
+  if (nBands == 1)
+  {
+    PROPAGATE_ERROR(ReadTiffChunks(pTIF, layout, 0, layout.nChunks));
+    return pNotifier ? pNotifier->Finish(roi.height) : NO_ERRORS;
+  }
+
+  TiffReadJob job;
+  job.pTIF = pTIF;
+  job.pLayout = &layout;
+  job.nBands = nBands;
+  job.results.resize(nBands, NO_ERRORS);
+  PROPAGATE_ERROR(RunMinImageTasks(&TiffReadJob::Run, &job, nBands));
+  for (int band = 0; band < nBands; ++band)
+    PROPAGATE_ERROR(job.results[band]);
+
+  return NO_ERRORS;
+}
+
+#endif // WITH_TIFF
+
+int LoadTiff
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  int page
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pImg);
+  SUPPRESS_UNUSED_VARIABLE(pFileName);
+  SUPPRESS_UNUSED_VARIABLE(page);
+  return NOT_SUPPORTED;
+#else
+  return LoadTiffImpl(pImg, pFileName, page, NULL, NULL);
+#endif // WITH_TIFF
+}
+
+int LoadTiffRows
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  int page,
+  RowsNotifier *pNotifier
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pImg);
+  SUPPRESS_UNUSED_VARIABLE(pFileName);
+  SUPPRESS_UNUSED_VARIABLE(page);
+  SUPPRESS_UNUSED_VARIABLE(pNotifier);
+  return NOT_SUPPORTED;
+#else
+  return LoadTiffImpl(pImg, pFileName, page, NULL, pNotifier);
+#endif // WITH_TIFF
+}
+
+int LoadTiffRegion
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  int page,
+  const MinRect *pRoi
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pImg);
+  SUPPRESS_UNUSED_VARIABLE(pFileName);
+  SUPPRESS_UNUSED_VARIABLE(page);
+  SUPPRESS_UNUSED_VARIABLE(pRoi);
+  return NOT_SUPPORTED;
+#else
+  if (!pRoi)
+    return BAD_ARGS;
+  return LoadTiffImpl(pImg, pFileName, page, pRoi, NULL);
+#endif // WITH_TIFF
+}
+
+int MapTiff
+(
+  MinImg *pImg,
+  const char *pFileName,
+  int page
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pImg);
+  SUPPRESS_UNUSED_VARIABLE(pFileName);
+  SUPPRESS_UNUSED_VARIABLE(page);
+  return NOT_SUPPORTED;
+#else
+  if (!pImg || !pFileName || page < 0)
+    return BAD_ARGS;
+  if (pImg->pScan0)
+    return BAD_ARGS;
+  if (DeduceFileLocation(pFileName) != inFileSystem)
+    return NOT_SUPPORTED;
+
+  MinImg prototype = {};
+  PROPAGATE_ERROR(GetTiffPropsEx(&prototype, NULL, pFileName, page));
+  if (prototype.channelDepth == 0)
+    return NOT_SUPPORTED;
+
+  scoped_tiff_handle pTIF(OpenTiff(pFileName, "r"));
+  if (!pTIF)
+    return FILE_ERROR;
+  TIFFSetDirectory(pTIF, page);
+
+  // Only a raster stored in the file exactly as the image lines are laid out
+  // in memory may be mapped: uncompressed, contiguous strips in native order.
+  int compression = 0, metr = 0;
+  _TIFFGetField(pTIF, TIFFTAG_COMPRESSION, &compression, COMPRESSION_NONE);
+  _TIFFGetField(pTIF, TIFFTAG_PHOTOMETRIC, &metr, PHOTOMETRIC_MINISBLACK);
+  if (TIFFIsTiled(pTIF) || compression != COMPRESSION_NONE ||
+      metr == PHOTOMETRIC_MINISWHITE)
+    return NOT_SUPPORTED;
+  if (prototype.channelDepth > 1 && TIFFIsByteSwapped(pTIF))
+    return NOT_SUPPORTED;
+
+  const tsize_t scanLen = TIFFScanlineSize(pTIF);
+  if (scanLen < static_cast<tsize_t>(prototype.width) *
+                prototype.channels * prototype.channelDepth)
+    return FILE_ERROR;
+
+  uint32 rps = 0;
+  _TIFFGetField(pTIF, TIFFTAG_ROWSPERSTRIP, &rps,
+                static_cast<uint32>(prototype.height));
+  rps = std::max<uint32>(1, std::min<uint32>(rps, prototype.height));
+  const int nStrips = (prototype.height + rps - 1) / rps;
+  if (static_cast<int>(TIFFNumberOfStrips(pTIF)) < nStrips)
+    return FILE_ERROR;
+
+  toff_t *pOffsets = NULL, *pByteCounts = NULL;
+  if (!TIFFGetField(pTIF, TIFFTAG_STRIPOFFSETS, &pOffsets) ||
+      !TIFFGetField(pTIF, TIFFTAG_STRIPBYTECOUNTS, &pByteCounts) ||
+      !pOffsets || !pByteCounts)
+    return FILE_ERROR;
+  const uint64_t stripSize = static_cast<uint64_t>(rps) * scanLen;
+  for (int strip = 0; strip < nStrips; ++strip)
   {
-    SHOULD_WORK(TIFFReadScanline(pTIF, pScanLineUint8, y));
-
-    if (bpc == 0 && bpc == pImg->channelDepth)
-      CopyBits(p_dst_line, pScanLineUint8, len, invert);
-    else if (bpc == 0 && bpc < pImg->channelDepth)
-      UnpackLine(p_dst_line, pScanLineUint8, len, invert);
-    else
-      ::memcpy(p_dst_line, pScanLineUint8, scanLen);
-    p_dst_line += pImg->stride;
+    const int rows = std::min<int>(rps, prototype.height - strip * rps);
+    if (pOffsets[strip] != pOffsets[0] + strip * stripSize ||
+        pByteCounts[strip] < static_cast<uint64_t>(rows) * scanLen)
+      return NOT_SUPPORTED;
   }
 
+  prototype.stride = static_cast<int>(scanLen);
+  PROPAGATE_ERROR(MapMinImageFile(&prototype, pFileName, pOffsets[0]));
+  *pImg = prototype;
   return NO_ERRORS;
 #endif // WITH_TIFF
 }
@@ -519,7 +1034,13 @@ int SaveTiffEx
   TIFFSetErrorHandler(NULL);
   TIFFSetWarningHandler(NULL);
 
-  int nPages = GetTiffPages(pFileName);
+  // A memory block has no end-of-file mark to append pages after, so it is
+  // always overwritten with a single page.
+  const bool inMemoryFile = DeduceFileLocation(pFileName) == inMemory;
+  if (inMemoryFile && page != 0)
+    return NOT_IMPLEMENTED;
+
+  int nPages = inMemoryFile ? 0 : GetTiffPages(pFileName);
   if (nPages == FILE_ERROR)
     nPages = 0;
   if (page > nPages || page < 0)
@@ -527,7 +1048,7 @@ int SaveTiffEx
   scoped_cpp_array<TiffData> tiff_pages(new TiffData[nPages]);
   if (page < nPages)
   {
-    scoped_tiff_handle pTIF(TIFFOpen(pFileName, "r"));
+    scoped_tiff_handle pTIF(OpenTiff(pFileName, "r"));
     if (!pTIF)
       return FILE_ERROR;
 
@@ -575,9 +1096,9 @@ int SaveTiffEx
    }
 
   char mode[] = "a";
-  if (page < nPages)
+  if (page < nPages || inMemoryFile)
     mode[0] = 'w';
-  scoped_tiff_handle pTIF(TIFFOpen( pFileName, mode ));
+  scoped_tiff_handle pTIF(OpenTiff(pFileName, mode));
   if (!pTIF)
     return FILE_ERROR;
 
@@ -646,3 +1167,239 @@ int SaveTiffEx
   return NO_ERRORS;
 #endif // WITH_TIFF
 }
+
+int SaveTiffToBuffer
+(
+  std::vector<uint8_t> *pBuffer,
+  const MinImg *pImg,
+  const ExtImgProps *pProps
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pBuffer);
+  SUPPRESS_UNUSED_VARIABLE(pImg);
+  SUPPRESS_UNUSED_VARIABLE(pProps);
+  return NOT_SUPPORTED;
+#else
+  if (!pBuffer || !pImg)
+    return BAD_ARGS;
+  if (!pImg->pScan0)
+    return BAD_ARGS;
+
+  TIFFSetErrorHandler(NULL);
+  TIFFSetWarningHandler(NULL);
+
+  {
+    scoped_tiff_handle pTIF(OpenTiffMemoryStream(
+        new TiffMemoryStream(pBuffer), "mem://", "w"));
+    if (!pTIF)
+      return FILE_ERROR;
+
+    TIFFSetField(pTIF, TIFFTAG_SUBFILETYPE, FILETYPE_PAGE);
+    TIFFSetField(pTIF, TIFFTAG_PAGENUMBER, 0, 1);
+    PROPAGATE_ERROR(AddPageToTiffExImpl(pTIF, pImg, pProps));
+    if (!TIFFWriteDirectory(pTIF))
+      return INTERNAL_ERROR;
+  } // TIFFClose() flushes the stream and trims the buffer to the file size.
+
+  return NO_ERRORS;
+#endif // WITH_TIFF
+}
+
+#ifdef WITH_TIFF
+
+// At most so many pages wait for the background thread; adding one more
+// blocks, so that a slow disk does not pile up copies of the pages.
+static const size_t TIFF_WRITER_QUEUE_SIZE = 4;
+
+struct TiffWriterPage
+{
+  MinImg image;
+  ExtImgProps props;
+  bool hasProps;
+  int page;
+};
+
+// The file stays open between the pages, so every page is written once,
+// right after the previous one. In the background mode the pages are copied
+// and encoded by a separate thread. In both modes the first error of a page
+// is kept in result and returned by the later calls, as the file is broken.
+struct MinImageWriter
+{
+  TIFF *pTIF;
+  int nPages;
+  bool background;
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<TiffWriterPage> queue;
+  bool closing;
+  int result;
+};
+
+static int WriteTiffPage
+(
+  TIFF *pTIF,
+  int page,
+  const MinImg *pImg,
+  const ExtImgProps *pProps
+)
+{
+  // The number of pages is not known yet, which TIFF denotes by zero.
+  TIFFSetField(pTIF, TIFFTAG_SUBFILETYPE, FILETYPE_PAGE);
+  TIFFSetField(pTIF, TIFFTAG_PAGENUMBER, page, 0);
+  PROPAGATE_ERROR(AddPageToTiffExImpl(pTIF, pImg, pProps));
+  if (!TIFFWriteDirectory(pTIF))
+    return INTERNAL_ERROR;
+  return NO_ERRORS;
+}
+
+static void RunTiffWriter(MinImageWriter *pWriter)
+{
+  std::unique_lock<std::mutex> lock(pWriter->mutex);
+  for (;;)
+  {
+    while (pWriter->queue.empty() && !pWriter->closing)
+      pWriter->changed.wait(lock);
+    if (pWriter->queue.empty())
+      return;
+
+    // The page stays queued while it is written, so that it counts against
+    // the queue size.
+    TiffWriterPage page = pWriter->queue.front();
+    const bool failed = pWriter->result != NO_ERRORS;
+    lock.unlock();
+    int result = NO_ERRORS;
+    if (!failed)
+      result = WriteTiffPage(pWriter->pTIF, page.page, &page.image,
+                             page.hasProps ? &page.props : NULL);
+    FreeMinImage(&page.image);
+    lock.lock();
+
+    if (pWriter->result == NO_ERRORS)
+      pWriter->result = result;
+    pWriter->queue.pop_front();
+    pWriter->changed.notify_all();
+  }
+}
+
+#endif // WITH_TIFF
+
+int OpenTiffWriter
+(
+  MinImageWriter **ppWriter,
+  const char *pFileName,
+  bool background
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(ppWriter);
+  SUPPRESS_UNUSED_VARIABLE(pFileName);
+  SUPPRESS_UNUSED_VARIABLE(background);
+  return NOT_SUPPORTED;
+#else
+  if (!ppWriter || !pFileName)
+    return BAD_ARGS;
+
+  TIFFSetErrorHandler(NULL);
+  TIFFSetWarningHandler(NULL);
+
+  TIFF *pTIF = OpenTiff(pFileName, "w");
+  if (!pTIF)
+    return FILE_ERROR;
+
+  MinImageWriter *pWriter = new MinImageWriter;
+  pWriter->pTIF = pTIF;
+  pWriter->nPages = 0;
+  pWriter->background = background;
+  pWriter->closing = false;
+  pWriter->result = NO_ERRORS;
+  if (background)
+    pWriter->worker = std::thread(RunTiffWriter, pWriter);
+
+  *ppWriter = pWriter;
+  return NO_ERRORS;
+#endif // WITH_TIFF
+}
+
+int AddTiffWriterPage
+(
+  MinImageWriter *pWriter,
+  const MinImg *pImg,
+  const ExtImgProps *pProps
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pWriter);
+  SUPPRESS_UNUSED_VARIABLE(pImg);
+  SUPPRESS_UNUSED_VARIABLE(pProps);
+  return NOT_SUPPORTED;
+#else
+  if (!pWriter || !pImg)
+    return BAD_ARGS;
+  if (!pImg->pScan0)
+    return BAD_ARGS;
+
+  if (!pWriter->background)
+  {
+    PROPAGATE_ERROR(pWriter->result);
+    pWriter->result = WriteTiffPage(pWriter->pTIF, pWriter->nPages, pImg,
+                                    pProps);
+    PROPAGATE_ERROR(pWriter->result);
+    pWriter->nPages++;
+    return NO_ERRORS;
+  }
+
+  TiffWriterPage page;
+  ::memset(&page.image, 0, sizeof(page.image));
+  PROPAGATE_ERROR(CloneMinImagePrototype(&page.image, pImg));
+  BACKED_PROPAGATE_ERROR(CopyMinImage(&page.image, pImg),
+                         FreeMinImage(&page.image));
+  page.hasProps = pProps != NULL;
+  if (pProps)
+    page.props = *pProps;
+
+  std::unique_lock<std::mutex> lock(pWriter->mutex);
+  while (pWriter->queue.size() >= TIFF_WRITER_QUEUE_SIZE &&
+         pWriter->result == NO_ERRORS)
+    pWriter->changed.wait(lock);
+  if (pWriter->result != NO_ERRORS)
+  {
+    FreeMinImage(&page.image);
+    return pWriter->result;
+  }
+  page.page = pWriter->nPages++;
+  pWriter->queue.push_back(page);
+  pWriter->changed.notify_all();
+  return NO_ERRORS;
+#endif // WITH_TIFF
+}
+
+int CloseTiffWriter
+(
+  MinImageWriter *pWriter
+)
+{
+#ifndef WITH_TIFF
+  SUPPRESS_UNUSED_VARIABLE(pWriter);
+  return NOT_SUPPORTED;
+#else
+  if (!pWriter)
+    return BAD_ARGS;
+
+  if (pWriter->background)
+  {
+    {
+      std::lock_guard<std::mutex> lock(pWriter->mutex);
+      pWriter->closing = true;
+      pWriter->changed.notify_all();
+    }
+    pWriter->worker.join();
+  }
+
+  const int result = pWriter->result;
+  TIFFClose(pWriter->pTIF);
+  delete pWriter;
+  return result;
+#endif // WITH_TIFF
+}
@@ -35,8 +35,12 @@ either expressed or implied, of copyright holders.
 #ifndef MINIMGIO_SRC_MINIMGIOTIFF_H_INCLUDED
 #define MINIMGIO_SRC_MINIMGIOTIFF_H_INCLUDED
 
+#include <vector>
+
 #include <minimgio/minimgio.h>
 
+struct RowsNotifier;
+
 int GetTiffPages
 (
   const char *pFileName
@@ -65,6 +69,33 @@ int LoadTiff
   int page
 );
 
+// Loads the page reporting the decoded rows to the notifier, if any. The
+// strips or tiles are then decoded in order in the calling thread.
+int LoadTiffRows
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  int page,
+  RowsNotifier *pNotifier
+);
+
+int LoadTiffRegion
+(
+  const MinImg *pImg,
+  const char *pFileName,
+  int page,
+  const MinRect *pRoi
+);
+
+// Maps the uncompressed raster of the page instead of reading it, see
+// MapMinImage.
+int MapTiff
+(
+  MinImg *pImg,
+  const char *pFileName,
+  int page
+);
+
 int SaveTiffEx
 (
   const char *pFileName,
@@ -73,4 +104,31 @@ int SaveTiffEx
   int page
 );
 
+// Encodes a single-page TIFF into the buffer, replacing its contents.
+int SaveTiffToBuffer
+(
+  std::vector<uint8_t> *pBuffer,
+  const MinImg *pImg,
+  const ExtImgProps *pProps
+);
+
+int OpenTiffWriter
+(
+  MinImageWriter **ppWriter,
+  const char *pFileName,
+  bool background
+);
+
+int AddTiffWriterPage
+(
+  MinImageWriter *pWriter,
+  const MinImg *pImg,
+  const ExtImgProps *pProps
+);
+
+int CloseTiffWriter
+(
+  MinImageWriter *pWriter
+);
+
 #endif // #ifndef MINIMGIO_SRC_MINIMGIOTIFF_H_INCLUDED
@@ -264,3 +264,40 @@ int CopyBits(uint8_t *pDstLine, const uint8_t *pSrcLine, size_t count, bool inve
 
   return NO_ERRORS;
 }
+
+int CopyBitRange(uint8_t *pDstLine, size_t dstOffset,
+                 const uint8_t *pSrcLine, size_t srcOffset,
+                 size_t count, bool invert)
+{
+  if (pDstLine == NULL || pSrcLine == NULL)
+    return BAD_ARGS;
+
+  if (!(dstOffset & 7) && !(srcOffset & 7))
+    return CopyBits(pDstLine + (dstOffset >> 3), pSrcLine + (srcOffset >> 3),
+                    count, invert);
+
+  for (size_t x = 0; x < count; x++)
+  {
+    if (!GETBIT(pSrcLine, srcOffset + x) == invert)
+      SETBIT(pDstLine, dstOffset + x);
+    else
+      CLRBIT(pDstLine, dstOffset + x);
+  }
+
+  return NO_ERRORS;
+}
+
+int UnpackBitRange(uint8_t *pDstLine, const uint8_t *pSrcLine, size_t srcOffset,
+                   size_t count, bool invert)
+{
+  if (pDstLine == NULL || pSrcLine == NULL)
+    return BAD_ARGS;
+
+  if (!(srcOffset & 7))
+    return UnpackLine(pDstLine, pSrcLine + (srcOffset >> 3), count, invert);
+
+  for (size_t x = 0; x < count; x++)
+    pDstLine[x] = (!GETBIT(pSrcLine, srcOffset + x) == invert) ? 0xFF : 0;
+
+  return NO_ERRORS;
+}
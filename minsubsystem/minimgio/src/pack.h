@@ -46,4 +46,13 @@ int UnpackLine(uint8_t *pDstLine, const uint8_t *pSrcLine, size_t count, bool in
 
 int CopyBits(uint8_t *pDstLine, const uint8_t *pSrcLine, size_t count, bool invert);
 
+// Same as CopyBits() and UnpackLine(), with the bits counted from the given
+// offsets in the lines.
+int CopyBitRange(uint8_t *pDstLine, size_t dstOffset,
+                 const uint8_t *pSrcLine, size_t srcOffset,
+                 size_t count, bool invert);
+
+int UnpackBitRange(uint8_t *pDstLine, const uint8_t *pSrcLine, size_t srcOffset,
+                   size_t count, bool invert);
+
 #endif // #ifndef MINIMGIO_SRC_PACK_H_INCLUDED
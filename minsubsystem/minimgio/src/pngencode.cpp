@@ -0,0 +1,504 @@
+/*
+
+Copyright (c) 2011, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+
+*/
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include <minbase/crossplat.h>
+#include <minbase/minresult.h>
+#include <minimgapi/minimgapi.h>
+
+#include "pngencode.h"
+
+#ifdef WITH_PNG
+
+#include <png.h>
+#include <zlib.h>
+
+#if defined(USE_SSE_SIMD)
+# include <emmintrin.h>
+#endif
+
+// Images smaller than this are encoded by libpng in the calling thread.
+static const int64_t PARALLEL_PNG_MIN_BYTES = 1 << 20;
+
+// The size of the filtered rows compressed by a single task.
+static const size_t PNG_BAND_BYTES = 1 << 18;
+
+// The deflate window, which is also the size of the dictionary of a band.
+static const size_t PNG_WINDOW_BYTES = 1 << 15;
+
+enum PngFilterType
+{
+  PNG_FILTER_TYPE_NONE,
+  PNG_FILTER_TYPE_SUB,
+  PNG_FILTER_TYPE_UP,
+  PNG_FILTER_TYPE_AVG,
+  PNG_FILTER_TYPE_PAETH
+};
+
+// Describes the scanlines of the image as stored in the PNG stream.
+struct PngRowLayout
+{
+  size_t rowBytes;
+  int bpp;
+  bool swap;
+  bool adaptive;
+};
+
+static PngRowLayout GetPngRowLayout(const MinImg *pImg)
+{
+  PngRowLayout layout;
+  const size_t samples = static_cast<size_t>(pImg->width) * pImg->channels;
+  layout.rowBytes = pImg->channelDepth == 0 ? (samples + 7) / 8 :
+                                              samples * pImg->channelDepth;
+  layout.bpp = std::max(1, pImg->channels * pImg->channelDepth);
+#ifndef __BIG_ENDIAN__
+  layout.swap = pImg->channelDepth == 2;
+#else
+  layout.swap = false;
+#endif
+  // As libpng does, only images of 8 bits per sample and more are filtered.
+  layout.adaptive = pImg->channelDepth > 0;
+  return layout;
+}
+
+// Returns row y as stored in the PNG stream, 16-bit samples are big-endian.
+static const uint8_t *GetPngRow
+(
+  const MinImg *pImg,
+  const PngRowLayout &layout,
+  int y,
+  uint8_t *pBuffer
+)
+{
+  const uint8_t *pRow = pImg->pScan0 + static_cast<ptrdiff_t>(y) * pImg->stride;
+  if (!layout.swap)
+    return pRow;
+  for (size_t i = 0; i < layout.rowBytes; i += 2)
+  {
+    pBuffer[i] = pRow[i + 1];
+    pBuffer[i + 1] = pRow[i];
+  }
+  return pBuffer;
+}
+
+// The libpng heuristic for choosing the filter type: the sum of the filtered
+// bytes taken as signed values, the smaller the better.
+static uint64_t SumPngFilteredRow(const uint8_t *p, size_t len)
+{
+  uint64_t sum = 0;
+  size_t i = 0;
+#if defined(USE_SSE_SIMD)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero;
+  for (; i + 16 <= len; i += 16)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    const __m128i a = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(a, zero));
+  }
+  MIN_ALIGNED(16) uint64_t lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  sum = lanes[0] + lanes[1];
+#endif
+  for (; i < len; ++i)
+    sum += p[i] < 128 ? p[i] : 256 - p[i];
+  return sum;
+}
+
+static void FilterPngRowSub
+(
+  uint8_t *pOut,
+  const uint8_t *pRow,
+  size_t len,
+  size_t bpp
+)
+{
+  size_t i = 0;
+  for (; i < len && i < bpp; ++i)
+    pOut[i] = pRow[i];
+#if defined(USE_SSE_SIMD)
+  for (; i + 16 <= len; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow + i));
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow + i - bpp));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + i), _mm_sub_epi8(x, a));
+  }
+#endif
+  for (; i < len; ++i)
+    pOut[i] = static_cast<uint8_t>(pRow[i] - pRow[i - bpp]);
+}
+
+static void FilterPngRowUp
+(
+  uint8_t *pOut,
+  const uint8_t *pRow,
+  const uint8_t *pPrior,
+  size_t len
+)
+{
+  size_t i = 0;
+#if defined(USE_SSE_SIMD)
+  for (; i + 16 <= len; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPrior + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + i), _mm_sub_epi8(x, b));
+  }
+#endif
+  for (; i < len; ++i)
+    pOut[i] = static_cast<uint8_t>(pRow[i] - pPrior[i]);
+}
+
+static void FilterPngRowAvg
+(
+  uint8_t *pOut,
+  const uint8_t *pRow,
+  const uint8_t *pPrior,
+  size_t len,
+  size_t bpp
+)
+{
+  size_t i = 0;
+  for (; i < len && i < bpp; ++i)
+    pOut[i] = static_cast<uint8_t>(pRow[i] - (pPrior[i] >> 1));
+#if defined(USE_SSE_SIMD)
+  // _mm_avg_epu8 rounds up, the filter rounds down.
+  const __m128i one = _mm_set1_epi8(1);
+  for (; i + 16 <= len; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow + i));
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow + i - bpp));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPrior + i));
+    const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+                                     _mm_and_si128(_mm_xor_si128(a, b), one));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + i), _mm_sub_epi8(x, avg));
+  }
+#endif
+  for (; i < len; ++i)
+    pOut[i] = static_cast<uint8_t>(pRow[i] - ((pRow[i - bpp] + pPrior[i]) >> 1));
+}
+
+static void FilterPngRowPaeth
+(
+  uint8_t *pOut,
+  const uint8_t *pRow,
+  const uint8_t *pPrior,
+  size_t len,
+  size_t bpp
+)
+{
+  size_t i = 0;
+  for (; i < len && i < bpp; ++i)
+    pOut[i] = static_cast<uint8_t>(pRow[i] - pPrior[i]);
+  for (; i < len; ++i)
+  {
+    const int a = pRow[i - bpp], b = pPrior[i], c = pPrior[i - bpp];
+    const int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+    const int pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+    pOut[i] = static_cast<uint8_t>(pRow[i] - pred);
+  }
+}
+
+// Writes the filter type byte and the filtered row. The filter type giving
+// the smallest sum of SumPngFilteredRow() is chosen, as libpng does.
+static void FilterPngRow
+(
+  uint8_t *pOut,
+  const uint8_t *pRow,
+  const uint8_t *pPrior,
+  const PngRowLayout &layout,
+  uint8_t *pCandidate,
+  uint8_t *pBest
+)
+{
+  const size_t len = layout.rowBytes;
+  if (!layout.adaptive)
+  {
+    pOut[0] = PNG_FILTER_TYPE_NONE;
+    ::memcpy(pOut + 1, pRow, len);
+    return;
+  }
+
+  int bestType = PNG_FILTER_TYPE_NONE;
+  uint64_t bestSum = SumPngFilteredRow(pRow, len);
+  for (int type = PNG_FILTER_TYPE_SUB; type <= PNG_FILTER_TYPE_PAETH; ++type)
+  {
+    switch (type)
+    {
+    case PNG_FILTER_TYPE_SUB:
+      FilterPngRowSub(pCandidate, pRow, len, layout.bpp);
+      break;
+    case PNG_FILTER_TYPE_UP:
+      FilterPngRowUp(pCandidate, pRow, pPrior, len);
+      break;
+    case PNG_FILTER_TYPE_AVG:
+      FilterPngRowAvg(pCandidate, pRow, pPrior, len, layout.bpp);
+      break;
+    default:
+      FilterPngRowPaeth(pCandidate, pRow, pPrior, len, layout.bpp);
+    }
+    const uint64_t sum = SumPngFilteredRow(pCandidate, len);
+    if (sum < bestSum)
+    {
+      bestSum = sum;
+      bestType = type;
+      std::swap(pCandidate, pBest);
+    }
+  }
+
+  pOut[0] = static_cast<uint8_t>(bestType);
+  ::memcpy(pOut + 1, bestType == PNG_FILTER_TYPE_NONE ? pRow : pBest, len);
+}
+
+struct PngDeflateJob
+{
+  const MinImg *pImg;
+  PngRowLayout layout;
+  int level;
+  int bandRows;
+  std::vector<std::vector<uint8_t> > blocks;
+  std::vector<uLong> adlers;
+  std::vector<size_t> lengths;
+  std::vector<int> results;
+
+  // Filters rows [begin, end) into pOut.
+  void FilterRows(uint8_t *pOut, int begin, int end) const
+  {
+    const size_t len = layout.rowBytes;
+    std::vector<uint8_t> buffers(5 * len);
+    uint8_t *pRowBuffer = &buffers[0];
+    uint8_t *pPriorBuffer = pRowBuffer + len;
+    uint8_t *pZeros = pPriorBuffer + len;
+    for (int y = begin; y < end; ++y, pOut += len + 1)
+    {
+      const uint8_t *pRow = GetPngRow(pImg, layout, y, pRowBuffer);
+      const uint8_t *pPrior = y > 0 ? GetPngRow(pImg, layout, y - 1, pPriorBuffer) :
+                                      pZeros;
+      FilterPngRow(pOut, pRow, pPrior, layout, pZeros + len, pZeros + 2 * len);
+    }
+  }
+
+  int DeflateBand(int band)
+  {
+    const int height = pImg->height;
+    const int begin = band * bandRows;
+    const int end = std::min(height, begin + bandRows);
+    const bool last = end == height;
+    const size_t len = layout.rowBytes + 1;
+
+    std::vector<uint8_t> filtered((end - begin) * len);
+    FilterRows(&filtered[0], begin, end);
+
+    // The rows preceding the band are filtered once more to make the
+    // dictionary, so the bands do not wait for each other.
+    std::vector<uint8_t> dictionary;
+    if (begin > 0)
+    {
+      const int dictionaryRows = std::min<int>(
+          begin, static_cast<int>((PNG_WINDOW_BYTES + len - 1) / len));
+      dictionary.resize(dictionaryRows * len);
+      FilterRows(&dictionary[0], begin - dictionaryRows, begin);
+    }
+
+    z_stream zs;
+    ::memset(&zs, 0, sizeof(zs));
+    const int strategy = layout.adaptive ? Z_FILTERED : Z_DEFAULT_STRATEGY;
+    if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+      return INTERNAL_ERROR;
+    if (!dictionary.empty())
+    {
+      const size_t size = std::min(dictionary.size(), PNG_WINDOW_BYTES);
+      deflateSetDictionary(&zs, &dictionary[dictionary.size() - size],
+                           static_cast<uInt>(size));
+    }
+
+    // Every band but the last ends at a byte-aligned sync flush point and
+    // the last one ends the deflate stream.
+    std::vector<uint8_t> &block = blocks[band];
+    block.resize(deflateBound(&zs, static_cast<uLong>(filtered.size())) + 64);
+    zs.next_in = &filtered[0];
+    zs.avail_in = static_cast<uInt>(filtered.size());
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    for (;;)
+    {
+      zs.next_out = &block[zs.total_out];
+      zs.avail_out = static_cast<uInt>(block.size() - zs.total_out);
+      const int res = deflate(&zs, flush);
+      if (res == Z_STREAM_ERROR)
+      {
+        deflateEnd(&zs);
+        return INTERNAL_ERROR;
+      }
+      if (last ? res == Z_STREAM_END : zs.avail_out != 0)
+        break;
+      block.resize(block.size() * 2);
+    }
+    block.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    adlers[band] = adler32(adler32(0, NULL, 0), &filtered[0],
+                           static_cast<uInt>(filtered.size()));
+    lengths[band] = filtered.size();
+    return NO_ERRORS;
+  }
+
+  static void Run(void *pContext, int band)
+  {
+    PngDeflateJob *pJob = static_cast<PngDeflateJob *>(pContext);
+    try
+    {
+      pJob->results[band] = pJob->DeflateBand(band);
+    }
+    catch (const std::bad_alloc &)
+    {
+      pJob->results[band] = NO_MEMORY;
+    }
+  }
+};
+
+bool IsPngParallelEncodingUseful(const MinImg *pImg)
+{
+  if (!pImg || GetMinImageThreadCount() <= 1)
+    return false;
+  const PngRowLayout layout = GetPngRowLayout(pImg);
+  return static_cast<int64_t>(layout.rowBytes) * pImg->height >=
+         PARALLEL_PNG_MIN_BYTES;
+}
+
+int DeflatePngRows
+(
+  std::vector<std::vector<uint8_t> > *pBlocks,
+  const MinImg *pImg,
+  int level
+)
+{
+  if (!pBlocks || !pImg || !pImg->pScan0 || pImg->width <= 0 || pImg->height <= 0)
+    return BAD_ARGS;
+  if (pImg->channelDepth < 0 || pImg->channelDepth > 2 ||
+      pImg->channels < 1 || pImg->channels > 4)
+    return NOT_SUPPORTED;
+  if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION)
+    return BAD_ARGS;
+
+  PngDeflateJob job;
+  job.pImg = pImg;
+  job.layout = GetPngRowLayout(pImg);
+  job.level = level;
+  job.bandRows = static_cast<int>(
+      std::max<size_t>(1, PNG_BAND_BYTES / (job.layout.rowBytes + 1)));
+  const int nBands = (pImg->height + job.bandRows - 1) / job.bandRows;
+  try
+  {
+    job.blocks.resize(nBands);
+    job.adlers.resize(nBands);
+    job.lengths.resize(nBands);
+    job.results.resize(nBands, NO_ERRORS);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return NO_MEMORY;
+  }
+  PROPAGATE_ERROR(RunMinImageTasks(&PngDeflateJob::Run, &job, nBands));
+  for (int band = 0; band < nBands; ++band)
+    PROPAGATE_ERROR(job.results[band]);
+
+  // The zlib header, its level field is informational only.
+  const int effectiveLevel = level == Z_DEFAULT_COMPRESSION ? 6 : level;
+  const int fLevel = effectiveLevel < 2 ? 0 : effectiveLevel < 6 ? 1 :
+                     effectiveLevel == 6 ? 2 : 3;
+  const int cmf = 0x78;
+  int flg = fLevel << 6;
+  flg += 31 - (cmf * 256 + flg) % 31;
+  uint8_t header[2] = {static_cast<uint8_t>(cmf), static_cast<uint8_t>(flg)};
+
+  uLong adler = adler32(0, NULL, 0);
+  for (int band = 0; band < nBands; ++band)
+    adler = adler32_combine(adler, job.adlers[band],
+                            static_cast<z_off_t>(job.lengths[band]));
+  uint8_t trailer[4] = {
+    static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+    static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)
+  };
+
+  try
+  {
+    job.blocks.front().insert(job.blocks.front().begin(), header, header + 2);
+    job.blocks.back().insert(job.blocks.back().end(), trailer, trailer + 4);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return NO_MEMORY;
+  }
+  pBlocks->swap(job.blocks);
+  return NO_ERRORS;
+}
+
+void WritePngDataChunks
+(
+  png_struct_def *pPng,
+  const std::vector<std::vector<uint8_t> > &blocks
+)
+{
+  static const png_byte idat[5] = {'I', 'D', 'A', 'T', '\0'};
+  static const png_byte iend[5] = {'I', 'E', 'N', 'D', '\0'};
+  for (size_t i = 0; i < blocks.size(); ++i)
+    if (!blocks[i].empty())
+      png_write_chunk(pPng, idat, &blocks[i][0], blocks[i].size());
+  png_write_chunk(pPng, iend, NULL, 0);
+}
+
+#else // WITH_PNG
+
+bool IsPngParallelEncodingUseful(const MinImg * /*pImg*/)
+{
+  return false;
+}
+
+int DeflatePngRows(std::vector<std::vector<uint8_t> > * /*pBlocks*/,
+                   const MinImg * /*pImg*/, int /*level*/)
+{
+  return NOT_SUPPORTED;
+}
+
+void WritePngDataChunks(png_struct_def * /*pPng*/,
+                        const std::vector<std::vector<uint8_t> > & /*blocks*/)
+{
+}
+
+#endif // WITH_PNG
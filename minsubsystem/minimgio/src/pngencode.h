@@ -0,0 +1,73 @@
+/*
+
+Copyright (c) 2011, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+
+*/
+
+#pragma once
+#ifndef MINIMGIO_SRC_PNGENCODE_H_INCLUDED
+#define MINIMGIO_SRC_PNGENCODE_H_INCLUDED
+
+#include <vector>
+
+#include <minbase/mintyp.h>
+#include <minbase/minimg.h>
+
+// Whether the image is large enough and there are threads enough for
+// DeflatePngRows() to pay off compared to encoding with libpng.
+bool IsPngParallelEncodingUseful(const MinImg *pImg);
+
+// Filters the rows of the image and compresses them into the zlib stream of
+// the PNG image data (the concatenated contents of the IDAT chunks), which is
+// returned as consecutive blocks, each to be written as an IDAT chunk. The rows
+// are split into bands compressed in parallel as independent deflate blocks
+// ending at sync flush points. Every band is primed with the last 32 KiB of the
+// previous one as a dictionary, so the stream is almost as small as a serial
+// one. level is the zlib compression level or Z_DEFAULT_COMPRESSION (-1).
+int DeflatePngRows
+(
+  std::vector<std::vector<uint8_t> > *pBlocks,
+  const MinImg *pImg,
+  int level
+);
+
+struct png_struct_def;
+
+// Writes the blocks made by DeflatePngRows() as IDAT chunks followed by the
+// IEND chunk, which replaces png_write_image() and png_write_end() after
+// png_write_info(). Reports errors through the libpng error handler, so the
+// blocks must be owned outside of the setjmp() scope.
+void WritePngDataChunks
+(
+  png_struct_def *pPng,
+  const std::vector<std::vector<uint8_t> > &blocks
+);
+
+#endif // #ifndef MINIMGIO_SRC_PNGENCODE_H_INCLUDED
@@ -0,0 +1,365 @@
+/*
+
+Copyright (c) 2011, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+
+*/
+#include <minimgio/minimgio.h>
+#include <minimgio/device.h>
+#include <minimgapi/minimgapi.h>
+#include <minbase/minresult.h>
+
+#include "replaydevice.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+static bool IsDirectory(const std::string& path) {
+  struct stat st;
+  return 0 == ::stat(path.c_str(), &st) && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+static void ListDirectory(
+    std::vector<std::string>& file_names,
+    const std::string&        dir_path) {
+#ifdef _WIN32
+  _finddata_t data;
+  intptr_t handle = ::_findfirst((dir_path + "/*").c_str(), &data);
+  if (-1 == handle)
+    return;
+  do {
+    if (!(data.attrib & _A_SUBDIR) && '.' != data.name[0])
+      file_names.push_back(dir_path + "/" + data.name);
+  } while (0 == ::_findnext(handle, &data));
+  ::_findclose(handle);
+#else
+  DIR* p_dir = ::opendir(dir_path.c_str());
+  if (!p_dir)
+    return;
+  while (const dirent* p_entry = ::readdir(p_dir)) {
+    if ('.' == p_entry->d_name[0])
+      continue;
+    const std::string file_name = dir_path + "/" + p_entry->d_name;
+    if (!IsDirectory(file_name))
+      file_names.push_back(file_name);
+  }
+  ::closedir(p_dir);
+#endif
+  std::sort(file_names.begin(), file_names.end());
+}
+
+ReplayDevice* ReplayDevice::Instance(
+    const std::string& source_path,
+    const std::string& frame_rate,
+    const std::string& ring_frames) {
+  real64_t fps = 0.;
+  if (!frame_rate.empty()) {
+    char* p_str_end = nullptr;
+    fps = ::strtod(frame_rate.c_str(), &p_str_end);
+    if (*p_str_end || fps < 0.)
+      return nullptr;
+  }
+  long ring_size = DEFAULT_REPLAY_RING_FRAMES;
+  if (!ring_frames.empty()) {
+    char* p_str_end = nullptr;
+    ring_size = ::strtol(ring_frames.c_str(), &p_str_end, 10);
+    if (*p_str_end || ring_size < 1)
+      return nullptr;
+  }
+
+  std::vector<std::string> file_names;
+  if (IsDirectory(source_path))
+    ListDirectory(file_names, source_path);
+  else
+    file_names.push_back(source_path);
+
+  // A capture device keeps its frame format, so the pages that differ from
+  // the first one are skipped along with the files that are not images.
+  std::vector<Frame> frames;
+  MinImg prototype = {0};
+  for (const auto& file_name : file_names) {
+    const int n_pages = GetMinImageFilePages(file_name.c_str());
+    for (int page = 0; page < n_pages; ++page) {
+      MinImg image = {0};
+      if (GetMinImageFileProps(&image, file_name.c_str(), page) < 0)
+        continue;
+      if (frames.empty())
+        prototype = image;
+      else if (CompareMinImagePrototypes(&image, &prototype))
+        continue;
+      Frame frame = {file_name, page};
+      frames.push_back(frame);
+    }
+  }
+  if (frames.empty())
+    return nullptr;
+
+  ReplayDevice* p_device = new ReplayDevice(
+      frames, prototype, fps,
+      static_cast<int>(std::min<size_t>(ring_size, frames.size())));
+  if (p_device->AllocateRing() < 0) {
+    delete p_device;
+    return nullptr;
+  }
+  if (p_device->resident_)
+    for (int i = 0; i < static_cast<int>(frames.size()); ++i)
+      p_device->ring_results_[i] = p_device->DecodeFrame(i, i);
+
+  return p_device;
+}
+
+ReplayDevice::ReplayDevice(
+    const std::vector<Frame>& frames,
+    const MinImg&             prototype,
+    real64_t                  fps,
+    int                       ring_frames)
+  : frames_(frames),
+    prototype_(prototype),
+    fps_(fps),
+    counter_(0),
+    resident_(static_cast<int>(frames.size()) <= ring_frames),
+    stopping_(false),
+    ring_(ring_frames),
+    ring_results_(ring_frames, NO_ERRORS),
+    produced_(0),
+    consumed_(0) {
+  // empty
+}
+
+ReplayDevice::~ReplayDevice() {
+  FreeRing();
+}
+
+int ReplayDevice::AllocateRing() {
+  for (auto& image : ring_)
+    PROPAGATE_ERROR(CloneMinImagePrototype(&image, &prototype_));
+  return NO_ERRORS;
+}
+
+void ReplayDevice::FreeRing() {
+  for (auto& image : ring_)
+    FreeMinImage(&image);
+}
+
+int ReplayDevice::DecodeFrame(int frame_index, int slot) {
+  const Frame& frame = frames_[frame_index];
+  return LoadMinImage(&ring_[slot], frame.file_name.c_str(), frame.page);
+}
+
+void ReplayDevice::RunDecoder() {
+  const int64_t ring_size = static_cast<int64_t>(ring_.size());
+  const int64_t n_frames = static_cast<int64_t>(frames_.size());
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [&] {
+        return stopping_ || produced_ - consumed_ < ring_size;
+      });
+      if (stopping_)
+        return;
+    }
+
+    // Only this thread advances produced_, and the slot is not read until then.
+    const int slot = static_cast<int>(produced_ % ring_size);
+    const int result = DecodeFrame(static_cast<int>(produced_ % n_frames), slot);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ring_results_[slot] = result;
+      ++produced_;
+    }
+    changed_.notify_all();
+  }
+}
+
+int ReplayDevice::Take() {
+  if (!counter_++) {
+    stopping_ = false;
+    next_frame_time_ = std::chrono::steady_clock::now();
+    if (!resident_) {
+      try {
+        decoder_ = std::thread(&ReplayDevice::RunDecoder, this);
+      } catch (const std::system_error&) {
+        --counter_;
+        return INTERNAL_ERROR;
+      }
+    }
+  }
+
+  return NO_ERRORS;
+}
+
+int ReplayDevice::Release() {
+  if (!counter_)
+    return BAD_STATE;
+
+  if (!--counter_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    changed_.notify_all();
+    if (decoder_.joinable())
+      decoder_.join();
+    // Every replay stream gets a device of its own, owned by the stream.
+    delete this;
+  }
+
+  return NO_ERRORS;
+}
+
+int ReplayDevice::PushImage(const MinImg*) {
+  return NO_SENSE;
+}
+
+int ReplayDevice::QueryImage(const MinImg* p_image) {
+  if (!counter_)
+    return BAD_STATE;
+
+  if (!p_image)
+    return BAD_ARGS;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (fps_ > 0.) {
+    // A slow consumer gets the next frame at once but earns no extra ones.
+    const auto now = std::chrono::steady_clock::now();
+    const auto due = std::max(next_frame_time_, now);
+    next_frame_time_ = due + std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+          std::chrono::duration<real64_t>(1. / fps_));
+    if (due > now) {
+      lock.unlock();
+      std::this_thread::sleep_until(due);
+      lock.lock();
+    }
+  }
+
+  const int64_t ring_size = static_cast<int64_t>(ring_.size());
+  if (!resident_)
+    changed_.wait(lock, [&] { return produced_ > consumed_; });
+  const int slot = static_cast<int>(consumed_ % ring_size);
+  int result = ring_results_[slot];
+  if (result >= 0)
+    result = CopyMinImage(p_image, &ring_[slot]);
+  ++consumed_;
+  lock.unlock();
+  changed_.notify_all();
+
+  return result;
+}
+
+int ReplayDevice::QueryImagePropsEx(MinImg* p_image, ExtImgProps* p_props) {
+  if (!counter_)
+    return BAD_STATE;
+
+  if (!p_image)
+    return BAD_ARGS;
+
+  p_image->width = prototype_.width;
+  p_image->height = prototype_.height;
+  p_image->channels = prototype_.channels;
+  p_image->channelDepth = prototype_.channelDepth;
+  p_image->format = prototype_.format;
+  if (p_props) {
+    p_props->iff = IFF_UNKNOWN;
+    p_props->comp = IFC_NONE;
+    p_props->xDPI = 0.f;
+    p_props->yDPI = 0.f;
+    p_props->qty = 0;
+  }
+  return NO_ERRORS;
+}
+
+int ReplayDevice::GetProperty(const char* p_key, char* p_value, int size) {
+  if (!p_key || !p_value)
+    return BAD_ARGS;
+
+  if (!::strcmp(p_key, SP_FRAMESIZE)) {
+    if (::snprintf(p_value, size, "%dx%d",
+                   prototype_.width, prototype_.height) > size)
+      return NO_MEMORY;
+
+    return NO_ERRORS;
+  }
+
+  if (!::strcmp(p_key, SP_FRAMERATE)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (::snprintf(p_value, size, "%lf", fps_) > size)
+      return NO_MEMORY;
+
+    return NO_ERRORS;
+  }
+
+  return NOT_SUPPORTED;
+}
+
+int ReplayDevice::SetProperty(const char* p_key, const char* p_value) {
+  if (!p_key || !p_value)
+    return BAD_ARGS;
+
+  if (!::strcmp(p_key, SP_FRAMESIZE)) {
+    int width = 0;
+    int height = 0;
+    char tail = 0;
+    if (2 != ::sscanf(p_value, "%dx%d%c", &width, &height, &tail))
+      return BAD_ARGS;
+
+    // Frames are served as they were recorded.
+    if (width != prototype_.width || height != prototype_.height)
+      return NOT_SUPPORTED;
+
+    return NO_ERRORS;
+  }
+
+  if (!::strcmp(p_key, SP_FRAMERATE)) {
+    char* p_str_end = nullptr;
+    real64_t fps = ::strtod(p_value, &p_str_end);
+    if (*p_str_end || fps < 0.)
+      return BAD_ARGS;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    fps_ = fps;
+    return NO_ERRORS;
+  }
+
+  return NOT_SUPPORTED;
+}
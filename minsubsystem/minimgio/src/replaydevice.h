@@ -0,0 +1,109 @@
+/*
+
+Copyright (c) 2011, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+
+*/
+#pragma once
+#ifndef MINIMGIO_SRC_REPLAYDEVICE_H_INCLUDED
+#define MINIMGIO_SRC_REPLAYDEVICE_H_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stream.h"
+
+/// Number of decoded frames kept by a replay device unless requested otherwise.
+static constexpr int DEFAULT_REPLAY_RING_FRAMES = 16;
+
+/// Serves the pages of a directory, list or multi-page file as a capture
+/// device. Sources that fit the ring are decoded once when the device is taken
+/// and then looped; longer ones are decoded ahead by a background thread.
+class ReplayDevice : public Device {
+public:
+  static ReplayDevice *Instance(
+      const std::string &source_path,
+      const std::string &frame_rate = "",
+      const std::string &ring_frames = "");
+
+private:
+  struct Frame {
+    std::string file_name;
+    int         page;
+  };
+
+  ReplayDevice(const std::vector<Frame> &frames,
+               const MinImg             &prototype,
+               real64_t                  fps,
+               int                       ring_frames);
+  ReplayDevice(const ReplayDevice &);
+  ReplayDevice &operator =(const ReplayDevice &);
+  virtual ~ReplayDevice();
+
+public:
+  int Take();
+  int Release();
+  int PushImage(const MinImg *);
+  int QueryImage(const MinImg *p_image);
+  int QueryImagePropsEx(MinImg *p_image, ExtImgProps *p_props);
+  int GetProperty(const char *p_key, char *p_value, int size);
+  int SetProperty(const char *p_key, const char *p_value);
+
+private:
+  int AllocateRing();
+  void FreeRing();
+  int DecodeFrame(int frame_index, int slot);
+  void RunDecoder();
+
+private:
+  const std::vector<Frame> frames_;
+  MinImg                   prototype_;
+  real64_t                 fps_;
+  int                      counter_;
+  bool                     resident_;
+  bool                     stopping_;
+
+private:
+  std::vector<MinImg> ring_;
+  std::vector<int>    ring_results_;
+  int64_t             produced_;
+  int64_t             consumed_;
+
+private:
+  std::mutex              mutex_;
+  std::condition_variable changed_;
+  std::thread             decoder_;
+  std::chrono::steady_clock::time_point next_frame_time_;
+};
+
+#endif // #ifndef MINIMGIO_SRC_REPLAYDEVICE_H_INCLUDED
@@ -0,0 +1,95 @@
+/*
+
+Copyright (c) 2011, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+
+*/
+#include <cstdio>
+
+#include <minbase/minresult.h>
+
+#include "replaysubsystem.h"
+#include "replaydevice.h"
+#include "camstream.h"
+
+#include <string>
+#include <sstream>
+
+ReplaySubSystem::ReplaySubSystem() {
+  // empty
+}
+
+SubSystem* ReplaySubSystem::Instance() {
+  static ReplaySubSystem instance;
+  return &instance;
+}
+
+int ReplaySubSystem::GetDeviceNameList(char* p_device_names, int size) const {
+  if (!p_device_names)
+    return BAD_ARGS;
+
+  // Any directory, list or image file is a device, so none are enumerated.
+  if (::snprintf(p_device_names, size, "%s", "") > size)
+    return NO_MEMORY;
+
+  return NO_ERRORS;
+}
+
+int ReplaySubSystem::OpenStream(
+    const char* p_device_name,
+    char*       p_URI,
+    int         size) {
+  if (!p_device_name || !p_URI)
+    return BAD_ARGS;
+
+  std::istringstream iss(p_device_name);
+  std::string source_path;
+  if (!std::getline(iss, source_path) || source_path.empty())
+    return BAD_ARGS;
+
+  std::string frame_rate = "";
+  std::string ring_frames = "";
+  if (std::getline(iss, frame_rate))
+    std::getline(iss, ring_frames);
+
+  Device* p_device = ReplayDevice::Instance(source_path, frame_rate, ring_frames);
+  if (!p_device)
+    return BAD_ARGS;
+
+  Stream* p_stream = new CamStream(p_device);
+  if (!p_stream)
+    return INTERNAL_ERROR;
+
+  if (::snprintf(p_URI, size, "dev://%p", p_stream) > size) {
+    delete p_stream;
+    return NO_MEMORY;
+  }
+
+  return NO_ERRORS;
+}
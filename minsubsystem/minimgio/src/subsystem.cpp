@@ -36,6 +36,8 @@ either expressed or implied, of copyright holders.
 #include <cstring>
 #include <minimgio/device.h>
 
+#include "replaysubsystem.h"
+
 #ifdef DIRECTX_SHOW
 #include "dshowsubsystem.h"
 #endif
@@ -53,6 +55,9 @@ SubSystem * SubSystem::Instance(const char *pSubSystemName)
   if (pSubSystemName == NULL)
     return NULL;
 
+  if (strcmp(pSubSystemName, DSS_REPLAY) == 0)
+    return ReplaySubSystem::Instance();
+
 #ifdef DIRECTX_SHOW
 
   if (strcmp(pSubSystemName, DSS_CAMERA) == 0)
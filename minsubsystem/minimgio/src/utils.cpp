@@ -110,3 +110,25 @@ bool atob(const char *pValue)
 
   return false;
 }
+
+int RowsNotifier::Advance(int decodedRows)
+{
+  while (decodedRows - notifiedRows >= rowsPerCall)
+  {
+    PROPAGATE_ERROR(callback(pContext, pImg, notifiedRows, rowsPerCall));
+    notifiedRows += rowsPerCall;
+  }
+  return NO_ERRORS;
+}
+
+int RowsNotifier::Finish(int decodedRows)
+{
+  PROPAGATE_ERROR(Advance(decodedRows));
+  if (decodedRows > notifiedRows)
+  {
+    PROPAGATE_ERROR(callback(pContext, pImg, notifiedRows,
+                             decodedRows - notifiedRows));
+    notifiedRows = decodedRows;
+  }
+  return NO_ERRORS;
+}
@@ -35,6 +35,8 @@ either expressed or implied, of copyright holders.
 #ifndef MINIMGIO_SRC_UTILS_H_INCLUDED
 #define MINIMGIO_SRC_UTILS_H_INCLUDED
 
+#include <minimgio/minimgio.h>
+
 enum FileLocation {
   inFileSystem,
   inMemory,
@@ -49,4 +51,20 @@ bool IsTextualFile(const char *fileName, int blockSize = 1024);
 
 bool atob(const char *pValue);
 
+// Reports the rows decoded so far to the callback of LoadMinImageRows() in
+// portions of rowsPerCall rows, the last portion may be shorter.
+struct RowsNotifier
+{
+  const MinImg *pImg;
+  int rowsPerCall;
+  MinImageRowsCallback callback;
+  void *pContext;
+  int notifiedRows;
+
+  // Reports the full portions among the first decodedRows rows.
+  int Advance(int decodedRows);
+  // Reports all of the first decodedRows rows not reported yet.
+  int Finish(int decodedRows);
+};
+
 #endif // #ifndef MINIMGIO_SRC_UTILS_H_INCLUDED
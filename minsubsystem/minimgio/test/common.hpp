@@ -165,6 +165,124 @@ void minimgio_test_props(
   EXPECT_EQ(load_props.yDPI, save_props_none.yDPI);
 }
 
+// Checks that the regions loaded by LoadMinImageRegion() match the same regions
+// of the whole image loaded at the same scale.
+void minimgio_test_region(const std::string &fn, const int scale) {
+  DECLARE_GUARDED_MINIMG(whole);
+  ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&whole, fn.c_str()));
+  const int width = whole.width, height = whole.height;
+  whole.width = (width + scale - 1) / scale;
+  whole.height = (height + scale - 1) / scale;
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&whole));
+  ASSERT_EQ(NO_ERRORS, LoadMinImageRegion(&whole, fn.c_str(), 0, NULL, scale));
+  // Bit regions may start inside a byte, so binary images are compared unpacked.
+  const bool packed = whole.channelDepth == 0;
+  DECLARE_GUARDED_MINIMG(whole_unpacked);
+  if (packed) {
+    ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(
+      &whole_unpacked, &whole, TYP_UINT8));
+    ASSERT_EQ(NO_ERRORS, UnpackMinImage(&whole_unpacked, &whole));
+  }
+
+  const MinRect rois[] = {
+    minRect(17, 5, 131, 77),
+    minRect(width - 45, height - 31, 45, 31),
+    minRect(0, 40, width, 24),
+    minRect(3, 0, 1, height)
+  };
+  for (size_t i = 0; i < sizeof(rois) / sizeof(rois[0]); ++i) {
+    const MinRect &roi = rois[i];
+    const int wd = (roi.width + scale - 1) / scale;
+    const int ht = (roi.height + scale - 1) / scale;
+    DECLARE_GUARDED_MINIMG(region);
+    ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&region, &whole, AO_EMPTY));
+    region.width = wd;
+    region.height = ht;
+    ASSERT_EQ(NO_ERRORS, AllocMinImage(&region));
+    ASSERT_EQ(NO_ERRORS, LoadMinImageRegion(&region, fn.c_str(), 0, &roi, scale));
+    DECLARE_GUARDED_MINIMG(region_unpacked);
+    if (packed) {
+      ASSERT_EQ(NO_ERRORS, CloneRetypifiedMinImagePrototype(
+        &region_unpacked, &region, TYP_UINT8));
+      ASSERT_EQ(NO_ERRORS, UnpackMinImage(&region_unpacked, &region));
+    }
+    MinImg expected = {0};
+    ASSERT_EQ(NO_ERRORS, GetMinImageRegion(
+      &expected, packed ? &whole_unpacked : &whole,
+      roi.x / scale, roi.y / scale, wd, ht));
+    EXPECT_EQ(NO_ERRORS, CompareMinImages(
+      packed ? &region_unpacked : &region, &expected)) << i;
+  }
+
+  DECLARE_GUARDED_MINIMG(small);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&small, &whole, AO_EMPTY));
+  small.width = 1;
+  small.height = 1;
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&small));
+  const MinRect outside = minRect(width - 1, 0, 2, 1);
+  EXPECT_EQ(BAD_ARGS, LoadMinImageRegion(&small, fn.c_str(), 0, &outside, scale));
+  EXPECT_EQ(BAD_ARGS, LoadMinImageRegion(&small, fn.c_str(), 0, NULL, 3));
+}
+
+// Rows reported by LoadMinImageRows() checked against the whole image.
+struct RowsCheck {
+  const MinImg *p_expected;
+  int rows_per_call;
+  int next_row;
+  int calls;
+  int stop_after;
+  bool complete;
+};
+
+static int check_rows(void *p_context, const MinImg *p_img, int first_row, int n_rows) {
+  RowsCheck *p_check = static_cast<RowsCheck *>(p_context);
+  if (first_row != p_check->next_row || n_rows <= 0 ||
+      n_rows > p_check->rows_per_call ||
+      first_row + n_rows > p_check->p_expected->height)
+    p_check->complete = false;
+  else if (n_rows < p_check->rows_per_call &&
+           first_row + n_rows != p_check->p_expected->height)
+    p_check->complete = false;
+  else {
+    // The reported rows must already be decoded.
+    MinImg rows = {0}, expected_rows = {0};
+    GetMinImageRegion(&rows, p_img, 0, first_row, p_img->width, n_rows);
+    GetMinImageRegion(&expected_rows, p_check->p_expected, 0, first_row,
+                      p_img->width, n_rows);
+    if (CompareMinImages(&rows, &expected_rows) != NO_ERRORS)
+      p_check->complete = false;
+  }
+  p_check->next_row = first_row + n_rows;
+  if (++p_check->calls == p_check->stop_after)
+    return INTERNAL_ERROR;
+  return NO_ERRORS;
+}
+
+// Checks that LoadMinImageRows() reports all the rows in order, each portion
+// once it is decoded, and stops when the callback fails.
+void minimgio_test_rows(const std::string &fn, const int rows_per_call) {
+  DECLARE_GUARDED_MINIMG(expected);
+  ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&expected, fn.c_str()));
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&expected));
+  ASSERT_EQ(NO_ERRORS, LoadMinImage(&expected, fn.c_str()));
+
+  DECLARE_GUARDED_MINIMG(loaded);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&loaded, &expected));
+  RowsCheck check = {&expected, rows_per_call, 0, 0, 0, true};
+  ASSERT_EQ(NO_ERRORS, LoadMinImageRows(&loaded, fn.c_str(), 0, rows_per_call,
+                                        check_rows, &check));
+  EXPECT_TRUE(check.complete);
+  EXPECT_EQ(expected.height, check.next_row);
+  EXPECT_EQ((expected.height + rows_per_call - 1) / rows_per_call, check.calls);
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&loaded, &expected));
+
+  RowsCheck stopped = {&expected, rows_per_call, 0, 0, 1, true};
+  EXPECT_EQ(INTERNAL_ERROR, LoadMinImageRows(&loaded, fn.c_str(), 0,
+                                             rows_per_call, check_rows, &stopped));
+  EXPECT_EQ(1, stopped.calls);
+  EXPECT_EQ(BAD_ARGS, LoadMinImageRows(&loaded, fn.c_str(), 0, 0, check_rows));
+}
+
 static bool check_tmp_is_writeable() {
   const std::string fn = std::string(std::tmpnam(NULL)) + ".test_minimgio";
   FILE *f = fopen(fn.c_str(), "wb");
@@ -1,3 +1,8 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <minbase/minresult.h>
 #include <minimgapi/minimgapi.h>
@@ -101,6 +106,33 @@ TEST(TestMinimgio, test_pack_and_unpack) {
 }
 
 
+static int collect_file_name(void *p_context, const char *p_file_name) {
+  static_cast<std::vector<std::string> *>(p_context)->push_back(p_file_name);
+  return NO_ERRORS;
+}
+
+TEST(TestMinimgio, test_interface_lst) {
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".lst";
+  {
+    std::ofstream lst(fn.c_str());
+    if (!lst.is_open())
+      return;
+    lst << "a.png\n; comment\n\n  b.tif  \n#end\nc.jpg\n";
+  }
+  std::string const dir = fn.substr(0, fn.find_last_of("/\\"));
+
+  std::vector<std::string> names;
+  EXPECT_EQ(2, ListMinImageFiles(fn.c_str(), collect_file_name, &names));
+  ASSERT_EQ(2u, names.size());
+  EXPECT_EQ(dir + "/a.png", names[0]);
+  EXPECT_EQ(dir + "/b.tif", names[1]);
+  EXPECT_EQ(2, GetMinImageFilePages(fn.c_str()));
+  std::remove(fn.c_str());
+
+  EXPECT_EQ(BAD_ARGS, ListMinImageFiles(fn.c_str(), NULL));
+  EXPECT_EQ(FILE_ERROR, ListMinImageFiles(fn.c_str(), collect_file_name, &names));
+}
+
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
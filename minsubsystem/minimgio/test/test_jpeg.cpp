@@ -45,6 +45,31 @@ TEST(TestMinimgio, jpeg_rgb) {
   test_jpeg<uint8_t>(3);
 }
 
+TEST(TestMinimgio, jpeg_region) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".jpg";
+  FileRemover file_remover(fn);
+  const int channels[] = {1, 3};
+  for (int i = 0; i < 2; ++i) {
+    DECLARE_GUARDED_MINIMG(original_img);
+    create_test_image<uint8_t>(&original_img, channels[i]);
+    ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &original_img));
+    for (int scale = 1; scale <= 8; scale *= 2)
+      minimgio_test_region(fn, scale);
+  }
+}
+
+TEST(TestMinimgio, jpeg_rows) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".jpg";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint8_t>(&original_img, 3, 300, 205);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &original_img));
+  minimgio_test_rows(fn, 16);
+  minimgio_test_rows(fn, 1);
+}
+
 TEST(TestMinimgio, tiff_props) {
   minimgio_test_props(IFF_JPEG, ".jpeg");
 }
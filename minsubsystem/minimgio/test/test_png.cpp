@@ -1,4 +1,5 @@
 #include "common.hpp"
+#include <minimgio/contrib.h>
 
 
 static void test_png(MinImg const& original_img)
@@ -137,6 +138,122 @@ TEST(TestMinimgio, png_memory) {
   ASSERT_EQ(NO_ERRORS, CompareMinImages(&in_memory_img, &original_img));
 }
 
+static long get_file_size(const std::string &fn) {
+  std::ifstream file(fn.c_str(), std::ios::binary | std::ios::ate);
+  return static_cast<long>(file.tellg());
+}
+
+TEST(TestMinimgio, png_parallel) {
+  SKIP_IF(!tmp_is_writeable);
+  DECLARE_GUARDED_MINIMG(rgb_img);
+  create_test_image<uint8_t>(&rgb_img, 3, 1202, 600);
+  DECLARE_GUARDED_MINIMG(gray_img);
+  create_test_image<uint16_t>(&gray_img, 1, 1202, 600);
+  DECLARE_GUARDED_MINIMG(binary_img);
+  create_test_image<bool>(&binary_img, 1, 4000, 2200);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".png";
+  FileRemover file_remover(fn);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &rgb_img));
+  const long serial_size = get_file_size(fn);
+
+  // Large images are compressed by bands in parallel.
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(4));
+  test_png(rgb_img);
+  test_png(gray_img);
+  test_png(binary_img);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &rgb_img));
+  EXPECT_GE(serial_size * 21 / 20, get_file_size(fn));
+
+  se::image_io::ExtensibleBufferOutputStream output;
+  ASSERT_EQ(0, se::image_io::EncodeImage(
+      rgb_img, se::image_io::FORMAT_PNG, output));
+  char mem_path[64] = {0};
+  sprintf(mem_path, "mem://%p.%lu", static_cast<const void *>(output.GetBuffer()),
+          static_cast<unsigned long>(output.WrittenBytes()));
+  DECLARE_GUARDED_MINIMG(loaded_image);
+  ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&loaded_image, mem_path));
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&loaded_image));
+  ASSERT_EQ(NO_ERRORS, LoadMinImage(&loaded_image, mem_path));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, &rgb_img));
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(1));
+}
+
+TEST(TestMinimgio, png_region) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".png";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(rgb_img);
+  create_test_image<uint8_t>(&rgb_img, 3, 600, 296);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &rgb_img));
+  for (int scale = 1; scale <= 8; scale *= 2)
+    minimgio_test_region(fn, scale);
+
+  DECLARE_GUARDED_MINIMG(gray_img);
+  create_test_image<uint16_t>(&gray_img, 1, 600, 296);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &gray_img));
+  minimgio_test_region(fn, 2);
+
+  DECLARE_GUARDED_MINIMG(binary_img);
+  create_test_image<bool>(&binary_img, 1, 600, 296);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &binary_img));
+  minimgio_test_region(fn, 1);
+}
+
+TEST(TestMinimgio, png_region_partial_blocks) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".png";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(gradient);
+  gradient.width = 10;
+  gradient.height = 10;
+  gradient.channels = 1;
+  gradient.channelDepth = 1;
+  gradient.format = FMT_UINT;
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&gradient));
+  for (int y = 0; y < gradient.height; ++y)
+    for (int x = 0; x < gradient.width; ++x)
+      gradient.pScan0[y * gradient.stride + x] = static_cast<uint8_t>(x * 20);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &gradient));
+
+  // The last column of blocks holds two pixels and averages only those.
+  DECLARE_GUARDED_MINIMG(reduced);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&reduced, &gradient, AO_EMPTY));
+  reduced.width = 3;
+  reduced.height = 3;
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&reduced));
+  ASSERT_EQ(NO_ERRORS, LoadMinImageRegion(&reduced, fn.c_str(), 0, NULL, 4));
+  const uint8_t expected[] = {30, 110, 170};
+  for (int y = 0; y < reduced.height; ++y)
+    for (int x = 0; x < reduced.width; ++x)
+      EXPECT_EQ(expected[x], reduced.pScan0[y * reduced.stride + x]) << x << y;
+
+  DECLARE_GUARDED_MINIMG(block);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&block, &gradient, AO_EMPTY));
+  block.width = 1;
+  block.height = 1;
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&block));
+  const MinRect roi = minRect(4, 0, 4, 4);
+  ASSERT_EQ(NO_ERRORS, LoadMinImageRegion(&block, fn.c_str(), 0, &roi, 4));
+  EXPECT_EQ(110, block.pScan0[0]);
+
+  DECLARE_GUARDED_MINIMG(odd_img);
+  create_test_image<uint8_t>(&odd_img, 3, 603, 301);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &odd_img));
+  for (int scale = 2; scale <= 8; scale *= 2)
+    minimgio_test_region(fn, scale);
+}
+
+TEST(TestMinimgio, png_rows) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".png";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint16_t>(&original_img, 3, 300, 205);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &original_img));
+  minimgio_test_rows(fn, 16);
+  minimgio_test_rows(fn, 205);
+}
+
 TEST(TestMinimgio, png_props) {
   minimgio_test_props(IFF_PNG, ".png");
 }
@@ -1,5 +1,11 @@
 #include "common.hpp"
 #include "quantile_diff.hpp"
+#include <minimgio/contrib.h>
+#include <minimgio/device.h>
+#include <tiffio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 static void test_tiff(MinImg const& original_img)
 {
@@ -128,6 +134,312 @@ MINIMGIO_COMP_TEST(RLE, bool);
 MINIMGIO_COMP_TEST(GROUP3, bool);
 MINIMGIO_COMP_TEST(GROUP4, bool);
 
+TEST(TestMinimgio, tiff_memory) {
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint16_t>(&original_img, 3);
+
+  se::image_io::ExtensibleBufferOutputStream output;
+  ASSERT_EQ(0, se::image_io::EncodeImage(
+      original_img, se::image_io::FORMAT_TIFF, output));
+  ASSERT_LT(0, output.WrittenBytes());
+
+  char mem_path[64] = {0};
+  sprintf(mem_path, "mem://%p.%lu", static_cast<const void *>(output.GetBuffer()),
+          static_cast<unsigned long>(output.WrittenBytes()));
+  ASSERT_EQ(IFF_TIFF, GuessImageFileFormat(mem_path));
+  ASSERT_EQ(1, GetMinImageFilePages(mem_path));
+  DECLARE_GUARDED_MINIMG(loaded_image);
+  ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&loaded_image, mem_path));
+  ASSERT_EQ(NO_ERRORS, CompareMinImagePrototypes(&loaded_image, &original_img));
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&loaded_image));
+  ASSERT_EQ(NO_ERRORS, LoadMinImage(&loaded_image, mem_path));
+  ASSERT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, &original_img));
+
+  // Saving into a fixed block fails if it is too small.
+  std::vector<uint8_t> block(2 * output.WrittenBytes());
+  ExtImgProps props = {IFF_TIFF, IFC_PACKBITS, 0.f, 0.f, 0};
+  sprintf(mem_path, "mem://%p.%lu", static_cast<void *>(&block[0]), 1024ul);
+  ASSERT_NE(NO_ERRORS, SaveMinImageEx(mem_path, &original_img, &props));
+  sprintf(mem_path, "mem://%p.%lu", static_cast<void *>(&block[0]),
+          static_cast<unsigned long>(block.size()));
+  ASSERT_EQ(NO_ERRORS, SaveMinImageEx(mem_path, &original_img, &props));
+  ASSERT_EQ(NOT_IMPLEMENTED, SaveMinImageEx(mem_path, &original_img, &props, 1));
+  ExtImgProps loaded_props;
+  ASSERT_EQ(NO_ERRORS, GetMinImageFilePropsEx(NULL, &loaded_props, mem_path));
+  ASSERT_EQ(IFC_PACKBITS, loaded_props.comp);
+  ASSERT_EQ(NO_ERRORS, LoadMinImage(&loaded_image, mem_path));
+  ASSERT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, &original_img));
+}
+
+TEST(TestMinimgio, tiff_tiled) {
+  SKIP_IF(!tmp_is_writeable);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint8_t>(&original_img, 3);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+
+  const int tile_width = 64, tile_height = 48;
+  TIFF *tif = TIFFOpen(fn.c_str(), "w");
+  ASSERT_TRUE(tif != NULL);
+  TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, original_img.width);
+  TIFFSetField(tif, TIFFTAG_IMAGELENGTH, original_img.height);
+  TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
+  TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, original_img.channels);
+  TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+  TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+  TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_PACKBITS);
+  TIFFSetField(tif, TIFFTAG_TILEWIDTH, tile_width);
+  TIFFSetField(tif, TIFFTAG_TILELENGTH, tile_height);
+  const int row_size = tile_width * original_img.channels;
+  std::vector<uint8_t> tile(row_size * tile_height);
+  for (int y0 = 0; y0 < original_img.height; y0 += tile_height)
+    for (int x0 = 0; x0 < original_img.width; x0 += tile_width) {
+      std::fill(tile.begin(), tile.end(), 0);
+      const int cols = std::min(tile_width, original_img.width - x0);
+      for (int y = y0; y < std::min(y0 + tile_height, original_img.height); ++y)
+        ::memcpy(&tile[(y - y0) * row_size],
+                 GetMinImageLineAs<uint8_t>(&original_img, y) +
+                     x0 * original_img.channels,
+                 cols * original_img.channels);
+      ASSERT_LT(0, TIFFWriteEncodedTile(tif, TIFFComputeTile(tif, x0, y0, 0, 0),
+                                        &tile[0], tile.size()));
+    }
+  TIFFClose(tif);
+
+  DECLARE_GUARDED_MINIMG(loaded_image);
+  ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&loaded_image, fn.c_str()));
+  ASSERT_EQ(NO_ERRORS, CompareMinImagePrototypes(&loaded_image, &original_img));
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&loaded_image));
+  ASSERT_EQ(NO_ERRORS, LoadMinImage(&loaded_image, fn.c_str()));
+  ASSERT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, &original_img));
+  minimgio_test_region(fn, 1);
+  minimgio_test_rows(fn, 7);
+}
+
+TEST(TestMinimgio, tiff_region) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint8_t>(&original_img, 3, 600, 296);
+  ExtImgProps props = {IFF_TIFF, IFC_LZW, 0.f, 0.f, 0};
+  ASSERT_EQ(NO_ERRORS, SaveMinImageEx(fn.c_str(), &original_img, &props));
+  for (int scale = 1; scale <= 8; scale *= 2)
+    minimgio_test_region(fn, scale);
+
+  // The last blocks of a reduced image are cut off by the image edges.
+  DECLARE_GUARDED_MINIMG(odd_img);
+  create_test_image<uint8_t>(&odd_img, 3, 603, 301);
+  ASSERT_EQ(NO_ERRORS, SaveMinImageEx(fn.c_str(), &odd_img, &props));
+  for (int scale = 2; scale <= 8; scale *= 2)
+    minimgio_test_region(fn, scale);
+
+  DECLARE_GUARDED_MINIMG(binary_img);
+  create_test_image<bool>(&binary_img, 1, 600, 296);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &binary_img));
+  minimgio_test_region(fn, 1);
+  minimgio_test_region(fn, 4);
+}
+
+TEST(TestMinimgio, tiff_rows) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint8_t>(&original_img, 3, 600, 296);
+  ExtImgProps props = {IFF_TIFF, IFC_LZW, 0.f, 0.f, 0};
+  ASSERT_EQ(NO_ERRORS, SaveMinImageEx(fn.c_str(), &original_img, &props));
+  minimgio_test_rows(fn, 16);
+  minimgio_test_rows(fn, 1000);
+}
+
+TEST(TestMinimgio, tiff_parallel) {
+  SKIP_IF(!tmp_is_writeable);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint16_t>(&original_img, 3, 1202, 600);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  ExtImgProps props = {IFF_TIFF, IFC_PACKBITS, 0.f, 0.f, 0};
+  ASSERT_EQ(NO_ERRORS, SaveMinImageEx(fn.c_str(), &original_img, &props));
+
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(4));
+  // Contiguous rows are decoded in place, padded ones through a buffer.
+  const int alignments[] = {2, 64};
+  for (int i = 0; i < 2; ++i) {
+    DECLARE_GUARDED_MINIMG(loaded_image);
+    EXPECT_EQ(NO_ERRORS, GetMinImageFileProps(&loaded_image, fn.c_str()));
+    EXPECT_EQ(NO_ERRORS, AllocMinImage(&loaded_image, alignments[i]));
+    EXPECT_EQ(NO_ERRORS, LoadMinImage(&loaded_image, fn.c_str()));
+    EXPECT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, &original_img));
+  }
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(1));
+}
+
+static void check_tiff_pages(const std::string &fn, const MinImg *imgs, int n) {
+  ASSERT_EQ(n, GetMinImageFilePages(fn.c_str()));
+  for (int page = 0; page < n; ++page) {
+    DECLARE_GUARDED_MINIMG(loaded_image);
+    ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&loaded_image, fn.c_str(), page));
+    ASSERT_EQ(NO_ERRORS, CompareMinImagePrototypes(&loaded_image, imgs + page));
+    ASSERT_EQ(NO_ERRORS, AllocMinImage(&loaded_image));
+    ASSERT_EQ(NO_ERRORS, LoadMinImage(&loaded_image, fn.c_str(), page));
+    ASSERT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, imgs + page));
+  }
+}
+
+TEST(TestMinimgio, tiff_writer) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  const int n = 7;
+  MinImg imgs[n] = {};
+  for (int k = 0; k < n; ++k) {
+    if (k % 3 == 2)
+      create_test_image<uint16_t>(imgs + k, 1, 100 + k, 60);
+    else
+      create_test_image<uint8_t>(imgs + k, 1 + 2 * (k % 2), 120, 50 + k);
+  }
+  ExtImgProps props = {IFF_TIFF, IFC_PACKBITS, 0.f, 0.f, 0};
+
+  for (int background = 0; background < 2; ++background) {
+    MinImageWriter *writer = NULL;
+    ASSERT_EQ(NO_ERRORS, OpenMinImageWriter(&writer, fn.c_str(), IFF_UNKNOWN,
+                                            background));
+    for (int k = 0; k < n; ++k)
+      EXPECT_EQ(NO_ERRORS, AddMinImageWriterPage(writer, imgs + k, &props));
+    ASSERT_EQ(NO_ERRORS, CloseMinImageWriter(writer));
+    check_tiff_pages(fn, imgs, n);
+  }
+
+  // A failed page breaks the file, so the writer keeps reporting the error.
+  MinImg broken = imgs[0];
+  broken.format = static_cast<MinFmt>(-1);
+  MinImageWriter *failed_writer = NULL;
+  ASSERT_EQ(NO_ERRORS, OpenMinImageWriter(&failed_writer, fn.c_str()));
+  EXPECT_EQ(NO_ERRORS, AddMinImageWriterPage(failed_writer, imgs, &props));
+  EXPECT_EQ(BAD_ARGS, AddMinImageWriterPage(failed_writer, &broken, &props));
+  EXPECT_EQ(BAD_ARGS, AddMinImageWriterPage(failed_writer, imgs, &props));
+  EXPECT_EQ(BAD_ARGS, CloseMinImageWriter(failed_writer));
+
+  ASSERT_EQ(NO_ERRORS, SaveMinImagePages(fn.c_str(), imgs, n - 2, &props));
+  check_tiff_pages(fn, imgs, n - 2);
+
+  MinImageWriter *writer = NULL;
+  ASSERT_EQ(NOT_IMPLEMENTED, OpenMinImageWriter(&writer, "pages.png"));
+  for (int k = 0; k < n; ++k)
+    FreeMinImage(imgs + k);
+}
+
+TEST(TestMinimgio, tiff_opened_file) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  MinImg imgs[2] = {};
+  create_test_image<uint8_t>(imgs, 3);
+  create_test_image<uint16_t>(imgs + 1, 1, 200, 100);
+  ASSERT_EQ(NO_ERRORS, SaveMinImagePages(fn.c_str(), imgs, 2));
+
+  MinImageFile *file = NULL;
+  ASSERT_EQ(NO_ERRORS, OpenMinImageFile(&file, fn.c_str()));
+  // The file is read once when opened.
+  std::remove(fn.c_str());
+  EXPECT_EQ(2, GetOpenedMinImagePages(file));
+  for (int page = 1; page >= 0; --page) {
+    DECLARE_GUARDED_MINIMG(loaded_image);
+    ExtImgProps props;
+    EXPECT_EQ(NO_ERRORS, GetOpenedMinImageProps(&loaded_image, &props, file, page));
+    EXPECT_EQ(IFF_TIFF, props.iff);
+    EXPECT_EQ(NO_ERRORS, CompareMinImagePrototypes(&loaded_image, imgs + page));
+    EXPECT_EQ(NO_ERRORS, AllocMinImage(&loaded_image));
+    EXPECT_EQ(BAD_ARGS, GetOpenedMinImageProps(&loaded_image, NULL, file, page));
+    EXPECT_EQ(NO_ERRORS, LoadOpenedMinImage(&loaded_image, file, page));
+    EXPECT_EQ(NO_ERRORS, CompareMinImages(&loaded_image, imgs + page));
+  }
+  EXPECT_EQ(NO_ERRORS, CloseMinImageFile(file));
+  EXPECT_EQ(FILE_ERROR, OpenMinImageFile(&file, fn.c_str()));
+  FreeMinImage(imgs);
+  FreeMinImage(imgs + 1);
+}
+
+TEST(TestMinimgio, tiff_mapped) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  DECLARE_GUARDED_MINIMG(original_img);
+  create_test_image<uint16_t>(&original_img, 3, 300, 200);
+  ASSERT_EQ(NO_ERRORS, SaveMinImage(fn.c_str(), &original_img));
+
+  DECLARE_GUARDED_MINIMG(mapped_img);
+  ASSERT_EQ(NO_ERRORS, MapMinImage(&mapped_img, fn.c_str()));
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&mapped_img, &original_img));
+  EXPECT_EQ(BAD_ARGS, MapMinImage(&mapped_img, fn.c_str()));
+
+  ExtImgProps props = {IFF_TIFF, IFC_LZW, 0.f, 0.f, 0};
+  ASSERT_EQ(NO_ERRORS, SaveMinImageEx(fn.c_str(), &original_img, &props));
+  MinImg compressed_img = {};
+  EXPECT_EQ(NOT_SUPPORTED, MapMinImage(&compressed_img, fn.c_str()));
+  EXPECT_EQ(NULL, compressed_img.pScan0);
+}
+
+static void check_replay(const std::string &device_name, int n_frames) {
+  char uri[64] = {0};
+  ASSERT_EQ(NO_ERRORS, OpenStream(DSS_REPLAY, device_name.c_str(), uri,
+                                  sizeof(uri)));
+  char value[32] = {0};
+  EXPECT_EQ(NO_ERRORS, GetStreamProperty(uri, SP_FRAMESIZE, value, 32));
+  EXPECT_STREQ("64x32", value);
+  EXPECT_EQ(NOT_SUPPORTED, GetStreamProperty(uri, SP_GAIN, value, 32));
+  EXPECT_EQ(NO_ERRORS, SetStreamProperty(uri, SP_FRAMESIZE, "64x32"));
+  EXPECT_EQ(NOT_SUPPORTED, SetStreamProperty(uri, SP_FRAMESIZE, "32x32"));
+
+  DECLARE_GUARDED_MINIMG(frame);
+  ASSERT_EQ(NO_ERRORS, GetMinImageFileProps(&frame, uri));
+  ASSERT_EQ(64, frame.width);
+  ASSERT_EQ(32, frame.height);
+  ASSERT_EQ(NO_ERRORS, AllocMinImage(&frame));
+  for (int i = 0; i < 3 * n_frames; ++i) {
+    ASSERT_EQ(NO_ERRORS, LoadMinImage(&frame, uri));
+    EXPECT_EQ(10 * (i % n_frames), frame.pScan0[frame.stride + 1]);
+  }
+
+  ASSERT_EQ(NO_ERRORS, SetStreamProperty(uri, SP_FRAMERATE, "200"));
+  EXPECT_EQ(NO_ERRORS, GetStreamProperty(uri, SP_FRAMERATE, value, 32));
+  EXPECT_EQ(200., atof(value));
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; ++i)
+    ASSERT_EQ(NO_ERRORS, LoadMinImage(&frame, uri));
+  EXPECT_LE(std::chrono::milliseconds(20),
+            std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(NO_ERRORS, CloseStream(uri));
+}
+
+TEST(TestMinimgio, tiff_replay) {
+  SKIP_IF(!tmp_is_writeable);
+  std::string const fn = std::string(std::tmpnam(NULL)) + ".tif";
+  FileRemover file_remover(fn);
+  const int n = 5;
+  MinImg imgs[n] = {};
+  for (int k = 0; k < n; ++k) {
+    // the last page has another size and is not replayed
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(imgs + k, 64, 32 + k / (n - 1), 1,
+                                              TYP_UINT8));
+    uint8_t value = static_cast<uint8_t>(10 * k);
+    ASSERT_EQ(NO_ERRORS, FillMinImage(imgs + k, &value, sizeof(value)));
+  }
+  ASSERT_EQ(NO_ERRORS, SaveMinImagePages(fn.c_str(), imgs, n));
+  for (int k = 0; k < n; ++k)
+    FreeMinImage(imgs + k);
+
+  check_replay(fn, n - 1);           // decoded once and looped
+  check_replay(fn + "\n0\n2", n - 1);  // decoded ahead into a smaller ring
+
+  char uri[64] = {0};
+  EXPECT_EQ(BAD_ARGS, OpenStream(DSS_REPLAY, "non_existing_file.tif", uri,
+                                 sizeof(uri)));
+  EXPECT_EQ(BAD_ARGS, OpenStream(DSS_REPLAY, (fn + "\nfast").c_str(), uri,
+                                 sizeof(uri)));
+}
+
 
 int main(int argc, char **argv) {
   tmp_is_writeable = check_tmp_is_writeable();
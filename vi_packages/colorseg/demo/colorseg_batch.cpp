@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi-helpers.hpp>
+#include <minimgapi/imgguard.hpp>
+#include <minimgio/minimgio.h>
+#include <mximg/list_reader.h>
+#include <vi_cvt/std/exception_macros.hpp>
+
+#include <colorseg/pipeline.h>
+#include <remseg/utils.h>
+
+#include <json-cpp/json.h>
+
+THIRDPARTY_INCLUDES_BEGIN
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+#include <tclap/CmdLine.h>
+THIRDPARTY_INCLUDES_END
+
+namespace bfs = boost::filesystem;
+
+using namespace vi::remseg;
+using namespace vi::colorseg;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point const & from)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+}
+
+// Reads the images of the batch in order: the image files of a directory or
+// the images of a .lst file, decoding the next ones in the background.
+mximg::PListReader openInput(std::string const & input, int prefetch, int threads,
+                             mximg::ListReader::LoadHook const & beforeLoad)
+{
+  if (!bfs::is_directory(input))
+  {
+    mximg::PListReader reader = mximg::ListReader::open(input, prefetch, threads, beforeLoad);
+    if (!reader)
+      throw std::runtime_error("Failed to read image list " + input);
+    return reader;
+  }
+
+  std::vector<std::string> fileNames;
+  static const char * const extensions[] = {".png", ".tif", ".tiff", ".jpg", ".jpeg", ".bmp"};
+  for (bfs::directory_iterator it(input), end; it != end; ++it)
+  {
+    if (!bfs::is_regular_file(it->status()))
+      continue;
+    std::string const ext = boost::algorithm::to_lower_copy(it->path().extension().string());
+    if (std::find(std::begin(extensions), std::end(extensions), ext) != std::end(extensions))
+      fileNames.push_back(it->path().string());
+  }
+  std::sort(fileNames.begin(), fileNames.end());
+  return std::make_shared<mximg::ListReader>(fileNames, prefetch, threads, beforeLoad);
+}
+
+// Names the result of every image after its file name with the extension kept,
+// so that a.jpg and a.png of one batch do not overwrite each other. Equal names
+// of files from different directories of a list get a numeric suffix.
+std::vector<std::string> outputNames(mximg::ListReader const & reader)
+{
+  std::vector<std::string> names(reader.size());
+  std::set<std::string> taken;
+  for (int i = 0; i < reader.size(); ++i)
+  {
+    std::string const name = bfs::path(reader.fileName(i)).filename().string();
+    std::string unique = name;
+    for (int n = 1; !taken.insert(unique).second; ++n)
+      unique = name + "." + std::to_string(n);
+    names[i] = unique + ".png";
+  }
+  return names;
+}
+
+// Limits the total estimated memory of the images being decoded or processed
+// simultaneously. Images are charged before they are decoded and in the order of
+// the batch, so an image waiting for memory never lets a later one overtake it
+// and hold the memory it waits for. An image is always admitted when nothing
+// else is in flight, so an image larger than the whole budget is still
+// processed (alone).
+class MemoryBudget
+{
+public:
+  explicit MemoryBudget(size_t limit) : limit(limit), used(0), next(0) {}
+
+  // Must be called once for every index of the batch.
+  void acquire(int index, size_t bytes)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&] { return next == index && (used == 0 || used + bytes <= limit); });
+    used += bytes;
+    charged[index] = bytes;
+    ++next;
+    lock.unlock();
+    cond.notify_all();
+  }
+
+  // Returns the memory charged for the image.
+  size_t release(int index)
+  {
+    size_t bytes = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<int, size_t>::iterator const it = charged.find(index);
+      if (it == charged.end())
+        return 0;
+      bytes = it->second;
+      used -= bytes;
+      charged.erase(it);
+    }
+    cond.notify_all();
+    return bytes;
+  }
+
+private:
+  size_t const limit;
+  size_t used;
+  int next;
+  std::map<int, size_t> charged;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+} // namespace
+
+int main(int argc, const char *argv[])
+{
+  TCLAP::CmdLine cmd("Run Range-Based Region Merge Segmentation on a directory or a list of images");
+  TCLAP::UnlabeledValueArg<std::string> input("input", "directory with RGB-images or .lst file", true, "", "string", cmd);
+  TCLAP::ValueArg<std::string> output("o", "output", "path to output dir", false, ".", "string", cmd);
+  TCLAP::ValueArg<int> threads("t", "threads", "number of worker threads (0 - hardware concurrency)", false, 0, "int", cmd);
+  TCLAP::ValueArg<int> prefetch("", "prefetch", "number of images decoded ahead (0 - twice the number of worker threads)", false, 0, "int", cmd);
+  TCLAP::ValueArg<int> ioThreads("", "io_threads", "number of threads decoding images ahead", false, 1, "int", cmd);
+  TCLAP::ValueArg<double> memoryLimit("m", "memory_limit", "estimated memory limit for images in flight, MB", false, 4096, "double", cmd);
+  TCLAP::ValueArg<double> errorLimit("e", "error_limit", "average error limit", false, -1, "double", cmd);
+  TCLAP::ValueArg<int> segmentsLimit("n", "segm_limit", "segments limit", false, -1, "int", cmd);
+  TCLAP::ValueArg<double> blockingThresh("g", "blocking_thresh", "blocking threshold value", false, 1, "double", cmd);
+  TCLAP::ValueArg<double> maxModelDistance("", "model_distance", "model distance", false, 20, "double", cmd);
+  TCLAP::ValueArg<double> glareThresh("", "glare_thresh", "glare threshold", false, 230, "double", cmd);
+  TCLAP::SwitchArg prefilter("p", "prefilter", "use image pre-filtering", cmd, false);
+  TCLAP::ValueArg<double> prefilterSigmaSpatial("", "prefilter_sigma_s", "pre-filtering spatial sigma", false, 5, "double", cmd);
+  TCLAP::ValueArg<double> prefilterSigmaRange("", "prefilter_sigma_r", "pre-filtering range sigma", false, 50, "double", cmd);
+
+  cmd.parse(argc, argv);
+
+  PipelineParams params;
+  params.errorLimit = errorLimit.getValue();
+  params.segmentsLimit = segmentsLimit.getValue();
+  params.blockingThresh = blockingThresh.getValue();
+  params.glareThresh = glareThresh.getValue();
+  params.vertexParams.maxModelDistance = maxModelDistance.getValue();
+  if (prefilter.getValue())
+    params.prefilter.type = PREFILTER_DOMAIN_TRANSFORM;
+  params.prefilter.sigmaSpatial = prefilterSigmaSpatial.getValue();
+  params.prefilter.sigmaRange = prefilterSigmaRange.getValue();
+  // images are already processed in parallel
+  params.prefilter.threads = 1;
+
+  if (!bfs::is_directory(output.getValue()))
+  {
+    std::cerr << "Failed to find output directory " << output.getValue() << "\n";
+    return 1;
+  }
+
+  int numThreads = threads.getValue();
+  if (numThreads <= 0)
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  int const numPrefetched = prefetch.getValue() > 0 ? prefetch.getValue() : 2 * numThreads;
+
+  // The image is charged to the budget by the reader before it is decoded and
+  // released by the worker when its result is saved. The estimate comes from
+  // the file header; files whose header cannot be read are charged nothing and
+  // fail to load.
+  MemoryBudget budget(static_cast<size_t>(memoryLimit.getValue() * 1024 * 1024));
+  auto charge = [&budget](int index, std::string const & fileName)
+  {
+    size_t estimated = 0;
+    MinImg props = {};
+    if (GetMinImageFileProps(&props, fileName.c_str()) == NO_ERRORS)
+      estimated = estimatePipelineMemory(props.width, props.height, props.channels);
+    budget.acquire(index, estimated);
+  };
+
+  mximg::PListReader reader;
+  try
+  {
+    reader = openInput(input.getValue(), numPrefetched, ioThreads.getValue(), charge);
+  }
+  catch (std::exception const& e)
+  {
+    std::cerr << "Exception caught: " << e.what() << "\n";
+    return 1;
+  }
+  numThreads = std::min(numThreads, std::max(reader->size(), 1));
+  std::vector<std::string> const resultNames = outputNames(*reader);
+
+  std::string const metricsFilename = bfs::absolute("metrics.jsonl", output.getValue()).string();
+  std::ofstream metrics(metricsFilename);
+  if (!metrics)
+  {
+    std::cerr << "Failed to open " << metricsFilename << "\n";
+    return 1;
+  }
+  std::mutex metricsMutex;
+
+  std::atomic<int> failed(0);
+
+  auto worker = [&](int threadId)
+  {
+    Pipeline pipeline;
+    Json::FastWriter writer;
+    mximg::PImage image;
+    int i = 0;
+    // load_ms is the time spent waiting for the image decoded in the background
+    Clock::time_point start = Clock::now();
+    while (reader->read(image, &i))
+    {
+      std::string const & file = reader->fileName(i);
+      Json::Value record;
+      record["image"] = file;
+      record["thread"] = threadId;
+      record["load_ms"] = elapsedMs(start);
+
+      try
+      {
+        if (mximg::is_empty(image))
+          throw std::runtime_error("Failed to load image " + file);
+        MinImg const * minImage = *image;
+        if (minImage->channels != 3)
+          throw std::runtime_error("Image should have exact 3 channels for color segmentation");
+        record["width"] = minImage->width;
+        record["height"] = minImage->height;
+
+        Clock::time_point const segmentStart = Clock::now();
+        const ImageMap &imageMap = pipeline.run(minImage, params);
+        record["segment_ms"] = elapsedMs(segmentStart);
+        record["segments"] = pipeline.numberOfSegments();
+
+        Clock::time_point const saveStart = Clock::now();
+        std::string const imgres_filename = bfs::absolute(resultNames[i], output.getValue()).string();
+        record["output"] = resultNames[i];
+        DECLARE_GUARDED_MINIMG(imgres);
+        visualize(&imgres, imageMap);
+        THROW_ON_MINERR(SaveMinImage(imgres_filename.c_str(), &imgres));
+        record["save_ms"] = elapsedMs(saveStart);
+      }
+      catch (std::exception const& e)
+      {
+        record["error"] = e.what();
+        ++failed;
+      }
+      catch (...)
+      {
+        record["error"] = "UNTYPED exception";
+        ++failed;
+      }
+      image.reset();
+      record["estimated_bytes"] = Json::UInt64(budget.release(i));
+      record["total_ms"] = elapsedMs(start);
+
+      std::string const line = writer.write(record);
+      {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        metrics << line;
+        metrics.flush();
+      }
+      start = Clock::now();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < numThreads; ++t)
+    pool.emplace_back(worker, t);
+  worker(0);
+  for (auto & thread : pool)
+    thread.join();
+
+  std::cout << reader->size() << " images processed, " << failed << " failed\n";
+  return failed ? 2 : 0;
+}
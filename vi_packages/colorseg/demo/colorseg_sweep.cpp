@@ -0,0 +1,115 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi-helpers.hpp>
+#include <minimgapi/imgguard.hpp>
+#include <minimgio/minimgio.h>
+#include <mximg/image.h>
+#include <vi_cvt/std/exception_macros.hpp>
+
+#include <colorseg/sweep.h>
+#include <remseg/utils.h>
+
+#include <json-cpp/json.h>
+
+THIRDPARTY_INCLUDES_BEGIN
+#include <boost/filesystem.hpp>
+#include <tclap/CmdLine.h>
+THIRDPARTY_INCLUDES_END
+
+namespace bfs = boost::filesystem;
+
+using namespace vi::remseg;
+using namespace vi::colorseg;
+
+int main(int argc, const char *argv[])
+{
+  TCLAP::CmdLine cmd("Run Range-Based Region Merge Segmentation on a single image for a grid of parameters");
+  TCLAP::UnlabeledValueArg<std::string> imagePath("image", "path to source RGB-image in tif-convertible format", true, "", "string", cmd);
+  TCLAP::ValueArg<std::string> output("o", "output", "path to output dir", false, ".", "string", cmd);
+  TCLAP::ValueArg<int> threads("t", "threads", "number of worker threads (0 - hardware concurrency)", false, 0, "int", cmd);
+  TCLAP::MultiArg<double> errorLimit("e", "error_limit", "average error limit (repeat for several values)", false, "double", cmd);
+  TCLAP::MultiArg<int> segmentsLimit("n", "segm_limit", "segments limit (repeat for several values)", false, "int", cmd);
+  TCLAP::MultiArg<double> blockingThresh("g", "blocking_thresh", "blocking threshold value (repeat for several values)", false, "double", cmd);
+  TCLAP::MultiArg<double> maxModelDistance("", "model_distance", "model distance (repeat for several values)", false, "double", cmd);
+  TCLAP::MultiArg<double> glareThresh("", "glare_thresh", "glare threshold (repeat for several values)", false, "double", cmd);
+  TCLAP::SwitchArg prefilter("p", "prefilter", "use image pre-filtering", cmd, false);
+  TCLAP::ValueArg<double> prefilterSigmaSpatial("", "prefilter_sigma_s", "pre-filtering spatial sigma", false, 5, "double", cmd);
+  TCLAP::ValueArg<double> prefilterSigmaRange("", "prefilter_sigma_r", "pre-filtering range sigma", false, 50, "double", cmd);
+
+  cmd.parse(argc, argv);
+
+  SweepGrid grid;
+  grid.errorLimit = errorLimit.getValue();
+  grid.segmentsLimit = segmentsLimit.getValue();
+  grid.blockingThresh = blockingThresh.getValue();
+  grid.maxModelDistance = maxModelDistance.getValue();
+  grid.glareThresh = glareThresh.getValue();
+  if (prefilter.getValue())
+    grid.base.prefilter.type = PREFILTER_DOMAIN_TRANSFORM;
+  grid.base.prefilter.sigmaSpatial = prefilterSigmaSpatial.getValue();
+  grid.base.prefilter.sigmaRange = prefilterSigmaRange.getValue();
+
+  if (!bfs::is_directory(output.getValue()))
+  {
+    std::cerr << "Failed to find output directory " << output.getValue() << "\n";
+    return 1;
+  }
+
+  std::string const basename = bfs::path(imagePath.getValue()).stem().string();
+  std::string const resultsFilename = bfs::absolute(basename + ".sweep.jsonl", output.getValue()).string();
+
+  try
+  {
+    mximg::PImage image = mximg::Image::imread(imagePath.getValue().c_str());
+    if ((*image)->channels != 3)
+      throw std::runtime_error("Image should have exact 3 channels for color segmentation");
+
+    std::ofstream results(resultsFilename);
+    if (!results)
+      throw std::runtime_error("Failed to open " + resultsFilename);
+    Json::FastWriter writer;
+
+    std::vector<PipelineParams> const combinations = grid.combinations();
+    SweepStats const stats = sweep(*image, combinations,
+      [&](size_t index, PipelineParams const & params, ImageMap const & imageMap, int segments)
+      {
+        std::string const imgres_filename =
+          bfs::absolute(basename + "." + std::to_string(index) + ".png", output.getValue()).string();
+        DECLARE_GUARDED_MINIMG(imgres);
+        visualize(&imgres, imageMap);
+        THROW_ON_MINERR(SaveMinImage(imgres_filename.c_str(), &imgres));
+
+        Json::Value record;
+        record["index"] = Json::UInt64(index);
+        record["output"] = imgres_filename;
+        record["error_limit"] = params.errorLimit;
+        record["segm_limit"] = params.segmentsLimit;
+        record["blocking_thresh"] = params.blockingThresh;
+        record["model_distance"] = params.vertexParams.maxModelDistance;
+        record["glare_thresh"] = params.glareThresh;
+        record["segments"] = segments;
+        results << writer.write(record);
+      }, threads.getValue());
+
+    std::cout << combinations.size() << " combinations: "
+              << stats.prefilterRuns << " prefilter, "
+              << stats.pointlikeRuns << " pointlike, "
+              << stats.linearRuns << " linear, "
+              << stats.planarRuns << " planar runs\n";
+  }
+  catch (std::exception const& e)
+  {
+    std::cerr << "Exception caught: " << e.what() << "\n";
+    return 1;
+  }
+  catch (...)
+  {
+    std::cerr << "UNTYPED exception\n";
+    return 2;
+  }
+
+  return 0;
+}
@@ -48,10 +48,35 @@ using namespace remseg;
 
 namespace colorseg {
 
+// Parameters of a color segmentation run. A copy is owned by each Segmentator
+// and shared by its vertices, so runs with different parameters can go in
+// parallel threads.
+struct ColorSegParams
+{
+  double homographyA = 0.0;
+  double homographyK = 3.0;
+  double maxModelDistance = 20;
+
+  bool isIdentityHomography() const { return homographyA == 0 && homographyK == 0; }
+
+  static const ColorSegParams & defaults();
+};
+
 class ColorVertex : public Vertex
 {
 public:
-  long double **channelsSumOfSquares;
+  typedef ColorSegParams Params;
+
+  // Exact second moments: the unique terms of the symmetric 3x3 matrix of
+  // sums of channel products (00, 01, 02, 11, 12, 22). Like the channel sums
+  // they are integers, so absorbing vertices is exact and order-independent;
+  // floating point is used only in updateHelperStats() and channelMean().
+  uint64_t channelsSumOfSquares[6];
+
+  // Pixels mapped by a non-identity homography are accumulated in fixed point
+  // with this many fraction bits. The mapped values stay below 3 * 255, so the
+  // sums of products of a 2^32 pixel segment still fit 64 bits.
+  static const int homographyFractionBits = 6;
 
   struct HelperStats
   {
@@ -65,40 +90,37 @@ public:
 
   ColorVertex() :
     Vertex()
-  , channelsSumOfSquares(0)
+  , channelsSumOfSquares()
+  , params(&ColorSegParams::defaults())
   , needToUpdate(false)
   {}
 
   ColorVertex(const ColorVertex* v);
 
-  ~ColorVertex();
-
   void Initialize(int _channelsNum) override;
+  void reset() override;
   void update(const uint8_t * pix) override;
   void absorb(Vertex *to_be_absorbed) override;
+  double channelMean(int i) const override;
 
   const HelperStats & getHelperStats() const;
 
   Json::Value jsonLog() const override;
 
-  static double getHomographyA() { return homographyA; }
-  static double getHomographyK() { return homographyK; }
-  static void setHomographyA(double d) { homographyA = d; }
-  static void setHomographyK(double d) { homographyK = d; }
-
-  static double getMaxModelDistance() { return maxModelDistance; }
-  static void setMaxModelDistance(double d) { maxModelDistance = d; }
+  void setParams(const Params * p) { params = p; }
+  const Params & getParams() const { return *params; }
 
 private:
+  const Params * params;
+
   mutable HelperStats helperStats;
 
   mutable bool needToUpdate;
 
-  static double homographyA;
-  static double homographyK;
-  static double maxModelDistance;
-
   void updateHelperStats() const;
+
+  // the value of one unit of the channel sums
+  double sumScale() const;
 };
 
 }}	// ns vi::colorseg
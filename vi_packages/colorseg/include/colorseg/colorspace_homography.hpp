@@ -114,4 +114,18 @@ inline void homography(double * dst, uint8_t const * src, double a, double k)
   dst[2] = dst_vec[2];
 }
 
+// Fills the 4x4 matrix (row by row) of homography() for colors normalized to [0, 1],
+// as used by TransformMinImageColorsProjectively() to transform whole images.
+inline void homographyMatrix(double * matrix, double a, double k)
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+      matrix[4 * i + j] = (k + 1) * (i == j ? 1 : a);
+    matrix[4 * i + 3] = 0;
+    matrix[12 + i] = k;
+  }
+  matrix[15] = 1;
+}
+
 }} // ns vi::colorseg
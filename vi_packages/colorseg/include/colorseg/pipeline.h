@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2012-2018, Visillect Service LLC. All rights reserved.
+Developed for Kharkevich Institute for Information Transmission Problems of the
+              Russian Academy of Sciences (IITP RAS).
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+
+#include <colorseg/color_vertex.h>
+#include <colorseg/prefilter.h>
+#include <remseg/segmentator.hpp>
+
+#include <i8r/i8r.h>
+
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <utility>
+
+namespace vi { namespace colorseg {
+
+// Parameters of the whole color segmentation pipeline.
+struct PipelineParams
+{
+  double errorLimit = -1;
+  int segmentsLimit = -1;
+  double blockingThresh = 1;
+  double glareThresh = 230;
+  ColorSegParams vertexParams;
+  PrefilterParams prefilter;
+};
+
+double KL(Eigen::Vector3d const & mean1, Eigen::Vector3d const & mean2,
+          Eigen::Matrix3d const & cov1, Eigen::Matrix3d const & cov2);
+
+void obtainBlockList(std::set<std::pair<int, int> > & blockList,
+                     Segmentator<ColorVertex> const & segmentator,
+                     double threshold);
+
+void offscaleFix(Segmentator<ColorVertex> & segmentator, double threshold);
+
+// Stages of Pipeline::run. The segmentator is created on the first call and reset
+// on the following ones, so its buffers are reused.
+void pointlikeStage(std::unique_ptr<Segmentator<ColorVertex> > & segmentator,
+                    const MinImg * image, PipelineParams const & params,
+                    i8r::PLogger dbg = nullptr, int debugIter = 1, int maxSegments = -1);
+
+void linearStage(std::unique_ptr<Segmentator<ColorVertex> > & segmentator,
+                 const MinImg * image, ImageMap const & pointlikeMap,
+                 std::set<std::pair<int, int> > const & blockList, PipelineParams const & params,
+                 i8r::PLogger dbg = nullptr, int debugIter = 1, int maxSegments = -1);
+
+// Planar stage followed by offscaleFix.
+void planarStage(std::unique_ptr<Segmentator<ColorVertex> > & segmentator,
+                 const MinImg * image, ImageMap const & linearMap, PipelineParams const & params,
+                 i8r::PLogger dbg = nullptr, int debugIter = 1, int maxSegments = -1);
+
+// Rough upper estimate of the memory (in bytes) used by Pipeline::run on an image.
+size_t estimatePipelineMemory(int width, int height, int channels);
+
+// Three-stage color segmentation: pointlike, linear and planar stages followed by
+// offscaleFix. Segmentators and the prefilter buffer are kept between runs, so a
+// Pipeline per thread can process a stream of images without reallocations.
+class Pipeline
+{
+public:
+  Pipeline();
+  ~Pipeline();
+
+  Pipeline(Pipeline const&) = delete;
+  Pipeline & operator= (Pipeline const&) = delete;
+
+  // Segments a 3-channel uint8_t image. The result stays valid until the next run.
+  ImageMap const & run(const MinImg * image, PipelineParams const & params,
+                       i8r::PLogger dbg = nullptr, int debugIter = 1, int maxSegments = -1);
+
+  int numberOfSegments() const;
+
+private:
+  MinImg filtered;
+  std::unique_ptr<Segmentator<ColorVertex> > pointlike;
+  std::unique_ptr<Segmentator<ColorVertex> > linear;
+  std::unique_ptr<Segmentator<ColorVertex> > planar;
+};
+
+}}	// ns vi::colorseg
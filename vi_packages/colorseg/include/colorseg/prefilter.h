@@ -0,0 +1,69 @@
+/*
+Copyright (c) 2012-2018, Visillect Service LLC. All rights reserved.
+Developed for Kharkevich Institute for Information Transmission Problems of the
+              Russian Academy of Sciences (IITP RAS).
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#pragma once
+
+#include <minbase/minimg.h>
+
+namespace vi { namespace colorseg {
+
+enum PrefilterType
+{
+  PREFILTER_NONE,
+  PREFILTER_DOMAIN_TRANSFORM  // recursive domain transform filter (edge-preserving)
+};
+
+// Parameters of the image prefilter applied before segmentation.
+// sigmaSpatial is measured in pixels, sigmaRange in intensity units,
+// as for the bilateral filter which the domain transform approximates.
+//
+// The defaults replace cv::bilateralFilter(d = 15, sigmaColor = 50,
+// sigmaSpace = 50) formerly used by colorseg_go --prefilter. The range sigma
+// is the same. The bilateral kernel was cut to a 15 pixel window, and a
+// spatial sigma of 5 pixels covers about the same window. The output is not
+// identical to the OpenCV filter, so segmentations made with --prefilter
+// differ from those made before.
+struct PrefilterParams
+{
+  PrefilterType type = PREFILTER_NONE;
+  double sigmaSpatial = 5;
+  double sigmaRange = 50;
+  int iterations = 3;
+  int threads = 0;  // number of row bands, 0 - the minimgapi thread count (see SetMinImageThreadCount())
+};
+
+// Filters an uint8_t image src into dst (dst must be allocated and have the same
+// size and channel count as src; dst may coincide with src).
+// Throws std::runtime_error on invalid arguments.
+void prefilter(const MinImg * dst, const MinImg * src, PrefilterParams const & params);
+
+}}	// ns vi::colorseg
@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2012-2018, Visillect Service LLC. All rights reserved.
+Developed for Kharkevich Institute for Information Transmission Problems of the
+              Russian Academy of Sciences (IITP RAS).
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+
+#pragma once
+
+#include <colorseg/pipeline.h>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace vi { namespace colorseg {
+
+// Parameter grid for sweep(): every combination of the listed values is run.
+// An empty axis takes its single value from base.
+struct SweepGrid
+{
+  PipelineParams base;
+  std::vector<double> errorLimit;
+  std::vector<int> segmentsLimit;
+  std::vector<double> blockingThresh;
+  std::vector<double> maxModelDistance;
+  std::vector<double> glareThresh;
+
+  std::vector<PipelineParams> combinations() const;
+};
+
+// Number of executions of each stage during a sweep.
+struct SweepStats
+{
+  int prefilterRuns = 0;
+  int pointlikeRuns = 0;
+  int linearRuns = 0;
+  int planarRuns = 0;
+};
+
+// Receives the result for combinations[index]. Calls are serialized, but are made
+// from the worker threads; imageMap is valid only during the call.
+typedef std::function<void(size_t index, PipelineParams const & params,
+                           ImageMap const & imageMap, int segments)> SweepCallback;
+
+// Runs Pipeline on image for every parameter combination, sharing the stage
+// executions between combinations: the prefilter output is memoised by the
+// prefilter parameters, the pointlike stage by errorLimit, segmentsLimit and
+// homography, the linear stage additionally by blockingThresh. The planar stage
+// and offscaleFix run once per distinct (maxModelDistance, glareThresh) tail.
+// Independent executions of a stage run in parallel on threads threads
+// (0 - hardware concurrency). Results are identical to separate Pipeline::run calls.
+SweepStats sweep(const MinImg * image, std::vector<PipelineParams> const & combinations,
+                 SweepCallback const & onResult, int threads = 0);
+
+}}	// ns vi::colorseg
@@ -113,7 +113,7 @@ bool isLTCluster(const ColorVertex *v1, const ColorVertex *v2)
   };
 
   double minDist = *std::min_element(dists, dists + 4);
-  return minDist < ColorVertex::getMaxModelDistance();
+  return minDist < v1->getParams().maxModelDistance;
 }
 
 EdgeValue criteria_r2(const ColorVertex *v1, const ColorVertex *v2)
@@ -33,64 +33,69 @@ either expressed or implied, of copyright holders.
 #include <colorseg/color_vertex.h>
 #include <colorseg/colorspace_homography.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 
 namespace vi { namespace colorseg {
 
-double ColorVertex::homographyA = 0.0;
-double ColorVertex::homographyK = 3.0;
-double ColorVertex::maxModelDistance = 20;
+const ColorSegParams & ColorSegParams::defaults()
+{
+  static const ColorSegParams params;
+  return params;
+}
 
 ColorVertex::ColorVertex(const ColorVertex* v)
 : Vertex(v)
+, params(v->params)
 {
-  channelsSumOfSquares = new long double* [channelsNum];
-  for (int i = 0; i < channelsNum; i++)
-  {
-    channelsSumOfSquares[i] = new long double[channelsNum];
-    for (int j = 0; j < channelsNum; j++)
-      channelsSumOfSquares[i][j] = v->channelsSumOfSquares[i][j];
-  }
+  for (int i = 0; i < 6; i++)
+    channelsSumOfSquares[i] = v->channelsSumOfSquares[i];
   helperStats = v->helperStats;
   needToUpdate = v->needToUpdate;
 }
 
-ColorVertex::~ColorVertex()
+void ColorVertex::Initialize(int _channelsNum)
 {
-	if (channelsSumOfSquares != NULL)
-	{
-		for (int i = 0; i < channelsNum; i++)
-			delete[] channelsSumOfSquares[i];
-		delete [] channelsSumOfSquares;
-	}
+  assert(_channelsNum == 3);
+  Vertex::Initialize(_channelsNum);
+
+  for (int i = 0; i < 6; i++)
+    channelsSumOfSquares[i] = 0;
 }
 
-void ColorVertex::Initialize(int _channelsNum)
+void ColorVertex::reset()
 {
-    Vertex::Initialize(_channelsNum);
-
-	channelsSumOfSquares = new long double* [channelsNum];
-	for (int i = 0; i < channelsNum; i++)
-	{
-		channelsSumOfSquares[i] = new long double[channelsNum];
-		for (int j = 0; j < channelsNum; j++)
-			channelsSumOfSquares[i][j] = 0;
-	}
+  Vertex::reset();
+
+  for (int i = 0; i < 6; i++)
+    channelsSumOfSquares[i] = 0;
+  needToUpdate = false;
 }
 
 void ColorVertex::update(const uint8_t * pix)
 {
-  double pixd[3] = {(double)pix[0], (double)pix[1], (double)pix[2]};
-  homography(pixd, pix, homographyA, homographyK);
-  Vertex::update(pixd);
+  uint64_t value[3] = {pix[0], pix[1], pix[2]};
+  if (!params->isIdentityHomography())
+  {
+    double pixd[3];
+    homography(pixd, pix, params->homographyA, params->homographyK);
+    for (int i = 0; i < 3; ++i)
+      value[i] = uint64_t(std::max(0.0, std::ldexp(pixd[i], homographyFractionBits)) + 0.5);
+  }
+
+  for (int i = 0; i < 3; ++i)
+    channelsSum[i] += value[i];
+  area += 1;
 
-	Eigen::Vector3d pix_vec(pixd[0], pixd[1], pixd[2]);
-	Eigen::Matrix3d pix_sq_mat = pix_vec * pix_vec.transpose();
-	for (int i = 0; i < channelsNum; ++i)
-		for (int j = 0; j < channelsNum; ++j)
-			channelsSumOfSquares[i][j] += (long double)pix_sq_mat(i, j);
+  channelsSumOfSquares[0] += value[0] * value[0];
+  channelsSumOfSquares[1] += value[0] * value[1];
+  channelsSumOfSquares[2] += value[0] * value[2];
+  channelsSumOfSquares[3] += value[1] * value[1];
+  channelsSumOfSquares[4] += value[1] * value[2];
+  channelsSumOfSquares[5] += value[2] * value[2];
 
-    needToUpdate = true;
+  needToUpdate = true;
 }
 
 void ColorVertex::absorb(Vertex *v)
@@ -98,11 +103,20 @@ void ColorVertex::absorb(Vertex *v)
   Vertex::absorb(v);
 
   ColorVertex* cv = dynamic_cast<ColorVertex *>(v);
-	for (int i = 0; i < channelsNum; i++)
-		for (int j = 0; j < channelsNum; j++)
-			channelsSumOfSquares[i][j] += cv->channelsSumOfSquares[i][j];
+  for (int i = 0; i < 6; i++)
+    channelsSumOfSquares[i] += cv->channelsSumOfSquares[i];
+
+  needToUpdate = true;
+}
 
-    needToUpdate = true;
+double ColorVertex::sumScale() const
+{
+  return params->isIdentityHomography() ? 1.0 : std::ldexp(1.0, -homographyFractionBits);
+}
+
+double ColorVertex::channelMean(int i) const
+{
+  return double(channelsSum[i]) * sumScale() / area;
 }
 
 const ColorVertex::HelperStats & ColorVertex::getHelperStats() const
@@ -118,14 +132,19 @@ void ColorVertex::updateHelperStats() const
 
   // calculate mean and covariance matrix
   {
-    Eigen::Vector3d sum(channelsSum[0], channelsSum[1], channelsSum[2]);
+    static const int squareIndex[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+    const double scale = sumScale();
+    Eigen::Vector3d sum;
     Eigen::Matrix3d sumSquares;
     for (int i = 0; i < channelsNum; ++i)
-        for (int j = 0; j < channelsNum; ++j)
-            sumSquares(i,j) = channelsSumOfSquares[i][j];
-
-    hs.mean = sum / area;
-    hs.covariance = sumSquares / area - hs.mean * hs.mean.transpose();
+    {
+      sum(i) = double(channelsSum[i]) * scale;
+      for (int j = 0; j < channelsNum; ++j)
+        sumSquares(i,j) = double(channelsSumOfSquares[squareIndex[i][j]]) * scale * scale;
+    }
+
+    hs.mean = sum / double(area);
+    hs.covariance = sumSquares / double(area) - hs.mean * hs.mean.transpose();
   }
 
   // calculate eigen vectors
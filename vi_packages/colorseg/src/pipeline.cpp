@@ -0,0 +1,257 @@
+/*
+Copyright (c) 2012-2018, Visillect Service LLC. All rights reserved.
+Developed for Kharkevich Institute for Information Transmission Problems of the
+              Russian Academy of Sciences (IITP RAS).
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <colorseg/pipeline.h>
+
+#include <colorseg/color_distance_func.h>
+#include <colorseg/colorspace_homography.hpp>
+
+#include <minimgapi/minimgapi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace vi { namespace colorseg {
+
+double KL(Eigen::Vector3d const & mean1, Eigen::Vector3d const & mean2,
+          Eigen::Matrix3d const & cov1, Eigen::Matrix3d const & cov2)
+{
+  auto s1 = (cov2.inverse() * cov1).trace();
+  auto s2 = (mean2 - mean1).transpose() * cov2.inverse() * (mean2 - mean1);
+  auto s3 = std::log(cov2.determinant() / cov1.determinant());
+  return (s1 + s2 + s3 - 3)/ 2;
+}
+
+void obtainBlockList(std::set<std::pair<int, int> > & blockList,
+                     Segmentator<ColorVertex> const & segmentator,
+                     double threshold)
+{
+  const ImageMap &imageMap = segmentator.getImageMap();
+  auto stats = imageMap.getSegmentStats();
+  for (auto const & stat : stats)
+  {
+    SegmentID id = stat.first;
+    ColorVertex * v = segmentator.vertexById(id);
+    ColorVertex::HelperStats const & hs = v->getHelperStats();
+    std::vector<EdgeValue> dists;
+    for (auto const& n : stat.second.neighbours)
+    {
+      ColorVertex * v_n = segmentator.vertexById(n);
+      ColorVertex::HelperStats const & hs_n = v_n->getHelperStats();
+      dists.push_back(KL(hs.mean, hs_n.mean, hs.covariance, hs_n.covariance));
+    }
+
+    if (!dists.empty() && *std::min_element(dists.begin(), dists.end()) > threshold)
+      blockList.insert(stat.second.leftTopPoint);
+  }
+}
+
+void offscaleFix(Segmentator<ColorVertex> & segmentator, double threshold)
+{
+  const ImageMap &imageMap = segmentator.getImageMap();
+  auto const stats = imageMap.getSegmentStats();
+  std::set<SegmentID> merged;
+
+  for (auto const & stat : stats)
+  {
+    if (merged.find(stat.first) != merged.end())
+      continue;
+
+    ColorVertex * v = segmentator.vertexById(stat.first);
+    ColorVertex::HelperStats const & hs = v->getHelperStats();
+
+    ColorSegParams const & params = segmentator.getParams();
+    if (homographyInv(hs.mean, params.homographyA, params.homographyK).mean() < threshold)
+      continue;
+
+    if (v->size() == 1)
+    {
+      merged.insert(segmentator.getId(v->begin()->vertex));
+      segmentator.merge(v, dynamic_cast<ColorVertex*>(v->begin()->vertex));
+    }
+    else
+    {
+      std::vector<int> ids;
+      std::set<int> merged_ids;
+
+      for (ConstJoint it = v->begin(); it != v->end(); it++)
+        ids.push_back(segmentator.getId(it->vertex));
+
+      for (auto it1 = ids.begin(); it1 != ids.end(); it1++)
+      {
+        if (merged_ids.find(*it1) != merged_ids.end())
+          continue;
+
+        for (auto it2 = v->begin(); it2 != v->end(); it2++)
+        {
+          ColorVertex * v1 = segmentator.vertexById(*it1);
+          ColorVertex * v2 = dynamic_cast<ColorVertex*>(it2->vertex);
+
+          if (v1 == v2)
+            continue;
+
+          Edge * edge = 0;
+          for (auto it3 = v2->begin(); it3 != v2->end(); it3++)
+            if (dynamic_cast<ColorVertex*>(it3->vertex) == v1)
+              edge = it3->edge;
+
+          if (edge == 0)
+            continue;
+
+          if (!isLTCluster(v1, v2))
+            continue;
+
+          merged.insert(segmentator.getId(v1));
+          merged.insert(segmentator.getId(v2));
+
+          segmentator.merge(v, v1);
+          segmentator.merge(v, v2);
+
+          merged_ids.insert(*it1);
+          merged_ids.insert(segmentator.getId(v2));
+          break;
+        }
+      }
+    }
+    segmentator.updateMapping();
+  }
+}
+
+size_t estimatePipelineMemory(int width, int height, int channels)
+{
+  const size_t pixels = size_t(width) * height;
+  // the pointlike stage dominates: a vertex per pixel, whose second moments are
+  // stored inline and channel sums in one allocation, and two edges per pixel
+  const size_t vertex = sizeof(ColorVertex) +
+                        channels * sizeof(uint64_t) +
+                        2 * sizeof(void *);  // allocator overhead
+  const size_t links = 4 * (sizeof(Link) + 2 * sizeof(void *));
+  const size_t edges = 2 * sizeof(Edge);
+  const size_t maps = 3 * sizeof(SegmentID) + sizeof(int);
+  const size_t images = 2 * channels + (2 * channels + 1) * sizeof(float);  // source, filtered and prefilter buffers
+  return pixels * (vertex + links + edges + maps + images);
+}
+
+void pointlikeStage(std::unique_ptr<Segmentator<ColorVertex> > & segmentator,
+                    const MinImg * image, PipelineParams const & params,
+                    i8r::PLogger dbg, int debugIter, int maxSegments)
+{
+  if (!segmentator)
+    segmentator.reset(new Segmentator<ColorVertex>(image, shouldnotcall, criteria_r0, true, params.vertexParams));
+  else
+    segmentator->reset(image, shouldnotcall, criteria_r0, true, params.vertexParams);
+  segmentator->mergeToLimit(-1, params.errorLimit, params.segmentsLimit, dbg, debugIter, maxSegments);
+}
+
+void linearStage(std::unique_ptr<Segmentator<ColorVertex> > & segmentator,
+                 const MinImg * image, ImageMap const & pointlikeMap,
+                 std::set<std::pair<int, int> > const & blockList, PipelineParams const & params,
+                 i8r::PLogger dbg, int debugIter, int maxSegments)
+{
+  if (!segmentator)
+    segmentator.reset(new Segmentator<ColorVertex>(image, &pointlikeMap, error_r1, criteria_r1,
+                                                   blockList, BLOCK_SEGMENTS, true, params.vertexParams));
+  else
+    segmentator->reset(image, &pointlikeMap, error_r1, criteria_r1,
+                       blockList, BLOCK_SEGMENTS, true, params.vertexParams);
+  segmentator->mergeToLimit(-1, params.errorLimit * std::sqrt(2./3), params.segmentsLimit,
+                            dbg, debugIter, maxSegments);
+}
+
+void planarStage(std::unique_ptr<Segmentator<ColorVertex> > & segmentator,
+                 const MinImg * image, ImageMap const & linearMap, PipelineParams const & params,
+                 i8r::PLogger dbg, int debugIter, int maxSegments)
+{
+  if (!segmentator)
+    segmentator.reset(new Segmentator<ColorVertex>(image, &linearMap, error_r2, criteria_r2,
+                                                   {}, BLOCK_SEGMENTS, true, params.vertexParams));
+  else
+    segmentator->reset(image, &linearMap, error_r2, criteria_r2,
+                       {}, BLOCK_SEGMENTS, true, params.vertexParams);
+  segmentator->mergeToLimit(-1, params.errorLimit * std::sqrt(1./3), params.segmentsLimit,
+                            dbg, debugIter, maxSegments);
+
+  offscaleFix(*segmentator, params.glareThresh);
+}
+
+Pipeline::Pipeline()
+{
+  memset(&filtered, 0, sizeof(filtered));
+}
+
+Pipeline::~Pipeline()
+{
+  FreeMinImage(&filtered);
+}
+
+ImageMap const & Pipeline::run(const MinImg * image, PipelineParams const & params,
+                               i8r::PLogger dbg, int debugIter, int maxSegments)
+{
+  if (image->channels != 3)
+    throw std::runtime_error("Image should have exact 3 channels for color segmentation");
+
+  const MinImg * src = image;
+  if (params.prefilter.type != PREFILTER_NONE)
+  {
+    if (filtered.width != image->width || filtered.height != image->height ||
+        filtered.channels != image->channels || filtered.channelDepth != image->channelDepth ||
+        filtered.format != image->format)
+    {
+      FreeMinImage(&filtered);
+      if (CloneMinImagePrototype(&filtered, image) < 0)
+        throw std::runtime_error("Failed to allocate filtered image");
+    }
+    prefilter(&filtered, image, params.prefilter);
+    src = &filtered;
+    if (dbg && dbg->enabled())
+      dbg->save("filtered", "prefilter", src, "");
+  }
+
+  pointlikeStage(pointlike, src, params, dbg, debugIter, maxSegments);
+
+  std::set<std::pair<int, int> > blockList;
+  obtainBlockList(blockList, *pointlike, params.blockingThresh);
+
+  linearStage(linear, src, pointlike->getImageMap(), blockList, params, dbg, debugIter, maxSegments);
+  planarStage(planar, src, linear->getImageMap(), params, dbg, debugIter, maxSegments);
+  return planar->getImageMap();
+}
+
+int Pipeline::numberOfSegments() const
+{
+  return planar ? planar->numberOfSegments() : 0;
+}
+
+}}	// ns vi::colorseg
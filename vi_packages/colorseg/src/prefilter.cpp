@@ -0,0 +1,379 @@
+/*
+Copyright (c) 2012-2018, Visillect Service LLC. All rights reserved.
+Developed for Kharkevich Institute for Information Transmission Problems of the
+              Russian Academy of Sciences (IITP RAS).
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+#include <colorseg/prefilter.h>
+
+#include <minbase/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-helpers.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(USE_SSE_SIMD)
+#include <emmintrin.h>
+#endif
+
+namespace vi { namespace colorseg {
+
+namespace {
+
+template<typename F>
+struct BandJob
+{
+  F const * f;
+  int begin;
+  int n;
+  int bands;
+  std::atomic<bool> failed;
+
+  // An exception must not leave a pool thread, it is reported by parallelFor().
+  static void run(void * context, int band)
+  {
+    BandJob & job = *static_cast<BandJob *>(context);
+    try
+    {
+      (*job.f)(job.begin + int(int64_t(job.n) * band / job.bands),
+               job.begin + int(int64_t(job.n) * (band + 1) / job.bands), band);
+    }
+    catch (...)
+    {
+      job.failed = true;
+    }
+  }
+};
+
+// Splits [begin, end) into at most `bands` contiguous bands and runs
+// f(bandBegin, bandEnd, band) on them on the minimgapi thread pool (see
+// SetMinImageThreadCount()). The tasks should not allocate: buffers they need
+// are allocated by the caller for every band beforehand.
+template<typename F>
+void parallelFor(int begin, int end, int bands, F const & f)
+{
+  const int n = end - begin;
+  bands = std::min(bands, n);
+  if (bands <= 1)
+  {
+    f(begin, end, 0);
+    return;
+  }
+
+  BandJob<F> job;
+  job.f = &f;
+  job.begin = begin;
+  job.n = n;
+  job.bands = bands;
+  job.failed = false;
+  if (RunMinImageTasks(&BandJob<F>::run, &job, bands) < 0 || job.failed)
+    throw std::runtime_error("prefilter: failed to run parallel tasks");
+}
+
+// row[i] += w[i] * (prev[i] - row[i]) for i in [begin, end)
+inline void recursiveStep(float * row, const float * prev, const float * w, int begin, int end)
+{
+  int i = begin;
+#if defined(USE_SSE_SIMD)
+  for (; i + 4 <= end; i += 4)
+  {
+    const __m128 r = _mm_loadu_ps(row + i);
+    const __m128 d = _mm_sub_ps(_mm_loadu_ps(prev + i), r);
+    _mm_storeu_ps(row + i, _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(w + i), d)));
+  }
+#endif
+  for (; i < end; ++i)
+    row[i] += w[i] * (prev[i] - row[i]);
+}
+
+// Filters a row forwards and backwards: f[x] += w[x] * (f[x - 1] - f[x]), then
+// f[x] += w[x + 1] * (f[x + 1] - f[x]) for every channel.
+inline void horizontalPass(float * f, const float * w, int width, int channels)
+{
+  for (int x = 1; x < width; ++x)
+    for (int c = 0; c < channels; ++c)
+      f[x * channels + c] += w[x] * (f[(x - 1) * channels + c] - f[x * channels + c]);
+  for (int x = width - 2; x >= 0; --x)
+    for (int c = 0; c < channels; ++c)
+      f[x * channels + c] += w[x + 1] * (f[(x + 1) * channels + c] - f[x * channels + c]);
+}
+
+#if defined(USE_SSE_SIMD)
+// The same for four rows at once: the rows are interleaved into f4 and w4, so
+// that every recursive step is one vector operation.
+inline void horizontalPass4(float * const f[4], const float * const w[4], int width, int channels,
+                            float * f4, float * w4)
+{
+  const int rowSize = width * channels;
+  for (int i = 0; i < rowSize; ++i)
+    _mm_storeu_ps(f4 + 4 * i, _mm_setr_ps(f[0][i], f[1][i], f[2][i], f[3][i]));
+  for (int x = 0; x < width; ++x)
+    _mm_storeu_ps(w4 + 4 * x, _mm_setr_ps(w[0][x], w[1][x], w[2][x], w[3][x]));
+
+  for (int x = 1; x < width; ++x)
+  {
+    const __m128 wx = _mm_loadu_ps(w4 + 4 * x);
+    for (int c = 0; c < channels; ++c)
+    {
+      float * cur = f4 + 4 * (x * channels + c);
+      const __m128 r = _mm_loadu_ps(cur);
+      const __m128 d = _mm_sub_ps(_mm_loadu_ps(cur - 4 * channels), r);
+      _mm_storeu_ps(cur, _mm_add_ps(r, _mm_mul_ps(wx, d)));
+    }
+  }
+  for (int x = width - 2; x >= 0; --x)
+  {
+    const __m128 wx = _mm_loadu_ps(w4 + 4 * (x + 1));
+    for (int c = 0; c < channels; ++c)
+    {
+      float * cur = f4 + 4 * (x * channels + c);
+      const __m128 r = _mm_loadu_ps(cur);
+      const __m128 d = _mm_sub_ps(_mm_loadu_ps(cur + 4 * channels), r);
+      _mm_storeu_ps(cur, _mm_add_ps(r, _mm_mul_ps(wx, d)));
+    }
+  }
+
+  MIN_ALIGNED(16) float lanes[4];
+  for (int i = 0; i < rowSize; ++i)
+  {
+    _mm_store_ps(lanes, _mm_loadu_ps(f4 + 4 * i));
+    f[0][i] = lanes[0];
+    f[1][i] = lanes[1];
+    f[2][i] = lanes[2];
+    f[3][i] = lanes[3];
+  }
+}
+#endif
+
+// Repeats the weight of every pixel for its channels: dst[i] = w[i / channels]
+// for i in [begin, end).
+inline void expandWeights(float * dst, const float * w, int channels, int begin, int end)
+{
+  int x = begin / channels;
+  int c = begin - x * channels;
+  for (int i = begin; i < end; ++i)
+  {
+    dst[i] = w[x];
+    if (++c == channels)
+    {
+      c = 0;
+      ++x;
+    }
+  }
+}
+
+inline void squareWeights(float * w, int count)
+{
+  int i = 0;
+#if defined(USE_SSE_SIMD)
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m128 v = _mm_loadu_ps(w + i);
+    _mm_storeu_ps(w + i, _mm_mul_ps(v, v));
+  }
+#endif
+  for (; i < count; ++i)
+    w[i] *= w[i];
+}
+
+// Recursive filtering in the domain transform space
+// (Gastal, Oliveira. Domain Transform for Edge-Aware Image and Video Processing, 2011).
+// The weight between neighbouring pixels p and q is a^(1 + sigmaS / sigmaR * |I(p) - I(q)|_1),
+// a = exp(-sqrt(2) / sigmaH). sigmaH halves from iteration to iteration, so the weights
+// of the next iteration are the squared weights of the current one.
+void domainTransformFilter(const MinImg * dst, const MinImg * src,
+                           PrefilterParams const & params, int threads)
+{
+  const int width = src->width;
+  const int height = src->height;
+  const int channels = src->channels;
+  const int rowSize = width * channels;
+  const int iterations = std::max(params.iterations, 1);
+
+  std::vector<float> image(size_t(height) * rowSize);
+  std::vector<float> weightsH(size_t(height) * width); // weight between (x - 1, y) and (x, y)
+  std::vector<float> weightsV(size_t(height) * width); // weight between (x, y - 1) and (x, y)
+
+  // Scratch of the passes, allocated before the tasks are dispatched: the
+  // vertical weights of a row repeated for every channel (the vertical bands
+  // share it, each uses its own columns) and the interleaved rows of the
+  // vectorized horizontal pass for every band.
+  std::vector<float> weightsRow(rowSize);
+#if defined(USE_SSE_SIMD)
+  const int rowBands = std::max(1, std::min(threads, height));
+  const size_t interleavedSize = size_t(4) * (rowSize + width);
+  std::vector<float> interleaved(height >= 4 ? rowBands * interleavedSize : 0);
+#endif
+
+  const double sigmaH = params.sigmaSpatial * std::sqrt(3.) * std::pow(2., iterations - 1) /
+                        std::sqrt(std::pow(4., iterations) - 1);
+  const double logA = -std::sqrt(2.) / sigmaH;
+  const double ratio = params.sigmaSpatial / params.sigmaRange;
+
+  parallelFor(0, height, threads, [&](int y0, int y1, int)
+  {
+    for (int y = y0; y < y1; ++y)
+    {
+      const uint8_t *line = GetMinImageLineAs<uint8_t>(src, y);
+      const uint8_t *prevLine = y > 0 ? GetMinImageLineAs<uint8_t>(src, y - 1) : line;
+      float *f = &image[size_t(y) * rowSize];
+      float *wh = &weightsH[size_t(y) * width];
+      float *wv = &weightsV[size_t(y) * width];
+
+      for (int i = 0; i < rowSize; ++i)
+        f[i] = line[i];
+
+      wh[0] = 0;
+      for (int x = 0; x < width; ++x)
+      {
+        int dh = 0, dv = 0;
+        for (int c = 0; c < channels; ++c)
+        {
+          const int v = line[x * channels + c];
+          if (x > 0)
+            dh += std::abs(v - line[(x - 1) * channels + c]);
+          dv += std::abs(v - prevLine[x * channels + c]);
+        }
+        if (x > 0)
+          wh[x] = float(std::exp(logA * (1 + ratio * dh)));
+        wv[x] = float(std::exp(logA * (1 + ratio * dv)));
+      }
+    }
+  });
+
+  const int blocks = (rowSize + 3) / 4;
+
+  for (int it = 0; it < iterations; ++it)
+  {
+    // horizontal pass: rows are independent, four of them are processed as vectors
+    parallelFor(0, height, threads, [&](int y0, int y1, int band)
+    {
+      int y = y0;
+#if defined(USE_SSE_SIMD)
+      if (y1 - y0 >= 4)
+      {
+        float * const f4 = &interleaved[band * interleavedSize];
+        float * const w4 = f4 + size_t(4) * rowSize;
+        for (; y + 4 <= y1; y += 4)
+        {
+          float * const f[4] = {&image[size_t(y) * rowSize], &image[size_t(y + 1) * rowSize],
+                                &image[size_t(y + 2) * rowSize], &image[size_t(y + 3) * rowSize]};
+          const float * const wh[4] = {&weightsH[size_t(y) * width], &weightsH[size_t(y + 1) * width],
+                                       &weightsH[size_t(y + 2) * width], &weightsH[size_t(y + 3) * width]};
+          horizontalPass4(f, wh, width, channels, f4, w4);
+        }
+      }
+#else
+      (void)band;
+#endif
+      for (; y < y1; ++y)
+        horizontalPass(&image[size_t(y) * rowSize], &weightsH[size_t(y) * width], width, channels);
+    });
+
+    // vertical pass: columns are independent, a row is processed as a vector
+    parallelFor(0, blocks, threads, [&](int b0, int b1, int)
+    {
+      const int i0 = b0 * 4;
+      const int i1 = std::min(b1 * 4, rowSize);
+      float * const w = weightsRow.data();
+      for (int y = 1; y < height; ++y)
+      {
+        expandWeights(w, &weightsV[size_t(y) * width], channels, i0, i1);
+        recursiveStep(&image[size_t(y) * rowSize], &image[size_t(y - 1) * rowSize], w, i0, i1);
+      }
+      for (int y = height - 2; y >= 0; --y)
+      {
+        expandWeights(w, &weightsV[size_t(y + 1) * width], channels, i0, i1);
+        recursiveStep(&image[size_t(y) * rowSize], &image[size_t(y + 1) * rowSize], w, i0, i1);
+      }
+    });
+
+    if (it + 1 < iterations)
+      parallelFor(0, height, threads, [&](int y0, int y1, int)
+      {
+        squareWeights(&weightsH[size_t(y0) * width], (y1 - y0) * width);
+        squareWeights(&weightsV[size_t(y0) * width], (y1 - y0) * width);
+      });
+  }
+
+  parallelFor(0, height, threads, [&](int y0, int y1, int)
+  {
+    for (int y = y0; y < y1; ++y)
+    {
+      const float *f = &image[size_t(y) * rowSize];
+      uint8_t *line = GetMinImageLineAs<uint8_t>(dst, y);
+      for (int i = 0; i < rowSize; ++i)
+        line[i] = uint8_t(std::min(std::max(f[i] + 0.5f, 0.f), 255.f));
+    }
+  });
+}
+
+} // namespace
+
+void prefilter(const MinImg * dst, const MinImg * src, PrefilterParams const & params)
+{
+  if (!dst || !src || !dst->pScan0 || !src->pScan0)
+    throw std::runtime_error("prefilter: images are not allocated");
+  if (src->channelDepth != 1 || src->format != FMT_UINT)
+    throw std::runtime_error("prefilter: only uint8_t images are supported");
+  if (dst->width != src->width || dst->height != src->height ||
+      dst->channels != src->channels || dst->channelDepth != src->channelDepth ||
+      dst->format != src->format)
+    throw std::runtime_error("prefilter: dst is inconsistent with src");
+
+  if (params.type == PREFILTER_NONE || src->width <= 0 || src->height <= 0)
+  {
+    if (dst->pScan0 != src->pScan0 && CopyMinImage(dst, src) < 0)
+      throw std::runtime_error("prefilter: failed to copy image");
+    return;
+  }
+
+  if (params.sigmaSpatial <= 0 || params.sigmaRange <= 0)
+    throw std::runtime_error("prefilter: sigmas should be positive");
+
+  int threads = params.threads;
+  if (threads <= 0)
+    threads = GetMinImageThreadCount();
+
+  switch (params.type)
+  {
+  case PREFILTER_DOMAIN_TRANSFORM:
+    domainTransformFilter(dst, src, params, threads);
+    break;
+  default:
+    throw std::runtime_error("prefilter: unknown prefilter type");
+  }
+}
+
+}}	// ns vi::colorseg
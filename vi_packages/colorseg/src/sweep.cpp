@@ -0,0 +1,282 @@
+/*
+Copyright (c) 2012-2018, Visillect Service LLC. All rights reserved.
+Developed for Kharkevich Institute for Information Transmission Problems of the
+              Russian Academy of Sciences (IITP RAS).
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+
+
+#include <colorseg/sweep.h>
+
+#include <minimgapi/minimgapi.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace vi { namespace colorseg {
+
+namespace {
+
+template<typename T>
+std::vector<T> axis(std::vector<T> const & values, T base)
+{
+  return values.empty() ? std::vector<T>(1, base) : values;
+}
+
+// Calls f(worker, i) for i in [0, count) on up to threads threads. Every worker
+// has its own index in [0, threads) to address per-thread buffers.
+// The first exception thrown by f is rethrown after all threads finish.
+template<typename F>
+void parallelForEach(size_t count, int threads, F const & f)
+{
+  threads = static_cast<int>(std::min<size_t>(std::max(threads, 1), count));
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  auto worker = [&](int w)
+  {
+    try
+    {
+      for (size_t i = next++; i < count; i = next++)
+        f(w, i);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error)
+        error = std::current_exception();
+      next = count;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < threads; ++t)
+    pool.emplace_back(worker, t);
+  if (threads > 0)
+    worker(0);
+  for (auto & th : pool)
+    th.join();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+typedef std::unique_ptr<Segmentator<ColorVertex> > PSegmentator;
+
+struct PrefilterNode
+{
+  PipelineParams const * params;  // params of the first combination using the node
+  MinImg filtered;
+};
+
+struct PointlikeNode
+{
+  PipelineParams const * params;
+  size_t prefilter;
+  std::unique_ptr<ImageMap> imageMap;
+  std::map<double, std::set<std::pair<int, int> > > blockLists;  // by blockingThresh
+};
+
+struct LinearNode
+{
+  PipelineParams const * params;
+  size_t pointlike;
+  std::unique_ptr<ImageMap> imageMap;
+};
+
+struct PlanarNode
+{
+  PipelineParams const * params;
+  size_t linear;
+  std::vector<size_t> combinations;
+};
+
+// Finds or appends the node with the given key; returns its index.
+template<typename Key>
+size_t nodeIndex(std::map<Key, size_t> & index, Key const & key, bool & created)
+{
+  auto it = index.find(key);
+  created = it == index.end();
+  if (created)
+    it = index.insert(std::make_pair(key, index.size())).first;
+  return it->second;
+}
+
+} // namespace
+
+std::vector<PipelineParams> SweepGrid::combinations() const
+{
+  std::vector<PipelineParams> result;
+  for (double e : axis(errorLimit, base.errorLimit))
+    for (int s : axis(segmentsLimit, base.segmentsLimit))
+      for (double b : axis(blockingThresh, base.blockingThresh))
+        for (double m : axis(maxModelDistance, base.vertexParams.maxModelDistance))
+          for (double g : axis(glareThresh, base.glareThresh))
+          {
+            PipelineParams p = base;
+            p.errorLimit = e;
+            p.segmentsLimit = s;
+            p.blockingThresh = b;
+            p.vertexParams.maxModelDistance = m;
+            p.glareThresh = g;
+            result.push_back(p);
+          }
+  return result;
+}
+
+SweepStats sweep(const MinImg * image, std::vector<PipelineParams> const & combinations,
+                 SweepCallback const & onResult, int threads)
+{
+  if (image->channels != 3)
+    throw std::runtime_error("Image should have exact 3 channels for color segmentation");
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // build the DAG of stage executions, keyed by the parameters each stage depends on
+  typedef std::tuple<int, double, double, int> PrefilterKey;
+  typedef std::tuple<size_t, double, int, double, double> PointlikeKey;
+  typedef std::tuple<size_t, double> LinearKey;
+  typedef std::tuple<size_t, double, double> PlanarKey;
+
+  std::map<PrefilterKey, size_t> prefilterIndex;
+  std::map<PointlikeKey, size_t> pointlikeIndex;
+  std::map<LinearKey, size_t> linearIndex;
+  std::map<PlanarKey, size_t> planarIndex;
+
+  std::vector<PrefilterNode> prefilterNodes;
+  std::vector<PointlikeNode> pointlikeNodes;
+  std::vector<LinearNode> linearNodes;
+  std::vector<PlanarNode> planarNodes;
+
+  for (size_t i = 0; i < combinations.size(); ++i)
+  {
+    PipelineParams const & p = combinations[i];
+    bool created = false;
+
+    PrefilterParams const & pf = p.prefilter;
+    size_t const f = pf.type == PREFILTER_NONE ?
+      nodeIndex(prefilterIndex, PrefilterKey(PREFILTER_NONE, 0, 0, 0), created) :
+      nodeIndex(prefilterIndex, PrefilterKey(pf.type, pf.sigmaSpatial, pf.sigmaRange, pf.iterations), created);
+    if (created)
+      prefilterNodes.push_back(PrefilterNode{&p, MinImg()});
+
+    size_t const pl = nodeIndex(pointlikeIndex, PointlikeKey(f, p.errorLimit, p.segmentsLimit,
+                                                             p.vertexParams.homographyA,
+                                                             p.vertexParams.homographyK), created);
+    if (created)
+      pointlikeNodes.push_back(PointlikeNode{&p, f, nullptr, {}});
+    pointlikeNodes[pl].blockLists[p.blockingThresh];
+
+    size_t const l = nodeIndex(linearIndex, LinearKey(pl, p.blockingThresh), created);
+    if (created)
+      linearNodes.push_back(LinearNode{&p, pl, nullptr});
+
+    size_t const pn = nodeIndex(planarIndex, PlanarKey(l, p.vertexParams.maxModelDistance, p.glareThresh), created);
+    if (created)
+      planarNodes.push_back(PlanarNode{&p, l, {}});
+    planarNodes[pn].combinations.push_back(i);
+  }
+
+  SweepStats stats;
+  std::vector<PSegmentator> segmentators(threads);
+
+  auto source = [&](size_t f) -> const MinImg *
+  {
+    return prefilterNodes[f].params->prefilter.type == PREFILTER_NONE ? image : &prefilterNodes[f].filtered;
+  };
+
+  try
+  {
+    // the prefilter is parallel by itself
+    for (auto & node : prefilterNodes)
+    {
+      if (node.params->prefilter.type == PREFILTER_NONE)
+        continue;
+      if (CloneMinImagePrototype(&node.filtered, image) < 0)
+        throw std::runtime_error("Failed to allocate filtered image");
+      prefilter(&node.filtered, image, node.params->prefilter);
+      stats.prefilterRuns++;
+    }
+
+    parallelForEach(pointlikeNodes.size(), threads, [&](int w, size_t i)
+    {
+      PointlikeNode & node = pointlikeNodes[i];
+      pointlikeStage(segmentators[w], source(node.prefilter), *node.params);
+      for (auto & bl : node.blockLists)
+        obtainBlockList(bl.second, *segmentators[w], bl.first);
+      node.imageMap.reset(new ImageMap(segmentators[w]->getImageMap()));
+    });
+    stats.pointlikeRuns = static_cast<int>(pointlikeNodes.size());
+
+    parallelForEach(linearNodes.size(), threads, [&](int w, size_t i)
+    {
+      LinearNode & node = linearNodes[i];
+      PointlikeNode const & parent = pointlikeNodes[node.pointlike];
+      linearStage(segmentators[w], source(parent.prefilter), *parent.imageMap,
+                  parent.blockLists.at(node.params->blockingThresh), *node.params);
+      node.imageMap.reset(new ImageMap(segmentators[w]->getImageMap()));
+    });
+    stats.linearRuns = static_cast<int>(linearNodes.size());
+    for (auto & node : pointlikeNodes)
+      node.imageMap.reset();
+
+    std::mutex resultMutex;
+    parallelForEach(planarNodes.size(), threads, [&](int w, size_t i)
+    {
+      PlanarNode const & node = planarNodes[i];
+      LinearNode const & parent = linearNodes[node.linear];
+      planarStage(segmentators[w], source(pointlikeNodes[parent.pointlike].prefilter),
+                  *parent.imageMap, *node.params);
+
+      std::lock_guard<std::mutex> lock(resultMutex);
+      for (size_t c : node.combinations)
+        onResult(c, combinations[c], segmentators[w]->getImageMap(), segmentators[w]->numberOfSegments());
+    });
+    stats.planarRuns = static_cast<int>(planarNodes.size());
+  }
+  catch (...)
+  {
+    for (auto & node : prefilterNodes)
+      FreeMinImage(&node.filtered);
+    throw;
+  }
+
+  for (auto & node : prefilterNodes)
+    FreeMinImage(&node.filtered);
+  return stats;
+}
+
+}}	// ns vi::colorseg
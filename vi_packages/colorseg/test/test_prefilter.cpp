@@ -0,0 +1,116 @@
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include <minbase/minresult.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-helpers.hpp>
+#include <minimgapi/imgguard.hpp>
+
+#include <colorseg/prefilter.h>
+
+using namespace vi::colorseg;
+
+// A vertical step edge between 60 and 190 with pseudo-random noise in [-8, 8].
+static void create_noisy_step(MinImg *img, int width, int height) {
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(img, width, height, 3, TYP_UINT8));
+  srand(1);
+  for (int y = 0; y < height; ++y) {
+    uint8_t *line = GetMinImageLineAs<uint8_t>(img, y);
+    for (int x = 0; x < width; ++x)
+      for (int c = 0; c < 3; ++c)
+        line[3 * x + c] = static_cast<uint8_t>(
+            (x < width / 2 ? 60 : 190) + rand() % 17 - 8);
+  }
+}
+
+// Root mean square deviation from the noiseless step in the given columns.
+static double step_noise(const MinImg *img, int x0, int x1) {
+  double sum = 0;
+  int n = 0;
+  for (int y = 0; y < img->height; ++y) {
+    const uint8_t *line = GetMinImageLineAs<uint8_t>(img, y);
+    for (int x = x0; x < x1; ++x)
+      for (int c = 0; c < 3; ++c, ++n) {
+        const double d = line[3 * x + c] - (x < img->width / 2 ? 60 : 190);
+        sum += d * d;
+      }
+  }
+  return std::sqrt(sum / n);
+}
+
+TEST(TestColorseg, prefilter_defaults) {
+  // The defaults stand in for the former bilateral filter (see prefilter.h).
+  PrefilterParams params;
+  EXPECT_EQ(PREFILTER_NONE, params.type);
+  EXPECT_EQ(5., params.sigmaSpatial);
+  EXPECT_EQ(50., params.sigmaRange);
+  EXPECT_EQ(3, params.iterations);
+  EXPECT_EQ(0, params.threads);
+}
+
+TEST(TestColorseg, prefilter_smooths_and_keeps_edges) {
+  // the height is not a multiple of four to cover the scalar rows
+  DECLARE_GUARDED_MINIMG(src);
+  create_noisy_step(&src, 64, 37);
+  DECLARE_GUARDED_MINIMG(dst);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst, &src));
+
+  PrefilterParams params;
+  params.type = PREFILTER_DOMAIN_TRANSFORM;
+  params.threads = 1;
+  prefilter(&dst, &src, params);
+
+  // away from the edge the noise goes down, next to it the step stays
+  EXPECT_LT(step_noise(&dst, 0, 28), 0.5 * step_noise(&src, 0, 28));
+  EXPECT_LT(step_noise(&dst, 36, 64), 0.5 * step_noise(&src, 36, 64));
+  EXPECT_LT(step_noise(&dst, 30, 34), 20.);
+}
+
+TEST(TestColorseg, prefilter_is_deterministic) {
+  DECLARE_GUARDED_MINIMG(src);
+  create_noisy_step(&src, 53, 41);
+  PrefilterParams params;
+  params.type = PREFILTER_DOMAIN_TRANSFORM;
+  params.threads = 1;
+
+  DECLARE_GUARDED_MINIMG(serial);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&serial, &src));
+  prefilter(&serial, &src, params);
+
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(4));
+  params.threads = 0;
+  DECLARE_GUARDED_MINIMG(parallel);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&parallel, &src));
+  prefilter(&parallel, &src, params);
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&serial, &parallel));
+
+  // in place
+  prefilter(&src, &src, params);
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&serial, &src));
+  ASSERT_EQ(NO_ERRORS, SetMinImageThreadCount(1));
+}
+
+TEST(TestColorseg, prefilter_none_and_bad_args) {
+  DECLARE_GUARDED_MINIMG(src);
+  create_noisy_step(&src, 16, 8);
+  DECLARE_GUARDED_MINIMG(dst);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst, &src));
+
+  PrefilterParams params;
+  prefilter(&dst, &src, params);
+  EXPECT_EQ(NO_ERRORS, CompareMinImages(&dst, &src));
+
+  params.type = PREFILTER_DOMAIN_TRANSFORM;
+  params.sigmaRange = 0;
+  EXPECT_THROW(prefilter(&dst, &src, params), std::runtime_error);
+
+  DECLARE_GUARDED_MINIMG(small);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&small, 8, 8, 3, TYP_UINT8));
+  EXPECT_THROW(prefilter(&small, &src, PrefilterParams()), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
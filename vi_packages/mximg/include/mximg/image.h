@@ -38,6 +38,10 @@ public:
 
   static PImage imread(std::string const& fileName);
 
+  // Maps the pixels of the file copy-on-write where the format allows it and
+  // reads the image otherwise. Changes to the image never reach the file.
+  static PImage immap(std::string const& fileName);
+
   bool imwrite(std::string const& fileName) const;
 
 protected:
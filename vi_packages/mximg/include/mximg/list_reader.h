@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mximg/image.h>
+
+
+namespace mximg
+{
+
+class ListReader;
+using PListReader = std::shared_ptr<ListReader>;
+
+// Reads the images of a list in order while the next ones are decoded ahead
+// by a pool of background threads. At most `prefetch` images are decoded or
+// waiting to be taken at any time.
+class ListReader
+{
+public:
+  // Called on a background thread with the index and the file name of an image
+  // right before it is decoded. It may block, for example to wait until there
+  // is memory for the image; with several threads neighbouring images may come
+  // out of order.
+  using LoadHook = std::function<void(int index, std::string const& fileName)>;
+
+  ListReader(std::vector<std::string> const& fileNames, int prefetch = 4, int threads = 1,
+             LoadHook beforeLoad = LoadHook());
+  ~ListReader();
+
+  ListReader(ListReader const&) = delete;
+  ListReader & operator= (ListReader const&) = delete;
+
+  // Parses the .lst file once with ListMinImageFiles(), so the images are
+  // the pages LoadMinImage() reads from the list. Returns null if the list
+  // cannot be read.
+  static PListReader open(std::string const& lstFileName, int prefetch = 4, int threads = 1,
+                          LoadHook beforeLoad = LoadHook());
+
+  int size() const
+  {
+    return static_cast<int>(fileNames.size());
+  }
+
+  std::string const& fileName(int index) const
+  {
+    return fileNames[index];
+  }
+
+  // Takes the next image of the list, waiting for it to be decoded. Returns
+  // false after the last one; the image is empty when it failed to load or
+  // decoding it threw.
+  // May be called from several threads, each image is taken once.
+  bool read(PImage & image, int * index = nullptr);
+
+private:
+  void run();
+
+  std::vector<std::string> const fileNames;
+  int const prefetch;
+  LoadHook const beforeLoad;
+  std::vector<std::thread> pool;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::map<int, PImage> ready;
+  int nextToLoad;
+  int nextToRead;
+  int inFlight;
+  bool stopping;
+};
+
+} // namespace mximg
@@ -6,16 +6,35 @@ namespace mximg {
 
 PImage Image::imread(std::string const& fileName)
 {
-  MinImg img = {0};
-  if (GetMinImageFileProps(&img, fileName.c_str()) < 0)
-    return PImage();
-  if (AllocMinImage(&img) < 0)
+  MinImageFile *file = nullptr;
+  if (OpenMinImageFile(&file, fileName.c_str()) < 0)
     return PImage();
-  if (LoadMinImage(&img, fileName.c_str()) < 0)
+  MinImg img = {0};
+  int res = GetOpenedMinImageProps(&img, nullptr, file);
+  if (res >= 0)
+    res = AllocMinImage(&img);
+  if (res >= 0)
+    res = LoadOpenedMinImage(&img, file);
+  CloseMinImageFile(file);
+  if (res < 0)
+  {
+    FreeMinImage(&img);
     return PImage();
+  }
   return createByOwning(img);
 }
 
+PImage Image::immap(std::string const& fileName)
+{
+  MinImg img = {0};
+  if (MapMinImage(&img, fileName.c_str()) < 0)
+    return imread(fileName);
+  PImage result = createByOwning(img);
+  if (!result)
+    FreeMinImage(&img);
+  return result;
+}
+
 bool Image::imwrite(std::string const& fileName) const
 {
   if (!img.pScan0)
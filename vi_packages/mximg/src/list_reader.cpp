@@ -0,0 +1,107 @@
+#include <mximg/list_reader.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <minimgio/minimgio.h>
+
+
+namespace mximg {
+
+static int addFileName(void * context, const char * fileName)
+{
+  static_cast<std::vector<std::string> *>(context)->push_back(fileName);
+  return NO_ERRORS;
+}
+
+ListReader::ListReader(std::vector<std::string> const& fileNames, int prefetch, int threads,
+                       LoadHook beforeLoad)
+  : fileNames(fileNames)
+  , prefetch(std::max(1, prefetch))
+  , beforeLoad(std::move(beforeLoad))
+  , nextToLoad(0)
+  , nextToRead(0)
+  , inFlight(0)
+  , stopping(false)
+{
+  threads = std::max(1, std::min(threads, this->prefetch));
+  for (int t = 0; t < threads; ++t)
+    pool.emplace_back(&ListReader::run, this);
+}
+
+ListReader::~ListReader()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  for (auto & thread : pool)
+    thread.join();
+}
+
+PListReader ListReader::open(std::string const& lstFileName, int prefetch, int threads,
+                             LoadHook beforeLoad)
+{
+  std::vector<std::string> fileNames;
+  if (ListMinImageFiles(lstFileName.c_str(), addFileName, &fileNames) < 0)
+    return PListReader();
+  return std::make_shared<ListReader>(fileNames, prefetch, threads, std::move(beforeLoad));
+}
+
+bool ListReader::read(PImage & image, int * index)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (nextToRead >= size())
+    return false;
+  int const current = nextToRead++;
+  changed.wait(lock, [&] { return ready.count(current) != 0; });
+  image = ready[current];
+  ready.erase(current);
+  --inFlight;
+  lock.unlock();
+  // the freed slot lets the pool start decoding the next image
+  changed.notify_all();
+  if (index)
+    *index = current;
+  return true;
+}
+
+void ListReader::run()
+{
+  for (;;)
+  {
+    int current = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&] {
+        return stopping || nextToLoad >= size() || inFlight < prefetch;
+      });
+      if (stopping || nextToLoad >= size())
+        return;
+      current = nextToLoad++;
+      ++inFlight;
+    }
+
+    // an exception must not leave the pool thread, the consumer gets an
+    // empty image for the entry instead
+    PImage image;
+    try
+    {
+      if (beforeLoad)
+        beforeLoad(current, fileNames[current]);
+      image = Image::imread(fileNames[current]);
+    }
+    catch (...)
+    {
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ready[current] = image;
+    }
+    changed.notify_all();
+  }
+}
+
+} // namespace mximg
@@ -81,6 +81,10 @@ public:
   void remove(Edge *edge);
   void update(Edge *edge, EdgeValue newValue);
 
+  // удаляет все ребра, сохраняя выделенную память
+  void clear()
+  { size = 0; }
+
   Edge *top();
 
   bool isEmpty() const
@@ -89,6 +93,9 @@ public:
   int getSize() const
   { return size; }
 
+  int getCapacity() const
+  { return max_size; }
+
   bool isConsistent() const;
 
 private:
@@ -52,13 +52,14 @@ either expressed or implied, of copyright holders.
 #include <cmath>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
 #include <numeric>
 #include <vector>
 #include <set>
 
 #include <cassert>
 
-std::string dist_to_string(const double a_value)
+inline std::string dist_to_string(const double a_value)
 {
   char buff[100];
   snprintf(buff, sizeof(buff), "%09.4f", a_value);
@@ -79,13 +80,15 @@ class Segmentator
 
 public:
 
+  typedef typename T::Params Params;
   typedef EdgeValue (*ErrorFunction)(const T *v);
   typedef EdgeValue (*DistanceFunction)(const T *v1, const T *v2);
 
   Segmentator(const MinImg * image,
               EdgeValue (*ef)(const T *v) = error_function_replaceme,
               EdgeValue (*df)(const T *v1, const T *v2) = student_distance,
-              bool _normalize = false);
+              bool _normalize = false,
+              Params const & _params = Params());
 
   Segmentator(const MinImg * image,
               const ImageMap * _imageMap,
@@ -93,10 +96,35 @@ public:
               EdgeValue (*df)(const T *v1, const T *v2) = student_distance,
               std::set<std::pair<int, int> > const & _blockList = {},
               bool _blocking_policy = BLOCK_SEGMENTS,
-              bool _normalize = false);
+              bool _normalize = false,
+              Params const & _params = Params());
 
   ~Segmentator();
 
+  // Вершины хранят указатель на params этого сегментатора, а память под
+  // вершины и ребра принадлежит ему, поэтому копирование и перемещение запрещены.
+  Segmentator(Segmentator const &) = delete;
+  Segmentator & operator=(Segmentator const &) = delete;
+  Segmentator(Segmentator &&) = delete;
+  Segmentator & operator=(Segmentator &&) = delete;
+
+  // Перезапускают сегментатор на новом изображении (аналогично соответствующим конструкторам).
+  // Память под вершины, ребра и вспомогательные массивы переиспользуется, если ее хватает.
+  void reset(const MinImg * image,
+             EdgeValue (*ef)(const T *v) = error_function_replaceme,
+             EdgeValue (*df)(const T *v1, const T *v2) = student_distance,
+             bool _normalize = false,
+             Params const & _params = Params());
+
+  void reset(const MinImg * image,
+             const ImageMap * _imageMap,
+             EdgeValue (*ef)(const T *v) = error_function_replaceme,
+             EdgeValue (*df)(const T *v1, const T *v2) = student_distance,
+             std::set<std::pair<int, int> > const & _blockList = {},
+             bool _blocking_policy = BLOCK_SEGMENTS,
+             bool _normalize = false,
+             Params const & _params = Params());
+
   EdgeValue calcError(const T* v) const;
 
   int numberOfSegments() const { return vertexNum; }
@@ -155,10 +183,14 @@ public:
 
   DistanceFunction getDistanceFunction() const { return distance_function; }
 
+  Params const & getParams() const { return params; }
+
 protected:
   ErrorFunction error_function;
   DistanceFunction distance_function;
 
+  Params params;
+
   ImageMap *imageMap = nullptr;
   EdgeHeap *edgeHeap = nullptr;
   T *vertices = nullptr;
@@ -170,6 +202,7 @@ protected:
 
   int vertexNum = 0;
   int sizeOfVertices = 0;
+  int capacityOfVertices = 0;
 
   unsigned int max_neighbours = 0;
 
@@ -177,7 +210,7 @@ protected:
   int stepNumber = 0;
 
   std::set<std::pair<int, int> > blockList;
-  bool blocking_policy;
+  bool blocking_policy = BLOCK_SEGMENTS;
 
   EdgeValue errorAccumulator = 0;
   bool normalize;
@@ -185,6 +218,7 @@ protected:
   std::map<SegmentID, SegmentID> id_to_idx;
 
   void initialize(int maxNumberOfVertices, int maxNumberOfEdges);
+  void resetImageMap(const MinImg * image);
   bool goodVertex(const T *v) const
   { return v != 0 and !isEmpty() and v >= vertices and v < vertices + sizeOfVertices and v->exists(); }
 
@@ -268,18 +302,10 @@ template<typename T>
 Segmentator<T>::Segmentator(const MinImg * image,
                             EdgeValue (*ef)(const T *v),
                             EdgeValue (*df)(const T *v1, const T *v2),
-                            bool _normalize)
-  : error_function(ef)
-  , distance_function(df)
-  , channelsNum(image->channels)
-  , normalize(_normalize)
+                            bool _normalize,
+                            Params const & _params)
 {
-  if (image->channelDepth != 1)
-    throw std::runtime_error("Unsupported image type. Only uint8_t is supported");
-
-  imageMap = new ImageMap(image->width, image->height);
-
-  createAdjacencyGraph(image);
+  reset(image, ef, df, _normalize, _params);
 }
 
 template<typename T>
@@ -289,25 +315,83 @@ Segmentator<T>::Segmentator(const MinImg * image,
                             EdgeValue (*df)(const T *v1, const T *v2),
                             std::set<std::pair<int, int> > const & _blockList,
                             bool _blocking_policy,
-                            bool _normalize)
-  : error_function(ef)
-  , distance_function(df)
-  , channelsNum(image->channels)
-  , blockList(_blockList)
-  , blocking_policy(_blocking_policy)
-  , normalize(_normalize)
+                            bool _normalize,
+                            Params const & _params)
+{
+  reset(image, _imageMap, ef, df, _blockList, _blocking_policy, _normalize, _params);
+}
+
+template<typename T>
+void Segmentator<T>::reset(const MinImg * image,
+                           EdgeValue (*ef)(const T *v),
+                           EdgeValue (*df)(const T *v1, const T *v2),
+                           bool _normalize,
+                           Params const & _params)
 {
   if (image->channelDepth != 1)
     throw std::runtime_error("Unsupported image type. Only uint8_t is supported");
 
-  imageMap = new ImageMap(image->width, image->height);
+  error_function = ef;
+  distance_function = df;
+  params = _params;
+  channelsNum = image->channels;
+  blockList.clear();
+  blocking_policy = BLOCK_SEGMENTS;
+  normalize = _normalize;
+  id_to_idx.clear();
+
+  resetImageMap(image);
+
+  createAdjacencyGraph(image);
+}
+
+template<typename T>
+void Segmentator<T>::reset(const MinImg * image,
+                           const ImageMap * _imageMap,
+                           EdgeValue (*ef)(const T *v),
+                           EdgeValue (*df)(const T *v1, const T *v2),
+                           std::set<std::pair<int, int> > const & _blockList,
+                           bool _blocking_policy,
+                           bool _normalize,
+                           Params const & _params)
+{
+  if (image->channelDepth != 1)
+    throw std::runtime_error("Unsupported image type. Only uint8_t is supported");
 
   if (_imageMap->getWidth() != image->width || _imageMap->getHeight() != image->height)
     throw std::runtime_error("ImageMap size is inconsistent with image");
 
+  std::unique_ptr<ImageMap> sourceMap;
+  if (_imageMap == imageMap)  // собственная карта будет пересоздана
+  {
+    sourceMap.reset(new ImageMap(*_imageMap));
+    _imageMap = sourceMap.get();
+  }
+
+  error_function = ef;
+  distance_function = df;
+  params = _params;
+  channelsNum = image->channels;
+  blockList = _blockList;
+  blocking_policy = _blocking_policy;
+  normalize = _normalize;
+  id_to_idx.clear();
+
+  resetImageMap(image);
+
   createAdjacencyGraph(image, _imageMap);
 }
 
+template<typename T>
+void Segmentator<T>::resetImageMap(const MinImg * image)
+{
+  // карта пересоздается целиком, т.к. ImageMap кэширует палитру сегментов
+  if (imageMap)
+    delete imageMap;
+  imageMap = 0;
+  imageMap = new ImageMap(image->width, image->height);
+}
+
 template<typename T>
 void Segmentator<T>::createAdjacencyGraph(const MinImg * image)
 {
@@ -545,13 +629,13 @@ int Segmentator<T>::mergeToLimit(EdgeValue distanceLimit, EdgeValue errorLimit,
   if (!blockList.empty() || blocking_policy == BLOCK_EDGES)
   {
     updateMapping(true);
+    // после updateMapping карта содержит номера вершин, а не исходные id сегментов
     for (auto const & stat : imageMap->getSegmentStats())
     {
-      int idx = id_to_idx[stat.first];
-      T *v = &vertices[idx];
+      T *v = &vertices[stat.first];
       for (auto const & n : stat.second.neighbours)
-        if (vertices[id_to_idx[n]].isBlocked != v->isBlocked)
-          connect(v, &vertices[id_to_idx[n]]);
+        if (stat.first < n and vertices[n].isBlocked != v->isBlocked)	// каждую пару соединяем один раз
+          connect(v, &vertices[n]);
     }
 
     result = mergeToLimitCycle(distanceLimit, errorLimit, segmentsLimit, dbg, debug_iter, maxSegments);
@@ -572,7 +656,7 @@ T *Segmentator<T>::mergeBackground(int areaLimit)
 
   // searching for the first piece of background (seed)
   for (int i = 0; i < sizeOfVertices; i++)
-    if (vertices[i].exists()  and  vertices[i].area > areaLimit)
+    if (vertices[i].exists()  and  int64_t(vertices[i].area) > areaLimit)
     {
       seed = &vertices[i];
       break;
@@ -583,7 +667,7 @@ T *Segmentator<T>::mergeBackground(int areaLimit)
 
   int n = 1;
   for (int i = seed - vertices + 1; i < sizeOfVertices; i++)
-    if (vertices[i].exists()  and  vertices[i].area > areaLimit)
+    if (vertices[i].exists()  and  int64_t(vertices[i].area) > areaLimit)
     {
       merge(seed, &vertices[i]);
       n++;
@@ -690,15 +774,10 @@ void Segmentator<T>::merge(T *absorbent, T *v)
 template<typename T>
 Segmentator<T>::~Segmentator()
 {
-  // TODO: FIX
-  // if (vertices)
-  // {
-  //   if (vertices[i].empty())
-  //   LOG_WARNING("existing empty vertex");
-  // 	 delete[] vertices;
-  // }
   if (edgeHeap)
     delete edgeHeap;
+  if (vertices)
+    delete[] vertices;
   if (mergeAuxArray)
     delete[] mergeAuxArray;
   if (imageMap)
@@ -713,24 +792,60 @@ void Segmentator<T>::initialize(int vNum, int eNum)
   if (vNum <= 0 or eNum <= 0)
     throw std::invalid_argument("invalid Segmentator parameters");
 
-  if (not isEmpty())
-    throw std::runtime_error("Segmentator is not empty");
+  // вершины переиспользуются, если их хватает и у них то же число каналов
+  if (vertices and (vNum > capacityOfVertices or vertices[0].channelsNum != channelsNum))
+  {
+    delete[] vertices;
+    vertices = 0;
+    delete[] mergeAuxArray;
+    mergeAuxArray = 0;
+    capacityOfVertices = 0;
+  }
+
+  if (vertices)
+  {
+    for (int i = 0; i < vNum; i++)
+    {
+      vertices[i].reset();
+      vertices[i].setParams(&params);
+    }
+  }
+  else
+  {
+    if (!(vertices = new T[vNum]))
+      throw std::runtime_error("cannot allocate vertices");
+    capacityOfVertices = vNum;
+
+    for (int i = 0; i < vNum; i++)
+    {
+      vertices[i].setParams(&params);
+      vertices[i].Initialize(channelsNum);
+    }
 
-  if (!(vertices = new T[vNum]))
-    throw std::runtime_error("cannot allocate vertices");
+    if (!(mergeAuxArray = new int [capacityOfVertices]))
+      throw std::runtime_error("failed to allocate mergeAuxArray");
+  }
 
   vertexNum = sizeOfVertices = vNum;
 
-  for (int i = 0; i < sizeOfVertices; i++)
-    vertices[i].Initialize(channelsNum);
+  if (edgeHeap and edgeHeap->getCapacity() < eNum)
+  {
+    delete edgeHeap;
+    edgeHeap = 0;
+  }
 
-  if (!(edgeHeap = new EdgeHeap(eNum)))
+  if (edgeHeap)
+    edgeHeap->clear();
+  else if (!(edgeHeap = new EdgeHeap(eNum)))
     throw std::runtime_error("cannot allocate edges heap");
 
-  if (!(mergeAuxArray = new int [sizeOfVertices]))
-    throw std::runtime_error("failed to allocate mergeAuxArray");
-
   memset(mergeAuxArray, 0, sizeOfVertices * sizeof(int));
+
+  breakpoint = 0;
+  needUpdateMapping = false;
+  max_neighbours = 0;
+  stepNumber = 0;
+  errorAccumulator = 0;
 }
 
 template<typename T>
@@ -36,6 +36,7 @@ either expressed or implied, of copyright holders.
 #include <list>
 #include <array>
 #include <vector>
+#include <cstdint>
 #include <validate_json/validate_json.h>
 
 namespace vi { namespace remseg {
@@ -49,10 +50,18 @@ public:
 	typedef iterator Joint;
 	typedef const_iterator ConstJoint;
 
+	// параметры, общие для всех вершин одного сегментатора (хранятся в Segmentator,
+	// вершины получают указатель на них через setParams)
+	struct Params {};
+	void setParams(const Params *) { }
+
 	int channelsNum;
 
-	long double *channelsSum;
-	long area;
+	// целочисленные суммы значений каналов по пикселям вершины; слияние вершин
+	// складывает их точно и не зависит от порядка, перевод в вещественные числа
+	// происходит только в channelMean
+	uint64_t *channelsSum;
+	uint32_t area;
 
 	bool needsSort;
 
@@ -73,10 +82,15 @@ public:
 	virtual ~Vertex();
 
 	virtual void Initialize(int _channelsNum);
-	virtual void update(const double * pix);
+	// возвращает проинициализированную вершину в исходное состояние без перевыделения памяти
+	virtual void reset();
 	virtual void update(const uint8_t * pix);
 	virtual void absorb(Vertex *to_be_absorbed);
 
+	// среднее значение i-го канала
+	virtual double channelMean(int i) const
+		{ return double(channelsSum[i]) / area; }
+
 	void clearAbsorbent() { absorbent = 0; }
 
 	// возвращает последний ненулевой поглотитель в цепочке (absorbent) - (absorbent->absorbent) - (absorbent->absorbent->absorbent) - ...
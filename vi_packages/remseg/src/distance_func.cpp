@@ -45,11 +45,11 @@ EdgeValue student_distance(const Vertex *v1, const Vertex *v2)
   double s = 0;
 	for (int i = 0; i < v1->channelsNum; i++)
   {
-    double mean1 = double(v1->channelsSum[i]) / v1->area;
-    double mean2 = double(v2->channelsSum[i]) / v2->area;
+    double mean1 = v1->channelMean(i);
+    double mean2 = v2->channelMean(i);
     s += sqr(mean1 - mean2 + 0.5);
   }
-	return s * v1->area * v2->area / (v1->area + v2->area);
+	return s * v1->area * v2->area / (double(v1->area) + v2->area);
 }
 
 }}	// ns vi::remseg
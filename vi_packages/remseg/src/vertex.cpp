@@ -60,11 +60,23 @@ void Vertex::Initialize(int _channelsNum)
 {
   assert(_channelsNum > 0);
   channelsNum = _channelsNum;
-  channelsSum = new long double[channelsNum];
+  channelsSum = new uint64_t[channelsNum];
   for (int i = 0; i < channelsNum; i++)
     channelsSum[i] = 0;
 }
 
+void Vertex::reset()
+{
+  clear();
+  for (int i = 0; i < channelsNum; i++)
+    channelsSum[i] = 0;
+  area = 0;
+  needsSort = false;
+  isBlocked = false;
+  existence_flag = true;
+  absorbent = 0;
+}
+
 Vertex::~Vertex()
 {
   if (channelsSum != NULL)
@@ -107,19 +119,11 @@ bool Vertex::isSorted() const
   return true;
 }
 
-void Vertex::update(const double * pix)
-{
-  const int n = channelsNum;
-  for (int i = 0; i < n; ++i)
-    channelsSum[i] += pix[i];
-  area += 1;
-}
-
 void Vertex::update(const uint8_t * pix)
 {
   const int n = channelsNum;
   for (int i = 0; i < n; ++i)
-    channelsSum[i] += (long double)pix[i];
+    channelsSum[i] += pix[i];
   area += 1;
 }
 
@@ -162,7 +166,7 @@ Json::Value Vertex::jsonLog() const
   root["area"] = (int)area;
   root["mean"] = Json::arrayValue;
   for (int i = 0; i < channelsNum; ++i)
-    root["mean"].append(double(channelsSum[i]) / area);
+    root["mean"].append(channelMean(i));
   return root;
 }
 